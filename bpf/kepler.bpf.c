@@ -12,22 +12,54 @@ int kepler_sched_switch_trace(u64 *ctx)
 	next_task = (struct task_struct *)ctx[2];
 
 	return do_kepler_sched_switch_trace(
-		prev_task->pid, next_task->pid, prev_task->tgid, next_task->tgid);
+		prev_task->pid, next_task->pid, prev_task->tgid, next_task->tgid,
+		prev_task, next_task);
+}
+
+SEC("tp_btf/sched_process_exit")
+int kepler_sched_process_exit_trace(u64 *ctx)
+{
+	struct task_struct *task;
+
+	task = (struct task_struct *)ctx[0];
+
+	return do_kepler_process_exit(task->pid, task->tgid, task);
+}
+
+SEC("tp_btf/sched_process_exec")
+int kepler_sched_process_exec_trace(u64 *ctx)
+{
+	u32 curr_tgid;
+
+	curr_tgid = bpf_get_current_pid_tgid() >> 32;
+	return do_kepler_process_exec(curr_tgid);
+}
+
+// Run once on attach to seed the maps with the existing tasks
+SEC("iter/task")
+int kepler_task_iter(struct bpf_iter__task *ctx)
+{
+	return do_kepler_task_iter(ctx->task);
 }
 
 SEC("tp_btf/softirq_entry")
 int kepler_irq_trace(u64 *ctx)
+{
+	unsigned int vec;
+
+	vec = (unsigned int)ctx[0];
+	return do_kepler_softirq_entry(vec);
+}
+
+SEC("tp_btf/softirq_exit")
+int kepler_softirq_exit_trace(u64 *ctx)
 {
 	u32 curr_tgid;
-	struct process_metrics_t *process_metrics;
 	unsigned int vec;
 
 	curr_tgid = bpf_get_current_pid_tgid() >> 32;
 	vec = (unsigned int)ctx[0];
-	process_metrics = bpf_map_lookup_elem(&processes, &curr_tgid);
-	if (process_metrics != 0 && vec < 10)
-		process_metrics->vec_nr[vec] += 1;
-	return 0;
+	return do_kepler_softirq_exit(curr_tgid, vec);
 }
 
 // count read page cache
@@ -52,4 +84,49 @@ int kepler_write_page_trace(void *ctx)
 	return 0;
 }
 
+// count the bytes of the block I/O requests issued
+SEC("tp/block/block_rq_issue")
+int kepler_block_rq_issue_trace(struct trace_event_raw_block_rq *ctx)
+{
+	u32 curr_tgid;
+
+	curr_tgid = bpf_get_current_pid_tgid() >> 32;
+	return do_kepler_io_bytes(
+		curr_tgid, BLOCK_IO_BYTES, BPF_CORE_READ(ctx, bytes));
+}
+
+// count the network bytes sent and received through sockets, in the context
+// of the process unlike the device tracepoints that may run in softirqs
+SEC("tp/sock/sock_send_length")
+int kepler_sock_send_trace(struct trace_event_raw_sock_msg_length *ctx)
+{
+	u32 curr_tgid;
+
+	curr_tgid = bpf_get_current_pid_tgid() >> 32;
+	return do_kepler_io_bytes(
+		curr_tgid, NET_TX_BYTES, get_sock_msg_bytes(ctx));
+}
+
+SEC("tp/sock/sock_recv_length")
+int kepler_sock_recv_trace(struct trace_event_raw_sock_msg_length *ctx)
+{
+	u32 curr_tgid;
+
+	curr_tgid = bpf_get_current_pid_tgid() >> 32;
+	return do_kepler_io_bytes(
+		curr_tgid, NET_RX_BYTES, get_sock_msg_bytes(ctx));
+}
+
+SEC("tp_btf/cpu_idle")
+int kepler_cpu_idle_trace(u64 *ctx)
+{
+	return do_kepler_cpu_idle((u32)ctx[0], (u32)ctx[1]);
+}
+
+SEC("tp_btf/cpu_frequency")
+int kepler_cpu_frequency_trace(u64 *ctx)
+{
+	return do_kepler_cpu_frequency((u32)ctx[0], (u32)ctx[1]);
+}
+
 char __license[] SEC("license") = "Dual BSD/GPL";
@@ -27,6 +27,8 @@ typedef struct pid_time_t {
 	__u32 pid;
 } pid_time_t;
 
+// Default size of the perf event arrays, userspace resizes them to the number
+// of CPUs of the host
 #ifndef NUM_CPUS
 # define NUM_CPUS 128
 #endif
@@ -35,6 +37,55 @@ typedef struct pid_time_t {
 # define MAP_SIZE 32768
 #endif
 
+// Default size of the threads map, userspace resizes it to the configured one
+#ifndef THREAD_MAP_SIZE
+# define THREAD_MAP_SIZE 4096
+#endif
+
+// Default size of the cgroup_slices map
+#ifndef SLICE_MAP_SIZE
+# define SLICE_MAP_SIZE 4096
+#endif
+
+#ifndef EXIT_RINGBUF_SIZE
+# define EXIT_RINGBUF_SIZE (256 * 1024)
+#endif
+
+// Window over which each CPU measures its context switch rate when
+// SAMPLE_TARGET > 0, and the highest sample rate it may pick
+#define SAMPLE_WINDOW_NS 100000000ULL
+#define MAX_SAMPLE_RATE 1000
+
+// Socket families counted as network traffic
+#define AF_INET 2
+#define AF_INET6 10
+
+// Number of idle states tracked per CPU, per CPUIDLE_STATE_MAX, and the
+// cpu_idle state of a CPU leaving its idle state
+#define MAX_IDLE_STATES 10
+#define PWR_EVENT_EXIT ((u32)-1)
+#define CPU_BUSY PWR_EVENT_EXIT
+
+// Number of log2 buckets of the on-CPU slice histograms: bucket i counts the
+// slices of [2^i, 2^(i+1)) us, the last one all the slices of 2^23 us or more
+#define SLICE_BUCKETS 24
+
+// Softirq vectors accounted per process, per include/linux/interrupt.h. Only
+// the contiguous NET_TX, NET_RX and BLOCK vectors are exported.
+#define NET_TX_SOFTIRQ 2
+#define BLOCK_SOFTIRQ 4
+#define NR_TRACKED_SOFTIRQS (BLOCK_SOFTIRQ - NET_TX_SOFTIRQ + 1)
+
+// Deepest cgroup level searched for the pod cgroup of a process
+#define MAX_CGROUP_LEVEL 16
+
+// Bytes of a cgroup name read to match the pod cgroups, long enough for
+// kubepods-besteffort-pod
+#define POD_CGROUP_NAME_LEN 32
+
+// task_struct flags, the task is in do_exit
+#define PF_EXITING 0x00000004
+
 #include <bpf/bpf_helpers.h>
 #include <bpf/bpf_core_read.h>
 
@@ -68,6 +119,7 @@ enum bpf_map_type {
 	BPF_MAP_TYPE_STRUCT_OPS = 26,
 	BPF_MAP_TYPE_RINGBUF = 27,
 	BPF_MAP_TYPE_INODE_STORAGE = 28,
+	BPF_MAP_TYPE_TASK_STORAGE = 29,
 };
 
 enum {
@@ -77,6 +129,15 @@ enum {
 	BPF_F_LOCK = 4,
 };
 
+enum {
+	BPF_F_NO_PREALLOC = (1U << 0),
+	BPF_F_MMAPABLE = (1U << 10),
+};
+
+enum {
+	BPF_LOCAL_STORAGE_GET_F_CREATE = (1ULL << 0),
+};
+
 enum {
 	BPF_F_INDEX_MASK = 0xffffffffULL,
 	BPF_F_CURRENT_CPU = BPF_F_INDEX_MASK,
@@ -90,24 +151,170 @@ struct bpf_perf_event_value {
 	__u64 running;
 };
 
+// The counters updated on every context switch fit in one 64-byte cache line,
+// the identity of a process is kept apart in process_info and its softirq and
+// I/O counters in process_io.
 typedef struct process_metrics_t {
-	u64 cgroup_id;
-	u64 pid; // pid is the kernel space view of the thread id
 	u64 process_run_time;
 	u64 cpu_cycles;
 	u64 cpu_instr;
 	u64 cache_miss;
 	u64 page_cache_hit;
-	u16 vec_nr[10];
-	char comm[16];
+	u32 pid; // pid is the kernel space view of the thread id
 } process_metrics_t;
 
+_Static_assert(
+	sizeof(process_metrics_t) <= 64,
+	"process_metrics_t must fit in one cache line");
+
+// Counters of a process, or of a cgroup with CGROUP_METRICS, updated outside
+// of sched_switch
+typedef struct process_io_t {
+	// softirqs of the tracked vectors run in the context of the process,
+	// indexed from NET_TX_SOFTIRQ and added from softirq_state
+	u64 softirq_time_ns[NR_TRACKED_SOFTIRQS];
+	// block I/O requests issued and network bytes sent and received by
+	// the process, only collected when their programs are attached
+	u64 block_io_bytes;
+	u64 net_tx_bytes;
+	u64 net_rx_bytes;
+	u32 vec_nr[NR_TRACKED_SOFTIRQS];
+} process_io_t;
+
+// Written once per process and read by userspace only for the pids it has not
+// seen yet
+typedef struct process_info_t {
+	u64 cgroup_id;
+	// pod cgroup of cgroup_id with POD_CGROUP_ANCESTOR, 0 outside the pods
+	u64 ancestor_cgroup_id;
+	char comm[16];
+} process_info_t;
+
+// Record of the process_exits ring buffer, the entry of an exited process
+// carries its identity as process_info is cleaned up with it
+typedef struct process_exit_t {
+	process_metrics_t metrics;
+	process_io_t io;
+	process_info_t info;
+} process_exit_t;
+
+// Userspace may load these maps as BPF_MAP_TYPE_LRU_PERCPU_HASH, the programs
+// then update the slot of the current CPU and the slots are summed on read.
+struct processes_map {
+	__uint(type, BPF_MAP_TYPE_LRU_HASH);
+	__type(key, u32);
+	__type(value, process_metrics_t);
+	__uint(max_entries, MAP_SIZE);
+} processes SEC(".maps"), processes_shadow SEC(".maps");
+
+// The programs always write through the map in slot 0. On each read userspace
+// swaps in the other processes map, which waits for the running programs to
+// finish, and then drains the previous map while no program writes to it.
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY_OF_MAPS);
+	__type(key, u32);
+	__uint(max_entries, 1);
+	__array(values, struct processes_map);
+} processes_epochs SEC(".maps") = {
+	.values = { [0] = &processes },
+};
+
+// Cumulative on-CPU metrics of a thread, kept when THREAD_METRICS is set
+typedef struct thread_metrics_t {
+	u64 process_run_time;
+	u64 cpu_cycles;
+	u64 cpu_instr;
+	u64 cache_miss;
+	u32 tgid;
+	char comm[16];
+} thread_metrics_t;
+
+// Keyed by the kernel pid, i.e. the thread id. The entries are only updated
+// by the sched_switch of their own thread, which runs on one CPU at a time,
+// and are read but not drained by userspace. The LRU bounds the overhead to
+// the hottest THREAD_MAP_SIZE threads.
 struct {
 	__uint(type, BPF_MAP_TYPE_LRU_HASH);
 	__type(key, u32);
+	__type(value, thread_metrics_t);
+	__uint(max_entries, THREAD_MAP_SIZE);
+} threads SEC(".maps");
+
+// Distribution of the on-CPU time slices of the tasks of a cgroup
+typedef struct slice_histogram_t {
+	u64 buckets[SLICE_BUCKETS];
+	u64 sum_us;
+} slice_histogram_t;
+
+// Keyed by cgroup id, kept when SLICE_HISTOGRAMS is set. The entries are
+// shared by the CPUs running the tasks of a cgroup, so they are updated
+// atomically, and are read but not drained by userspace.
+struct {
+	__uint(type, BPF_MAP_TYPE_LRU_HASH);
+	__type(key, u64);
+	__type(value, slice_histogram_t);
+	__uint(max_entries, SLICE_MAP_SIZE);
+} cgroup_slices SEC(".maps");
+
+// Per-cgroup totals used instead of processes when CGROUP_METRICS is set, the
+// pid of an entry is the first process seen in the cgroup. The entries are
+// shared by all the processes of a cgroup, so they are updated atomically.
+struct cgroups_map {
+	__uint(type, BPF_MAP_TYPE_LRU_HASH);
+	__type(key, u64);
 	__type(value, process_metrics_t);
 	__uint(max_entries, MAP_SIZE);
-} processes SEC(".maps");
+} cgroups SEC(".maps"), cgroups_shadow SEC(".maps");
+
+// Swapped by userspace on each read, like processes_epochs
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY_OF_MAPS);
+	__type(key, u32);
+	__uint(max_entries, 1);
+	__array(values, struct cgroups_map);
+} cgroups_epochs SEC(".maps") = {
+	.values = { [0] = &cgroups },
+};
+
+// Keyed by the key of the processes or cgroups entry the counters belong to,
+// i.e. by tgid or by cgroup id with CGROUP_METRICS. Entries are only added for
+// processes and cgroups that have an entry.
+struct process_io_map {
+	__uint(type, BPF_MAP_TYPE_LRU_HASH);
+	__type(key, u64);
+	__type(value, process_io_t);
+	__uint(max_entries, MAP_SIZE);
+} process_io SEC(".maps"), process_io_shadow SEC(".maps");
+
+// Swapped by userspace on each read, like processes_epochs
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY_OF_MAPS);
+	__type(key, u32);
+	__uint(max_entries, 1);
+	__array(values, struct process_io_map);
+} process_io_epochs SEC(".maps") = {
+	.values = { [0] = &process_io },
+};
+
+// Keyed by tgid, filled when a process is registered and updated on exec
+struct {
+	__uint(type, BPF_MAP_TYPE_LRU_HASH);
+	__type(key, u32);
+	__type(value, process_info_t);
+	__uint(max_entries, MAP_SIZE);
+} process_info SEC(".maps");
+
+// Final process_exit_t of exiting processes, so that short-lived processes
+// are accounted even if their processes entry would not survive until the
+// next read.
+struct {
+	__uint(type, BPF_MAP_TYPE_RINGBUF);
+	__uint(max_entries, EXIT_RINGBUF_SIZE);
+} process_exits SEC(".maps");
+
+// Only a pointer to the records is used by the programs, this keeps the type
+// in the BTF for bpf2go -type process_exit_t
+const struct process_exit_t *unused_process_exit __attribute__((unused));
 
 struct {
 	__uint(type, BPF_MAP_TYPE_LRU_HASH);
@@ -116,6 +323,16 @@ struct {
 	__uint(max_entries, MAP_SIZE);
 } pid_time_map SEC(".maps");
 
+// Task local storage alternative to pid_time_map, used when TASK_STORAGE is
+// set. The timestamp lives in the task_struct, so there is no hash churn on
+// sched_switch and no eviction when there are more than MAP_SIZE tasks.
+struct {
+	__uint(type, BPF_MAP_TYPE_TASK_STORAGE);
+	__uint(map_flags, BPF_F_NO_PREALLOC);
+	__type(key, int);
+	__type(value, u64);
+} task_time_map SEC(".maps");
+
 struct {
 	__uint(type, BPF_MAP_TYPE_PERF_EVENT_ARRAY);
 	__type(key, int);
@@ -124,63 +341,393 @@ struct {
 } cpu_cycles_event_reader SEC(".maps");
 
 struct {
-	__uint(type, BPF_MAP_TYPE_ARRAY);
-	__type(key, u32);
-	__type(value, u64);
+	__uint(type, BPF_MAP_TYPE_PERF_EVENT_ARRAY);
+	__type(key, int);
+	__type(value, u32);
 	__uint(max_entries, NUM_CPUS);
-} cpu_cycles SEC(".maps");
+} cpu_instructions_event_reader SEC(".maps");
 
 struct {
 	__uint(type, BPF_MAP_TYPE_PERF_EVENT_ARRAY);
 	__type(key, int);
 	__type(value, u32);
 	__uint(max_entries, NUM_CPUS);
-} cpu_instructions_event_reader SEC(".maps");
+} cache_miss_event_reader SEC(".maps");
+
+// Last value read from each hardware counter, to compute the delta since the
+// previous sched_switch on this CPU. To add an event, add a field here and a
+// perf event reader map, and read it in collect_metrics_and_reset_counters.
+typedef struct hw_counters_t {
+	u64 cpu_cycles;
+	u64 cpu_instr;
+	u64 cache_miss;
+	// hw setting the values were read with, the first read after the
+	// counters are (re-)enabled only records the baseline
+	u64 generation;
+} hw_counters_t;
+
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__type(key, u32);
+	__type(value, hw_counters_t);
+	__uint(max_entries, 1);
+} cpu_hw_counters SEC(".maps");
+
+// Self-overhead counters of a program, only updated when PROG_STATS is set
+typedef struct prog_stats_t {
+	u64 run_count;
+	u64 run_time_ns;
+	// failed map updates and ring buffer reservations, excluding races
+	u64 map_update_failures;
+	// processes or cgroups entries concurrently created by another CPU
+	u64 register_races;
+	// tasks switched out without an on-CPU timestamp, e.g. because it was
+	// evicted from pid_time_map
+	u64 timestamp_misses;
+} prog_stats_t;
+
+enum {
+	PROG_SCHED_SWITCH = 0,
+	PROG_SOFTIRQ = 1,
+	PROG_PAGE_CACHE_HIT = 2,
+	PROG_PROCESS_EXIT = 3,
+	PROG_IO_BYTES = 4,
+	NUM_PROGS = 5,
+};
+
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__type(key, u32);
+	__type(value, prog_stats_t);
+	__uint(max_entries, NUM_PROGS);
+} prog_stats SEC(".maps");
+
+// Settings userspace may change while the programs run, used instead of the
+// SAMPLE_RATE and HW constants when RUNTIME_CONFIG is set. hw is 0 when the
+// hardware counters are disabled and changes every time they are enabled.
+typedef struct runtime_config_t {
+	u32 sample_rate;
+	u32 hw;
+} runtime_config_t;
 
 struct {
 	__uint(type, BPF_MAP_TYPE_ARRAY);
 	__type(key, u32);
-	__type(value, u64);
-	__uint(max_entries, NUM_CPUS);
-} cpu_instructions SEC(".maps");
+	__type(value, runtime_config_t);
+	__uint(max_entries, 1);
+	__uint(map_flags, BPF_F_MMAPABLE);
+} runtime_config SEC(".maps");
 
+// Per-CPU countdown used to skip sched_switch events when SAMPLE_RATE > 0.
+// Keeping it per-CPU avoids bouncing a shared cacheline and keeps the
+// sampling ratio exact since each CPU only modifies its own slot.
 struct {
-	__uint(type, BPF_MAP_TYPE_PERF_EVENT_ARRAY);
-	__type(key, int);
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__type(key, u32);
 	__type(value, u32);
-	__uint(max_entries, NUM_CPUS);
-} cache_miss_event_reader SEC(".maps");
+	__uint(max_entries, 1);
+} counter_sched_switch SEC(".maps");
+
+// Per-CPU sampling state, next to counter_sched_switch
+typedef struct sample_state_t {
+	// start and number of context switches of the current window
+	u64 window_start;
+	u64 window_switches;
+	// sample rate picked from the previous window when SAMPLE_TARGET > 0
+	u32 sample_rate;
+	// events skipped since the last sample, the sample is scaled by
+	// skipped + 1 to account for them
+	u32 skipped;
+} sample_state_t;
+
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__type(key, u32);
+	__type(value, sample_state_t);
+	__uint(max_entries, 1);
+} sample_state SEC(".maps");
+
+// Per-CPU state of the page cache hit probe. With PAGE_CACHE_BATCH the hits
+// of the current process are counted in pending and added to its processes
+// entry when it is switched out or another process hits the page cache on
+// this CPU, saving a hash lookup per hit.
+typedef struct page_cache_state_t {
+	u32 tgid;
+	u32 pending;
+	// countdown of the hits to skip when PAGE_CACHE_SAMPLE_RATE > 0
+	u32 counter;
+} page_cache_state_t;
+
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__type(key, u32);
+	__type(value, page_cache_state_t);
+	__uint(max_entries, 1);
+} page_cache_state SEC(".maps");
+
+// Per-CPU state of the softirq probes, softirqs do not nest on a CPU. The
+// softirqs of the interrupted process are accumulated in the pending values,
+// which are added to its processes entry like the batched page cache hits.
+typedef struct softirq_state_t {
+	// entry time and vector of the running softirq, entry_ts is 0 if none
+	u64 entry_ts;
+	u32 vec;
+	u32 tgid;
+	u32 pending_nr[NR_TRACKED_SOFTIRQS];
+	u64 pending_time_ns[NR_TRACKED_SOFTIRQS];
+} softirq_state_t;
+
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__type(key, u32);
+	__type(value, softirq_state_t);
+	__uint(max_entries, 1);
+} softirq_state SEC(".maps");
+
+// Frequency and idle state residency of a CPU, updated on the power:cpu_idle
+// and power:cpu_frequency transitions. The frequency events may come from
+// another CPU of the cpufreq policy, so the map is indexed by the CPU ID of
+// the event rather than per-CPU; the rare concurrent updates are not
+// serialized.
+typedef struct cpu_power_state_t {
+	// time of the last transition, 0 until the first one
+	u64 last_ts;
+	// last frequency reported for the CPU, 0 until the first report
+	u32 freq_mhz;
+	// idle state the CPU is in, or CPU_BUSY
+	u32 idle_state;
+	u64 busy_time_ns;
+	// busy time weighted by the frequency, i.e. the number of cycles
+	u64 busy_mhz_us;
+	u64 idle_time_ns[MAX_IDLE_STATES];
+} cpu_power_state_t;
 
 struct {
 	__uint(type, BPF_MAP_TYPE_ARRAY);
 	__type(key, u32);
-	__type(value, u64);
+	__type(value, cpu_power_state_t);
 	__uint(max_entries, NUM_CPUS);
-} cache_miss SEC(".maps");
+} cpu_power_state SEC(".maps");
 
 // Test mode skips unsupported helpers
 SEC(".rodata.config")
 __attribute__((btf_decl_tag("Test"))) static volatile const int TEST = 0;
 
-// Test mode skips unsupported helpers
+// Read the hardware counters on sched_switch
 SEC(".rodata.config")
 __attribute__((btf_decl_tag(
 	"Hardware Events Enabled"))) static volatile const int HW = 1;
 
+// Target number of sampled sched_switch events per second and CPU, each CPU
+// then picks its sample rate from its context switch rate. 0 disables it and
+// uses the sample rate of SAMPLE_RATE or runtime_config.
+SEC(".rodata.config")
+__attribute__((btf_decl_tag(
+	"Sample Target"))) static volatile const int SAMPLE_TARGET = 0;
+
+// Read the sample rate and hardware counter setting from runtime_config
+SEC(".rodata.config")
+__attribute__((btf_decl_tag(
+	"Runtime Config Enabled"))) static volatile const int RUNTIME_CONFIG = 0;
+
+// Store the on-CPU timestamps in task_time_map instead of pid_time_map
+SEC(".rodata.config")
+__attribute__((btf_decl_tag(
+	"Task Storage Enabled"))) static volatile const int TASK_STORAGE = 0;
+
+// Accumulate the metrics per cgroup in cgroups instead of per process
+SEC(".rodata.config")
+__attribute__((btf_decl_tag(
+	"Cgroup Metrics Enabled"))) static volatile const int CGROUP_METRICS = 0;
+
+// Also accumulate the sched_switch metrics per thread in threads
+SEC(".rodata.config")
+__attribute__((btf_decl_tag(
+	"Thread Metrics Enabled"))) static volatile const int THREAD_METRICS = 0;
+
+// Also count the on-CPU time slices per cgroup in cgroup_slices
+SEC(".rodata.config")
+__attribute__((btf_decl_tag(
+	"Slice Histograms Enabled"))) static volatile const int SLICE_HISTOGRAMS =
+	0;
+
+// Record the pod cgroup of each entry as its ancestor, whatever the QoS class
+// of the pod
+SEC(".rodata.config")
+__attribute__((btf_decl_tag(
+	"Pod Cgroup Ancestor"))) static volatile const int POD_CGROUP_ANCESTOR =
+	0;
+
+// The softirq programs are attached, sched_switch and the exit then flush the
+// pending softirqs of the process. Without them the flush and its per-CPU
+// lookup are compiled out of the hot path.
+SEC(".rodata.config")
+__attribute__((btf_decl_tag(
+	"Softirq Metrics Enabled"))) static volatile const int SOFTIRQ_METRICS =
+	1;
+
+// Collect the self-overhead counters of the programs in prog_stats
+SEC(".rodata.config")
+__attribute__((btf_decl_tag(
+	"Program Stats Enabled"))) static volatile const int PROG_STATS = 0;
+
+// Batch the page cache hits of the current process in page_cache_state
+SEC(".rodata.config")
+__attribute__((btf_decl_tag(
+	"Page Cache Batch Enabled"))) static volatile const int PAGE_CACHE_BATCH =
+	0;
+
+// Only count one of every PAGE_CACHE_SAMPLE_RATE + 1 page cache hits, each
+// counted hit stands for the skipped ones
+SEC(".rodata.config")
+__attribute__((btf_decl_tag(
+	"Page Cache Sample Rate"))) static volatile const int
+	PAGE_CACHE_SAMPLE_RATE = 0;
+
 // The sampling rate should be disabled by default because its impact on the
 // measurements is unknown.
 SEC(".rodata.config")
 __attribute__((
 	btf_decl_tag("Sample Rate"))) static volatile const int SAMPLE_RATE = 0;
 
-int counter_sched_switch = 0;
+struct kernfs_node {
+	struct kernfs_node *__parent;
+	const char *name;
+	u64 id;
+} __attribute__((preserve_access_index));
+
+// kernfs_node before kernel 6.15
+struct kernfs_node___old {
+	struct kernfs_node *parent;
+} __attribute__((preserve_access_index));
+
+struct cgroup {
+	struct kernfs_node *kn;
+} __attribute__((preserve_access_index));
+
+struct css_set {
+	struct cgroup *dfl_cgrp;
+} __attribute__((preserve_access_index));
 
 struct task_struct {
 	int pid;
 	unsigned int tgid;
+	int on_cpu;
+	unsigned int flags;
+	char comm[16];
+	struct css_set *cgroups;
+} __attribute__((preserve_access_index));
+
+struct trace_event_raw_block_rq {
+	unsigned int bytes;
+} __attribute__((preserve_access_index));
+
+// sock:sock_send_length and sock:sock_recv_length, added in kernel 6.3
+struct trace_event_raw_sock_msg_length {
+	u16 family;
+	int ret;
+} __attribute__((preserve_access_index));
+
+struct bpf_iter_meta {
+	void *seq;
+	u64 session_id;
+	u64 seq_num;
+} __attribute__((preserve_access_index));
+
+struct bpf_iter__task {
+	struct bpf_iter_meta *meta;
+	struct task_struct *task;
 } __attribute__((preserve_access_index));
 
-static inline u64 calc_delta(u64 *prev_val, u64 val)
+// prog_stats_enter counts a run of prog and returns its stats, or 0 if
+// PROG_STATS is not set
+static __always_inline struct prog_stats_t *prog_stats_enter(u32 prog, u64 *start)
+{
+	struct prog_stats_t *stats;
+
+	if (!PROG_STATS)
+		return 0;
+
+	stats = bpf_map_lookup_elem(&prog_stats, &prog);
+	if (stats) {
+		stats->run_count++;
+		*start = bpf_ktime_get_ns();
+	}
+	return stats;
+}
+
+static __always_inline void prog_stats_exit(struct prog_stats_t *stats, u64 start)
+{
+	if (stats)
+		stats->run_time_ns += bpf_ktime_get_ns() - start;
+}
+
+static __always_inline void count_map_update_error(struct prog_stats_t *stats, long err)
+{
+	if (stats && err)
+		stats->map_update_failures++;
+}
+
+// count_register_error counts the result of a BPF_NOEXIST update
+static __always_inline void count_register_error(struct prog_stats_t *stats, long err)
+{
+	if (!stats || !err)
+		return;
+	if (err == -17) // EEXIST
+		stats->register_races++;
+	else
+		stats->map_update_failures++;
+}
+
+// get_runtime_config returns the sample rate and hardware counter setting,
+// which are constants unless RUNTIME_CONFIG is set
+static __always_inline void get_runtime_config(u32 *sample_rate, u32 *hw)
+{
+	u32 key = 0;
+	struct runtime_config_t *config;
+
+	*sample_rate = SAMPLE_RATE;
+	*hw = HW;
+	if (!RUNTIME_CONFIG)
+		return;
+
+	config = bpf_map_lookup_elem(&runtime_config, &key);
+	if (config) {
+		*sample_rate = config->sample_rate;
+		*hw = config->hw;
+	}
+}
+
+// update_adaptive_sample_rate counts a context switch in the current window
+// and, at the end of the window, picks the sample rate that brings the
+// switches of the next window down to SAMPLE_TARGET per second
+static __always_inline u32
+update_adaptive_sample_rate(struct sample_state_t *state, u64 curr_ts)
+{
+	u64 elapsed, switches_per_sec, sample_rate = 0;
+
+	state->window_switches++;
+	elapsed = curr_ts - state->window_start;
+	if (elapsed < SAMPLE_WINDOW_NS)
+		return state->sample_rate;
+
+	if (state->window_start) {
+		switches_per_sec = state->window_switches * 1000000000ULL /
+				   elapsed;
+		// one of every sample_rate + 1 events is sampled, so round
+		// switches_per_sec / (sample_rate + 1) down to SAMPLE_TARGET
+		if (switches_per_sec > SAMPLE_TARGET)
+			sample_rate = (switches_per_sec - 1) / SAMPLE_TARGET;
+		if (sample_rate > MAX_SAMPLE_RATE)
+			sample_rate = MAX_SAMPLE_RATE;
+		state->sample_rate = sample_rate;
+	}
+	state->window_start = curr_ts;
+	state->window_switches = 0;
+	return state->sample_rate;
+}
+
+static __always_inline u64 calc_delta(u64 *prev_val, u64 val)
 {
 	u64 delta = 0;
 	// Probably a clock issue where the recorded on-CPU event had a
@@ -191,175 +738,1077 @@ static inline u64 calc_delta(u64 *prev_val, u64 val)
 	return delta;
 }
 
-static inline u64 get_on_cpu_elapsed_time_us(u32 prev_pid, u64 curr_ts)
+static __always_inline u64 get_on_cpu_elapsed_time_us(
+	u32 prev_pid, struct task_struct *prev_task, u64 curr_ts,
+	struct prog_stats_t *stats)
 {
 	u64 cpu_time = 0;
 	u64 *prev_ts;
 
+	if (TASK_STORAGE) {
+		prev_ts = bpf_task_storage_get(&task_time_map, prev_task, 0, 0);
+		if (prev_ts && *prev_ts) {
+			cpu_time = calc_delta(prev_ts, curr_ts) / 1000;
+			// clear the timestamp as the pid_time_map entry would be deleted
+			*prev_ts = 0;
+		} else if (stats) {
+			stats->timestamp_misses++;
+		}
+		return cpu_time;
+	}
+
 	prev_ts = bpf_map_lookup_elem(&pid_time_map, &prev_pid);
 	if (prev_ts) {
 		cpu_time = calc_delta(prev_ts, curr_ts) / 1000;
 		bpf_map_delete_elem(&pid_time_map, &prev_pid);
+	} else if (stats) {
+		stats->timestamp_misses++;
 	}
 
 	return cpu_time;
 }
 
-static inline u64 get_on_cpu_cycles(u32 *cpu_id)
+static __always_inline void set_on_cpu_start_time(
+	u32 next_pid, struct task_struct *next_task, u64 curr_ts,
+	struct prog_stats_t *stats)
 {
-	u64 delta, val, *prev_val;
+	u64 *ts;
+	long err;
+
+	if (TASK_STORAGE) {
+		ts = bpf_task_storage_get(
+			&task_time_map, next_task, 0,
+			BPF_LOCAL_STORAGE_GET_F_CREATE);
+		if (ts)
+			*ts = curr_ts;
+		else
+			count_map_update_error(stats, -1);
+		return;
+	}
+
+	err = bpf_map_update_elem(&pid_time_map, &next_pid, &curr_ts, BPF_ANY);
+	count_map_update_error(stats, err);
+}
+
+// seed_on_cpu_start_time is set_on_cpu_start_time for a task that is already
+// running, keeping the timestamp if sched_switch recorded one in the meantime
+static __always_inline void
+seed_on_cpu_start_time(u32 pid, struct task_struct *task, u64 curr_ts)
+{
+	u64 *ts;
+
+	if (TASK_STORAGE) {
+		ts = bpf_task_storage_get(
+			&task_time_map, task, 0,
+			BPF_LOCAL_STORAGE_GET_F_CREATE);
+		if (ts && !*ts)
+			*ts = curr_ts;
+		return;
+	}
+
+	bpf_map_update_elem(&pid_time_map, &pid, &curr_ts, BPF_NOEXIST);
+}
+
+// read_on_cpu_delta reads the counter of the current CPU from event_reader and
+// returns its increase since prev_val, which is updated in place
+static __always_inline u64
+read_on_cpu_delta(void *event_reader, u32 cpu_id, u64 *prev_val)
+{
+	u64 delta;
 	long error;
 	struct bpf_perf_event_value c = {};
 
-	error = bpf_perf_event_read_value(
-		&cpu_cycles_event_reader, *cpu_id, &c, sizeof(c));
+	error = bpf_perf_event_read_value(event_reader, cpu_id, &c, sizeof(c));
 	if (error)
 		return 0;
 
-	val = c.counter;
-	prev_val = bpf_map_lookup_elem(&cpu_cycles, cpu_id);
-	delta = calc_delta(prev_val, val);
-	bpf_map_update_elem(&cpu_cycles, cpu_id, &val, BPF_ANY);
+	delta = calc_delta(prev_val, c.counter);
+	*prev_val = c.counter;
 
 	return delta;
 }
 
-static inline u64 get_on_cpu_instr(u32 *cpu_id)
+// get_processes_map returns the processes map the programs currently write to
+static __always_inline void *get_processes_map(void)
 {
-	u64 delta, val, *prev_val;
-	long error;
-	struct bpf_perf_event_value c = {};
+	u32 key = 0;
 
-	error = bpf_perf_event_read_value(
-		&cpu_instructions_event_reader, *cpu_id, &c, sizeof(c));
-	if (error)
+	return bpf_map_lookup_elem(&processes_epochs, &key);
+}
+
+// get_process_io_map returns the process_io map the programs currently write to
+static __always_inline void *get_process_io_map(void)
+{
+	u32 key = 0;
+
+	return bpf_map_lookup_elem(&process_io_epochs, &key);
+}
+
+// get_process_io returns the process_io entry of key, which is added if it is
+// missing
+static __always_inline struct process_io_t *
+get_process_io(u64 key, struct prog_stats_t *stats)
+{
+	long err;
+	void *io_map;
+	struct process_io_t *io;
+
+	io_map = get_process_io_map();
+	if (!io_map)
 		return 0;
 
-	val = c.counter;
-	prev_val = bpf_map_lookup_elem(&cpu_instructions, cpu_id);
-	delta = calc_delta(prev_val, val);
-	bpf_map_update_elem(&cpu_instructions, cpu_id, &val, BPF_ANY);
+	io = bpf_map_lookup_elem(io_map, &key);
+	if (io)
+		return io;
 
-	return delta;
+	process_io_t new_io = {};
+	err = bpf_map_update_elem(io_map, &key, &new_io, BPF_NOEXIST);
+	count_register_error(stats, err);
+	return bpf_map_lookup_elem(io_map, &key);
 }
 
-static inline u64 get_on_cpu_cache_miss(u32 *cpu_id)
+static __always_inline struct kernfs_node *get_kernfs_parent(struct kernfs_node *kn)
 {
-	u64 delta, val, *prev_val;
-	long error;
-	struct bpf_perf_event_value c = {};
+	struct kernfs_node___old *old_kn = (void *)kn;
 
-	error = bpf_perf_event_read_value(
-		&cache_miss_event_reader, *cpu_id, &c, sizeof(c));
-	if (error)
+	if (bpf_core_field_exists(old_kn->parent))
+		return BPF_CORE_READ(old_kn, parent);
+	return BPF_CORE_READ(kn, __parent);
+}
+
+static __always_inline int has_prefix(const char *name, const char *prefix,
+				      int len)
+{
+	for (int i = 0; i < len; i++) {
+		if (name[i] != prefix[i])
+			return 0;
+	}
+	return 1;
+}
+
+// is_pod_slice returns true for the pod slices of the systemd driver,
+// kubepods-pod<uid>.slice and kubepods-<qos>-pod<uid>.slice
+static __always_inline int is_pod_slice(const char *name)
+{
+	for (int i = sizeof("kubepods") - 1; i < POD_CGROUP_NAME_LEN - 4; i++) {
+		if (!name[i])
+			return 0;
+		if (has_prefix(&name[i], "-pod", 4))
+			return 1;
+	}
+	return 0;
+}
+
+// get_pod_cgroup_id walks up from the cgroup kn to the cgroup of its pod: the
+// first kubepods*-pod* slice with the systemd driver, or the pod* directory
+// below kubepods with the cgroupfs driver. The depth of the pod cgroup depends
+// on its QoS class. It returns 0 for a cgroup outside the pods.
+static __always_inline u64 get_pod_cgroup_id(struct kernfs_node *kn)
+{
+	char name[POD_CGROUP_NAME_LEN];
+	u64 pod_cgroup_id = 0;
+
+	for (int i = 0; i < MAX_CGROUP_LEVEL && kn; i++) {
+		if (bpf_probe_read_kernel_str(name, sizeof(name),
+					      BPF_CORE_READ(kn, name)) < 0)
+			return 0;
+		if (has_prefix(name, "kubepods", sizeof("kubepods") - 1)) {
+			if (!name[sizeof("kubepods") - 1])
+				return pod_cgroup_id;
+			if (is_pod_slice(name))
+				return BPF_CORE_READ(kn, id);
+			// a QoS slice, the cgroup is not in a pod slice
+			return 0;
+		}
+		if (has_prefix(name, "pod", sizeof("pod") - 1))
+			pod_cgroup_id = BPF_CORE_READ(kn, id);
+		kn = get_kernfs_parent(kn);
+	}
+	return 0;
+}
+
+// get_current_ancestor_cgroup_id returns the pod cgroup of the current task, or
+// 0 if it is disabled or the task is not in a pod
+static __always_inline u64 get_current_ancestor_cgroup_id(void)
+{
+	struct task_struct *task;
+
+	if (!POD_CGROUP_ANCESTOR)
 		return 0;
-	val = c.counter;
-	prev_val = bpf_map_lookup_elem(&cache_miss, cpu_id);
-	delta = calc_delta(prev_val, val);
-	bpf_map_update_elem(&cache_miss, cpu_id, &val, BPF_ANY);
 
-	return delta;
+	task = (struct task_struct *)bpf_get_current_task();
+	return get_pod_cgroup_id(BPF_CORE_READ(task, cgroups, dfl_cgrp, kn));
+}
+
+static __always_inline void
+fill_current_process_info(struct process_info_t *info)
+{
+	info->cgroup_id = bpf_get_current_cgroup_id();
+	info->ancestor_cgroup_id = get_current_ancestor_cgroup_id();
+	if (!TEST)
+		bpf_get_current_comm(&info->comm, sizeof(info->comm));
 }
 
-static inline void register_new_process_if_not_exist(u32 tgid)
+// register_process_info records the identity of the current process if it is
+// not known yet
+static __always_inline void
+register_process_info(u32 tgid, struct prog_stats_t *stats)
 {
+	long err;
+
+	if (bpf_map_lookup_elem(&process_info, &tgid))
+		return;
+
+	process_info_t new_info = {};
+	fill_current_process_info(&new_info);
+	err = bpf_map_update_elem(&process_info, &tgid, &new_info, BPF_NOEXIST);
+	// another CPU registering the same process is not an error here
+	if (err != -17) // EEXIST
+		count_map_update_error(stats, err);
+}
+
+// get_cgroup_metrics returns the entry of the current cgroup, tgid is recorded
+// as the pid of a new entry
+static __always_inline struct process_metrics_t *
+get_cgroup_metrics(u32 tgid, struct prog_stats_t *stats)
+{
+	long err;
+	u32 key = 0;
 	u64 cgroup_id;
+	void *cgroups_map;
+	struct process_metrics_t *cgroup_metrics;
+
+	cgroups_map = bpf_map_lookup_elem(&cgroups_epochs, &key);
+	if (!cgroups_map)
+		return 0;
+
+	cgroup_id = bpf_get_current_cgroup_id();
+	cgroup_metrics = bpf_map_lookup_elem(cgroups_map, &cgroup_id);
+	if (cgroup_metrics)
+		return cgroup_metrics;
+
+	// userspace takes the cgroup from the key and the rest of the identity
+	// from the process_info of pid
+	process_metrics_t new_cgroup = {
+		.pid = tgid,
+	};
+
+	err = bpf_map_update_elem(
+		cgroups_map, &cgroup_id, &new_cgroup, BPF_NOEXIST);
+	count_register_error(stats, err);
+	register_process_info(tgid, stats);
+	return bpf_map_lookup_elem(cgroups_map, &cgroup_id);
+}
+
+static __always_inline void register_new_process_if_not_exist(
+	void *processes_map, u32 tgid, struct prog_stats_t *stats)
+{
+	long err;
 	struct process_metrics_t *curr_tgid_metrics;
 
 	// create new process metrics
-	curr_tgid_metrics = bpf_map_lookup_elem(&processes, &tgid);
+	curr_tgid_metrics = bpf_map_lookup_elem(processes_map, &tgid);
 	if (!curr_tgid_metrics) {
-		cgroup_id = bpf_get_current_cgroup_id();
 		// the Kernel tgid is the user-space PID, and the Kernel pid is the
 		// user-space TID
 		process_metrics_t new_process = {
 			.pid = tgid,
-			.cgroup_id = cgroup_id,
+		};
+
+		err = bpf_map_update_elem(
+			processes_map, &tgid, &new_process, BPF_NOEXIST);
+		count_register_error(stats, err);
+		register_process_info(tgid, stats);
+	}
+}
+
+static __always_inline void collect_metrics_and_reset_counters(
+	struct process_metrics_t *buf, u32 prev_pid,
+	struct task_struct *prev_task, u64 curr_ts, u32 cpu_id, u32 hw,
+	struct prog_stats_t *stats)
+{
+	if (hw) {
+		u32 key = 0;
+		struct hw_counters_t *prev =
+			bpf_map_lookup_elem(&cpu_hw_counters, &key);
+
+		if (prev) {
+			if (prev->generation != hw) {
+				// calc_delta returns 0 until the values are read
+				prev->cpu_cycles = ~0ULL;
+				prev->cpu_instr = ~0ULL;
+				prev->cache_miss = ~0ULL;
+				prev->generation = hw;
+			}
+			buf->cpu_cycles = read_on_cpu_delta(
+				&cpu_cycles_event_reader, cpu_id,
+				&prev->cpu_cycles);
+			buf->cpu_instr = read_on_cpu_delta(
+				&cpu_instructions_event_reader, cpu_id,
+				&prev->cpu_instr);
+			buf->cache_miss = read_on_cpu_delta(
+				&cache_miss_event_reader, cpu_id,
+				&prev->cache_miss);
+		}
+	}
+	// Get current time to calculate the previous task on-CPU time
+	buf->process_run_time =
+		get_on_cpu_elapsed_time_us(prev_pid, prev_task, curr_ts, stats);
+}
+
+// add_thread_metrics adds the metrics of the time slice of the previous thread
+// to its threads entry, sched_switch runs in the context of that thread
+static __always_inline void add_thread_metrics(
+	u32 prev_pid, u32 prev_tgid, struct process_metrics_t *buf,
+	struct prog_stats_t *stats)
+{
+	long err;
+	struct thread_metrics_t *thread_metrics;
+
+	thread_metrics = bpf_map_lookup_elem(&threads, &prev_pid);
+	if (!thread_metrics) {
+		thread_metrics_t new_thread = {
+			.tgid = prev_tgid,
 		};
 
 		if (!TEST)
 			bpf_get_current_comm(
-				&new_process.comm, sizeof(new_process.comm));
-
-		bpf_map_update_elem(&processes, &tgid, &new_process, BPF_NOEXIST);
+				&new_thread.comm, sizeof(new_thread.comm));
+		err = bpf_map_update_elem(
+			&threads, &prev_pid, &new_thread, BPF_NOEXIST);
+		if (err != -17) // EEXIST
+			count_map_update_error(stats, err);
+		thread_metrics = bpf_map_lookup_elem(&threads, &prev_pid);
+		if (!thread_metrics)
+			return;
 	}
+	thread_metrics->process_run_time += buf->process_run_time;
+	thread_metrics->cpu_cycles += buf->cpu_cycles;
+	thread_metrics->cpu_instr += buf->cpu_instr;
+	thread_metrics->cache_miss += buf->cache_miss;
+}
+
+// log2l returns the index of the highest bit set in v, which must not be 0
+static __always_inline u32 log2l(u64 v)
+{
+	u32 r = 0, shift;
+
+	shift = (v > 0xFFFFFFFFULL) << 5;
+	v >>= shift;
+	r |= shift;
+	shift = (v > 0xFFFF) << 4;
+	v >>= shift;
+	r |= shift;
+	shift = (v > 0xFF) << 3;
+	v >>= shift;
+	r |= shift;
+	shift = (v > 0xF) << 2;
+	v >>= shift;
+	r |= shift;
+	shift = (v > 0x3) << 1;
+	v >>= shift;
+	r |= shift;
+	r |= (v >> 1);
+	return r;
 }
 
-static inline void collect_metrics_and_reset_counters(
-	struct process_metrics_t *buf, u32 prev_pid, u64 curr_ts, u32 cpu_id)
+// add_slice_histogram counts the time slice of the previous task in the
+// histogram of its cgroup, sched_switch runs in the context of that task. A
+// sampled slice stands for scale slices.
+static __always_inline void
+add_slice_histogram(u64 slice_us, u32 scale, struct prog_stats_t *stats)
 {
-	if (HW) {
-		buf->cpu_cycles = get_on_cpu_cycles(&cpu_id);
-		buf->cpu_instr = get_on_cpu_instr(&cpu_id);
-		buf->cache_miss = get_on_cpu_cache_miss(&cpu_id);
+	long err;
+	u32 bucket;
+	u64 cgroup_id = bpf_get_current_cgroup_id();
+	struct slice_histogram_t *histogram;
+
+	histogram = bpf_map_lookup_elem(&cgroup_slices, &cgroup_id);
+	if (!histogram) {
+		slice_histogram_t new_histogram = {};
+
+		err = bpf_map_update_elem(
+			&cgroup_slices, &cgroup_id, &new_histogram, BPF_NOEXIST);
+		if (err != -17) // EEXIST
+			count_map_update_error(stats, err);
+		histogram = bpf_map_lookup_elem(&cgroup_slices, &cgroup_id);
+		if (!histogram)
+			return;
 	}
-	// Get current time to calculate the previous task on-CPU time
-	buf->process_run_time = get_on_cpu_elapsed_time_us(prev_pid, curr_ts);
+	bucket = log2l(slice_us);
+	if (bucket >= SLICE_BUCKETS)
+		bucket = SLICE_BUCKETS - 1;
+	__sync_fetch_and_add(&histogram->buckets[bucket], scale);
+	__sync_fetch_and_add(&histogram->sum_us, slice_us * scale);
 }
 
-static inline void do_page_cache_hit_increment(u32 curr_pid)
+static __always_inline struct page_cache_state_t *get_page_cache_state(void)
+{
+	u32 key = 0;
+
+	return bpf_map_lookup_elem(&page_cache_state, &key);
+}
+
+// take_page_cache_pending returns the batched page cache hits of tgid on this
+// CPU and clears them
+static __always_inline u32 take_page_cache_pending(u32 tgid)
+{
+	struct page_cache_state_t *state;
+	u32 pending;
+
+	if (!PAGE_CACHE_BATCH)
+		return 0;
+
+	state = get_page_cache_state();
+	if (!state || state->tgid != tgid)
+		return 0;
+
+	pending = state->pending;
+	state->pending = 0;
+	return pending;
+}
+
+static __always_inline void add_page_cache_hits(u32 tgid, u32 hits)
 {
 	struct process_metrics_t *process_metrics;
+	void *processes_map;
+
+	processes_map = get_processes_map();
+	if (!processes_map)
+		return;
 
-	process_metrics = bpf_map_lookup_elem(&processes, &curr_pid);
+	process_metrics = bpf_map_lookup_elem(processes_map, &tgid);
 	if (process_metrics)
-		process_metrics->page_cache_hit++;
+		process_metrics->page_cache_hit += hits;
+}
+
+enum io_bytes_counter {
+	BLOCK_IO_BYTES,
+	NET_TX_BYTES,
+	NET_RX_BYTES,
+};
+
+// add_io_bytes adds bytes to a counter of the current process
+static __always_inline void add_io_bytes(
+	u32 curr_tgid, enum io_bytes_counter counter, u64 bytes,
+	struct prog_stats_t *stats)
+{
+	struct process_io_t *io;
+	void *processes_map;
+	u64 key = curr_tgid;
+
+	if (CGROUP_METRICS) {
+		if (!get_cgroup_metrics(curr_tgid, stats))
+			return;
+		key = bpf_get_current_cgroup_id();
+	} else {
+		processes_map = get_processes_map();
+		if (!processes_map ||
+		    !bpf_map_lookup_elem(processes_map, &curr_tgid))
+			return;
+	}
+	io = get_process_io(key, stats);
+	if (!io)
+		return;
+
+	switch (counter) {
+	case BLOCK_IO_BYTES:
+		__sync_fetch_and_add(&io->block_io_bytes, bytes);
+		break;
+	case NET_TX_BYTES:
+		__sync_fetch_and_add(&io->net_tx_bytes, bytes);
+		break;
+	case NET_RX_BYTES:
+		__sync_fetch_and_add(&io->net_rx_bytes, bytes);
+		break;
+	}
+}
+
+static __always_inline int do_kepler_io_bytes(
+	u32 curr_tgid, enum io_bytes_counter counter, u64 bytes)
+{
+	u64 start = 0;
+	struct prog_stats_t *stats = prog_stats_enter(PROG_IO_BYTES, &start);
+
+	if (bytes > 0)
+		add_io_bytes(curr_tgid, counter, bytes, stats);
+	prog_stats_exit(stats, start);
+	return 0;
+}
+
+// get_sock_msg_bytes returns the bytes of an IPv4 or IPv6 socket message, or
+// 0 for the other socket families and failed calls
+static __always_inline u64 get_sock_msg_bytes(struct trace_event_raw_sock_msg_length *ctx)
+{
+	u16 family;
+	int ret;
+
+	if (!bpf_core_type_exists(struct trace_event_raw_sock_msg_length))
+		return 0;
+
+	family = BPF_CORE_READ(ctx, family);
+	ret = BPF_CORE_READ(ctx, ret);
+	if ((family != AF_INET && family != AF_INET6) || ret <= 0)
+		return 0;
+	return ret;
+}
+
+static __always_inline struct softirq_state_t *get_softirq_state(void)
+{
+	u32 key = 0;
+
+	return bpf_map_lookup_elem(&softirq_state, &key);
+}
+
+// has_softirq_pending returns whether state holds softirqs of its tgid
+static __always_inline int has_softirq_pending(struct softirq_state_t *state)
+{
+	for (int i = 0; i < NR_TRACKED_SOFTIRQS; i++) {
+		if (state->pending_nr[i])
+			return 1;
+	}
+	return 0;
+}
+
+// move_softirq_pending adds the pending softirqs of state to io, they are
+// dropped if io is NULL
+static __always_inline void
+move_softirq_pending(struct softirq_state_t *state, struct process_io_t *io)
+{
+	for (int i = 0; i < NR_TRACKED_SOFTIRQS; i++) {
+		if (!state->pending_nr[i])
+			continue;
+		if (io) {
+			io->vec_nr[i] += state->pending_nr[i];
+			io->softirq_time_ns[i] += state->pending_time_ns[i];
+		}
+		state->pending_nr[i] = 0;
+		state->pending_time_ns[i] = 0;
+	}
+}
+
+// flush_softirq_pending adds the pending softirqs of tgid on this CPU to its
+// process_io entry
+static __always_inline void
+flush_softirq_pending(u32 tgid, struct prog_stats_t *stats)
+{
+	struct softirq_state_t *state;
+
+	if (CGROUP_METRICS || !SOFTIRQ_METRICS)
+		return;
+
+	state = get_softirq_state();
+	if (state && state->tgid == tgid && has_softirq_pending(state))
+		move_softirq_pending(state, get_process_io(tgid, stats));
+}
+
+// task_exiting returns whether the task is in do_exit, its process may already
+// be removed by kepler_process_exit
+static __always_inline int task_exiting(struct task_struct *task)
+{
+	return task && (task->flags & PF_EXITING);
+}
+
+// add_exit_slice adds the last time slice of the exiting task, which is still
+// on-CPU, to the metrics of its process, as its last sched_switch does not find
+// the process anymore
+static __always_inline void add_exit_slice(
+	struct process_metrics_t *process_metrics, u32 pid, u32 tgid,
+	struct task_struct *task, struct prog_stats_t *stats)
+{
+	u32 sample_rate, hw, scale = 1;
+	struct process_metrics_t buf = {};
+
+	get_runtime_config(&sample_rate, &hw);
+	if (SAMPLE_TARGET > 0 || sample_rate > 0) {
+		u32 key = 0;
+		struct sample_state_t *state =
+			bpf_map_lookup_elem(&sample_state, &key);
+
+		// the task only has an on-CPU timestamp if the next sched_switch
+		// is sampled, the slice then stands for the skipped ones
+		if (state)
+			scale += state->skipped;
+	}
+
+	collect_metrics_and_reset_counters(
+		&buf, pid, task, bpf_ktime_get_ns(), bpf_get_smp_processor_id(),
+		hw, stats);
+	if (!buf.process_run_time)
+		return;
+	if (SLICE_HISTOGRAMS)
+		add_slice_histogram(buf.process_run_time, scale, stats);
+	if (scale > 1) {
+		buf.process_run_time *= scale;
+		buf.cpu_cycles *= scale;
+		buf.cpu_instr *= scale;
+		buf.cache_miss *= scale;
+	}
+	if (THREAD_METRICS)
+		add_thread_metrics(pid, tgid, &buf, stats);
+	process_metrics->process_run_time += buf.process_run_time;
+	process_metrics->cpu_cycles += buf.cpu_cycles;
+	process_metrics->cpu_instr += buf.cpu_instr;
+	process_metrics->cache_miss += buf.cache_miss;
+}
+
+static __always_inline void kepler_process_exit(
+	u32 pid, u32 tgid, struct task_struct *task, struct prog_stats_t *stats)
+{
+	struct process_metrics_t *process_metrics;
+	struct process_info_t *info;
+	struct process_exit_t *record;
+	struct process_io_t *io = 0;
+	void *processes_map, *io_map;
+	u64 io_key = tgid;
+
+	// only the exit of the thread group leader ends the process
+	if (pid != tgid)
+		return;
+
+	processes_map = get_processes_map();
+	if (!processes_map)
+		return;
+
+	process_metrics = bpf_map_lookup_elem(processes_map, &tgid);
+	if (!process_metrics)
+		return;
+
+	// if the ring buffer is full the entry stays in processes and is read
+	// with the other processes, and its process_info is left to the LRU
+	record = bpf_ringbuf_reserve(&process_exits, sizeof(*record), 0);
+	if (!record) {
+		count_map_update_error(stats, -1);
+		return;
+	}
+
+	add_exit_slice(process_metrics, pid, tgid, task, stats);
+	process_metrics->page_cache_hit += take_page_cache_pending(tgid);
+	flush_softirq_pending(tgid, stats);
+	__builtin_memcpy(&record->metrics, process_metrics, sizeof(record->metrics));
+	io_map = get_process_io_map();
+	if (io_map)
+		io = bpf_map_lookup_elem(io_map, &io_key);
+	if (io)
+		__builtin_memcpy(&record->io, io, sizeof(record->io));
+	else
+		__builtin_memset(&record->io, 0, sizeof(record->io));
+	info = bpf_map_lookup_elem(&process_info, &tgid);
+	if (info)
+		__builtin_memcpy(&record->info, info, sizeof(record->info));
+	else
+		__builtin_memset(&record->info, 0, sizeof(record->info));
+	bpf_ringbuf_submit(record, 0);
+	bpf_map_delete_elem(processes_map, &tgid);
+	if (io)
+		bpf_map_delete_elem(io_map, &io_key);
+	bpf_map_delete_elem(&process_info, &tgid);
+}
+
+static __always_inline int
+do_kepler_process_exit(u32 pid, u32 tgid, struct task_struct *task)
+{
+	u64 start = 0;
+	struct prog_stats_t *stats =
+		prog_stats_enter(PROG_PROCESS_EXIT, &start);
+
+	kepler_process_exit(pid, tgid, task, stats);
+	prog_stats_exit(stats, start);
+	return 0;
+}
+
+// do_kepler_process_exec refreshes the identity of a process when it execs a
+// new program, as it was registered with the comm of its parent if it ran
+// before the exec
+static __always_inline int do_kepler_process_exec(u32 tgid)
+{
+	process_info_t info = {};
+
+	fill_current_process_info(&info);
+	bpf_map_update_elem(&process_info, &tgid, &info, BPF_ANY);
+	return 0;
+}
+
+// account_cpu_power_state adds the time since the last transition to the
+// busy or idle residency of the CPU
+static __always_inline void
+account_cpu_power_state(struct cpu_power_state_t *state, u64 curr_ts)
+{
+	u64 delta;
+
+	if (state->last_ts && curr_ts > state->last_ts) {
+		delta = curr_ts - state->last_ts;
+		if (state->idle_state == CPU_BUSY) {
+			state->busy_time_ns += delta;
+			state->busy_mhz_us += state->freq_mhz * (delta / 1000);
+		} else if (state->idle_state < MAX_IDLE_STATES) {
+			state->idle_time_ns[state->idle_state] += delta;
+		}
+	}
+	state->last_ts = curr_ts;
+}
+
+// do_kepler_cpu_idle records a CPU entering idle state idle_state, or leaving
+// it if idle_state is PWR_EVENT_EXIT
+static __always_inline int do_kepler_cpu_idle(u32 idle_state, u32 cpu_id)
+{
+	struct cpu_power_state_t *state;
+
+	state = bpf_map_lookup_elem(&cpu_power_state, &cpu_id);
+	if (!state)
+		return 0;
+
+	account_cpu_power_state(state, bpf_ktime_get_ns());
+	state->idle_state = idle_state;
+	return 0;
 }
 
-static inline int do_kepler_sched_switch_trace(
-	u32 prev_pid, u32 next_pid, u32 prev_tgid, u32 next_tgid)
+static __always_inline int do_kepler_cpu_frequency(u32 freq_khz, u32 cpu_id)
 {
-	u32 cpu_id;
+	struct cpu_power_state_t *state;
+
+	state = bpf_map_lookup_elem(&cpu_power_state, &cpu_id);
+	if (!state)
+		return 0;
+
+	// the residency is only known from the first idle event
+	if (state->last_ts)
+		account_cpu_power_state(state, bpf_ktime_get_ns());
+	state->freq_mhz = freq_khz / 1000;
+	return 0;
+}
+
+// fill_task_process_info is fill_current_process_info for another task, the
+// cgroup IDs are those of the default hierarchy like
+// bpf_get_current_cgroup_id
+static __always_inline void
+fill_task_process_info(struct task_struct *task, struct process_info_t *info)
+{
+	struct kernfs_node *kn;
+
+	kn = BPF_CORE_READ(task, cgroups, dfl_cgrp, kn);
+	info->cgroup_id = BPF_CORE_READ(kn, id);
+	if (POD_CGROUP_ANCESTOR)
+		info->ancestor_cgroup_id = get_pod_cgroup_id(kn);
+	bpf_probe_read_kernel_str(&info->comm, sizeof(info->comm), task->comm);
+}
+
+// do_kepler_task_iter seeds the maps for a task that existed before the programs
+// were attached: the processes and process_info entries of its process and,
+// if it is running, its on-CPU start time, which sched_switch would otherwise
+// only record after the task is switched out and in again
+static __always_inline int do_kepler_task_iter(struct task_struct *task)
+{
+	u32 pid, tgid;
+	void *processes_map;
+
+	if (!task)
+		return 0;
+
+	pid = task->pid;
+	tgid = task->tgid;
+	if (task->on_cpu)
+		seed_on_cpu_start_time(pid, task, bpf_ktime_get_ns());
+
+	// the entries of the process are seeded once, from its leader
+	if (pid != tgid)
+		return 0;
+
+	if (!bpf_map_lookup_elem(&process_info, &tgid)) {
+		process_info_t info = {};
+
+		fill_task_process_info(task, &info);
+		bpf_map_update_elem(&process_info, &tgid, &info, BPF_NOEXIST);
+	}
+
+	// the cgroups entries are created by the first event of the cgroup
+	if (CGROUP_METRICS)
+		return 0;
+
+	processes_map = get_processes_map();
+	if (processes_map && !bpf_map_lookup_elem(processes_map, &tgid)) {
+		process_metrics_t new_process = {
+			.pid = tgid,
+		};
+
+		bpf_map_update_elem(
+			processes_map, &tgid, &new_process, BPF_NOEXIST);
+	}
+	return 0;
+}
+
+static __always_inline void
+page_cache_hit_increment(u32 curr_pid, struct prog_stats_t *stats)
+{
+	struct process_metrics_t *process_metrics;
+	struct page_cache_state_t *state = 0;
+	u32 hits = 1;
+
+	if (PAGE_CACHE_BATCH || PAGE_CACHE_SAMPLE_RATE > 0) {
+		state = get_page_cache_state();
+		if (!state)
+			return;
+	}
+
+	if (PAGE_CACHE_SAMPLE_RATE > 0) {
+		if (state->counter > 0) {
+			state->counter--;
+			return;
+		}
+		state->counter = PAGE_CACHE_SAMPLE_RATE;
+		hits += PAGE_CACHE_SAMPLE_RATE;
+	}
+
+	if (CGROUP_METRICS) {
+		process_metrics = get_cgroup_metrics(curr_pid, stats);
+		if (process_metrics)
+			__sync_fetch_and_add(
+				&process_metrics->page_cache_hit, hits);
+		return;
+	}
+
+	if (PAGE_CACHE_BATCH) {
+		if (state->tgid != curr_pid) {
+			// the previous process was not flushed by sched_switch,
+			// e.g. because the event was skipped
+			if (state->pending > 0)
+				add_page_cache_hits(state->tgid, state->pending);
+			state->tgid = curr_pid;
+			state->pending = 0;
+		}
+		state->pending += hits;
+		return;
+	}
+
+	add_page_cache_hits(curr_pid, hits);
+}
+
+static __always_inline void do_page_cache_hit_increment(u32 curr_pid)
+{
+	u64 start = 0;
+	struct prog_stats_t *stats =
+		prog_stats_enter(PROG_PAGE_CACHE_HIT, &start);
+
+	page_cache_hit_increment(curr_pid, stats);
+	prog_stats_exit(stats, start);
+}
+
+static __always_inline void softirq_entry(unsigned int vec)
+{
+	struct softirq_state_t *state = get_softirq_state();
+
+	if (state) {
+		state->entry_ts = bpf_ktime_get_ns();
+		state->vec = vec;
+	}
+}
+
+// softirq_exit accounts the softirq to the interrupted process, which is only
+// looked up if it is not the one of the previous softirq on this CPU
+static __always_inline void
+softirq_exit(u32 curr_tgid, unsigned int vec, struct prog_stats_t *stats)
+{
+	struct softirq_state_t *state;
+	struct process_io_t *io = 0;
+	void *processes_map;
+	u64 delta, slot;
+
+	state = get_softirq_state();
+	// the softirq started before the programs were attached
+	if (!state || !state->entry_ts || state->vec != vec)
+		return;
+
+	delta = calc_delta(&state->entry_ts, bpf_ktime_get_ns());
+	state->entry_ts = 0;
+	// the other vectors wrap around to large slots
+	slot = (u64)vec - NET_TX_SOFTIRQ;
+	if (slot >= NR_TRACKED_SOFTIRQS)
+		return;
+
+	if (CGROUP_METRICS) {
+		if (!get_cgroup_metrics(curr_tgid, stats))
+			return;
+		io = get_process_io(bpf_get_current_cgroup_id(), stats);
+		if (io) {
+			__sync_fetch_and_add(&io->vec_nr[slot], 1);
+			__sync_fetch_and_add(&io->softirq_time_ns[slot], delta);
+		}
+		return;
+	}
+
+	if (state->tgid != curr_tgid) {
+		// the previous process was not flushed by sched_switch
+		if (has_softirq_pending(state)) {
+			processes_map = get_processes_map();
+			if (!processes_map)
+				return;
+			if (bpf_map_lookup_elem(processes_map, &state->tgid))
+				io = get_process_io(state->tgid, stats);
+			move_softirq_pending(state, io);
+		}
+		state->tgid = curr_tgid;
+	}
+	state->pending_nr[slot]++;
+	state->pending_time_ns[slot] += delta;
+}
+
+static __always_inline int do_kepler_softirq_entry(unsigned int vec)
+{
+	u64 start = 0;
+	struct prog_stats_t *stats = prog_stats_enter(PROG_SOFTIRQ, &start);
+
+	softirq_entry(vec);
+	prog_stats_exit(stats, start);
+	return 0;
+}
+
+static __always_inline int do_kepler_softirq_exit(u32 curr_tgid, unsigned int vec)
+{
+	u64 start = 0;
+	struct prog_stats_t *stats = prog_stats_enter(PROG_SOFTIRQ, &start);
+
+	softirq_exit(curr_tgid, vec, stats);
+	prog_stats_exit(stats, start);
+	return 0;
+}
+
+static __always_inline void kepler_sched_switch(
+	u32 prev_pid, u32 next_pid, u32 prev_tgid, u32 next_tgid,
+	struct task_struct *prev_task, struct task_struct *next_task,
+	struct prog_stats_t *stats)
+{
+	u32 cpu_id, sample_rate, hw, scale = 1;
 	u64 curr_ts = bpf_ktime_get_ns();
 
 	struct process_metrics_t *curr_tgid_metrics, *prev_tgid_metrics;
 	struct process_metrics_t buf = {};
+	void *processes_map;
 
 	cpu_id = bpf_get_smp_processor_id();
+	get_runtime_config(&sample_rate, &hw);
+
+	processes_map = get_processes_map();
+	if (!processes_map)
+		return;
 
 	// Skip some samples to minimize overhead
-	if (SAMPLE_RATE > 0) {
-		if (counter_sched_switch > 0) {
+	if (SAMPLE_TARGET > 0 || sample_rate > 0) {
+		u32 key = 0;
+		u32 *counter = bpf_map_lookup_elem(&counter_sched_switch, &key);
+		struct sample_state_t *state =
+			bpf_map_lookup_elem(&sample_state, &key);
+
+		if (!counter || !state)
+			return;
+		if (SAMPLE_TARGET > 0)
+			sample_rate = update_adaptive_sample_rate(state, curr_ts);
+		// the sample rate was lowered since the countdown started
+		if (*counter > sample_rate)
+			*counter = sample_rate;
+		if (*counter > 0) {
 			// update hardware counters to be used when sample is taken
-			if (counter_sched_switch == 1) {
+			if (*counter == 1) {
 				collect_metrics_and_reset_counters(
-					&buf, prev_pid, curr_ts, cpu_id);
+					&buf, prev_pid, prev_task, curr_ts,
+					cpu_id, hw, stats);
 				// Add task on-cpu running start time
-				bpf_map_update_elem(
-					&pid_time_map, &next_pid, &curr_ts,
-					BPF_ANY);
-				// create new process metrics
-				register_new_process_if_not_exist(next_tgid);
+				set_on_cpu_start_time(
+					next_pid, next_task, curr_ts, stats);
+				// create new process metrics, unless the process
+				// already exited
+				if (!CGROUP_METRICS && !task_exiting(next_task))
+					register_new_process_if_not_exist(
+						processes_map, next_tgid,
+						stats);
 			}
-			counter_sched_switch--;
-			return 0;
+			(*counter)--;
+			state->skipped++;
+			return;
 		}
-		counter_sched_switch = SAMPLE_RATE;
+		*counter = sample_rate;
+		scale += state->skipped;
+		state->skipped = 0;
 	}
 
-	collect_metrics_and_reset_counters(&buf, prev_pid, curr_ts, cpu_id);
+	collect_metrics_and_reset_counters(
+		&buf, prev_pid, prev_task, curr_ts, cpu_id, hw, stats);
+	if (SLICE_HISTOGRAMS && buf.process_run_time > 0)
+		add_slice_histogram(buf.process_run_time, scale, stats);
+	// the sampled time slice stands for the skipped ones
+	if (scale > 1) {
+		buf.process_run_time *= scale;
+		buf.cpu_cycles *= scale;
+		buf.cpu_instr *= scale;
+		buf.cache_miss *= scale;
+	}
+
+	if (THREAD_METRICS && buf.process_run_time > 0)
+		add_thread_metrics(prev_pid, prev_tgid, &buf, stats);
+
+	if (CGROUP_METRICS) {
+		// sched_switch runs in the context of the previous task, so the
+		// current cgroup is the one of prev_tgid
+		if (buf.process_run_time > 0) {
+			prev_tgid_metrics = get_cgroup_metrics(prev_tgid, stats);
+			if (prev_tgid_metrics) {
+				__sync_fetch_and_add(
+					&prev_tgid_metrics->process_run_time,
+					buf.process_run_time);
+				__sync_fetch_and_add(
+					&prev_tgid_metrics->cpu_cycles,
+					buf.cpu_cycles);
+				__sync_fetch_and_add(
+					&prev_tgid_metrics->cpu_instr,
+					buf.cpu_instr);
+				__sync_fetch_and_add(
+					&prev_tgid_metrics->cache_miss,
+					buf.cache_miss);
+			}
+		}
+		curr_ts = bpf_ktime_get_ns();
+		set_on_cpu_start_time(next_pid, next_task, curr_ts, stats);
+		return;
+	}
 
 	// The process_run_time is 0 if we do not have the previous timestamp of
 	// the task or due to a clock issue. In either case, we skip collecting
 	// all metrics to avoid discrepancies between the hardware counter and CPU
 	// time.
 	if (buf.process_run_time > 0) {
-		prev_tgid_metrics = bpf_map_lookup_elem(&processes, &prev_tgid);
+		prev_tgid_metrics =
+			bpf_map_lookup_elem(processes_map, &prev_tgid);
 		if (prev_tgid_metrics) {
 			prev_tgid_metrics->process_run_time += buf.process_run_time;
 			prev_tgid_metrics->cpu_cycles += buf.cpu_cycles;
 			prev_tgid_metrics->cpu_instr += buf.cpu_instr;
 			prev_tgid_metrics->cache_miss += buf.cache_miss;
+			prev_tgid_metrics->page_cache_hit +=
+				take_page_cache_pending(prev_tgid);
+			flush_softirq_pending(prev_tgid, stats);
 		}
 	}
 
-	// create new process metrics
-	register_new_process_if_not_exist(prev_tgid);
+	// create new process metrics, unless this is the last switch of an exiting
+	// task whose process was already removed
+	if (!task_exiting(prev_task))
+		register_new_process_if_not_exist(processes_map, prev_tgid, stats);
 
 	// Add task on-cpu running start time
 	curr_ts = bpf_ktime_get_ns();
-	bpf_map_update_elem(&pid_time_map, &next_pid, &curr_ts, BPF_ANY);
+	set_on_cpu_start_time(next_pid, next_task, curr_ts, stats);
+}
+
+static __always_inline int do_kepler_sched_switch_trace(
+	u32 prev_pid, u32 next_pid, u32 prev_tgid, u32 next_tgid,
+	struct task_struct *prev_task, struct task_struct *next_task)
+{
+	u64 start = 0;
+	struct prog_stats_t *stats = prog_stats_enter(PROG_SCHED_SWITCH, &start);
 
+	kepler_sched_switch(
+		prev_pid, next_pid, prev_tgid, next_tgid, prev_task, next_task,
+		stats);
+	prog_stats_exit(stats, start);
 	return 0;
 }
 
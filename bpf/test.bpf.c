@@ -13,15 +13,126 @@ int test_kepler_write_page_trace(void *ctx)
 SEC("raw_tp")
 int test_register_new_process_if_not_exist(void *ctx)
 {
-	register_new_process_if_not_exist(42);
+	void *processes_map = get_processes_map();
+
+	if (processes_map)
+		register_new_process_if_not_exist(processes_map, 42, 0);
 	return 0;
 }
 
 SEC("raw_tp/sched_switch")
 int test_kepler_sched_switch_trace(u64 *ctx)
 {
-	do_kepler_sched_switch_trace(42, 43, 42, 43);
+	do_kepler_sched_switch_trace(42, 43, 42, 43, 0, 0);
+
+	return 0;
+}
+
+// Thread 44 of TGID 42 is switched out
+SEC("raw_tp/sched_switch")
+int test_kepler_thread_sched_switch_trace(u64 *ctx)
+{
+	do_kepler_sched_switch_trace(44, 43, 42, 43, 0, 0);
+
+	return 0;
+}
+
+// The current task is switched out and in again, with its task_struct for the
+// task storage, thread and cgroup paths
+SEC("raw_tp/sched_switch")
+int test_kepler_current_sched_switch_trace(void *ctx)
+{
+	struct task_struct *task = bpf_get_current_task_btf();
+
+	do_kepler_sched_switch_trace(
+		task->pid, task->pid, task->tgid, task->tgid, task, task);
+
+	return 0;
+}
+
+// The current task exits as the leader of its process
+SEC("raw_tp")
+int test_kepler_current_process_exit_trace(void *ctx)
+{
+	struct task_struct *task = bpf_get_current_task_btf();
+
+	do_kepler_process_exit(task->tgid, task->tgid, task);
+
+	return 0;
+}
+
+SEC("raw_tp")
+int test_kepler_sched_process_exit_trace(void *ctx)
+{
+	do_kepler_process_exit(42, 42, 0);
+
+	return 0;
+}
+
+SEC("raw_tp")
+int test_kepler_sched_process_exec_trace(void *ctx)
+{
+	do_kepler_process_exec(42);
+
+	return 0;
+}
 
+SEC("raw_tp")
+int test_kepler_irq_trace(void *ctx)
+{
+	// NET_RX
+	do_kepler_softirq_entry(3);
+
+	return 0;
+}
+
+SEC("raw_tp")
+int test_kepler_softirq_exit_trace(void *ctx)
+{
+	do_kepler_softirq_exit(42, 3);
+
+	return 0;
+}
+
+SEC("iter/task")
+int test_kepler_task_iter(struct bpf_iter__task *ctx)
+{
+	return do_kepler_task_iter(ctx->task);
+}
+
+SEC("raw_tp")
+int test_kepler_io_bytes(void *ctx)
+{
+	do_kepler_io_bytes(42, BLOCK_IO_BYTES, 4096);
+	do_kepler_io_bytes(42, NET_TX_BYTES, 100);
+	do_kepler_io_bytes(42, NET_RX_BYTES, 1500);
+
+	return 0;
+}
+
+// CPU 0 runs at 2GHz, then enters and leaves idle state 1
+SEC("raw_tp")
+int test_kepler_cpu_frequency_trace(void *ctx)
+{
+	return do_kepler_cpu_frequency(2000000, 0);
+}
+
+SEC("raw_tp")
+int test_kepler_cpu_idle_enter_trace(void *ctx)
+{
+	return do_kepler_cpu_idle(1, 0);
+}
+
+SEC("raw_tp")
+int test_kepler_cpu_idle_exit_trace(void *ctx)
+{
+	return do_kepler_cpu_idle(PWR_EVENT_EXIT, 0);
+}
+
+// Baseline for the benchmarks, measures the cost of BPF_PROG_TEST_RUN itself
+SEC("raw_tp")
+int test_noop(void *ctx)
+{
 	return 0;
 }
 
@@ -34,13 +34,13 @@ import (
 	"github.com/sustainable-computing-io/kepler/pkg/config"
 	"github.com/sustainable-computing-io/kepler/pkg/manager"
 	"github.com/sustainable-computing-io/kepler/pkg/metrics"
+	"github.com/sustainable-computing-io/kepler/pkg/replay"
 	"github.com/sustainable-computing-io/kepler/pkg/sensors/accelerator"
 	"github.com/sustainable-computing-io/kepler/pkg/sensors/components"
 	"github.com/sustainable-computing-io/kepler/pkg/sensors/platform"
 	"gopkg.in/yaml.v3"
 
 	"github.com/prometheus/client_golang/prometheus"
-	"github.com/prometheus/client_golang/prometheus/promhttp"
 
 	"k8s.io/klog/v2"
 )
@@ -178,6 +178,11 @@ func main() {
 	if err != nil {
 		klog.Fatalf("failed to create eBPF exporter: %v", err)
 	}
+	if recordFile := config.GetBPFRecordFile(); recordFile != "" {
+		if bpfExporter, err = replay.NewRecordingExporter(bpfExporter, recordFile); err != nil {
+			klog.Fatalf("failed to record the eBPF samples: %v", err)
+		}
+	}
 	defer bpfExporter.Detach()
 
 	m := manager.New(bpfExporter)
@@ -221,12 +226,7 @@ func main() {
 
 	handler := http.ServeMux{}
 	reg := m.PrometheusCollector.RegisterMetrics()
-	handler.Handle(metricPathConfig, promhttp.HandlerFor(
-		reg,
-		promhttp.HandlerOpts{
-			Registry: reg,
-		},
-	))
+	handler.Handle(metricPathConfig, m.PrometheusCollector.MetricsHandler(reg))
 	handler.HandleFunc("/healthz", healthProbe)
 	handler.HandleFunc("/", rootHandler(metricPathConfig))
 	handler.HandleFunc("/debug/pprof/", http.DefaultServeMux.ServeHTTP)
@@ -22,8 +22,10 @@ package bpf
 import (
 	"errors"
 	"fmt"
+	"io"
 	"os"
 	"runtime"
+	"sync"
 	"time"
 	"unsafe"
 
@@ -42,11 +44,80 @@ type exporter struct {
 
 	schedSwitchLink link.Link
 	irqLink         link.Link
+	softirqExitLink link.Link
+	blockIOLink     link.Link
+	netTXLink       link.Link
+	netRXLink       link.Link
+	cpuIdleLink     link.Link
+	cpuFreqLink     link.Link
 	pageWriteLink   link.Link
 	pageReadLink    link.Link
+	processExitLink link.Link
+	processExecLink link.Link
 
 	perfEvents *hardwarePerfEvents
 
+	// perCPUProcesses is set when the processes map is a per-CPU map
+	perCPUProcesses bool
+	numPossibleCPU  int
+
+	// cgroupMetrics is set when the programs accumulate the metrics per cgroup
+	cgroupMetrics bool
+
+	// progStats is set when the programs count their own overhead
+	progStats bool
+
+	// cpuPowerState is set when the power tracepoints are attached
+	cpuPowerState bool
+
+	// threadMetrics is set when sched_switch also accumulates the metrics per thread
+	threadMetrics bool
+
+	// sliceHistograms is set when sched_switch also counts the on-CPU slices per cgroup
+	sliceHistograms bool
+
+	// pinDir is the bpffs directory of the pinned maps, if they are pinned, and
+	// pinnedReused is set when they were created by a previous exporter
+	pinDir       string
+	pinnedReused bool
+
+	// the processes, cgroups and process_io maps swapped on every CollectProcesses call
+	processes epochMaps
+	cgroups   epochMaps
+	processIO epochMaps
+
+	// buffers reused by every CollectProcesses call
+	processKeys        []uint32
+	cgroupKeys         []uint64
+	processValues      []keplerProcessMetricsT
+	collectedProcesses []ProcessMetrics
+	ioKeys             []uint64
+	ioValues           []keplerProcessIoT
+	// ioIndex maps the keys of the drained process_io entries that are not merged yet to their index in ioValues
+	ioIndex map[uint64]int
+
+	// identities of the processes of the current and the previous collection,
+	// the process_info map is only read for the others
+	identities     map[uint32]processIdentity
+	prevIdentities map[uint32]processIdentity
+
+	// exitReader consumes the final metrics of exited processes, which are
+	// merged into the next CollectProcesses result
+	exitReader      *ringbufReader
+	exitDone        chan struct{}
+	exitWg          sync.WaitGroup
+	exitMu          sync.Mutex
+	exitedProcesses []ProcessMetrics
+	// exitDropped counts the records dropped since the last collection
+	// because nobody collected the exited processes
+	exitDropped uint64
+
+	// runtimeConfig holds the settings the programs read while they run,
+	// updated from the config until runtimeConfigDone is closed
+	runtimeConfig     *runtimeConfig
+	runtimeConfigDone chan struct{}
+	runtimeConfigWg   sync.WaitGroup
+
 	enabledHardwareCounters sets.Set[string]
 	enabledSoftwareCounters sets.Set[string]
 }
@@ -55,6 +126,11 @@ func NewExporter() (Exporter, error) {
 	e := &exporter{
 		enabledHardwareCounters: sets.New[string](config.BPFHwCounters()...),
 		enabledSoftwareCounters: sets.New[string](config.BPFSwCounters()...),
+		perCPUProcesses:         config.IsBPFPerCPUProcessMapEnabled(),
+		cgroupMetrics:           config.IsBPFCgroupMetricsEnabled(),
+		progStats:               config.IsBPFProgStatsEnabled(),
+		threadMetrics:           config.IsBPFThreadMetricsEnabled(),
+		sliceHistograms:         config.IsBPFSliceHistogramsEnabled(),
 	}
 	err := e.attach()
 	if err != nil {
@@ -76,33 +152,57 @@ func (e *exporter) attach() error {
 		return fmt.Errorf("error removing memlock: %v", err)
 	}
 
-	// Load eBPF Specs
-	specs, err := loadKepler()
+	numCPU := getCPUCores()
+	klog.Infof("Number of CPUs: %d", numCPU)
+
+	// Load the eBPF program(s), preferring task local storage for the on-CPU
+	// timestamps and falling back to pid_time_map if the kernel lacks support
+	useTaskStorage := config.IsBPFTaskStorageEnabled()
+	err := e.load(numCPU, useTaskStorage)
+	if err != nil && useTaskStorage {
+		klog.Warningf("failed to load eBPF objects with task local storage, falling back to pid_time_map: %v", err)
+		useTaskStorage = false
+		err = e.load(numCPU, useTaskStorage)
+	}
 	if err != nil {
-		return fmt.Errorf("error loading eBPF specs: %v", err)
+		return err
 	}
+	klog.Infof("Using task local storage for on-CPU timestamps: %t", useTaskStorage)
 
-	// Adjust map sizes to the number of available CPUs
-	numCPU := getCPUCores()
-	klog.Infof("Number of CPUs: %d", numCPU)
-	for _, m := range specs.Maps {
-		// Only resize maps that have a MaxEntries of NUM_CPUS constant
-		if m.MaxEntries == 128 {
-			m.MaxEntries = uint32(numCPU)
+	e.processes = epochMaps{
+		outer:    e.bpfObjects.ProcessesEpochs,
+		active:   e.bpfObjects.Processes,
+		inactive: e.bpfObjects.ProcessesShadow,
+	}
+	e.cgroups = epochMaps{
+		outer:    e.bpfObjects.CgroupsEpochs,
+		active:   e.bpfObjects.Cgroups,
+		inactive: e.bpfObjects.CgroupsShadow,
+	}
+	e.processIO = epochMaps{
+		outer:    e.bpfObjects.ProcessIoEpochs,
+		active:   e.bpfObjects.ProcessIo,
+		inactive: e.bpfObjects.ProcessIoShadow,
+	}
+	// The previous exporter may have left the shadow maps active, the first read must drain them
+	if e.pinnedReused {
+		for _, m := range []*epochMaps{&e.processes, &e.cgroups, &e.processIO} {
+			if err := m.loadActive(); err != nil {
+				return err
+			}
 		}
 	}
-
-	// Set program global variables
-	err = specs.RewriteConstants(map[string]interface{}{
-		"SAMPLE_RATE": int32(config.GetBPFSampleRate()),
-	})
-	if err != nil {
-		return fmt.Errorf("error rewriting program constants: %v", err)
+	if err := e.allocateProcessBuffers(); err != nil {
+		return err
 	}
+	e.identities = make(map[uint32]processIdentity)
+	e.prevIdentities = make(map[uint32]processIdentity)
 
-	// Load the eBPF program(s)
-	if err := specs.LoadAndAssign(&e.bpfObjects, nil); err != nil {
-		return fmt.Errorf("error loading eBPF objects: %v", err)
+	// Detach the programs of a previous exporter right before attaching ours,
+	// they updated the pinned maps until now
+	if e.pinDir != "" {
+		removeStaleLayouts(config.GetBPFPinPath(), e.pinDir)
+		unpinLinks(e.pinDir)
 	}
 
 	// Attach the eBPF program(s)
@@ -122,6 +222,14 @@ func (e *exporter) attach() error {
 		if err != nil {
 			return fmt.Errorf("could not attach irq/softirq_entry: %w", err)
 		}
+		// the softirqs are accounted when they exit
+		e.softirqExitLink, err = link.AttachTracing(link.TracingOptions{
+			Program:    e.bpfObjects.KeplerSoftirqExitTrace,
+			AttachType: ebpf.AttachTraceRawTp,
+		})
+		if err != nil {
+			return fmt.Errorf("could not attach irq/softirq_exit: %w", err)
+		}
 	}
 
 	group := "writeback"
@@ -144,26 +252,491 @@ func (e *exporter) attach() error {
 		klog.Warningf("failed to attach fentry/mark_page_accessed: %v. Kepler will not collect page cache read events. This will affect the DRAM power model estimation on VMs.", err)
 	}
 
-	// Return early if hardware counters are not enabled
+	if config.IsBPFBlockIOBytesEnabled() {
+		e.blockIOLink, err = link.Tracepoint("block", "block_rq_issue", e.bpfObjects.KeplerBlockRqIssueTrace, nil)
+		if err != nil {
+			klog.Warningf("failed to attach tp/block/block_rq_issue: %v. Kepler will not collect the block I/O bytes.", err)
+			e.enabledSoftwareCounters.Delete(config.BlockIOBytesLabel)
+		}
+	}
+
+	if config.IsBPFNetBytesEnabled() {
+		if err := e.attachNetBytes(); err != nil {
+			klog.Warningf("failed to attach the sock tracepoints: %v. Kepler will not collect the network bytes, which needs kernel 6.3 or later.", err)
+			e.enabledSoftwareCounters.Delete(config.NetTXBytesLabel, config.NetRXBytesLabel)
+		}
+	}
+
+	if config.IsBPFCPUPowerStateEnabled() {
+		if err := e.attachCPUPowerState(); err != nil {
+			klog.Warningf("failed to attach the power tracepoints: %v. Kepler will not track the CPU frequency and idle states.", err)
+		}
+	}
+
+	e.processExecLink, err = link.AttachTracing(link.TracingOptions{
+		Program:    e.bpfObjects.KeplerSchedProcessExecTrace,
+		AttachType: ebpf.AttachTraceRawTp,
+	})
+	if err != nil {
+		klog.Warningf("failed to attach tp_btf/sched_process_exec: %v. Processes may be reported with the command of their parent.", err)
+	}
+
+	// The exit records are copied from the processes entry, which only holds
+	// one CPU's slot when the map is per-CPU
+	if e.cgroupMetrics {
+		klog.Infof("Process exit events are disabled with the per-cgroup metrics")
+	} else if e.perCPUProcesses {
+		klog.Infof("Process exit events are disabled with the per-CPU processes map")
+	} else if err := e.attachProcessExit(); err != nil {
+		klog.Warningf("failed to attach tp_btf/sched_process_exit: %v. Kepler may miss short-lived processes.", err)
+	}
+
+	// Now that sched_switch is attached, seed the maps with the processes
+	// that have not been switched in since, unless a previous exporter did
+	if e.pinnedReused {
+		klog.Infof("Reusing the eBPF maps pinned in %s", e.pinDir)
+	} else if err := e.bootstrapProcesses(); err != nil {
+		klog.Warningf("failed to run iter/task: %v. The processes running at startup may be accounted from their next time slice only.", err)
+	}
+
+	if e.pinDir != "" && config.IsBPFPinLinksEnabled() {
+		pinLinks(e.pinDir, e.links())
+	}
+
 	if !config.ExposeHardwareCounterMetrics() {
 		klog.Infof("Hardware counter metrics are disabled")
-		return nil
+	} else {
+		// the programs read no hardware counter values without the perf events
+		e.perfEvents, _ = createHardwarePerfEvents(
+			e.bpfObjects.CpuInstructionsEventReader,
+			e.bpfObjects.CpuCyclesEventReader,
+			e.bpfObjects.CacheMissEventReader,
+			numCPU,
+		)
+	}
+
+	if config.IsBPFRuntimeConfigEnabled() {
+		return e.startRuntimeConfig()
+	}
+	return nil
+}
+
+// startRuntimeConfig sets the initial runtime settings of the programs and
+// applies the config changes until Detach is called
+func (e *exporter) startRuntimeConfig() error {
+	c, err := newRuntimeConfig(e.bpfObjects.RuntimeConfig)
+	if err != nil {
+		return err
+	}
+	e.runtimeConfig = c
+	c.set(config.GetBPFSampleRate(), e.perfEvents != nil)
+
+	e.runtimeConfigDone = make(chan struct{})
+	e.runtimeConfigWg.Add(1)
+	go func() {
+		defer e.runtimeConfigWg.Done()
+		ticker := time.NewTicker(runtimeConfigPollInterval)
+		defer ticker.Stop()
+		for {
+			select {
+			case <-e.runtimeConfigDone:
+				return
+			case <-ticker.C:
+			}
+			sampleRate, hardwareCounters := config.GetBPFRuntimeConfig()
+			// the hardware counters cannot be enabled without their perf events
+			hardwareCounters = hardwareCounters && e.perfEvents != nil
+			if c.set(sampleRate, hardwareCounters) {
+				klog.Infof("Updated the eBPF runtime config: sample rate %d, hardware counters %t", sampleRate, hardwareCounters)
+			}
+		}
+	}()
+	return nil
+}
+
+// load loads the eBPF specs, adjusts them to the host and loads the objects into the kernel
+func (e *exporter) load(numCPU int, useTaskStorage bool) error {
+	// Load eBPF Specs
+	specs, err := loadKepler()
+	if err != nil {
+		return fmt.Errorf("error loading eBPF specs: %v", err)
+	}
+	// The maps adjusted to the configuration below
+	maps, err := lookupMapSpecs(specs,
+		"cpu_power_state", "threads", "cgroup_slices", "pid_time_map", "task_time_map", "runtime_config",
+		"processes", "processes_shadow", "processes_epochs", "cgroups", "cgroups_shadow", "cgroups_epochs")
+	if err != nil {
+		return err
+	}
+
+	// Size the perf event readers so that every CPU ID has a slot, the
+	// per-CPU state maps are sized by the kernel
+	possibleCPU, err := ebpf.PossibleCPU()
+	if err != nil {
+		return fmt.Errorf("failed to get the number of possible CPUs: %v", err)
+	}
+	for _, m := range specs.Maps {
+		if m.Type == ebpf.PerfEventArray {
+			m.MaxEntries = uint32(max(numCPU, possibleCPU))
+		}
+	}
+	if config.IsBPFCPUPowerStateEnabled() {
+		maps["cpu_power_state"].MaxEntries = uint32(max(numCPU, possibleCPU))
+	} else {
+		maps["cpu_power_state"].MaxEntries = 1
+	}
+
+	// The threads map is only written with the per-thread metrics
+	if e.threadMetrics {
+		maps["threads"].MaxEntries = uint32(config.GetBPFThreadMapSize())
+	} else {
+		maps["threads"].MaxEntries = 1
+	}
+
+	// The cgroup_slices map is only written with the slice histograms
+	if !e.sliceHistograms {
+		maps["cgroup_slices"].MaxEntries = 1
+	}
+
+	// Give each CPU its own slot of the process metrics to avoid lost
+	// updates and cacheline bouncing, the slots are summed in userspace
+	if e.perCPUProcesses {
+		maps["processes"].Type = ebpf.LRUCPUHash
+		maps["processes_shadow"].Type = ebpf.LRUCPUHash
+		maps["processes_epochs"].InnerMap.Type = ebpf.LRUCPUHash
+	}
+
+	// Only one of the processes and cgroups maps is used, shrink the other one
+	unused := []string{"cgroups", "cgroups_shadow", "cgroups_epochs"}
+	if e.cgroupMetrics {
+		unused = []string{"processes", "processes_shadow", "processes_epochs"}
+	}
+	maps[unused[0]].MaxEntries = 1
+	maps[unused[1]].MaxEntries = 1
+	maps[unused[2]].InnerMap.MaxEntries = 1
+
+	// Only one of the on-CPU timestamp maps is used, shrink the other one
+	if useTaskStorage {
+		maps["pid_time_map"].MaxEntries = 1
+	} else {
+		// Replace the task storage map so that it can be created on kernels without support
+		taskTimeMap := maps["task_time_map"]
+		taskTimeMap.Type = ebpf.Hash
+		taskTimeMap.Flags = 0
+		taskTimeMap.MaxEntries = 1
+	}
+
+	// The runtime_config map is only read with the runtime config, and
+	// mmapable maps need kernel 5.5
+	if !config.IsBPFRuntimeConfigEnabled() {
+		maps["runtime_config"].Flags &^= unix.BPF_F_MMAPABLE
+	}
+
+	// The batched page cache hits are flushed to the process, the cgroups
+	// entries are updated on every hit
+	pageCacheBatch := config.IsBPFPageCacheBatchEnabled()
+	if pageCacheBatch && e.cgroupMetrics {
+		klog.Infof("Page cache hit batching is disabled with the per-cgroup metrics")
+		pageCacheBatch = false
 	}
 
-	e.perfEvents, err = createHardwarePerfEvents(
-		e.bpfObjects.CpuInstructionsEventReader,
-		e.bpfObjects.CpuCyclesEventReader,
-		e.bpfObjects.CacheMissEventReader,
-		numCPU,
-	)
+	// Set program global variables
+	err = specs.RewriteConstants(map[string]interface{}{
+		"SAMPLE_RATE":            int32(config.GetBPFSampleRate()),
+		"HW":                     boolToInt32(config.ExposeHardwareCounterMetrics()),
+		"RUNTIME_CONFIG":         boolToInt32(config.IsBPFRuntimeConfigEnabled()),
+		"SAMPLE_TARGET":          int32(config.GetBPFSampleTarget()),
+		"TASK_STORAGE":           boolToInt32(useTaskStorage),
+		"CGROUP_METRICS":         boolToInt32(e.cgroupMetrics),
+		"POD_CGROUP_ANCESTOR":    boolToInt32(config.IsBPFPodCgroupAncestorEnabled()),
+		"PROG_STATS":             boolToInt32(e.progStats),
+		"THREAD_METRICS":         boolToInt32(e.threadMetrics),
+		"SLICE_HISTOGRAMS":       boolToInt32(e.sliceHistograms),
+		"PAGE_CACHE_BATCH":       boolToInt32(pageCacheBatch),
+		"PAGE_CACHE_SAMPLE_RATE": int32(config.GetBPFPageCacheSampleRate()),
+		"SOFTIRQ_METRICS":        boolToInt32(config.ExposeIRQCounterMetrics()),
+	})
 	if err != nil {
+		return fmt.Errorf("error rewriting program constants: %v", err)
+	}
+
+	// Pin the maps so that the next exporter reuses their entries
+	opts := &ebpf.CollectionOptions{}
+	e.pinDir, e.pinnedReused = "", false
+	if config.IsBPFPinMapsEnabled() {
+		dir, reused, err := pinLayout(specs, config.GetBPFPinPath())
+		if err != nil {
+			return err
+		}
+		opts.Maps.PinPath = dir
+		e.pinDir, e.pinnedReused = dir, reused
+	}
+
+	// Load the eBPF program(s)
+	if err := specs.LoadAndAssign(&e.bpfObjects, opts); err != nil {
+		return fmt.Errorf("error loading eBPF objects: %v", err)
+	}
+	return nil
+}
+
+// lookupMapSpecs returns the specs of the named maps, or an error if the specs do not match the exporter, e.g. stale
+// objects. The inner map of the maps of maps must be set.
+func lookupMapSpecs(specs *ebpf.CollectionSpec, names ...string) (map[string]*ebpf.MapSpec, error) {
+	maps := make(map[string]*ebpf.MapSpec, len(names))
+	for _, name := range names {
+		m, found := specs.Maps[name]
+		if !found {
+			return nil, fmt.Errorf("the eBPF specs have no %s map", name)
+		}
+		if m.Type == ebpf.ArrayOfMaps && m.InnerMap == nil {
+			return nil, fmt.Errorf("the eBPF specs have no inner map for %s", name)
+		}
+		maps[name] = m
+	}
+	return maps, nil
+}
+
+// links returns the links of the exporter by program, nil when not attached
+func (e *exporter) links() map[string]link.Link {
+	return map[string]link.Link{
+		"sched_switch":   e.schedSwitchLink,
+		"softirq_entry":  e.irqLink,
+		"softirq_exit":   e.softirqExitLink,
+		"block_rq_issue": e.blockIOLink,
+		"sock_send":      e.netTXLink,
+		"sock_recv":      e.netRXLink,
+		"cpu_idle":       e.cpuIdleLink,
+		"cpu_frequency":  e.cpuFreqLink,
+		"page_write":     e.pageWriteLink,
+		"page_read":      e.pageReadLink,
+		"process_exit":   e.processExitLink,
+		"process_exec":   e.processExecLink,
+	}
+}
+
+// allocateProcessBuffers preallocates the buffers used to drain the processes
+// maps so that CollectProcesses does not allocate on every call
+func (e *exporter) allocateProcessBuffers() error {
+	ioEntries := int(e.bpfObjects.ProcessIo.MaxEntries())
+	e.ioKeys = make([]uint64, ioEntries)
+	e.ioValues = make([]keplerProcessIoT, ioEntries)
+	e.ioIndex = make(map[uint64]int, ioEntries)
+	if e.cgroupMetrics {
+		maxEntries := int(e.bpfObjects.Cgroups.MaxEntries())
+		e.cgroupKeys = make([]uint64, maxEntries)
+		e.processValues = make([]keplerProcessMetricsT, maxEntries)
+		e.collectedProcesses = make([]ProcessMetrics, 0, maxEntries)
 		return nil
 	}
+	maxEntries := int(e.bpfObjects.Processes.MaxEntries())
+	if e.perCPUProcesses {
+		numCPU, err := ebpf.PossibleCPU()
+		if err != nil {
+			return fmt.Errorf("failed to get the number of possible CPUs: %v", err)
+		}
+		e.numPossibleCPU = numCPU
+		e.processKeys = make([]uint32, perCPUBatchSize)
+		e.processValues = make([]keplerProcessMetricsT, perCPUBatchSize*numCPU)
+		e.collectedProcesses = make([]ProcessMetrics, 0, maxEntries)
+		return nil
+	}
+	e.processKeys = make([]uint32, maxEntries)
+	e.processValues = make([]keplerProcessMetricsT, maxEntries)
+	// leave room for the pending exit records, which are bounded by maxEntries
+	e.collectedProcesses = make([]ProcessMetrics, 0, 2*maxEntries)
+	return nil
+}
 
+func (e *exporter) attachNetBytes() error {
+	var err error
+	e.netTXLink, err = link.Tracepoint("sock", "sock_send_length", e.bpfObjects.KeplerSockSendTrace, nil)
+	if err != nil {
+		return err
+	}
+	e.netRXLink, err = link.Tracepoint("sock", "sock_recv_length", e.bpfObjects.KeplerSockRecvTrace, nil)
+	if err != nil {
+		e.netTXLink.Close()
+		e.netTXLink = nil
+		return err
+	}
+	return nil
+}
+
+func (e *exporter) attachCPUPowerState() error {
+	var err error
+	e.cpuIdleLink, err = link.AttachTracing(link.TracingOptions{
+		Program:    e.bpfObjects.KeplerCpuIdleTrace,
+		AttachType: ebpf.AttachTraceRawTp,
+	})
+	if err != nil {
+		return err
+	}
+	e.cpuFreqLink, err = link.AttachTracing(link.TracingOptions{
+		Program:    e.bpfObjects.KeplerCpuFrequencyTrace,
+		AttachType: ebpf.AttachTraceRawTp,
+	})
+	if err != nil {
+		e.cpuIdleLink.Close()
+		e.cpuIdleLink = nil
+		return err
+	}
+	e.cpuPowerState = true
+	return nil
+}
+
+// bootstrapProcesses runs the task iterator once, which registers the existing
+// processes and the on-CPU start time of the running tasks
+func (e *exporter) bootstrapProcesses() error {
+	iter, err := link.AttachIter(link.IterOptions{
+		Program: e.bpfObjects.KeplerTaskIter,
+	})
+	if err != nil {
+		return err
+	}
+	defer iter.Close()
+
+	reader, err := iter.Open()
+	if err != nil {
+		return err
+	}
+	defer reader.Close()
+	// the program writes no output, reading it runs the program on every task
+	_, err = io.Copy(io.Discard, reader)
+	return err
+}
+
+func (e *exporter) attachProcessExit() error {
+	reader, err := newRingbufReader(e.bpfObjects.ProcessExits)
+	if err != nil {
+		return err
+	}
+	e.processExitLink, err = link.AttachTracing(link.TracingOptions{
+		Program:    e.bpfObjects.KeplerSchedProcessExitTrace,
+		AttachType: ebpf.AttachTraceRawTp,
+	})
+	if err != nil {
+		reader.Close()
+		return err
+	}
+	e.exitReader = reader
+	e.exitedProcesses = make([]ProcessMetrics, 0, e.bpfObjects.Processes.MaxEntries())
+	e.exitDone = make(chan struct{})
+	e.exitWg.Add(1)
+	go e.consumeProcessExits()
 	return nil
 }
 
+// consumeProcessExits reads the exit records until Detach is called
+func (e *exporter) consumeProcessExits() {
+	defer e.exitWg.Done()
+	maxPending := int(e.bpfObjects.Processes.MaxEntries())
+	recordSize := int(unsafe.Sizeof(keplerProcessExitT{}))
+	for {
+		select {
+		case <-e.exitDone:
+			return
+		default:
+		}
+		if err := e.exitReader.Wait(exitPollTimeoutMs); err != nil {
+			// the records stay in the ring buffer, retry after the poll timeout
+			klog.Errorf("failed to wait for process exit events: %v", err)
+			select {
+			case <-e.exitDone:
+				return
+			case <-time.After(exitPollTimeoutMs * time.Millisecond):
+			}
+			continue
+		}
+		e.exitMu.Lock()
+		e.exitReader.Read(func(sample []byte) {
+			if len(sample) < recordSize {
+				e.exitDropped++
+				return
+			}
+			// bound the memory used if nobody collects the processes
+			if len(e.exitedProcesses) >= maxPending {
+				e.exitDropped++
+				return
+			}
+			record := (*keplerProcessExitT)(unsafe.Pointer(&sample[0]))
+			p := newProcessMetrics(&record.Metrics, newProcessIdentity(&record.Info))
+			addProcessIO(&p, &record.Io)
+			e.exitedProcesses = append(e.exitedProcesses, p)
+		})
+		e.exitMu.Unlock()
+	}
+}
+
+// appendExitedProcesses appends the exit records received since the last call to processes
+// and forgets the identity of the exited processes, as their pid may be reused
+func (e *exporter) appendExitedProcesses(processes []ProcessMetrics) ([]ProcessMetrics, int) {
+	e.exitMu.Lock()
+	defer e.exitMu.Unlock()
+	if e.exitDropped > 0 {
+		klog.Warningf("Dropped %d process exit records since the last collection, their last metrics are not accounted", e.exitDropped)
+		e.exitDropped = 0
+	}
+	exited := len(e.exitedProcesses)
+	for i := range e.exitedProcesses {
+		pid := uint32(e.exitedProcesses[i].Pid)
+		delete(e.identities, pid)
+		delete(e.prevIdentities, pid)
+	}
+	processes = append(processes, e.exitedProcesses...)
+	e.exitedProcesses = e.exitedProcesses[:0]
+	return processes, exited
+}
+
+// startCollection keeps the identities of the previous collection and starts a new one, so that the
+// identities of the processes that are gone are dropped after one collection without them
+func (e *exporter) startCollection() {
+	e.identities, e.prevIdentities = e.prevIdentities, e.identities
+	clear(e.identities)
+}
+
+// resolveProcess merges a process record with the identity of its pid, which is only read from the
+// process_info map if the process was not seen in the previous collection
+func (e *exporter) resolveProcess(m *keplerProcessMetricsT) ProcessMetrics {
+	id, ok := e.identities[m.Pid]
+	if !ok {
+		id, ok = e.prevIdentities[m.Pid]
+		if !ok {
+			var info keplerProcessInfoT
+			if err := e.bpfObjects.ProcessInfo.Lookup(m.Pid, &info); err != nil {
+				// retried in the next collection
+				klog.V(6).Infof("failed to lookup the process info of pid %d: %v", m.Pid, err)
+				return newProcessMetrics(m, id)
+			}
+			id = newProcessIdentity(&info)
+		}
+		e.identities[m.Pid] = id
+	}
+	return newProcessMetrics(m, id)
+}
+
 func (e *exporter) Detach() {
+	// Runtime config
+	if e.runtimeConfigDone != nil {
+		close(e.runtimeConfigDone)
+		e.runtimeConfigWg.Wait()
+		e.runtimeConfigDone = nil
+	}
+	if e.runtimeConfig != nil {
+		e.runtimeConfig.Close()
+		e.runtimeConfig = nil
+	}
+
+	// Process exit consumer
+	if e.exitDone != nil {
+		close(e.exitDone)
+		e.exitWg.Wait()
+		e.exitDone = nil
+	}
+	if e.exitReader != nil {
+		e.exitReader.Close()
+		e.exitReader = nil
+	}
+
 	// Links
 	if e.schedSwitchLink != nil {
 		e.schedSwitchLink.Close()
@@ -175,6 +748,36 @@ func (e *exporter) Detach() {
 		e.irqLink = nil
 	}
 
+	if e.softirqExitLink != nil {
+		e.softirqExitLink.Close()
+		e.softirqExitLink = nil
+	}
+
+	if e.blockIOLink != nil {
+		e.blockIOLink.Close()
+		e.blockIOLink = nil
+	}
+
+	if e.netTXLink != nil {
+		e.netTXLink.Close()
+		e.netTXLink = nil
+	}
+
+	if e.netRXLink != nil {
+		e.netRXLink.Close()
+		e.netRXLink = nil
+	}
+
+	if e.cpuIdleLink != nil {
+		e.cpuIdleLink.Close()
+		e.cpuIdleLink = nil
+	}
+
+	if e.cpuFreqLink != nil {
+		e.cpuFreqLink.Close()
+		e.cpuFreqLink = nil
+	}
+
 	if e.pageWriteLink != nil {
 		e.pageWriteLink.Close()
 		e.pageWriteLink = nil
@@ -185,39 +788,347 @@ func (e *exporter) Detach() {
 		e.pageReadLink = nil
 	}
 
+	if e.processExitLink != nil {
+		e.processExitLink.Close()
+		e.processExitLink = nil
+	}
+
+	if e.processExecLink != nil {
+		e.processExecLink.Close()
+		e.processExecLink = nil
+	}
+
 	// Perf events
-	e.perfEvents.close()
-	e.perfEvents = nil
+	if e.perfEvents != nil {
+		e.perfEvents.close()
+		e.perfEvents = nil
+	}
 
 	// Objects
 	e.bpfObjects.Close()
 }
 
+// CollectProcesses returns the process metrics accumulated since the last call,
+// or one record per cgroup when the per-cgroup metrics are enabled.
+// The returned slice is reused and is only valid until the next call.
 func (e *exporter) CollectProcesses() ([]ProcessMetrics, error) {
 	start := time.Now()
-	// Get the max number of entries in the map
-	maxEntries := e.bpfObjects.Processes.MaxEntries()
+	e.startCollection()
+	if e.cgroupMetrics {
+		return e.collectCgroups(start)
+	}
+	drained, err := e.processes.swap()
+	if err != nil {
+		return nil, err
+	}
+	if err := e.drainProcessIO(); err != nil {
+		return nil, err
+	}
+	if e.perCPUProcesses {
+		return e.collectPerCPUProcesses(drained, start)
+	}
 	total := 0
-	deleteKeys := make([]uint32, maxEntries)
-	deleteValues := make([]ProcessMetrics, maxEntries)
 	var cursor ebpf.MapBatchCursor
-	for {
-		count, err := e.bpfObjects.Processes.BatchLookupAndDelete(
+	for total < len(e.processKeys) {
+		count, err := drained.BatchLookupAndDelete(
+			&cursor,
+			e.processKeys[total:],
+			e.processValues[total:],
+			&ebpf.BatchOptions{},
+		)
+		total += count
+		if errors.Is(err, ebpf.ErrKeyNotExist) || (err == nil && count == 0) {
+			break
+		}
+		if err != nil {
+			return nil, fmt.Errorf("failed to batch lookup and delete: %v", err)
+		}
+	}
+	processes := e.collectedProcesses[:0]
+	for i := 0; i < total; i++ {
+		p := e.resolveProcess(&e.processValues[i])
+		e.takeProcessIO(&p, uint64(e.processKeys[i]))
+		processes = append(processes, p)
+	}
+	processes = e.appendUnmatchedProcessIO(processes)
+	processes, exited := e.appendExitedProcesses(processes)
+	e.collectedProcesses = processes
+	klog.V(5).Infof("collected %d process samples and %d exited processes in %v", total, exited, time.Since(start))
+	return processes, nil
+}
+
+// epochMaps holds the two inner maps that alternate in slot 0 of an outer map of maps
+type epochMaps struct {
+	outer    *ebpf.Map
+	active   *ebpf.Map
+	inactive *ebpf.Map
+}
+
+// loadActive reads back which inner map is in slot 0 of the outer map, e.g. the one a previous exporter left active in
+// the pinned maps
+func (m *epochMaps) loadActive() error {
+	var id uint32
+	if err := m.outer.Lookup(uint32(0), &id); err != nil {
+		return fmt.Errorf("failed to read the inner map of %s: %v", m.outer.String(), err)
+	}
+	info, err := m.inactive.Info()
+	if err != nil {
+		return fmt.Errorf("failed to get the info of %s: %v", m.inactive.String(), err)
+	}
+	if inactiveID, ok := info.ID(); ok && uint32(inactiveID) == id {
+		m.active, m.inactive = m.inactive, m.active
+	}
+	return nil
+}
+
+// swap makes the programs write to the inactive map and returns the previously
+// active one. Replacing an inner map waits for an RCU grace period, so once the
+// update returns no program holds the returned map and it can be drained
+// without losing concurrent updates.
+func (m *epochMaps) swap() (*ebpf.Map, error) {
+	if err := m.outer.Update(uint32(0), m.inactive, ebpf.UpdateAny); err != nil {
+		return nil, fmt.Errorf("failed to swap the inner map of %s: %v", m.outer.String(), err)
+	}
+	m.active, m.inactive = m.inactive, m.active
+	return m.inactive, nil
+}
+
+// drainProcessIO swaps the process_io maps and indexes the drained entries by key, so that they are merged into the
+// records of their processes or cgroups
+func (e *exporter) drainProcessIO() error {
+	drained, err := e.processIO.swap()
+	if err != nil {
+		return err
+	}
+	clear(e.ioIndex)
+	total := 0
+	var cursor ebpf.MapBatchCursor
+	for total < len(e.ioKeys) {
+		count, err := drained.BatchLookupAndDelete(
+			&cursor,
+			e.ioKeys[total:],
+			e.ioValues[total:],
+			&ebpf.BatchOptions{},
+		)
+		total += count
+		if errors.Is(err, ebpf.ErrKeyNotExist) || (err == nil && count == 0) {
+			break
+		}
+		if err != nil {
+			return fmt.Errorf("failed to batch lookup and delete: %v", err)
+		}
+	}
+	for i := 0; i < total; i++ {
+		e.ioIndex[e.ioKeys[i]] = i
+	}
+	return nil
+}
+
+// takeProcessIO adds the drained process_io entry of key, if any, to p
+func (e *exporter) takeProcessIO(p *ProcessMetrics, key uint64) {
+	if i, found := e.ioIndex[key]; found {
+		addProcessIO(p, &e.ioValues[i])
+		delete(e.ioIndex, key)
+	}
+}
+
+// appendUnmatchedProcessIO appends a record for each drained process_io entry whose process or cgroup was not in the
+// drained processes or cgroups map, e.g. when an update came between the swaps of the two maps
+func (e *exporter) appendUnmatchedProcessIO(processes []ProcessMetrics) []ProcessMetrics {
+	for key, i := range e.ioIndex {
+		var p ProcessMetrics
+		if e.cgroupMetrics {
+			p.CgroupId = key
+		} else {
+			p = e.resolveProcess(&keplerProcessMetricsT{Pid: uint32(key)})
+		}
+		addProcessIO(&p, &e.ioValues[i])
+		processes = append(processes, p)
+	}
+	clear(e.ioIndex)
+	return processes
+}
+
+// collectCgroups drains the per-cgroup metrics
+func (e *exporter) collectCgroups(start time.Time) ([]ProcessMetrics, error) {
+	drained, err := e.cgroups.swap()
+	if err != nil {
+		return nil, err
+	}
+	if err := e.drainProcessIO(); err != nil {
+		return nil, err
+	}
+	total := 0
+	var cursor ebpf.MapBatchCursor
+	for total < len(e.cgroupKeys) {
+		count, err := drained.BatchLookupAndDelete(
 			&cursor,
-			deleteKeys,
-			deleteValues,
+			e.cgroupKeys[total:],
+			e.processValues[total:],
 			&ebpf.BatchOptions{},
 		)
 		total += count
-		if errors.Is(err, ebpf.ErrKeyNotExist) {
+		if errors.Is(err, ebpf.ErrKeyNotExist) || (err == nil && count == 0) {
 			break
 		}
 		if err != nil {
 			return nil, fmt.Errorf("failed to batch lookup and delete: %v", err)
 		}
 	}
-	klog.V(5).Infof("collected %d process samples in %v", total, time.Since(start))
-	return deleteValues[:total], nil
+	cgroups := e.collectedProcesses[:0]
+	for i := 0; i < total; i++ {
+		c := e.resolveProcess(&e.processValues[i])
+		c.CgroupId = e.cgroupKeys[i]
+		e.takeProcessIO(&c, c.CgroupId)
+		cgroups = append(cgroups, c)
+	}
+	cgroups = e.appendUnmatchedProcessIO(cgroups)
+	e.collectedProcesses = cgroups
+	klog.V(5).Infof("collected %d cgroup samples in %v", total, time.Since(start))
+	return cgroups, nil
+}
+
+// collectPerCPUProcesses drains the per-CPU processes map in chunks and sums the per-CPU slots of each process
+func (e *exporter) collectPerCPUProcesses(drained *ebpf.Map, start time.Time) ([]ProcessMetrics, error) {
+	numCPU := e.numPossibleCPU
+	processes := e.collectedProcesses[:0]
+	var cursor ebpf.MapBatchCursor
+	for {
+		count, err := drained.BatchLookupAndDelete(
+			&cursor,
+			e.processKeys,
+			e.processValues,
+			&ebpf.BatchOptions{},
+		)
+		for i := 0; i < count; i++ {
+			p := reducePerCPUProcessMetrics(e.processKeys[i], e.processValues[i*numCPU:(i+1)*numCPU])
+			m := e.resolveProcess(&p)
+			e.takeProcessIO(&m, uint64(e.processKeys[i]))
+			processes = append(processes, m)
+		}
+		if errors.Is(err, ebpf.ErrKeyNotExist) || (err == nil && count == 0) {
+			break
+		}
+		if err != nil {
+			return nil, fmt.Errorf("failed to batch lookup and delete: %v", err)
+		}
+	}
+	processes = e.appendUnmatchedProcessIO(processes)
+	e.collectedProcesses = processes
+	klog.V(5).Infof("collected %d per-CPU process samples in %v", len(processes), time.Since(start))
+	return processes, nil
+}
+
+// CollectProgStats sums the per-CPU prog_stats entries of every program
+func (e *exporter) CollectProgStats() (map[string]ProgStats, error) {
+	if !e.progStats {
+		return nil, nil
+	}
+	// called from the metrics scrapes, which may run concurrently
+	numCPU, err := ebpf.PossibleCPU()
+	if err != nil {
+		return nil, fmt.Errorf("failed to get the number of possible CPUs: %v", err)
+	}
+	perCPU := make([]ProgStats, numCPU)
+	stats := make(map[string]ProgStats, len(ProgStatsNames))
+	for i, name := range ProgStatsNames {
+		if err := e.bpfObjects.ProgStats.Lookup(uint32(i), perCPU); err != nil {
+			return nil, fmt.Errorf("failed to lookup the stats of %s: %v", name, err)
+		}
+		stats[name] = reducePerCPUProgStats(perCPU)
+	}
+	return stats, nil
+}
+
+// CollectSampleRates returns the sample rate picked by each CPU, or nil if the adaptive sampling is disabled
+func (e *exporter) CollectSampleRates() ([]uint32, error) {
+	if config.GetBPFSampleTarget() <= 0 {
+		return nil, nil
+	}
+	var states []keplerSampleStateT
+	if err := e.bpfObjects.SampleState.Lookup(uint32(0), &states); err != nil {
+		return nil, fmt.Errorf("failed to lookup the sample state: %v", err)
+	}
+	rates := make([]uint32, len(states))
+	for cpu := range states {
+		rates[cpu] = states[cpu].SampleRate
+	}
+	return rates, nil
+}
+
+// CollectCPUPowerStates returns the residency of each CPU up to now, or nil if the power tracepoints are not attached
+func (e *exporter) CollectCPUPowerStates() ([]CPUPowerState, error) {
+	if !e.cpuPowerState {
+		return nil, nil
+	}
+	var ts unix.Timespec
+	if err := unix.ClockGettime(unix.CLOCK_MONOTONIC, &ts); err != nil {
+		return nil, fmt.Errorf("failed to read the monotonic clock: %v", err)
+	}
+	now := uint64(ts.Nano())
+
+	numCPU := int(e.bpfObjects.CpuPowerState.MaxEntries())
+	states := make([]CPUPowerState, numCPU)
+	var s keplerCpuPowerStateT
+	for cpu := 0; cpu < numCPU; cpu++ {
+		if err := e.bpfObjects.CpuPowerState.Lookup(uint32(cpu), &s); err != nil {
+			return nil, fmt.Errorf("failed to lookup the power state of CPU %d: %v", cpu, err)
+		}
+		states[cpu] = newCPUPowerState(&s, now)
+	}
+	return states, nil
+}
+
+// CollectThreads reads the threads map without draining it, the entries are cumulative
+func (e *exporter) CollectThreads() ([]ThreadMetrics, error) {
+	if !e.threadMetrics {
+		return nil, nil
+	}
+	// called from the metrics scrapes, which may run concurrently
+	maxEntries := int(e.bpfObjects.Threads.MaxEntries())
+	keys := make([]uint32, maxEntries)
+	values := make([]keplerThreadMetricsT, maxEntries)
+	threads := make([]ThreadMetrics, 0, maxEntries)
+	var cursor ebpf.MapBatchCursor
+	for {
+		count, err := e.bpfObjects.Threads.BatchLookup(&cursor, keys, values, &ebpf.BatchOptions{})
+		for i := 0; i < count; i++ {
+			threads = append(threads, newThreadMetrics(keys[i], &values[i]))
+		}
+		if errors.Is(err, ebpf.ErrKeyNotExist) || (err == nil && count == 0) {
+			break
+		}
+		if err != nil {
+			return nil, fmt.Errorf("failed to batch lookup the threads: %v", err)
+		}
+	}
+	return threads, nil
+}
+
+// CollectSliceHistograms reads the cgroup_slices map without draining it, the histograms are cumulative
+func (e *exporter) CollectSliceHistograms() (map[uint64]SliceHistogram, error) {
+	if !e.sliceHistograms {
+		return nil, nil
+	}
+	// called from the metrics scrapes, which may run concurrently
+	maxEntries := int(e.bpfObjects.CgroupSlices.MaxEntries())
+	keys := make([]uint64, maxEntries)
+	values := make([]SliceHistogram, maxEntries)
+	histograms := make(map[uint64]SliceHistogram)
+	var cursor ebpf.MapBatchCursor
+	for {
+		count, err := e.bpfObjects.CgroupSlices.BatchLookup(&cursor, keys, values, &ebpf.BatchOptions{})
+		for i := 0; i < count; i++ {
+			histograms[keys[i]] = values[i]
+		}
+		if errors.Is(err, ebpf.ErrKeyNotExist) || (err == nil && count == 0) {
+			break
+		}
+		if err != nil {
+			return nil, fmt.Errorf("failed to batch lookup the slice histograms: %v", err)
+		}
+	}
+	return histograms, nil
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -248,6 +1159,13 @@ func unixClosePerfEvents(fds []int) {
 	}
 }
 
+func boolToInt32(b bool) int32 {
+	if b {
+		return 1
+	}
+	return 0
+}
+
 func getCPUCores() int {
 	cores := runtime.NumCPU()
 	if cpu, err := ghw.CPU(); err == nil {
@@ -0,0 +1,54 @@
+//go:build !darwin
+// +build !darwin
+
+package bpf
+
+import (
+	"unsafe"
+
+	"github.com/cilium/ebpf"
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+var _ = Describe("Embedded eBPF specs", func() {
+	It("should have the maps adjusted by the exporter", func() {
+		specs, err := loadKepler()
+		Expect(err).NotTo(HaveOccurred())
+		maps, err := lookupMapSpecs(specs, "processes", "processes_epochs", "cpu_power_state")
+		Expect(err).NotTo(HaveOccurred())
+		Expect(maps).To(HaveLen(3))
+	})
+
+	It("should match the generated bindings", func() {
+		// objects that were not regenerated with the sources lack programs or maps, or have other value sizes
+		specs, err := loadKepler()
+		Expect(err).NotTo(HaveOccurred())
+		var bindings keplerSpecs
+		Expect(specs.Assign(&bindings)).To(Succeed())
+
+		values := map[string]uintptr{
+			"processes":       unsafe.Sizeof(keplerProcessMetricsT{}),
+			"cgroups":         unsafe.Sizeof(keplerProcessMetricsT{}),
+			"process_io":      unsafe.Sizeof(keplerProcessIoT{}),
+			"process_info":    unsafe.Sizeof(keplerProcessInfoT{}),
+			"cpu_power_state": unsafe.Sizeof(keplerCpuPowerStateT{}),
+			"prog_stats":      unsafe.Sizeof(keplerProgStatsT{}),
+			"runtime_config":  unsafe.Sizeof(keplerRuntimeConfigT{}),
+		}
+		for name, size := range values {
+			Expect(specs.Maps).To(HaveKey(name))
+			Expect(int(specs.Maps[name].ValueSize)).To(Equal(int(size)), name)
+		}
+	})
+
+	It("should fail on a missing map instead of panicking", func() {
+		specs := &ebpf.CollectionSpec{Maps: map[string]*ebpf.MapSpec{
+			"processes_epochs": {Name: "processes_epochs", Type: ebpf.ArrayOfMaps},
+		}}
+		_, err := lookupMapSpecs(specs, "cpu_power_state")
+		Expect(err).To(MatchError(ContainSubstring("cpu_power_state")))
+		_, err = lookupMapSpecs(specs, "processes_epochs")
+		Expect(err).To(MatchError(ContainSubstring("inner map")))
+	})
+})
@@ -198,7 +198,7 @@ func (e *exporter) CollectProcesses() ([]ProcessMetrics, error) {
 	maxEntries := e.bpfObjects.Processes.MaxEntries()
 	total := 0
 	deleteKeys := make([]uint32, maxEntries)
-	deleteValues := make([]ProcessMetrics, maxEntries)
+	deleteValues := make([]keplerProcessMetricsT, maxEntries)
 	var cursor ebpf.MapBatchCursor
 	for {
 		count, err := e.bpfObjects.Processes.BatchLookupAndDelete(
@@ -215,8 +215,32 @@ func (e *exporter) CollectProcesses() ([]ProcessMetrics, error) {
 			return nil, fmt.Errorf("failed to batch lookup and delete: %v", err)
 		}
 	}
+	processes := make([]ProcessMetrics, total)
+	for i := range processes {
+		processes[i] = newProcessMetrics(&deleteValues[i], processIdentity{})
+	}
 	klog.V(5).Infof("collected %d process samples in %v", total, time.Since(start))
-	return deleteValues[:total], nil
+	return processes, nil
+}
+
+func (e *exporter) CollectProgStats() (map[string]ProgStats, error) {
+	return nil, nil
+}
+
+func (e *exporter) CollectSampleRates() ([]uint32, error) {
+	return nil, nil
+}
+
+func (e *exporter) CollectCPUPowerStates() ([]CPUPowerState, error) {
+	return nil, nil
+}
+
+func (e *exporter) CollectThreads() ([]ThreadMetrics, error) {
+	return nil, nil
+}
+
+func (e *exporter) CollectSliceHistograms() (map[uint64]SliceHistogram, error) {
+	return nil, nil
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -1,3 +1,3 @@
 package bpf
 
-//go:generate go run github.com/cilium/ebpf/cmd/bpf2go@v0.15.0 kepler ../../bpf/kepler.bpf.c -- -I../../bpf/include
+//go:generate go run github.com/cilium/ebpf/cmd/bpf2go@v0.15.0 -type process_exit_t kepler ../../bpf/kepler.bpf.c -- -I../../bpf/include
@@ -12,15 +12,99 @@ import (
 	"github.com/cilium/ebpf"
 )
 
+type keplerCpuPowerStateT struct {
+	LastTs     uint64
+	FreqMhz    uint32
+	IdleState  uint32
+	BusyTimeNs uint64
+	BusyMhzUs  uint64
+	IdleTimeNs [10]uint64
+}
+
+type keplerHwCountersT struct {
+	CpuCycles  uint64
+	CpuInstr   uint64
+	CacheMiss  uint64
+	Generation uint64
+}
+
+type keplerPageCacheStateT struct {
+	Tgid    uint32
+	Pending uint32
+	Counter uint32
+}
+
+type keplerProcessExitT struct {
+	Metrics keplerProcessMetricsT
+	Io      keplerProcessIoT
+	Info    keplerProcessInfoT
+}
+
+type keplerProcessInfoT struct {
+	CgroupId         uint64
+	AncestorCgroupId uint64
+	Comm             [16]int8
+}
+
+type keplerProcessIoT struct {
+	SoftirqTimeNs [3]uint64
+	BlockIoBytes  uint64
+	NetTxBytes    uint64
+	NetRxBytes    uint64
+	VecNr         [3]uint32
+	_             [4]byte
+}
+
 type keplerProcessMetricsT struct {
-	CgroupId       uint64
-	Pid            uint64
 	ProcessRunTime uint64
 	CpuCycles      uint64
 	CpuInstr       uint64
 	CacheMiss      uint64
 	PageCacheHit   uint64
-	VecNr          [10]uint16
+	Pid            uint32
+	_              [4]byte
+}
+
+type keplerProgStatsT struct {
+	RunCount          uint64
+	RunTimeNs         uint64
+	MapUpdateFailures uint64
+	RegisterRaces     uint64
+	TimestampMisses   uint64
+}
+
+type keplerRuntimeConfigT struct {
+	SampleRate uint32
+	Hw         uint32
+}
+
+type keplerSampleStateT struct {
+	WindowStart    uint64
+	WindowSwitches uint64
+	SampleRate     uint32
+	Skipped        uint32
+}
+
+type keplerSliceHistogramT struct {
+	Buckets [24]uint64
+	SumUs   uint64
+}
+
+type keplerSoftirqStateT struct {
+	EntryTs       uint64
+	Vec           uint32
+	Tgid          uint32
+	PendingNr     [3]uint32
+	_             [4]byte
+	PendingTimeNs [3]uint64
+}
+
+type keplerThreadMetricsT struct {
+	ProcessRunTime uint64
+	CpuCycles      uint64
+	CpuInstr       uint64
+	CacheMiss      uint64
+	Tgid           uint32
 	Comm           [16]int8
 	_              [4]byte
 }
@@ -66,24 +150,51 @@ type keplerSpecs struct {
 //
 // It can be passed ebpf.CollectionSpec.Assign.
 type keplerProgramSpecs struct {
-	KeplerIrqTrace         *ebpf.ProgramSpec `ebpf:"kepler_irq_trace"`
-	KeplerReadPageTrace    *ebpf.ProgramSpec `ebpf:"kepler_read_page_trace"`
-	KeplerSchedSwitchTrace *ebpf.ProgramSpec `ebpf:"kepler_sched_switch_trace"`
-	KeplerWritePageTrace   *ebpf.ProgramSpec `ebpf:"kepler_write_page_trace"`
+	KeplerBlockRqIssueTrace     *ebpf.ProgramSpec `ebpf:"kepler_block_rq_issue_trace"`
+	KeplerCpuFrequencyTrace     *ebpf.ProgramSpec `ebpf:"kepler_cpu_frequency_trace"`
+	KeplerCpuIdleTrace          *ebpf.ProgramSpec `ebpf:"kepler_cpu_idle_trace"`
+	KeplerIrqTrace              *ebpf.ProgramSpec `ebpf:"kepler_irq_trace"`
+	KeplerReadPageTrace         *ebpf.ProgramSpec `ebpf:"kepler_read_page_trace"`
+	KeplerSchedProcessExecTrace *ebpf.ProgramSpec `ebpf:"kepler_sched_process_exec_trace"`
+	KeplerSchedProcessExitTrace *ebpf.ProgramSpec `ebpf:"kepler_sched_process_exit_trace"`
+	KeplerSchedSwitchTrace      *ebpf.ProgramSpec `ebpf:"kepler_sched_switch_trace"`
+	KeplerSockRecvTrace         *ebpf.ProgramSpec `ebpf:"kepler_sock_recv_trace"`
+	KeplerSockSendTrace         *ebpf.ProgramSpec `ebpf:"kepler_sock_send_trace"`
+	KeplerSoftirqExitTrace      *ebpf.ProgramSpec `ebpf:"kepler_softirq_exit_trace"`
+	KeplerTaskIter              *ebpf.ProgramSpec `ebpf:"kepler_task_iter"`
+	KeplerWritePageTrace        *ebpf.ProgramSpec `ebpf:"kepler_write_page_trace"`
 }
 
 // keplerMapSpecs contains maps before they are loaded into the kernel.
 //
 // It can be passed ebpf.CollectionSpec.Assign.
 type keplerMapSpecs struct {
-	CacheMiss                  *ebpf.MapSpec `ebpf:"cache_miss"`
 	CacheMissEventReader       *ebpf.MapSpec `ebpf:"cache_miss_event_reader"`
-	CpuCycles                  *ebpf.MapSpec `ebpf:"cpu_cycles"`
+	CgroupSlices               *ebpf.MapSpec `ebpf:"cgroup_slices"`
+	Cgroups                    *ebpf.MapSpec `ebpf:"cgroups"`
+	CgroupsEpochs              *ebpf.MapSpec `ebpf:"cgroups_epochs"`
+	CgroupsShadow              *ebpf.MapSpec `ebpf:"cgroups_shadow"`
+	CounterSchedSwitch         *ebpf.MapSpec `ebpf:"counter_sched_switch"`
 	CpuCyclesEventReader       *ebpf.MapSpec `ebpf:"cpu_cycles_event_reader"`
-	CpuInstructions            *ebpf.MapSpec `ebpf:"cpu_instructions"`
+	CpuHwCounters              *ebpf.MapSpec `ebpf:"cpu_hw_counters"`
 	CpuInstructionsEventReader *ebpf.MapSpec `ebpf:"cpu_instructions_event_reader"`
+	CpuPowerState              *ebpf.MapSpec `ebpf:"cpu_power_state"`
+	PageCacheState             *ebpf.MapSpec `ebpf:"page_cache_state"`
 	PidTimeMap                 *ebpf.MapSpec `ebpf:"pid_time_map"`
+	ProcessExits               *ebpf.MapSpec `ebpf:"process_exits"`
+	ProcessInfo                *ebpf.MapSpec `ebpf:"process_info"`
+	ProcessIo                  *ebpf.MapSpec `ebpf:"process_io"`
+	ProcessIoEpochs            *ebpf.MapSpec `ebpf:"process_io_epochs"`
+	ProcessIoShadow            *ebpf.MapSpec `ebpf:"process_io_shadow"`
 	Processes                  *ebpf.MapSpec `ebpf:"processes"`
+	ProcessesEpochs            *ebpf.MapSpec `ebpf:"processes_epochs"`
+	ProcessesShadow            *ebpf.MapSpec `ebpf:"processes_shadow"`
+	ProgStats                  *ebpf.MapSpec `ebpf:"prog_stats"`
+	RuntimeConfig              *ebpf.MapSpec `ebpf:"runtime_config"`
+	SampleState                *ebpf.MapSpec `ebpf:"sample_state"`
+	SoftirqState               *ebpf.MapSpec `ebpf:"softirq_state"`
+	TaskTimeMap                *ebpf.MapSpec `ebpf:"task_time_map"`
+	Threads                    *ebpf.MapSpec `ebpf:"threads"`
 }
 
 // keplerObjects contains all objects after they have been loaded into the kernel.
@@ -105,26 +216,62 @@ func (o *keplerObjects) Close() error {
 //
 // It can be passed to loadKeplerObjects or ebpf.CollectionSpec.LoadAndAssign.
 type keplerMaps struct {
-	CacheMiss                  *ebpf.Map `ebpf:"cache_miss"`
 	CacheMissEventReader       *ebpf.Map `ebpf:"cache_miss_event_reader"`
-	CpuCycles                  *ebpf.Map `ebpf:"cpu_cycles"`
+	CgroupSlices               *ebpf.Map `ebpf:"cgroup_slices"`
+	Cgroups                    *ebpf.Map `ebpf:"cgroups"`
+	CgroupsEpochs              *ebpf.Map `ebpf:"cgroups_epochs"`
+	CgroupsShadow              *ebpf.Map `ebpf:"cgroups_shadow"`
+	CounterSchedSwitch         *ebpf.Map `ebpf:"counter_sched_switch"`
 	CpuCyclesEventReader       *ebpf.Map `ebpf:"cpu_cycles_event_reader"`
-	CpuInstructions            *ebpf.Map `ebpf:"cpu_instructions"`
+	CpuHwCounters              *ebpf.Map `ebpf:"cpu_hw_counters"`
 	CpuInstructionsEventReader *ebpf.Map `ebpf:"cpu_instructions_event_reader"`
+	CpuPowerState              *ebpf.Map `ebpf:"cpu_power_state"`
+	PageCacheState             *ebpf.Map `ebpf:"page_cache_state"`
 	PidTimeMap                 *ebpf.Map `ebpf:"pid_time_map"`
+	ProcessExits               *ebpf.Map `ebpf:"process_exits"`
+	ProcessInfo                *ebpf.Map `ebpf:"process_info"`
+	ProcessIo                  *ebpf.Map `ebpf:"process_io"`
+	ProcessIoEpochs            *ebpf.Map `ebpf:"process_io_epochs"`
+	ProcessIoShadow            *ebpf.Map `ebpf:"process_io_shadow"`
 	Processes                  *ebpf.Map `ebpf:"processes"`
+	ProcessesEpochs            *ebpf.Map `ebpf:"processes_epochs"`
+	ProcessesShadow            *ebpf.Map `ebpf:"processes_shadow"`
+	ProgStats                  *ebpf.Map `ebpf:"prog_stats"`
+	RuntimeConfig              *ebpf.Map `ebpf:"runtime_config"`
+	SampleState                *ebpf.Map `ebpf:"sample_state"`
+	SoftirqState               *ebpf.Map `ebpf:"softirq_state"`
+	TaskTimeMap                *ebpf.Map `ebpf:"task_time_map"`
+	Threads                    *ebpf.Map `ebpf:"threads"`
 }
 
 func (m *keplerMaps) Close() error {
 	return _KeplerClose(
-		m.CacheMiss,
 		m.CacheMissEventReader,
-		m.CpuCycles,
+		m.CgroupSlices,
+		m.Cgroups,
+		m.CgroupsEpochs,
+		m.CgroupsShadow,
+		m.CounterSchedSwitch,
 		m.CpuCyclesEventReader,
-		m.CpuInstructions,
+		m.CpuHwCounters,
 		m.CpuInstructionsEventReader,
+		m.CpuPowerState,
+		m.PageCacheState,
 		m.PidTimeMap,
+		m.ProcessExits,
+		m.ProcessInfo,
+		m.ProcessIo,
+		m.ProcessIoEpochs,
+		m.ProcessIoShadow,
 		m.Processes,
+		m.ProcessesEpochs,
+		m.ProcessesShadow,
+		m.ProgStats,
+		m.RuntimeConfig,
+		m.SampleState,
+		m.SoftirqState,
+		m.TaskTimeMap,
+		m.Threads,
 	)
 }
 
@@ -132,17 +279,35 @@ func (m *keplerMaps) Close() error {
 //
 // It can be passed to loadKeplerObjects or ebpf.CollectionSpec.LoadAndAssign.
 type keplerPrograms struct {
-	KeplerIrqTrace         *ebpf.Program `ebpf:"kepler_irq_trace"`
-	KeplerReadPageTrace    *ebpf.Program `ebpf:"kepler_read_page_trace"`
-	KeplerSchedSwitchTrace *ebpf.Program `ebpf:"kepler_sched_switch_trace"`
-	KeplerWritePageTrace   *ebpf.Program `ebpf:"kepler_write_page_trace"`
+	KeplerBlockRqIssueTrace     *ebpf.Program `ebpf:"kepler_block_rq_issue_trace"`
+	KeplerCpuFrequencyTrace     *ebpf.Program `ebpf:"kepler_cpu_frequency_trace"`
+	KeplerCpuIdleTrace          *ebpf.Program `ebpf:"kepler_cpu_idle_trace"`
+	KeplerIrqTrace              *ebpf.Program `ebpf:"kepler_irq_trace"`
+	KeplerReadPageTrace         *ebpf.Program `ebpf:"kepler_read_page_trace"`
+	KeplerSchedProcessExecTrace *ebpf.Program `ebpf:"kepler_sched_process_exec_trace"`
+	KeplerSchedProcessExitTrace *ebpf.Program `ebpf:"kepler_sched_process_exit_trace"`
+	KeplerSchedSwitchTrace      *ebpf.Program `ebpf:"kepler_sched_switch_trace"`
+	KeplerSockRecvTrace         *ebpf.Program `ebpf:"kepler_sock_recv_trace"`
+	KeplerSockSendTrace         *ebpf.Program `ebpf:"kepler_sock_send_trace"`
+	KeplerSoftirqExitTrace      *ebpf.Program `ebpf:"kepler_softirq_exit_trace"`
+	KeplerTaskIter              *ebpf.Program `ebpf:"kepler_task_iter"`
+	KeplerWritePageTrace        *ebpf.Program `ebpf:"kepler_write_page_trace"`
 }
 
 func (p *keplerPrograms) Close() error {
 	return _KeplerClose(
+		p.KeplerBlockRqIssueTrace,
+		p.KeplerCpuFrequencyTrace,
+		p.KeplerCpuIdleTrace,
 		p.KeplerIrqTrace,
 		p.KeplerReadPageTrace,
+		p.KeplerSchedProcessExecTrace,
+		p.KeplerSchedProcessExitTrace,
 		p.KeplerSchedSwitchTrace,
+		p.KeplerSockRecvTrace,
+		p.KeplerSockSendTrace,
+		p.KeplerSoftirqExitTrace,
+		p.KeplerTaskIter,
 		p.KeplerWritePageTrace,
 	)
 }
@@ -0,0 +1,205 @@
+//go:build !darwin
+// +build !darwin
+
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package bpf
+
+import (
+	"errors"
+	"fmt"
+	"hash/fnv"
+	"io"
+	"os"
+	"path/filepath"
+	"sort"
+
+	"github.com/cilium/ebpf"
+	"github.com/cilium/ebpf/btf"
+	"github.com/cilium/ebpf/link"
+	"k8s.io/klog/v2"
+)
+
+// pinnedMaps are the maps whose entries carry over a restart of the exporter: the metrics of the current interval,
+// the process identities, the on-CPU timestamps and the cumulative metrics. The perf event readers and the hardware
+// counter baselines are not pinned, since the perf events are opened again and their counts restart. The epochs
+// outer maps are pinned with their inner maps, so that the next exporter keeps writing to and drains the inner map
+// that was active.
+var pinnedMaps = []string{
+	"processes", "processes_shadow", "processes_epochs",
+	"cgroups", "cgroups_shadow", "cgroups_epochs",
+	"process_io", "process_io_shadow", "process_io_epochs",
+	"process_info",
+	"pid_time_map", "task_time_map",
+	"threads", "cgroup_slices",
+	"cpu_power_state",
+	"prog_stats",
+}
+
+// linksDir is the directory of the pinned links under the layout directory
+const linksDir = "links"
+
+// mapLayoutVersion returns a hash of the layout of the pinned maps: their type, sizes, flags and the offsets and sizes
+// of the fields of their key and value. The maps of a previous exporter are only reused with the same layout.
+func mapLayoutVersion(specs map[string]*ebpf.MapSpec, names []string) string {
+	h := fnv.New64a()
+	sorted := append([]string(nil), names...)
+	sort.Strings(sorted)
+	for _, name := range sorted {
+		spec, found := specs[name]
+		if !found {
+			continue
+		}
+		fmt.Fprintf(h, "%s:%v:%d:%d:%d:%d;", name, spec.Type, spec.KeySize, spec.ValueSize, spec.MaxEntries, spec.Flags)
+		writeTypeLayout(h, spec.Key)
+		writeTypeLayout(h, spec.Value)
+	}
+	return fmt.Sprintf("%016x", h.Sum64())
+}
+
+func writeTypeLayout(w io.Writer, typ btf.Type) {
+	if typ == nil {
+		return
+	}
+	var members []btf.Member
+	switch t := btf.UnderlyingType(typ).(type) {
+	case *btf.Struct:
+		members = t.Members
+	case *btf.Union:
+		members = t.Members
+	}
+	for _, m := range members {
+		size, _ := btf.Sizeof(m.Type)
+		fmt.Fprintf(w, "%s@%d+%d,", m.Name, m.Offset, size)
+	}
+	fmt.Fprint(w, ";")
+}
+
+// pinLayout prepares the pinned maps of the specs under the pin path, in a directory of their layout version, and
+// returns that directory and whether it already held the maps of a previous exporter
+func pinLayout(specs *ebpf.CollectionSpec, pinPath string) (string, bool, error) {
+	for _, name := range pinnedMaps {
+		if spec, found := specs.Maps[name]; found {
+			spec.Pinning = ebpf.PinByName
+		}
+	}
+	dir := filepath.Join(pinPath, mapLayoutVersion(specs.Maps, pinnedMaps))
+	if err := os.MkdirAll(dir, 0o700); err != nil {
+		return "", false, fmt.Errorf("failed to create the pin directory %s: %v", dir, err)
+	}
+	reused := loadPinnedMaps(specs, dir)
+	if reused {
+		// the loader would reset the slots of the pinned maps of maps to their initial inner maps
+		for _, name := range pinnedMaps {
+			if spec, found := specs.Maps[name]; found && (spec.Type == ebpf.ArrayOfMaps || spec.Type == ebpf.HashOfMaps) {
+				spec.Contents = nil
+			}
+		}
+	}
+	return dir, reused, nil
+}
+
+// loadPinnedMaps returns whether every pinned map of the specs can be loaded from the layout directory. Otherwise the
+// maps that are pinned, e.g. by an exporter that stopped while pinning them, are unpinned so that they are all created
+// again instead of mixing new and previous entries.
+func loadPinnedMaps(specs *ebpf.CollectionSpec, dir string) bool {
+	loaded := true
+	for _, name := range pinnedMaps {
+		if _, found := specs.Maps[name]; !found {
+			continue
+		}
+		m, err := ebpf.LoadPinnedMap(filepath.Join(dir, name), nil)
+		if err != nil {
+			if !errors.Is(err, os.ErrNotExist) {
+				klog.Warningf("failed to load the pinned map %s: %v", name, err)
+			}
+			loaded = false
+			continue
+		}
+		m.Close()
+	}
+	if loaded {
+		return true
+	}
+	for _, name := range pinnedMaps {
+		if err := os.Remove(filepath.Join(dir, name)); err != nil && !errors.Is(err, os.ErrNotExist) {
+			klog.Warningf("failed to unpin the map %s: %v", name, err)
+		}
+	}
+	return false
+}
+
+// removeStaleLayouts unpins the maps and links of the other layouts under the pin path, e.g. of an older version
+func removeStaleLayouts(pinPath, dir string) {
+	entries, err := os.ReadDir(pinPath)
+	if err != nil {
+		return
+	}
+	for _, entry := range entries {
+		path := filepath.Join(pinPath, entry.Name())
+		if !entry.IsDir() || path == dir {
+			continue
+		}
+		unpinLinks(path)
+		if err := os.RemoveAll(path); err != nil {
+			klog.Warningf("failed to remove the stale eBPF pins %s: %v", path, err)
+			continue
+		}
+		klog.Infof("Removed the stale eBPF pins %s", path)
+	}
+}
+
+// unpinLinks detaches the programs of the links pinned under a layout directory by a previous exporter
+func unpinLinks(dir string) {
+	entries, err := os.ReadDir(filepath.Join(dir, linksDir))
+	if err != nil {
+		return
+	}
+	for _, entry := range entries {
+		path := filepath.Join(dir, linksDir, entry.Name())
+		l, err := link.LoadPinnedLink(path, nil)
+		if err != nil {
+			klog.Warningf("failed to load the pinned link %s: %v", path, err)
+			_ = os.Remove(path)
+			continue
+		}
+		if err := l.Unpin(); err != nil {
+			klog.Warningf("failed to unpin the link %s: %v", path, err)
+		}
+		l.Close()
+	}
+}
+
+// pinLinks pins the attached links, so that the programs keep updating the pinned maps until the next exporter
+// attaches its own
+func pinLinks(dir string, links map[string]link.Link) {
+	if err := os.MkdirAll(filepath.Join(dir, linksDir), 0o700); err != nil {
+		klog.Warningf("failed to create the links pin directory: %v", err)
+		return
+	}
+	for name, l := range links {
+		if l == nil {
+			continue
+		}
+		if err := l.Pin(filepath.Join(dir, linksDir, name)); err != nil {
+			// e.g. the tracepoints attached through perf events on older kernels
+			if !errors.Is(err, ebpf.ErrNotSupported) {
+				klog.Warningf("failed to pin the link of %s: %v", name, err)
+			}
+		}
+	}
+}
@@ -0,0 +1,128 @@
+//go:build !darwin
+// +build !darwin
+
+package bpf
+
+import (
+	"os"
+	"path/filepath"
+
+	"github.com/cilium/ebpf"
+	"github.com/cilium/ebpf/btf"
+	"github.com/cilium/ebpf/rlimit"
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+	"golang.org/x/sys/unix"
+)
+
+// bpffsTempDir returns a temporary directory in bpffs, skipping the spec if bpffs is not mounted
+func bpffsTempDir() string {
+	var st unix.Statfs_t
+	if err := unix.Statfs("/sys/fs/bpf", &st); err != nil || st.Type != unix.BPF_FS_MAGIC {
+		Skip("requires bpffs mounted in /sys/fs/bpf")
+	}
+	dir, err := os.MkdirTemp("/sys/fs/bpf", "kepler-test")
+	if err != nil {
+		Skip("requires a writable bpffs: " + err.Error())
+	}
+	DeferCleanup(os.RemoveAll, dir)
+	return dir
+}
+
+var _ = Describe("Pinned map layout", func() {
+	u64 := &btf.Int{Name: "u64", Size: 8}
+	newSpecs := func(secondOffset btf.Bits) map[string]*ebpf.MapSpec {
+		value := &btf.Struct{Name: "process_metrics_t", Size: 16, Members: []btf.Member{
+			{Name: "process_run_time", Type: u64, Offset: 0},
+			{Name: "cpu_cycles", Type: u64, Offset: secondOffset},
+		}}
+		return map[string]*ebpf.MapSpec{
+			"processes":  {Name: "processes", Type: ebpf.LRUHash, KeySize: 4, ValueSize: 16, MaxEntries: 32768, Value: value},
+			"prog_stats": {Name: "prog_stats", Type: ebpf.PerCPUArray, KeySize: 4, ValueSize: 8, MaxEntries: 6},
+		}
+	}
+
+	It("should only change with the layout of the pinned maps", func() {
+		version := mapLayoutVersion(newSpecs(64), []string{"processes"})
+		Expect(mapLayoutVersion(newSpecs(64), []string{"processes"})).To(Equal(version))
+		Expect(mapLayoutVersion(newSpecs(64), []string{"processes", "missing"})).To(Equal(version))
+
+		// a field moved within the same value size
+		Expect(mapLayoutVersion(newSpecs(32), []string{"processes"})).NotTo(Equal(version))
+
+		resized := newSpecs(64)
+		resized["processes"].MaxEntries = 1
+		Expect(mapLayoutVersion(resized, []string{"processes"})).NotTo(Equal(version))
+
+		unpinned := newSpecs(64)
+		unpinned["prog_stats"].MaxEntries = 12
+		Expect(mapLayoutVersion(unpinned, []string{"processes"})).To(Equal(version))
+	})
+
+	It("should only reuse the pin directory when all the pinned maps load", func() {
+		specs := &ebpf.CollectionSpec{Maps: newSpecs(64)}
+		pinPath := GinkgoT().TempDir()
+		dir, reused, err := pinLayout(specs, pinPath)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(reused).To(BeFalse())
+		Expect(specs.Maps["processes"].Pinning).To(Equal(ebpf.PinByName))
+
+		// the directory of a previous exporter without its maps, or holding a file that is not a map
+		stale := filepath.Join(dir, "processes")
+		Expect(os.WriteFile(stale, nil, 0o600)).To(Succeed())
+		again, reused, err := pinLayout(specs, pinPath)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(again).To(Equal(dir))
+		Expect(reused).To(BeFalse())
+		Expect(stale).NotTo(BeAnExistingFile())
+	})
+
+	It("should keep the active inner map of the pinned maps of maps", func() {
+		pinPath := bpffsTempDir()
+		Expect(rlimit.RemoveMemlock()).To(Succeed())
+		newEpochSpecs := func() *ebpf.CollectionSpec {
+			inner := &ebpf.MapSpec{Type: ebpf.Hash, KeySize: 4, ValueSize: 8, MaxEntries: 4}
+			return &ebpf.CollectionSpec{Maps: map[string]*ebpf.MapSpec{
+				"processes":        {Name: "processes", Type: ebpf.Hash, KeySize: 4, ValueSize: 8, MaxEntries: 4},
+				"processes_shadow": {Name: "processes_shadow", Type: ebpf.Hash, KeySize: 4, ValueSize: 8, MaxEntries: 4},
+				"processes_epochs": {
+					Name: "processes_epochs", Type: ebpf.ArrayOfMaps, KeySize: 4, ValueSize: 4, MaxEntries: 1,
+					InnerMap: inner, Contents: []ebpf.MapKV{{Key: uint32(0), Value: "processes"}},
+				},
+			}}
+		}
+		type epochObjects struct {
+			Processes       *ebpf.Map `ebpf:"processes"`
+			ProcessesShadow *ebpf.Map `ebpf:"processes_shadow"`
+			ProcessesEpochs *ebpf.Map `ebpf:"processes_epochs"`
+		}
+		load := func() (epochObjects, epochMaps, bool) {
+			specs := newEpochSpecs()
+			dir, reused, err := pinLayout(specs, pinPath)
+			Expect(err).NotTo(HaveOccurred())
+			var objs epochObjects
+			Expect(specs.LoadAndAssign(&objs, &ebpf.CollectionOptions{Maps: ebpf.MapOptions{PinPath: dir}})).To(Succeed())
+			DeferCleanup(objs.ProcessesEpochs.Close)
+			DeferCleanup(objs.ProcessesShadow.Close)
+			DeferCleanup(objs.Processes.Close)
+			return objs, epochMaps{outer: objs.ProcessesEpochs, active: objs.Processes, inactive: objs.ProcessesShadow}, reused
+		}
+
+		// the previous exporter drained processes and left processes_shadow active with the entries of the interval
+		_, m, reused := load()
+		Expect(reused).To(BeFalse())
+		_, err := m.swap()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(m.active.Put(uint32(42), uint64(1000))).To(Succeed())
+
+		objs, m, reused := load()
+		Expect(reused).To(BeTrue())
+		Expect(m.loadActive()).To(Succeed())
+		drained, err := m.swap()
+		Expect(err).NotTo(HaveOccurred())
+		var runTime uint64
+		Expect(drained.Lookup(uint32(42), &runTime)).To(Succeed())
+		Expect(runTime).To(Equal(uint64(1000)))
+		Expect(m.active).To(BeIdenticalTo(objs.Processes))
+	})
+})
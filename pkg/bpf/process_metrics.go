@@ -0,0 +1,142 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package bpf
+
+// perCPUBatchSize is the number of keys read per batch from the per-CPU processes map.
+// Each key holds one value per possible CPU, so the map is drained in chunks instead of all at once.
+const perCPUBatchSize = 1024
+
+// exitPollTimeoutMs is how long the process exit consumer waits for new records before checking if it should stop.
+const exitPollTimeoutMs = 100
+
+// reducePerCPUProcessMetrics sums the per-CPU slots of one entry of the per-CPU processes map.
+func reducePerCPUProcessMetrics(tgid uint32, perCPU []keplerProcessMetricsT) keplerProcessMetricsT {
+	p := keplerProcessMetricsT{Pid: tgid}
+	for i := range perCPU {
+		v := &perCPU[i]
+		p.ProcessRunTime += v.ProcessRunTime
+		p.CpuCycles += v.CpuCycles
+		p.CpuInstr += v.CpuInstr
+		p.CacheMiss += v.CacheMiss
+		p.PageCacheHit += v.PageCacheHit
+	}
+	return p
+}
+
+// addProcessIO adds the counters of a process_io entry to the metrics of its process or cgroup. The softirq counters
+// of the entry start at the NET_TX vector.
+func addProcessIO(p *ProcessMetrics, io *keplerProcessIoT) {
+	for i := range io.VecNr {
+		p.VecNr[IRQNetTX+i] += io.VecNr[i]
+		p.SoftirqTimeNs[IRQNetTX+i] += io.SoftirqTimeNs[i]
+	}
+	p.BlockIoBytes += io.BlockIoBytes
+	p.NetTxBytes += io.NetTxBytes
+	p.NetRxBytes += io.NetRxBytes
+}
+
+// processIdentity is the process_info entry of a process, cached by pid so that the map is only read for
+// processes that were not seen in the previous collection
+type processIdentity struct {
+	cgroupID         uint64
+	ancestorCgroupID uint64
+	comm             string
+}
+
+// commToString converts a NUL-terminated task comm
+func commToString(c *[16]int8) string {
+	var comm [len(c)]byte
+	n := 0
+	for ; n < len(c) && c[n] != 0; n++ {
+		comm[n] = byte(c[n])
+	}
+	return string(comm[:n])
+}
+
+func newProcessIdentity(info *keplerProcessInfoT) processIdentity {
+	return processIdentity{
+		cgroupID:         info.CgroupId,
+		ancestorCgroupID: info.AncestorCgroupId,
+		comm:             commToString(&info.Comm),
+	}
+}
+
+func newProcessMetrics(m *keplerProcessMetricsT, id processIdentity) ProcessMetrics {
+	return ProcessMetrics{
+		CgroupId:         id.cgroupID,
+		AncestorCgroupId: id.ancestorCgroupID,
+		Pid:              uint64(m.Pid),
+		ProcessRunTime:   m.ProcessRunTime,
+		CpuCycles:        m.CpuCycles,
+		CpuInstr:         m.CpuInstr,
+		CacheMiss:        m.CacheMiss,
+		PageCacheHit:     m.PageCacheHit,
+		Comm:             id.comm,
+	}
+}
+
+func newThreadMetrics(tid uint32, m *keplerThreadMetricsT) ThreadMetrics {
+	return ThreadMetrics{
+		Tid:            uint64(tid),
+		Tgid:           uint64(m.Tgid),
+		ProcessRunTime: m.ProcessRunTime,
+		CpuCycles:      m.CpuCycles,
+		CpuInstr:       m.CpuInstr,
+		CacheMiss:      m.CacheMiss,
+		Comm:           commToString(&m.Comm),
+	}
+}
+
+// cpuBusy is the idle state of a busy CPU in the cpu_power_state map
+const cpuBusy = ^uint32(0)
+
+// newCPUPowerState converts an entry of the cpu_power_state map, adding the time from its last transition to now, in
+// the clock of bpf_ktime_get_ns
+func newCPUPowerState(s *keplerCpuPowerStateT, now uint64) CPUPowerState {
+	p := CPUPowerState{
+		BusyTimeNs: s.BusyTimeNs,
+		BusyCycles: s.BusyMhzUs,
+		IdleTimeNs: s.IdleTimeNs,
+	}
+	if s.LastTs == 0 || now <= s.LastTs {
+		return p
+	}
+	delta := now - s.LastTs
+	if s.IdleState == cpuBusy {
+		p.BusyTimeNs += delta
+		p.BusyCycles += uint64(s.FreqMhz) * (delta / 1000)
+	} else if s.IdleState < MaxIdleStates {
+		p.IdleTimeNs[s.IdleState] += delta
+	}
+	return p
+}
+
+// ProgStatsNames are the names of the programs tracked in the prog_stats map, indexed by its key
+var ProgStatsNames = []string{"sched_switch", "softirq", "page_cache_hit", "process_exit", "io_bytes"}
+
+// reducePerCPUProgStats sums the per-CPU slots of one entry of the prog_stats map.
+func reducePerCPUProgStats(perCPU []ProgStats) ProgStats {
+	var s ProgStats
+	for i := range perCPU {
+		s.RunCount += perCPU[i].RunCount
+		s.RunTimeNs += perCPU[i].RunTimeNs
+		s.MapUpdateFailures += perCPU[i].MapUpdateFailures
+		s.RegisterRaces += perCPU[i].RegisterRaces
+		s.TimestampMisses += perCPU[i].TimestampMisses
+	}
+	return s
+}
@@ -0,0 +1,136 @@
+package bpf
+
+import (
+	"unsafe"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+var _ = Describe("Per-CPU process metrics", func() {
+	It("should sum the counters of all CPUs", func() {
+		perCPU := []keplerProcessMetricsT{
+			{ProcessRunTime: 10, CpuCycles: 100, CpuInstr: 1000, CacheMiss: 1, PageCacheHit: 2},
+			{Pid: 42, ProcessRunTime: 5, CpuCycles: 50, CpuInstr: 500, CacheMiss: 3},
+			{ProcessRunTime: 1, PageCacheHit: 4},
+		}
+
+		p := reducePerCPUProcessMetrics(42, perCPU)
+		Expect(p.Pid).To(Equal(uint32(42)))
+		Expect(p.ProcessRunTime).To(Equal(uint64(16)))
+		Expect(p.CpuCycles).To(Equal(uint64(150)))
+		Expect(p.CpuInstr).To(Equal(uint64(1500)))
+		Expect(p.CacheMiss).To(Equal(uint64(4)))
+		Expect(p.PageCacheHit).To(Equal(uint64(6)))
+	})
+})
+
+var _ = Describe("Process I/O counters", func() {
+	It("should add the softirqs of the tracked vectors and the I/O bytes", func() {
+		io := keplerProcessIoT{BlockIoBytes: 4096, NetTxBytes: 100, NetRxBytes: 1500}
+		io.VecNr[IRQNetRX-IRQNetTX] = 2
+		io.SoftirqTimeNs[IRQNetRX-IRQNetTX] = 7000
+		io.VecNr[IRQBlock-IRQNetTX] = 1
+
+		p := ProcessMetrics{BlockIoBytes: 512}
+		p.VecNr[IRQNetRX] = 3
+		addProcessIO(&p, &io)
+		Expect(p.VecNr[IRQNetTX]).To(BeZero())
+		Expect(p.VecNr[IRQNetRX]).To(Equal(uint32(5)))
+		Expect(p.SoftirqTimeNs[IRQNetRX]).To(Equal(uint64(7000)))
+		Expect(p.VecNr[IRQBlock]).To(Equal(uint32(1)))
+		Expect(p.BlockIoBytes).To(Equal(uint64(4608)))
+		Expect(p.NetTxBytes).To(Equal(uint64(100)))
+		Expect(p.NetRxBytes).To(Equal(uint64(1500)))
+	})
+})
+
+var _ = Describe("Process identity", func() {
+	It("should keep the process metrics in one cache line", func() {
+		Expect(int(unsafe.Sizeof(keplerProcessMetricsT{}))).To(BeNumerically("<=", 64))
+	})
+
+	It("should merge the process info into the metrics", func() {
+		info := keplerProcessInfoT{CgroupId: 7, AncestorCgroupId: 3}
+		for i, c := range "bash" {
+			info.Comm[i] = int8(c)
+		}
+		m := keplerProcessMetricsT{Pid: 42, ProcessRunTime: 5, PageCacheHit: 2}
+
+		p := newProcessMetrics(&m, newProcessIdentity(&info))
+		Expect(p.Pid).To(Equal(uint64(42)))
+		Expect(p.CgroupId).To(Equal(uint64(7)))
+		Expect(p.AncestorCgroupId).To(Equal(uint64(3)))
+		Expect(p.Comm).To(Equal("bash"))
+		Expect(p.ProcessRunTime).To(Equal(uint64(5)))
+		Expect(p.PageCacheHit).To(Equal(uint64(2)))
+	})
+
+	It("should keep a comm that fills the whole buffer", func() {
+		var info keplerProcessInfoT
+		for i := range info.Comm {
+			info.Comm[i] = 'a'
+		}
+		Expect(newProcessIdentity(&info).comm).To(HaveLen(16))
+	})
+})
+
+var _ = Describe("Thread metrics", func() {
+	It("should convert the threads entry of a thread", func() {
+		m := keplerThreadMetricsT{Tgid: 42, ProcessRunTime: 5, CpuCycles: 100, CpuInstr: 200, CacheMiss: 3}
+		for i, c := range "C2 CompilerThre" {
+			m.Comm[i] = int8(c)
+		}
+
+		t := newThreadMetrics(44, &m)
+		Expect(t.Tid).To(Equal(uint64(44)))
+		Expect(t.Tgid).To(Equal(uint64(42)))
+		Expect(t.Comm).To(Equal("C2 CompilerThre"))
+		Expect(t.ProcessRunTime).To(Equal(uint64(5)))
+		Expect(t.CpuCycles).To(Equal(uint64(100)))
+		Expect(t.CpuInstr).To(Equal(uint64(200)))
+		Expect(t.CacheMiss).To(Equal(uint64(3)))
+	})
+})
+
+var _ = Describe("Per-CPU program stats", func() {
+	It("should sum the counters of all CPUs", func() {
+		perCPU := []ProgStats{
+			{RunCount: 10, RunTimeNs: 1000, TimestampMisses: 1},
+			{RunCount: 5, RunTimeNs: 600, MapUpdateFailures: 2, RegisterRaces: 3},
+		}
+
+		s := reducePerCPUProgStats(perCPU)
+		Expect(s.RunCount).To(Equal(uint64(15)))
+		Expect(s.RunTimeNs).To(Equal(uint64(1600)))
+		Expect(s.MapUpdateFailures).To(Equal(uint64(2)))
+		Expect(s.RegisterRaces).To(Equal(uint64(3)))
+		Expect(s.TimestampMisses).To(Equal(uint64(1)))
+	})
+})
+
+var _ = Describe("CPU power state", func() {
+	It("should add the time since the last transition of a busy CPU", func() {
+		s := keplerCpuPowerStateT{LastTs: 1000, FreqMhz: 2000, IdleState: cpuBusy, BusyTimeNs: 5000, BusyMhzUs: 10}
+		s.IdleTimeNs[1] = 7
+
+		p := newCPUPowerState(&s, 3000)
+		Expect(p.BusyTimeNs).To(Equal(uint64(7000)))
+		Expect(p.BusyCycles).To(Equal(uint64(10 + 2000*2)))
+		Expect(p.IdleTimeNs[1]).To(Equal(uint64(7)))
+	})
+
+	It("should add the time since the last transition of an idle CPU", func() {
+		s := keplerCpuPowerStateT{LastTs: 1000, FreqMhz: 2000, IdleState: 2}
+
+		p := newCPUPowerState(&s, 3000)
+		Expect(p.BusyTimeNs).To(BeZero())
+		Expect(p.BusyCycles).To(BeZero())
+		Expect(p.IdleTimeNs[2]).To(Equal(uint64(2000)))
+	})
+
+	It("should not account a CPU without transitions", func() {
+		s := keplerCpuPowerStateT{FreqMhz: 2000}
+		Expect(newCPUPowerState(&s, 3000)).To(Equal(CPUPowerState{}))
+	})
+})
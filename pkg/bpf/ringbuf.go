@@ -0,0 +1,140 @@
+//go:build !darwin
+// +build !darwin
+
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package bpf
+
+import (
+	"fmt"
+	"os"
+	"sync/atomic"
+	"unsafe"
+
+	"github.com/cilium/ebpf"
+	"golang.org/x/sys/unix"
+)
+
+const (
+	// per include/uapi/linux/bpf.h
+	ringbufBusyBit    = uint32(1 << 31)
+	ringbufDiscardBit = uint32(1 << 30)
+	ringbufHeaderSize = 8
+)
+
+// ringbufReader consumes the records of a BPF_MAP_TYPE_RINGBUF map.
+// The consumer position lives in the first (writable) page of the map and the
+// producer position followed by the data area, which is mapped twice so that
+// records never wrap, in the read-only pages after it.
+// It has the Wait/Read subset of github.com/cilium/ebpf/ringbuf.Reader that the
+// exporter uses, so it can be replaced once that package is vendored.
+type ringbufReader struct {
+	epollFd  int
+	events   []unix.EpollEvent
+	consumer []byte
+	producer []byte
+	data     []byte
+	mask     uint64
+}
+
+func newRingbufReader(m *ebpf.Map) (*ringbufReader, error) {
+	if m.Type() != ebpf.RingBuf {
+		return nil, fmt.Errorf("map %s is not a ring buffer", m.String())
+	}
+	pageSize := os.Getpagesize()
+	size := int(m.MaxEntries())
+
+	consumer, err := unix.Mmap(m.FD(), 0, pageSize, unix.PROT_READ|unix.PROT_WRITE, unix.MAP_SHARED)
+	if err != nil {
+		return nil, fmt.Errorf("failed to mmap ring buffer consumer page: %w", err)
+	}
+	producer, err := unix.Mmap(m.FD(), int64(pageSize), pageSize+2*size, unix.PROT_READ, unix.MAP_SHARED)
+	if err != nil {
+		_ = unix.Munmap(consumer)
+		return nil, fmt.Errorf("failed to mmap ring buffer data pages: %w", err)
+	}
+	r := &ringbufReader{
+		epollFd:  -1,
+		events:   make([]unix.EpollEvent, 1),
+		consumer: consumer,
+		producer: producer,
+		data:     producer[pageSize:],
+		mask:     uint64(size - 1),
+	}
+
+	r.epollFd, err = unix.EpollCreate1(unix.EPOLL_CLOEXEC)
+	if err != nil {
+		r.Close()
+		return nil, fmt.Errorf("failed to create epoll instance: %w", err)
+	}
+	event := unix.EpollEvent{Events: unix.EPOLLIN, Fd: int32(m.FD())}
+	if err := unix.EpollCtl(r.epollFd, unix.EPOLL_CTL_ADD, m.FD(), &event); err != nil {
+		r.Close()
+		return nil, fmt.Errorf("failed to add ring buffer to epoll: %w", err)
+	}
+	return r, nil
+}
+
+// Wait blocks until records are available or the timeout (in milliseconds) expires.
+func (r *ringbufReader) Wait(timeoutMs int) error {
+	_, err := unix.EpollWait(r.epollFd, r.events, timeoutMs)
+	if err == unix.EINTR {
+		return nil
+	}
+	return err
+}
+
+// Read calls fn for every committed record and releases the records to the producer.
+// The sample passed to fn is only valid during the call.
+func (r *ringbufReader) Read(fn func(sample []byte)) {
+	consumerPos := (*uint64)(unsafe.Pointer(&r.consumer[0]))
+	producerPos := (*uint64)(unsafe.Pointer(&r.producer[0]))
+
+	cons := atomic.LoadUint64(consumerPos)
+	prod := atomic.LoadUint64(producerPos)
+	for cons < prod {
+		offset := cons & r.mask
+		header := atomic.LoadUint32((*uint32)(unsafe.Pointer(&r.data[offset])))
+		if header&ringbufBusyBit != 0 {
+			// the record is still being written
+			break
+		}
+		length := header &^ (ringbufBusyBit | ringbufDiscardBit)
+		if header&ringbufDiscardBit == 0 {
+			start := offset + ringbufHeaderSize
+			fn(r.data[start : start+uint64(length)])
+		}
+		// records are 8-byte aligned
+		cons += (uint64(length) + ringbufHeaderSize + 7) &^ 7
+		atomic.StoreUint64(consumerPos, cons)
+	}
+}
+
+func (r *ringbufReader) Close() {
+	if r.epollFd >= 0 {
+		unix.Close(r.epollFd)
+		r.epollFd = -1
+	}
+	if r.producer != nil {
+		_ = unix.Munmap(r.producer)
+		r.producer = nil
+	}
+	if r.consumer != nil {
+		_ = unix.Munmap(r.consumer)
+		r.consumer = nil
+	}
+}
@@ -0,0 +1,157 @@
+//go:build !darwin
+// +build !darwin
+
+package bpf
+
+import (
+	"encoding/binary"
+	"errors"
+	"os"
+
+	"github.com/cilium/ebpf"
+	"github.com/cilium/ebpf/asm"
+	"github.com/cilium/ebpf/rlimit"
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+// fakeRingbuf lays out the pages of a ring buffer in memory as the kernel maps them, with the data area mapped twice
+type fakeRingbuf struct {
+	reader   *ringbufReader
+	size     uint64
+	producer uint64
+}
+
+func newFakeRingbuf(size uint64) *fakeRingbuf {
+	producer := make([]byte, 8+2*size)
+	return &fakeRingbuf{
+		reader: &ringbufReader{
+			epollFd:  -1,
+			consumer: make([]byte, 8),
+			producer: producer,
+			data:     producer[8:],
+			mask:     size - 1,
+		},
+		size: size,
+	}
+}
+
+// write appends a record with the given header flags, the producer position is only advanced past committed records
+// like the kernel does once they are reserved
+func (f *fakeRingbuf) write(sample []byte, flags uint32) {
+	record := make([]byte, ringbufHeaderSize+len(sample))
+	binary.NativeEndian.PutUint32(record, uint32(len(sample))|flags)
+	copy(record[ringbufHeaderSize:], sample)
+	for i, b := range record {
+		offset := (f.producer + uint64(i)) & f.reader.mask
+		f.reader.data[offset] = b
+		f.reader.data[offset+f.size] = b
+	}
+	f.producer += (uint64(len(record)) + 7) &^ 7
+	binary.NativeEndian.PutUint64(f.reader.producer, f.producer)
+}
+
+func (f *fakeRingbuf) consumer() uint64 {
+	return binary.NativeEndian.Uint64(f.reader.consumer)
+}
+
+func (f *fakeRingbuf) read() [][]byte {
+	var samples [][]byte
+	f.reader.Read(func(sample []byte) {
+		samples = append(samples, append([]byte(nil), sample...))
+	})
+	return samples
+}
+
+var _ = Describe("Ring buffer reader", func() {
+	It("reads the committed records in order", func() {
+		f := newFakeRingbuf(64)
+		f.write([]byte("first"), 0)
+		f.write([]byte("second record"), 0)
+		Expect(f.read()).To(Equal([][]byte{[]byte("first"), []byte("second record")}))
+		Expect(f.consumer()).To(Equal(f.producer))
+		Expect(f.read()).To(BeEmpty())
+	})
+
+	It("reads the records that wrap around the end of the data area", func() {
+		f := newFakeRingbuf(32)
+		f.write(make([]byte, 16), 0) // 24 bytes
+		Expect(f.read()).To(HaveLen(1))
+
+		// starts at offset 24 and ends past the end of the data area
+		sample := []byte("0123456789abcdef")
+		f.write(sample, 0)
+		Expect(f.read()).To(Equal([][]byte{sample}))
+		Expect(f.consumer()).To(Equal(uint64(48)))
+	})
+
+	It("skips the discarded records", func() {
+		f := newFakeRingbuf(64)
+		f.write([]byte("discarded"), ringbufDiscardBit)
+		f.write([]byte("kept"), 0)
+		Expect(f.read()).To(Equal([][]byte{[]byte("kept")}))
+		Expect(f.consumer()).To(Equal(f.producer))
+	})
+
+	It("stops at a record that is still being written", func() {
+		f := newFakeRingbuf(64)
+		f.write([]byte("done"), 0)
+		busy := f.producer
+		f.write([]byte("busy"), ringbufBusyBit)
+		f.write([]byte("after"), 0)
+		Expect(f.read()).To(Equal([][]byte{[]byte("done")}))
+		Expect(f.consumer()).To(Equal(busy))
+
+		// the record is committed
+		binary.NativeEndian.PutUint32(f.reader.data[busy&f.reader.mask:], 4)
+		Expect(f.read()).To(Equal([][]byte{[]byte("busy"), []byte("after")}))
+	})
+
+	It("reads the records of a BPF program", func() {
+		Expect(rlimit.RemoveMemlock()).To(Succeed())
+		m, err := ebpf.NewMap(&ebpf.MapSpec{Type: ebpf.RingBuf, MaxEntries: uint32(os.Getpagesize())})
+		if errors.Is(err, os.ErrPermission) {
+			Skip("creating a ring buffer needs CAP_BPF")
+		}
+		Expect(err).NotTo(HaveOccurred())
+		defer m.Close()
+
+		// bpf_ringbuf_output of the 8 bytes value 42
+		prog, err := ebpf.NewProgram(&ebpf.ProgramSpec{
+			Type:    ebpf.SocketFilter,
+			License: "Dual BSD/GPL",
+			Instructions: asm.Instructions{
+				asm.Mov.Imm(asm.R1, 42),
+				asm.StoreMem(asm.RFP, -8, asm.R1, asm.DWord),
+				asm.LoadMapPtr(asm.R1, m.FD()),
+				asm.Mov.Reg(asm.R2, asm.RFP),
+				asm.Add.Imm(asm.R2, -8),
+				asm.Mov.Imm(asm.R3, 8),
+				asm.Mov.Imm(asm.R4, 0),
+				asm.FnRingbufOutput.Call(),
+				asm.Mov.Imm(asm.R0, 0),
+				asm.Return(),
+			},
+		})
+		Expect(err).NotTo(HaveOccurred())
+		defer prog.Close()
+
+		r, err := newRingbufReader(m)
+		Expect(err).NotTo(HaveOccurred())
+		defer r.Close()
+
+		// more records than fit in the first pass over the data area
+		records := 2 * os.Getpagesize() / 16
+		for i := 0; i < records; i++ {
+			_, err = prog.Run(&ebpf.RunOptions{Data: make([]byte, 14)})
+			Expect(err).NotTo(HaveOccurred())
+			Expect(r.Wait(0)).To(Succeed())
+			n := 0
+			r.Read(func(sample []byte) {
+				Expect(binary.NativeEndian.Uint64(sample)).To(Equal(uint64(42)))
+				n++
+			})
+			Expect(n).To(Equal(1))
+		}
+	})
+})
@@ -0,0 +1,90 @@
+//go:build !darwin
+// +build !darwin
+
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package bpf
+
+import (
+	"fmt"
+	"os"
+	"sync/atomic"
+	"time"
+	"unsafe"
+
+	"github.com/cilium/ebpf"
+	"golang.org/x/sys/unix"
+)
+
+// runtimeConfigPollInterval is how often the config is re-read when the runtime config is enabled.
+const runtimeConfigPollInterval = 10 * time.Second
+
+// runtimeConfig writes the runtime_config map through its mmaped value, which
+// the programs read on every event, so that a change takes effect without a
+// syscall or reloading the programs.
+type runtimeConfig struct {
+	mem    []byte
+	config *keplerRuntimeConfigT
+	// generation of the last hardware counter enablement, never 0
+	hwGeneration uint32
+}
+
+func newRuntimeConfig(m *ebpf.Map) (*runtimeConfig, error) {
+	if m.Flags()&unix.BPF_F_MMAPABLE == 0 {
+		return nil, fmt.Errorf("map %s is not mmapable", m.String())
+	}
+	mem, err := unix.Mmap(m.FD(), 0, os.Getpagesize(), unix.PROT_READ|unix.PROT_WRITE, unix.MAP_SHARED)
+	if err != nil {
+		return nil, fmt.Errorf("failed to mmap %s: %w", m.String(), err)
+	}
+	return &runtimeConfig{
+		mem:    mem,
+		config: (*keplerRuntimeConfigT)(unsafe.Pointer(&mem[0])),
+	}, nil
+}
+
+// set updates the programs' settings and returns true if they changed
+func (c *runtimeConfig) set(sampleRate int, hardwareCounters bool) bool {
+	changed := false
+	if rate := uint32(sampleRate); atomic.LoadUint32(&c.config.SampleRate) != rate {
+		atomic.StoreUint32(&c.config.SampleRate, rate)
+		changed = true
+	}
+	hwEnabled := atomic.LoadUint32(&c.config.Hw) != 0
+	if hardwareCounters && !hwEnabled {
+		// a new generation makes the programs drop the counter values read
+		// before the counters were disabled
+		c.hwGeneration++
+		if c.hwGeneration == 0 {
+			c.hwGeneration = 1
+		}
+		atomic.StoreUint32(&c.config.Hw, c.hwGeneration)
+		changed = true
+	} else if !hardwareCounters && hwEnabled {
+		atomic.StoreUint32(&c.config.Hw, 0)
+		changed = true
+	}
+	return changed
+}
+
+func (c *runtimeConfig) Close() {
+	if c.mem != nil {
+		_ = unix.Munmap(c.mem)
+		c.mem = nil
+		c.config = nil
+	}
+}
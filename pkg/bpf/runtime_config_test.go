@@ -0,0 +1,28 @@
+//go:build !darwin
+// +build !darwin
+
+package bpf
+
+import (
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+var _ = Describe("Runtime config", func() {
+	It("should start a new hardware counter generation on every enablement", func() {
+		var value keplerRuntimeConfigT
+		c := &runtimeConfig{config: &value}
+
+		Expect(c.set(4, true)).To(BeTrue())
+		Expect(value.SampleRate).To(Equal(uint32(4)))
+		Expect(value.Hw).To(Equal(uint32(1)))
+		Expect(c.set(4, true)).To(BeFalse())
+
+		Expect(c.set(4, false)).To(BeTrue())
+		Expect(value.Hw).To(Equal(uint32(0)))
+
+		Expect(c.set(2, true)).To(BeTrue())
+		Expect(value.SampleRate).To(Equal(uint32(2)))
+		Expect(value.Hw).To(Equal(uint32(2)))
+	})
+})
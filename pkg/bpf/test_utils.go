@@ -52,8 +52,33 @@ func (m *mockExporter) CollectProcesses() ([]ProcessMetrics, error) {
 			CpuInstr:       0,
 			CacheMiss:      0,
 			PageCacheHit:   0,
-			VecNr:          [10]uint16{},
-			Comm:           [16]int8{},
+			VecNr:          [10]uint32{},
+			SoftirqTimeNs:  [10]uint64{},
+			Comm:           "",
 		},
 	}, nil
 }
+
+func (m *mockExporter) CollectProgStats() (map[string]ProgStats, error) {
+	stats := make(map[string]ProgStats, len(ProgStatsNames))
+	for _, name := range ProgStatsNames {
+		stats[name] = ProgStats{}
+	}
+	return stats, nil
+}
+
+func (m *mockExporter) CollectSampleRates() ([]uint32, error) {
+	return nil, nil
+}
+
+func (m *mockExporter) CollectCPUPowerStates() ([]CPUPowerState, error) {
+	return nil, nil
+}
+
+func (m *mockExporter) CollectThreads() ([]ThreadMetrics, error) {
+	return nil, nil
+}
+
+func (m *mockExporter) CollectSliceHistograms() (map[uint64]SliceHistogram, error) {
+	return nil, nil
+}
@@ -30,12 +30,77 @@ const (
 	IRQBlock = 4
 )
 
-type ProcessMetrics = keplerProcessMetricsT
+// ProcessMetrics are the metrics of a process, or of a cgroup with the per-cgroup metrics, merged with
+// its identity from the process_info map
+type ProcessMetrics struct {
+	CgroupId         uint64
+	AncestorCgroupId uint64
+	Pid              uint64
+	ProcessRunTime   uint64
+	CpuCycles        uint64
+	CpuInstr         uint64
+	CacheMiss        uint64
+	PageCacheHit     uint64
+	VecNr            [10]uint32
+	SoftirqTimeNs    [10]uint64
+	BlockIoBytes     uint64
+	NetTxBytes       uint64
+	NetRxBytes       uint64
+	Comm             string
+}
+
+// ThreadMetrics are the cumulative on-CPU metrics of a thread since it entered the threads map, which only keeps the
+// most recently active threads
+type ThreadMetrics struct {
+	Tid            uint64
+	Tgid           uint64
+	ProcessRunTime uint64
+	CpuCycles      uint64
+	CpuInstr       uint64
+	CacheMiss      uint64
+	Comm           string
+}
+
+type ProgStats = keplerProgStatsT
+
+// SliceBuckets is the number of log2 buckets of the on-CPU slice histograms. Bucket i counts the slices of
+// [2^i, 2^(i+1)) us, the last one all the longer slices.
+const SliceBuckets = len(SliceHistogram{}.Buckets)
+
+// SliceHistogram is the distribution of the on-CPU time slices of the tasks of a cgroup since it entered the
+// cgroup_slices map
+type SliceHistogram = keplerSliceHistogramT
+
+// MaxIdleStates is the number of idle states tracked per CPU
+const MaxIdleStates = 10
+
+// CPUPowerState is the residency of a CPU since the power tracepoints were attached
+type CPUPowerState struct {
+	BusyTimeNs uint64
+	// BusyCycles is the busy time weighted by the frequency of the CPU
+	BusyCycles uint64
+	IdleTimeNs [MaxIdleStates]uint64
+}
 
 type Exporter interface {
 	SupportedMetrics() SupportedMetrics
 	Detach()
 	CollectProcesses() ([]ProcessMetrics, error)
+	// CollectProgStats returns the cumulative self-overhead counters of the
+	// programs by name, or nil if they are not enabled
+	CollectProgStats() (map[string]ProgStats, error)
+	// CollectSampleRates returns the sched_switch sample rate picked by each
+	// CPU, or nil if the adaptive sampling is disabled
+	CollectSampleRates() ([]uint32, error)
+	// CollectCPUPowerStates returns the residency of each CPU, or nil if the
+	// CPU power state tracking is disabled
+	CollectCPUPowerStates() ([]CPUPowerState, error)
+	// CollectThreads returns the metrics of the threads in the threads map,
+	// or nil if the per-thread metrics are disabled
+	CollectThreads() ([]ThreadMetrics, error)
+	// CollectSliceHistograms returns the on-CPU slice histogram of each
+	// cgroup by cgroup ID, or nil if the histograms are disabled
+	CollectSliceHistograms() (map[uint64]SliceHistogram, error)
 }
 
 type SupportedMetrics struct {
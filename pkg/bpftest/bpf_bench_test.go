@@ -0,0 +1,268 @@
+//go:build !darwin
+// +build !darwin
+
+package bpftest
+
+import (
+	"os"
+	"strconv"
+	"time"
+
+	"github.com/cilium/ebpf"
+	"github.com/cilium/ebpf/rlimit"
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+	"github.com/onsi/gomega/gmeasure"
+)
+
+const (
+	// number of samples taken by each benchmark
+	benchSamplesEnv = "BPF_BENCH_SAMPLES"
+	// optional upper bound of the median cost of a probe over the test_noop baseline
+	benchMaxOverheadEnv = "BPF_BENCH_MAX_OVERHEAD_NS"
+
+	defaultBenchSamples = 2000
+)
+
+// The benchmarks run every probe of kepler.bpf.h through test.bpf.c with
+// BPF_PROG_TEST_RUN. raw_tp programs do not support the repeat attribute, so
+// each sample is one run and the syscall cost is measured by test_noop.
+var _ = Describe("BPF probe benchmarks", Label("bench"), Ordered, func() {
+	var (
+		obj      testObjects
+		baseline time.Duration
+	)
+
+	BeforeAll(func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST": int32(1),
+			"HW":   int32(0),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		DeferCleanup(obj.Close)
+	})
+
+	AfterEach(func() {
+		clearMap(obj.Processes)
+		clearMap(obj.PidTimeMap)
+	})
+
+	It("measures the BPF_PROG_TEST_RUN baseline", func() {
+		experiment := benchmark("test_noop", nil, func() {
+			runOnCPU0(obj.TestNoop)
+		})
+		baseline = experiment.GetStats("test_noop").DurationFor(gmeasure.StatMedian)
+	})
+
+	It("measures sched_switch with warm maps", func() {
+		experiment := benchmark("sched_switch warm", func() {
+			preRunSchedSwitchTracepoint(&obj)
+		}, func() {
+			runOnCPU0(obj.TestKeplerSchedSwitchTrace)
+		})
+		expectOverheadWithinBudget(experiment, "sched_switch warm", baseline)
+	})
+
+	It("measures sched_switch with cold maps", func() {
+		experiment := benchmark("sched_switch cold", func() {
+			clearMap(obj.Processes)
+			err := obj.PidTimeMap.Put(uint32(42), getNSecs())
+			Expect(err).NotTo(HaveOccurred())
+		}, func() {
+			runOnCPU0(obj.TestKeplerSchedSwitchTrace)
+		})
+		expectOverheadWithinBudget(experiment, "sched_switch cold", baseline)
+	})
+
+	It("measures sched_switch with warm maps and the thread metrics", func() {
+		threadObj := loadBenchObjects(map[string]interface{}{"THREAD_METRICS": int32(1)})
+		experiment := benchmark("sched_switch warm threads", func() {
+			preRunSchedSwitchTracepoint(threadObj)
+		}, func() {
+			runOnCPU0(threadObj.TestKeplerSchedSwitchTrace)
+		})
+		expectOverheadWithinBudget(experiment, "sched_switch warm threads", baseline)
+	})
+
+	It("measures sched_switch with warm maps and the slice histograms", func() {
+		sliceObj := loadBenchObjects(map[string]interface{}{"SLICE_HISTOGRAMS": int32(1)})
+		experiment := benchmark("sched_switch warm slices", func() {
+			preRunSchedSwitchTracepoint(sliceObj)
+		}, func() {
+			runOnCPU0(sliceObj.TestKeplerSchedSwitchTrace)
+		})
+		expectOverheadWithinBudget(experiment, "sched_switch warm slices", baseline)
+	})
+
+	It("measures register_new_process_if_not_exist on a map hit", func() {
+		err := obj.Processes.Put(uint32(42), testProcessMetricsT{Pid: 42})
+		Expect(err).NotTo(HaveOccurred())
+		experiment := benchmark("register hit", nil, func() {
+			runOnCPU0(obj.TestRegisterNewProcessIfNotExist)
+		})
+		expectOverheadWithinBudget(experiment, "register hit", baseline)
+	})
+
+	It("measures register_new_process_if_not_exist on a map miss", func() {
+		experiment := benchmark("register miss", func() {
+			_ = obj.Processes.Delete(uint32(42))
+		}, func() {
+			runOnCPU0(obj.TestRegisterNewProcessIfNotExist)
+		})
+		expectOverheadWithinBudget(experiment, "register miss", baseline)
+	})
+
+	It("measures register_new_process_if_not_exist on a full map", func() {
+		fillProcesses(&obj)
+		experiment := benchmark("register full map", func() {
+			_ = obj.Processes.Delete(uint32(42))
+		}, func() {
+			runOnCPU0(obj.TestRegisterNewProcessIfNotExist)
+		})
+		expectOverheadWithinBudget(experiment, "register full map", baseline)
+	})
+
+	It("measures the softirq entry path", func() {
+		experiment := benchmark("softirq entry", nil, func() {
+			runOnCPU0(obj.TestKeplerIrqTrace)
+		})
+		expectOverheadWithinBudget(experiment, "softirq entry", baseline)
+	})
+
+	It("measures the softirq exit path", func() {
+		err := obj.Processes.Put(uint32(42), testProcessMetricsT{Pid: 42})
+		Expect(err).NotTo(HaveOccurred())
+		experiment := benchmark("softirq exit", func() {
+			runOnCPU0(obj.TestKeplerIrqTrace)
+		}, func() {
+			runOnCPU0(obj.TestKeplerSoftirqExitTrace)
+		})
+		expectOverheadWithinBudget(experiment, "softirq exit", baseline)
+	})
+
+	It("measures the page cache hit path", func() {
+		err := obj.Processes.Put(uint32(0), testProcessMetricsT{})
+		Expect(err).NotTo(HaveOccurred())
+		experiment := benchmark("page cache hit", nil, func() {
+			runOnCPU0(obj.TestKeplerWritePageTrace)
+		})
+		expectOverheadWithinBudget(experiment, "page cache hit", baseline)
+	})
+
+	It("measures the page cache hit path with batching", func() {
+		batchObj := loadBenchObjects(map[string]interface{}{"PAGE_CACHE_BATCH": int32(1)})
+		err := batchObj.Processes.Put(uint32(0), testProcessMetricsT{})
+		Expect(err).NotTo(HaveOccurred())
+		experiment := benchmark("page cache hit batched", nil, func() {
+			runOnCPU0(batchObj.TestKeplerWritePageTrace)
+		})
+		expectOverheadWithinBudget(experiment, "page cache hit batched", baseline)
+	})
+
+	It("measures the page cache hit path with sampling", func() {
+		sampleObj := loadBenchObjects(map[string]interface{}{"PAGE_CACHE_SAMPLE_RATE": int32(9)})
+		err := sampleObj.Processes.Put(uint32(0), testProcessMetricsT{})
+		Expect(err).NotTo(HaveOccurred())
+		experiment := benchmark("page cache hit sampled", nil, func() {
+			runOnCPU0(sampleObj.TestKeplerWritePageTrace)
+		})
+		expectOverheadWithinBudget(experiment, "page cache hit sampled", baseline)
+	})
+})
+
+// loadBenchObjects loads the test objects with the benchmark constants and
+// the given ones, and closes them at the end of the spec
+func loadBenchObjects(constants map[string]interface{}) *testObjects {
+	specs, err := loadTest()
+	Expect(err).NotTo(HaveOccurred())
+
+	consts := map[string]interface{}{
+		"TEST": int32(1),
+		"HW":   int32(0),
+	}
+	for name, value := range constants {
+		consts[name] = value
+	}
+	err = specs.RewriteConstants(consts)
+	Expect(err).NotTo(HaveOccurred())
+
+	var obj testObjects
+	err = specs.LoadAndAssign(&obj, nil)
+	Expect(err).NotTo(HaveOccurred())
+	DeferCleanup(obj.Close)
+	return &obj
+}
+
+// benchmark samples run, calling setup before each sample outside of the measurement
+func benchmark(name string, setup, run func()) *gmeasure.Experiment {
+	experiment := gmeasure.NewExperiment(name)
+	AddReportEntry(experiment.Name, experiment)
+	experiment.Sample(func(idx int) {
+		if setup != nil {
+			setup()
+		}
+		experiment.MeasureDuration(name, run, gmeasure.Precision(time.Nanosecond))
+	}, gmeasure.SamplingConfig{N: getIntEnv(benchSamplesEnv, defaultBenchSamples)})
+	return experiment
+}
+
+// expectOverheadWithinBudget fails if the median cost over the baseline exceeds BPF_BENCH_MAX_OVERHEAD_NS
+func expectOverheadWithinBudget(experiment *gmeasure.Experiment, name string, baseline time.Duration) {
+	budget := getIntEnv(benchMaxOverheadEnv, 0)
+	if budget <= 0 {
+		return
+	}
+	median := experiment.GetStats(name).DurationFor(gmeasure.StatMedian)
+	Expect(median-baseline).To(BeNumerically("<=", time.Duration(budget)),
+		"median of %s is %v over the test_noop baseline", name, median-baseline)
+}
+
+func runOnCPU0(prog *ebpf.Program) {
+	out, err := prog.Run(&ebpf.RunOptions{
+		Flags: uint32(1), // BPF_F_TEST_RUN_ON_CPU
+		CPU:   uint32(0),
+	})
+	Expect(err).NotTo(HaveOccurred())
+	Expect(out).To(Equal(uint32(0)))
+}
+
+// fillProcesses inserts MaxEntries processes other than TGID 42
+func fillProcesses(obj *testObjects) {
+	maxEntries := int(obj.Processes.MaxEntries())
+	keys := make([]uint32, maxEntries)
+	values := make([]testProcessMetricsT, maxEntries)
+	for i := range keys {
+		keys[i] = uint32(1000 + i)
+		values[i].Pid = keys[i]
+	}
+	_, err := obj.Processes.BatchUpdate(keys, values, &ebpf.BatchOptions{})
+	Expect(err).NotTo(HaveOccurred())
+}
+
+func clearMap(m *ebpf.Map) {
+	var key uint32
+	for m.NextKey(nil, &key) == nil {
+		if err := m.Delete(key); err != nil {
+			return
+		}
+	}
+}
+
+func getIntEnv(name string, defaultValue int) int {
+	if v, err := strconv.Atoi(os.Getenv(name)); err == nil {
+		return v
+	}
+	return defaultValue
+}
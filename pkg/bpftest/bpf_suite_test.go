@@ -4,13 +4,20 @@
 package bpftest
 
 import (
+	"encoding/binary"
 	"fmt"
+	"io"
+	"os"
+	"runtime"
+	"strings"
+	"sync"
 	"syscall"
 	"testing"
 	"time"
 	"unsafe"
 
 	"github.com/cilium/ebpf"
+	"github.com/cilium/ebpf/link"
 	"github.com/cilium/ebpf/rlimit"
 	. "github.com/onsi/ginkgo/v2"
 	. "github.com/onsi/gomega"
@@ -24,6 +31,15 @@ func TestBpf(t *testing.T) {
 }
 
 var _ = Describe("BPF Exporter", func() {
+	It("should match the generated bindings", func() {
+		// objects that were not regenerated with the sources lack programs or maps
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+		var bindings testSpecs
+		Expect(specs.Assign(&bindings)).To(Succeed())
+		Expect(int(specs.Maps["processes"].ValueSize)).To(Equal(int(unsafe.Sizeof(testProcessMetricsT{}))))
+	})
+
 	It("should increment the page cache hit counter", func() {
 		// Remove resource limits for kernels <5.11.
 		err := rlimit.RemoveMemlock()
@@ -34,7 +50,1183 @@ var _ = Describe("BPF Exporter", func() {
 		Expect(err).NotTo(HaveOccurred())
 
 		err = specs.RewriteConstants(map[string]interface{}{
-			"TEST": int32(1),
+			"TEST": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+
+		key := uint32(0)
+
+		err = obj.Processes.Put(key, testProcessMetricsT{
+			Pid:            0,
+			ProcessRunTime: 0,
+			CpuCycles:      0,
+			CpuInstr:       0,
+			CacheMiss:      0,
+			PageCacheHit:   0,
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		out, err := obj.TestKeplerWritePageTrace.Run(&ebpf.RunOptions{})
+		Expect(err).NotTo(HaveOccurred())
+		Expect(out).To(Equal(uint32(0)))
+
+		// Read the page cache hit counter
+		var res testProcessMetricsT
+		err = obj.Processes.Lookup(key, &res)
+		Expect(err).NotTo(HaveOccurred())
+
+		Expect(res.PageCacheHit).To(BeNumerically("==", uint64(1)))
+
+		err = obj.Processes.Delete(key)
+		Expect(err).NotTo(HaveOccurred())
+	})
+
+	It("should register a new process if one doesn't exist", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+
+		out, err := obj.TestRegisterNewProcessIfNotExist.Run(&ebpf.RunOptions{})
+		Expect(err).NotTo(HaveOccurred())
+		Expect(out).To(BeNumerically("==", uint32(0)))
+
+		// Read the page cache hit counter
+		var res testProcessMetricsT
+		key := uint32(42) // Kernel TGID
+		err = obj.Processes.Lookup(key, &res)
+		Expect(err).NotTo(HaveOccurred())
+
+		Expect(res.Pid).To(BeNumerically("==", uint64(42)))
+
+		// The identity of the process is kept apart from its metrics
+		var info testProcessInfoT
+		err = obj.ProcessInfo.Lookup(key, &info)
+		Expect(err).NotTo(HaveOccurred())
+
+		err = obj.Processes.Delete(key)
+		Expect(err).NotTo(HaveOccurred())
+	})
+
+	It("should refresh the identity of a process on exec", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		// An identity recorded before the exec, with a cgroup ID no cgroup has
+		key := uint32(42)
+		stale := uint64(1 << 62)
+		err = obj.ProcessInfo.Put(key, testProcessInfoT{CgroupId: stale})
+		Expect(err).NotTo(HaveOccurred())
+
+		out, err := obj.TestKeplerSchedProcessExecTrace.Run(&ebpf.RunOptions{})
+		Expect(err).NotTo(HaveOccurred())
+		Expect(out).To(Equal(uint32(0)))
+
+		var info testProcessInfoT
+		err = obj.ProcessInfo.Lookup(key, &info)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(info.CgroupId).NotTo(Equal(stale))
+	})
+
+	It("should move the metrics of an exiting process to the ring buffer", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		key := uint32(42)
+		err = obj.Processes.Put(key, testProcessMetricsT{
+			Pid:            42,
+			ProcessRunTime: 1000,
+		})
+		Expect(err).NotTo(HaveOccurred())
+		err = obj.ProcessInfo.Put(key, testProcessInfoT{CgroupId: 7})
+		Expect(err).NotTo(HaveOccurred())
+		err = obj.ProcessIo.Put(uint64(key), testProcessIoT{BlockIoBytes: 4096})
+		Expect(err).NotTo(HaveOccurred())
+
+		out, err := obj.TestKeplerSchedProcessExitTrace.Run(&ebpf.RunOptions{})
+		Expect(err).NotTo(HaveOccurred())
+		Expect(out).To(Equal(uint32(0)))
+
+		// The entry and its identity are removed once the record is in the ring buffer
+		var res testProcessMetricsT
+		err = obj.Processes.Lookup(key, &res)
+		Expect(err).To(MatchError(ebpf.ErrKeyNotExist))
+		var info testProcessInfoT
+		err = obj.ProcessInfo.Lookup(key, &info)
+		Expect(err).To(MatchError(ebpf.ErrKeyNotExist))
+		var io testProcessIoT
+		err = obj.ProcessIo.Lookup(uint64(key), &io)
+		Expect(err).To(MatchError(ebpf.ErrKeyNotExist))
+	})
+
+	It("adds the last time slice of an exiting process to its record", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST":           int32(1),
+			"HW":             int32(0),
+			"THREAD_METRICS": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		// TGID 42 went on-CPU 1ms ago and exits before it is switched out
+		key := uint32(42)
+		err = obj.Processes.Put(key, testProcessMetricsT{Pid: 42})
+		Expect(err).NotTo(HaveOccurred())
+		err = obj.PidTimeMap.Put(key, getNSecs()-1000000)
+		Expect(err).NotTo(HaveOccurred())
+
+		out, err := obj.TestKeplerSchedProcessExitTrace.Run(&ebpf.RunOptions{
+			Flags: uint32(1), // BPF_F_TEST_RUN_ON_CPU
+			CPU:   uint32(0),
+		})
+		Expect(err).NotTo(HaveOccurred())
+		Expect(out).To(Equal(uint32(0)))
+
+		// The slice is accounted by the exit, its last sched_switch finds no timestamp
+		var thread testThreadMetricsT
+		err = obj.Threads.Lookup(key, &thread)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(thread.ProcessRunTime).To(BeNumerically(">=", uint64(1000)))
+		var ts uint64
+		err = obj.PidTimeMap.Lookup(key, &ts)
+		Expect(err).To(MatchError(ebpf.ErrKeyNotExist))
+	})
+
+	It("should register new processes in the active processes map", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		// Swap in the shadow map as userspace does when collecting
+		err = obj.ProcessesEpochs.Update(uint32(0), obj.ProcessesShadow, ebpf.UpdateAny)
+		Expect(err).NotTo(HaveOccurred())
+
+		out, err := obj.TestRegisterNewProcessIfNotExist.Run(&ebpf.RunOptions{})
+		Expect(err).NotTo(HaveOccurred())
+		Expect(out).To(BeNumerically("==", uint32(0)))
+
+		var res testProcessMetricsT
+		key := uint32(42) // Kernel TGID
+		err = obj.ProcessesShadow.Lookup(key, &res)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(res.Pid).To(BeNumerically("==", uint64(42)))
+
+		// The inactive map is not written to
+		err = obj.Processes.Lookup(key, &res)
+		Expect(err).To(MatchError(ebpf.ErrKeyNotExist))
+	})
+
+	It("accumulates the sched_switch metrics per cgroup", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST":           int32(1),
+			"HW":             int32(0),
+			"CGROUP_METRICS": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		// TGID 42 went on-CPU 1ms ago
+		err = obj.PidTimeMap.Put(uint32(42), getNSecs()-1000000)
+		Expect(err).NotTo(HaveOccurred())
+
+		out, err := obj.TestKeplerSchedSwitchTrace.Run(&ebpf.RunOptions{
+			Flags: uint32(1), // BPF_F_TEST_RUN_ON_CPU
+			CPU:   uint32(0),
+		})
+		Expect(err).NotTo(HaveOccurred())
+		Expect(out).To(Equal(uint32(0)))
+
+		// The run time is accounted to the cgroup of the test, not to the process
+		var cgroupID uint64
+		var res testProcessMetricsT
+		entries := obj.Cgroups.Iterate()
+		Expect(entries.Next(&cgroupID, &res)).To(BeTrue())
+		Expect(res.Pid).To(BeNumerically("==", uint64(42)))
+		Expect(res.ProcessRunTime).To(BeNumerically(">=", uint64(1000)))
+		Expect(entries.Next(&cgroupID, &res)).To(BeFalse())
+		Expect(entries.Err()).NotTo(HaveOccurred())
+
+		// The first process of the cgroup has its identity registered
+		var info testProcessInfoT
+		err = obj.ProcessInfo.Lookup(uint32(42), &info)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(info.CgroupId).To(Equal(cgroupID))
+
+		err = obj.Processes.Lookup(uint32(42), &res)
+		Expect(err).To(MatchError(ebpf.ErrKeyNotExist))
+	})
+
+	It("accumulates the sched_switch metrics per thread", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST":           int32(1),
+			"HW":             int32(0),
+			"THREAD_METRICS": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		// Register TGID 42, its first time slice is not accounted otherwise
+		err = obj.Processes.Put(uint32(42), testProcessMetricsT{Pid: 42})
+		Expect(err).NotTo(HaveOccurred())
+
+		// Thread 44 of TGID 42 went on-CPU 1ms ago, twice
+		for i := 0; i < 2; i++ {
+			err = obj.PidTimeMap.Put(uint32(44), getNSecs()-1000000)
+			Expect(err).NotTo(HaveOccurred())
+
+			out, err := obj.TestKeplerThreadSchedSwitchTrace.Run(&ebpf.RunOptions{
+				Flags: uint32(1), // BPF_F_TEST_RUN_ON_CPU
+				CPU:   uint32(0),
+			})
+			Expect(err).NotTo(HaveOccurred())
+			Expect(out).To(Equal(uint32(0)))
+		}
+
+		// The run time is accounted to the thread and to its process
+		var thread testThreadMetricsT
+		err = obj.Threads.Lookup(uint32(44), &thread)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(thread.Tgid).To(Equal(uint32(42)))
+		Expect(thread.ProcessRunTime).To(BeNumerically(">=", uint64(2000)))
+
+		var res testProcessMetricsT
+		err = obj.Processes.Lookup(uint32(42), &res)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(res.ProcessRunTime).To(Equal(thread.ProcessRunTime))
+
+		err = obj.Threads.Lookup(uint32(42), &thread)
+		Expect(err).To(MatchError(ebpf.ErrKeyNotExist))
+	})
+
+	It("counts the on-CPU slices of sched_switch per cgroup", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST":             int32(1),
+			"HW":               int32(0),
+			"SLICE_HISTOGRAMS": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		// TGID 42 went on-CPU 1ms ago
+		err = obj.PidTimeMap.Put(uint32(42), getNSecs()-1000000)
+		Expect(err).NotTo(HaveOccurred())
+
+		out, err := obj.TestKeplerSchedSwitchTrace.Run(&ebpf.RunOptions{
+			Flags: uint32(1), // BPF_F_TEST_RUN_ON_CPU
+			CPU:   uint32(0),
+		})
+		Expect(err).NotTo(HaveOccurred())
+		Expect(out).To(Equal(uint32(0)))
+
+		// The slice of at least 1000us is counted in bucket 9, [512, 1024) us,
+		// or 10, [1024, 2048) us, of the cgroup of the test
+		var (
+			cgroupID  uint64
+			histogram testSliceHistogramT
+			entries   int
+		)
+		iter := obj.CgroupSlices.Iterate()
+		for iter.Next(&cgroupID, &histogram) {
+			entries++
+		}
+		Expect(iter.Err()).NotTo(HaveOccurred())
+		Expect(entries).To(Equal(1))
+		Expect(histogram.Buckets[9] + histogram.Buckets[10]).To(Equal(uint64(1)))
+		Expect(histogram.SumUs).To(BeNumerically(">=", uint64(900)))
+	})
+
+	It("accounts the time slices of the current task with task storage", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST":           int32(1),
+			"HW":             int32(0),
+			"TASK_STORAGE":   int32(1),
+			"THREAD_METRICS": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		// The first switch registers the process and records the on-CPU timestamp in the task storage of this
+		// thread, the second one accounts the slice in between
+		runtime.LockOSThread()
+		defer runtime.UnlockOSThread()
+		runCurrentSchedSwitchTracepoint(&obj)
+		time.Sleep(time.Millisecond)
+		runCurrentSchedSwitchTracepoint(&obj)
+
+		pid, tid := uint32(os.Getpid()), uint32(unix.Gettid())
+		var res testProcessMetricsT
+		err = obj.Processes.Lookup(pid, &res)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(res.Pid).To(Equal(pid))
+		Expect(res.ProcessRunTime).To(BeNumerically(">=", uint64(1000)))
+
+		var thread testThreadMetricsT
+		err = obj.Threads.Lookup(tid, &thread)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(thread.Tgid).To(Equal(pid))
+		Expect(thread.ProcessRunTime).To(Equal(res.ProcessRunTime))
+
+		// The timestamps are not kept in pid_time_map
+		var ts uint64
+		err = obj.PidTimeMap.Lookup(tid, &ts)
+		Expect(err).To(MatchError(ebpf.ErrKeyNotExist))
+	})
+
+	It("counts the time slices of the current task per cgroup with task storage", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST":             int32(1),
+			"HW":               int32(0),
+			"TASK_STORAGE":     int32(1),
+			"CGROUP_METRICS":   int32(1),
+			"SLICE_HISTOGRAMS": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		runtime.LockOSThread()
+		defer runtime.UnlockOSThread()
+		runCurrentSchedSwitchTracepoint(&obj)
+		time.Sleep(time.Millisecond)
+		runCurrentSchedSwitchTracepoint(&obj)
+
+		pid := uint32(os.Getpid())
+		var cgroupID uint64
+		var res testProcessMetricsT
+		entries := obj.Cgroups.Iterate()
+		Expect(entries.Next(&cgroupID, &res)).To(BeTrue())
+		Expect(res.Pid).To(Equal(pid))
+		Expect(res.ProcessRunTime).To(BeNumerically(">=", uint64(1000)))
+		Expect(entries.Next(&cgroupID, &res)).To(BeFalse())
+
+		var info testProcessInfoT
+		err = obj.ProcessInfo.Lookup(pid, &info)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(info.CgroupId).To(Equal(cgroupID))
+		err = obj.Processes.Lookup(pid, &res)
+		Expect(err).To(MatchError(ebpf.ErrKeyNotExist))
+
+		// The slice is counted in the histogram of the same cgroup
+		var histogram testSliceHistogramT
+		err = obj.CgroupSlices.Lookup(cgroupID, &histogram)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(histogram.SumUs).To(Equal(res.ProcessRunTime))
+	})
+
+	It("records the pod cgroup of the current task whatever its QoS class", func() {
+		root := cgroup2Mount()
+		if root == "" {
+			Skip("requires a writable cgroup2 mount")
+		}
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST":                int32(1),
+			"HW":                  int32(0),
+			"POD_CGROUP_ANCESTOR": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		// the pod depth depends on the QoS class and the cgroup driver
+		const container = "cri-containerd-0123456789abcdef.scope"
+		layouts := []struct {
+			pod, container string
+		}{
+			{"kepler-test/kubepods.slice/kubepods-pod1.slice", container},
+			{"kepler-test/kubepods.slice/kubepods-burstable.slice/kubepods-burstable-pod2.slice", container},
+			{"kepler-test/kubepods.slice/kubepods-besteffort.slice/kubepods-besteffort-pod3.slice", container},
+			{"kepler-test/kubepods/burstable/pod4", "0123456789abcdef"},
+			{"", "kepler-test/kubepods.slice/kubepods-burstable.slice"},
+			{"", "kepler-test/system.slice/kepler.scope"},
+		}
+		pid := uint32(os.Getpid())
+		origin := currentCgroup2(root)
+		defer func() {
+			Expect(os.WriteFile(origin+"/cgroup.procs", []byte(fmt.Sprint(pid)), 0)).To(Succeed())
+			Expect(os.RemoveAll(root + "/kepler-test")).To(Succeed())
+		}()
+		for _, layout := range layouts {
+			leaf := root + "/" + layout.container
+			var podCgroupID uint64
+			if layout.pod != "" {
+				leaf = root + "/" + layout.pod + "/" + layout.container
+			}
+			Expect(os.MkdirAll(leaf, 0o755)).To(Succeed())
+			if layout.pod != "" {
+				podCgroupID = cgroupID(root + "/" + layout.pod)
+			}
+			Expect(os.WriteFile(leaf+"/cgroup.procs", []byte(fmt.Sprint(pid)), 0)).To(Succeed())
+
+			_ = obj.Processes.Delete(pid)
+			_ = obj.ProcessInfo.Delete(pid)
+			runCurrentSchedSwitchTracepoint(&obj)
+
+			var info testProcessInfoT
+			err = obj.ProcessInfo.Lookup(pid, &info)
+			Expect(err).NotTo(HaveOccurred())
+			Expect(info.CgroupId).To(Equal(cgroupID(leaf)), leaf)
+			Expect(info.AncestorCgroupId).To(Equal(podCgroupID), leaf)
+		}
+	})
+
+	It("adds the last time slice of the current task on exit with task storage", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST":           int32(1),
+			"HW":             int32(0),
+			"TASK_STORAGE":   int32(1),
+			"THREAD_METRICS": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		runtime.LockOSThread()
+		defer runtime.UnlockOSThread()
+		runCurrentSchedSwitchTracepoint(&obj)
+		time.Sleep(time.Millisecond)
+		out, err := obj.TestKeplerCurrentProcessExitTrace.Run(&ebpf.RunOptions{})
+		Expect(err).NotTo(HaveOccurred())
+		Expect(out).To(Equal(uint32(0)))
+
+		// The exit accounts the slice as the one of the leader, and removes the process
+		pid := uint32(os.Getpid())
+		var thread testThreadMetricsT
+		err = obj.Threads.Lookup(pid, &thread)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(thread.ProcessRunTime).To(BeNumerically(">=", uint64(1000)))
+		var res testProcessMetricsT
+		err = obj.Processes.Lookup(pid, &res)
+		Expect(err).To(MatchError(ebpf.ErrKeyNotExist))
+	})
+
+	It("counts the runs and timestamp misses of sched_switch", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST":       int32(1),
+			"HW":         int32(0),
+			"PROG_STATS": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		// TGID 42 has no on-CPU timestamp
+		out, err := obj.TestKeplerSchedSwitchTrace.Run(&ebpf.RunOptions{
+			Flags: uint32(1), // BPF_F_TEST_RUN_ON_CPU
+			CPU:   uint32(0),
+		})
+		Expect(err).NotTo(HaveOccurred())
+		Expect(out).To(Equal(uint32(0)))
+
+		var perCPU []testProgStatsT
+		err = obj.ProgStats.Lookup(uint32(0), &perCPU) // PROG_SCHED_SWITCH
+		Expect(err).NotTo(HaveOccurred())
+		Expect(perCPU[0].RunCount).To(Equal(uint64(1)))
+		Expect(perCPU[0].RunTimeNs).To(BeNumerically(">", uint64(0)))
+		Expect(perCPU[0].TimestampMisses).To(Equal(uint64(1)))
+		Expect(perCPU[0].MapUpdateFailures).To(Equal(uint64(0)))
+	})
+
+	It("should increment the page hit counter efficiently", func() {
+		experiment := gmeasure.NewExperiment("Increment the page hit counter")
+		AddReportEntry(experiment.Name, experiment)
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+
+		key := uint32(0)
+
+		err = obj.Processes.Put(key, testProcessMetricsT{
+			Pid:            0,
+			ProcessRunTime: 0,
+			CpuCycles:      0,
+			CpuInstr:       0,
+			CacheMiss:      0,
+			PageCacheHit:   0,
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		experiment.Sample(func(idx int) {
+			experiment.MeasureDuration("page hit counter increment", func() {
+				out, err := obj.TestKeplerWritePageTrace.Run(&ebpf.RunOptions{})
+				Expect(err).NotTo(HaveOccurred())
+				Expect(out).To(Equal(uint32(0)))
+			}, gmeasure.Precision(time.Nanosecond))
+		}, gmeasure.SamplingConfig{N: 1000000, Duration: 10 * time.Second})
+	})
+
+	It("collects hardware counter metrics for sched_switch events", Label("perf_event"), func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST": int32(1),
+			"HW":   int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+
+		perfEvents, err := createHardwarePerfEvents(
+			obj.CpuInstructionsEventReader,
+			obj.CpuCyclesEventReader,
+			obj.CacheMissEventReader,
+		)
+		Expect(err).NotTo(HaveOccurred())
+		defer func() {
+			for _, fd := range perfEvents {
+				unix.Close(fd)
+			}
+		}()
+
+		// Register TGID 42 - This would be done by register_new_process_if_not_exist
+		// when we get a sched_switch event for a new process
+		key := uint32(42)
+		nsecs := getNSecs()
+		err = obj.Processes.Put(key, testProcessMetricsT{
+			Pid:            42,
+			ProcessRunTime: nsecs,
+			CpuCycles:      0,
+			CpuInstr:       0,
+			CacheMiss:      0,
+			PageCacheHit:   0,
+		})
+		Expect(err).NotTo(HaveOccurred())
+		// The first run reads the baselines of the hardware counters
+		for i := 0; i < 2; i++ {
+			err = obj.PidTimeMap.Put(key, nsecs)
+			Expect(err).NotTo(HaveOccurred())
+
+			out, err := obj.TestKeplerSchedSwitchTrace.Run(&ebpf.RunOptions{
+				Flags: uint32(1), // BPF_F_TEST_RUN_ON_CPU
+				CPU:   uint32(0),
+			})
+			Expect(err).NotTo(HaveOccurred())
+			Expect(out).To(Equal(uint32(0)))
+		}
+
+		var res testProcessMetricsT
+		err = obj.Processes.Lookup(key, &res)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(res.CpuCycles).To(BeNumerically(">", uint64(0)))
+		Expect(res.CpuInstr).To(BeNumerically(">", uint64(0)))
+		Expect(res.CacheMiss).To(BeNumerically(">", uint64(0)))
+
+		err = obj.Processes.Delete(key)
+		Expect(err).NotTo(HaveOccurred())
+	})
+
+	It("collects metrics for sched_switch events when no hardware events are enabled", Label("perf_event"), func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST": int32(1),
+			"HW":   int32(0),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+
+		// Register TGID 42 - This would be done by register_new_process_if_not_exist
+		// when we get a sched_switch event for a new process
+		key := uint32(42)
+		nsecs := getNSecs()
+		err = obj.Processes.Put(key, testProcessMetricsT{
+			Pid:            42,
+			ProcessRunTime: nsecs,
+			CpuCycles:      0,
+			CpuInstr:       0,
+			CacheMiss:      0,
+			PageCacheHit:   0,
+		})
+		Expect(err).NotTo(HaveOccurred())
+		err = obj.PidTimeMap.Put(key, nsecs)
+		Expect(err).NotTo(HaveOccurred())
+
+		out, err := obj.TestKeplerSchedSwitchTrace.Run(&ebpf.RunOptions{
+			Flags: uint32(1), // BPF_F_TEST_RUN_ON_CPU
+			CPU:   uint32(0),
+		})
+		Expect(err).NotTo(HaveOccurred())
+		Expect(out).To(Equal(uint32(0)))
+
+		var res testProcessMetricsT
+		err = obj.Processes.Lookup(key, &res)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(res.CpuCycles).To(BeNumerically("==", uint64(0)))
+		Expect(res.ProcessRunTime).To(BeNumerically(">", uint64(0)))
+
+		err = obj.Processes.Delete(key)
+		Expect(err).NotTo(HaveOccurred())
+	})
+
+	It("efficiently collects hardware counter metrics for sched_switch events", Label("perf_event"), func() {
+		experiment := gmeasure.NewExperiment("sched_switch tracepoint")
+		AddReportEntry(experiment.Name, experiment)
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+
+		perfEvents, err := createHardwarePerfEvents(
+			obj.CpuInstructionsEventReader,
+			obj.CpuCyclesEventReader,
+			obj.CacheMissEventReader,
+		)
+		Expect(err).NotTo(HaveOccurred())
+		defer func() {
+			for _, fd := range perfEvents {
+				unix.Close(fd)
+			}
+		}()
+		experiment.Sample(func(idx int) {
+			preRunSchedSwitchTracepoint(&obj)
+			experiment.MeasureDuration("sampled sched_switch tracepoint", func() {
+				runSchedSwitchTracepoint(&obj)
+			}, gmeasure.Precision(time.Nanosecond))
+			err = obj.Processes.Delete(uint32(42))
+			Expect(err).NotTo(HaveOccurred())
+		}, gmeasure.SamplingConfig{N: 1000000, Duration: 10 * time.Second})
+	})
+
+	It("efficiently collects hardware counter metrics with every CPU busy", Label("perf_event"), func() {
+		experiment := gmeasure.NewExperiment("concurrent sched_switch tracepoint")
+		AddReportEntry(experiment.Name, experiment)
+		numCPU := runtime.NumCPU()
+		runsPerCPU := 1000
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Give every CPU a slot in the perf event readers, as the exporter does
+		for _, m := range specs.Maps {
+			if m.Type == ebpf.PerfEventArray {
+				m.MaxEntries = uint32(numCPU)
+			}
+		}
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST": int32(1),
+			"HW":   int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		perfEvents, err := createPerCPUPerfEvents(numCPU,
+			obj.CpuCyclesEventReader,
+			obj.CpuInstructionsEventReader,
+			obj.CacheMissEventReader,
+		)
+		defer func() {
+			for _, fd := range perfEvents {
+				unix.Close(fd)
+			}
+		}()
+		Expect(err).NotTo(HaveOccurred())
+
+		experiment.Sample(func(idx int) {
+			preRunSchedSwitchTracepoint(&obj)
+			experiment.MeasureDuration("sched_switch tracepoint on every CPU", func() {
+				var wg sync.WaitGroup
+				for cpu := 0; cpu < numCPU; cpu++ {
+					wg.Add(1)
+					go func(cpu int) {
+						defer GinkgoRecover()
+						defer wg.Done()
+						for i := 0; i < runsPerCPU; i++ {
+							out, err := obj.TestKeplerSchedSwitchTrace.Run(&ebpf.RunOptions{
+								Flags: uint32(1), // BPF_F_TEST_RUN_ON_CPU
+								CPU:   uint32(cpu),
+							})
+							Expect(err).NotTo(HaveOccurred())
+							Expect(out).To(Equal(uint32(0)))
+						}
+					}(cpu)
+				}
+				wg.Wait()
+			}, gmeasure.Precision(time.Microsecond))
+			err = obj.Processes.Delete(uint32(42))
+			Expect(err).NotTo(HaveOccurred())
+		}, gmeasure.SamplingConfig{N: 100, Duration: 10 * time.Second})
+
+		// Every CPU kept its own previous counter values
+		var counters []testHwCountersT
+		err = obj.CpuHwCounters.Lookup(uint32(0), &counters)
+		Expect(err).NotTo(HaveOccurred())
+		for cpu := 0; cpu < numCPU; cpu++ {
+			Expect(counters[cpu].CpuCycles).To(BeNumerically(">", uint64(0)))
+		}
+	})
+
+	It("uses sample rate to reduce CPU time", Label("perf_event"), func() {
+		experiment := gmeasure.NewExperiment("sampled sched_switch tracepoint")
+		AddReportEntry(experiment.Name, experiment)
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST":        int32(1),
+			"SAMPLE_RATE": int32(1000),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+
+		perfEvents, err := createHardwarePerfEvents(
+			obj.CpuInstructionsEventReader,
+			obj.CpuCyclesEventReader,
+			obj.CacheMissEventReader,
+		)
+		Expect(err).NotTo(HaveOccurred())
+		defer func() {
+			for _, fd := range perfEvents {
+				unix.Close(fd)
+			}
+		}()
+		experiment.Sample(func(idx int) {
+			preRunSchedSwitchTracepoint(&obj)
+			experiment.MeasureDuration("sampled sched_switch tracepoint", func() {
+				runSchedSwitchTracepoint(&obj)
+			}, gmeasure.Precision(time.Nanosecond))
+			err = obj.Processes.Delete(uint32(42))
+			Expect(err).NotTo(HaveOccurred())
+		}, gmeasure.SamplingConfig{N: 1000000, Duration: 10 * time.Second})
+	})
+
+	It("keeps the sample rate independently on each CPU", func() {
+		if runtime.NumCPU() < 2 {
+			Skip("requires at least 2 CPUs")
+		}
+		sampleRate := 4
+		// a sample is taken once the per-CPU counter reaches 0
+		period := sampleRate + 1
+		iterations := 10 * period
+
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST":        int32(1),
+			"HW":          int32(0),
+			"SAMPLE_RATE": int32(sampleRate),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		samples := map[int]int{}
+		// interleave the events of two CPUs, a shared counter would sample
+		// each CPU at half of the configured rate
+		for i := 0; i < iterations; i++ {
+			for _, cpu := range []int{0, 1} {
+				out, err := obj.TestKeplerSchedSwitchTrace.Run(&ebpf.RunOptions{
+					Flags: uint32(1), // BPF_F_TEST_RUN_ON_CPU
+					CPU:   uint32(cpu),
+				})
+				Expect(err).NotTo(HaveOccurred())
+				Expect(out).To(Equal(uint32(0)))
+
+				var counters []uint32
+				err = obj.CounterSchedSwitch.Lookup(uint32(0), &counters)
+				Expect(err).NotTo(HaveOccurred())
+				if counters[cpu] == uint32(sampleRate) {
+					samples[cpu]++
+				}
+			}
+		}
+		Expect(samples[0]).To(Equal(iterations / period))
+		Expect(samples[1]).To(Equal(iterations / period))
+	})
+
+	It("scales the sampled time slice by the skipped events", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST":        int32(1),
+			"HW":          int32(0),
+			"SAMPLE_RATE": int32(2),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		// the first event is sampled, the next 2 are skipped
+		for i := 0; i < 3; i++ {
+			runOnCPU0(obj.TestKeplerSchedSwitchTrace)
+		}
+
+		// TGID 42 went on-CPU 1ms ago
+		err = obj.PidTimeMap.Put(uint32(42), getNSecs()-1000000)
+		Expect(err).NotTo(HaveOccurred())
+		runOnCPU0(obj.TestKeplerSchedSwitchTrace)
+
+		var res testProcessMetricsT
+		err = obj.Processes.Lookup(uint32(42), &res)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(res.ProcessRunTime).To(BeNumerically(">=", uint64(3*1000)))
+	})
+
+	It("picks the sample rate from the context switch rate of the CPU", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST":          int32(1),
+			"HW":            int32(0),
+			"SAMPLE_TARGET": int32(1000),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		// pretend CPU 0 switched 10000 times a second during the last window
+		numCPU, err := ebpf.PossibleCPU()
+		Expect(err).NotTo(HaveOccurred())
+		states := make([]testSampleStateT, numCPU)
+		states[0] = testSampleStateT{
+			WindowStart:    getNSecs() - 100000000,
+			WindowSwitches: 999,
+		}
+		err = obj.SampleState.Put(uint32(0), states)
+		Expect(err).NotTo(HaveOccurred())
+
+		runOnCPU0(obj.TestKeplerSchedSwitchTrace)
+
+		err = obj.SampleState.Lookup(uint32(0), &states)
+		Expect(err).NotTo(HaveOccurred())
+		// about 10 events per sampled one, the window being slightly longer than 100ms
+		Expect(states[0].SampleRate).To(BeNumerically("~", 9, 1))
+		Expect(states[0].WindowSwitches).To(BeZero())
+	})
+
+	It("reads the sample rate from runtime_config while running", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST":           int32(1),
+			"HW":             int32(0),
+			"RUNTIME_CONFIG": int32(1),
+		})
+		Expect(err).NotTo(HaveOccurred())
+
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		switchOnCPU0 := func() uint32 {
+			out, err := obj.TestKeplerSchedSwitchTrace.Run(&ebpf.RunOptions{
+				Flags: uint32(1), // BPF_F_TEST_RUN_ON_CPU
+				CPU:   uint32(0),
+			})
+			Expect(err).NotTo(HaveOccurred())
+			Expect(out).To(Equal(uint32(0)))
+
+			var counters []uint32
+			err = obj.CounterSchedSwitch.Lookup(uint32(0), &counters)
+			Expect(err).NotTo(HaveOccurred())
+			return counters[0]
+		}
+
+		err = obj.RuntimeConfig.Put(uint32(0), testRuntimeConfigT{SampleRate: 4})
+		Expect(err).NotTo(HaveOccurred())
+		// the first event is sampled and starts the countdown
+		Expect(switchOnCPU0()).To(Equal(uint32(4)))
+		Expect(switchOnCPU0()).To(Equal(uint32(3)))
+
+		// lowering the sample rate shortens the current countdown
+		err = obj.RuntimeConfig.Put(uint32(0), testRuntimeConfigT{SampleRate: 2})
+		Expect(err).NotTo(HaveOccurred())
+		Expect(switchOnCPU0()).To(Equal(uint32(1)))
+	})
+
+	It("switches the hardware counters of the current task from runtime_config", Label("perf_event"), func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
+		Expect(err).NotTo(HaveOccurred())
+
+		// Load eBPF Specs
+		specs, err := loadTest()
+		Expect(err).NotTo(HaveOccurred())
+
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST":           int32(1),
+			"HW":             int32(0),
+			"RUNTIME_CONFIG": int32(1),
+			"TASK_STORAGE":   int32(1),
 		})
 		Expect(err).NotTo(HaveOccurred())
 
@@ -42,38 +1234,60 @@ var _ = Describe("BPF Exporter", func() {
 		// Load eBPF objects
 		err = specs.LoadAndAssign(&obj, nil)
 		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
 
-		key := uint32(0)
-
-		err = obj.Processes.Put(key, testProcessMetricsT{
-			CgroupId:       0,
-			Pid:            0,
-			ProcessRunTime: 0,
-			CpuCycles:      0,
-			CpuInstr:       0,
-			CacheMiss:      0,
-			PageCacheHit:   0,
-			VecNr:          [10]uint16{},
-			Comm:           [16]int8{},
-		})
+		perfEvents, err := createHardwarePerfEvents(
+			obj.CpuInstructionsEventReader,
+			obj.CpuCyclesEventReader,
+			obj.CacheMissEventReader,
+		)
 		Expect(err).NotTo(HaveOccurred())
+		defer func() {
+			for _, fd := range perfEvents {
+				unix.Close(fd)
+			}
+		}()
 
-		out, err := obj.TestKeplerWritePageTrace.Run(&ebpf.RunOptions{})
-		Expect(err).NotTo(HaveOccurred())
-		Expect(out).To(Equal(uint32(0)))
+		// The current task runs on CPU 0, where the perf events count
+		runtime.LockOSThread()
+		defer runtime.UnlockOSThread()
+		var affinity, cpu0 unix.CPUSet
+		Expect(unix.SchedGetaffinity(0, &affinity)).To(Succeed())
+		cpu0.Set(0)
+		Expect(unix.SchedSetaffinity(0, &cpu0)).To(Succeed())
+		defer func() {
+			Expect(unix.SchedSetaffinity(0, &affinity)).To(Succeed())
+		}()
 
-		// Read the page cache hit counter
-		var res testProcessMetricsT
-		err = obj.Processes.Lookup(key, &res)
-		Expect(err).NotTo(HaveOccurred())
+		pid := uint32(os.Getpid())
+		switchCurrent := func(n int) testProcessMetricsT {
+			for i := 0; i < n; i++ {
+				time.Sleep(time.Millisecond)
+				runCurrentSchedSwitchTracepoint(&obj)
+			}
+			var res testProcessMetricsT
+			err := obj.Processes.Lookup(pid, &res)
+			Expect(err).NotTo(HaveOccurred())
+			return res
+		}
 
-		Expect(res.PageCacheHit).To(BeNumerically("==", uint64(1)))
+		// The first run reads the baselines of the hardware counters
+		err = obj.RuntimeConfig.Put(uint32(0), testRuntimeConfigT{Hw: 1})
+		Expect(err).NotTo(HaveOccurred())
+		res := switchCurrent(2)
+		Expect(res.ProcessRunTime).To(BeNumerically(">=", uint64(1000)))
+		Expect(res.CpuCycles).To(BeNumerically(">", uint64(0)))
 
-		err = obj.Processes.Delete(key)
+		// The counters are no longer read, the run time still is
+		err = obj.RuntimeConfig.Put(uint32(0), testRuntimeConfigT{Hw: 0})
 		Expect(err).NotTo(HaveOccurred())
+		off := switchCurrent(2)
+		Expect(off.ProcessRunTime).To(BeNumerically(">", res.ProcessRunTime))
+		Expect(off.CpuCycles).To(Equal(res.CpuCycles))
+		Expect(off.CpuInstr).To(Equal(res.CpuInstr))
 	})
 
-	It("should register a new process if one doesn't exist", func() {
+	It("tracks the frequency and idle state residency of the CPU", func() {
 		// Remove resource limits for kernels <5.11.
 		err := rlimit.RemoveMemlock()
 		Expect(err).NotTo(HaveOccurred())
@@ -84,6 +1298,7 @@ var _ = Describe("BPF Exporter", func() {
 
 		err = specs.RewriteConstants(map[string]interface{}{
 			"TEST": int32(1),
+			"HW":   int32(0),
 		})
 		Expect(err).NotTo(HaveOccurred())
 
@@ -91,26 +1306,69 @@ var _ = Describe("BPF Exporter", func() {
 		// Load eBPF objects
 		err = specs.LoadAndAssign(&obj, nil)
 		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
 
-		out, err := obj.TestRegisterNewProcessIfNotExist.Run(&ebpf.RunOptions{})
+		getState := func() testCpuPowerStateT {
+			var s testCpuPowerStateT
+			err := obj.CpuPowerState.Lookup(uint32(0), &s)
+			Expect(err).NotTo(HaveOccurred())
+			return s
+		}
+
+		// the residency is unknown until the first idle event
+		runOnCPU0(obj.TestKeplerCpuFrequencyTrace)
+		Expect(getState()).To(Equal(testCpuPowerStateT{FreqMhz: 2000}))
+
+		runOnCPU0(obj.TestKeplerCpuIdleExitTrace)
+		time.Sleep(time.Millisecond)
+		runOnCPU0(obj.TestKeplerCpuIdleEnterTrace)
+		s := getState()
+		Expect(s.IdleState).To(Equal(uint32(1)))
+		Expect(s.BusyTimeNs).To(BeNumerically(">=", uint64(1000000)))
+		Expect(s.BusyMhzUs).To(Equal(2000 * (s.BusyTimeNs / 1000)))
+
+		time.Sleep(time.Millisecond)
+		runOnCPU0(obj.TestKeplerCpuIdleExitTrace)
+		s = getState()
+		Expect(s.IdleState).To(Equal(^uint32(0)))
+		Expect(s.IdleTimeNs[1]).To(BeNumerically(">=", uint64(1000000)))
+	})
+
+	It("counts the block I/O and network bytes of the process", func() {
+		// Remove resource limits for kernels <5.11.
+		err := rlimit.RemoveMemlock()
 		Expect(err).NotTo(HaveOccurred())
-		Expect(out).To(BeNumerically("==", uint32(0)))
 
-		// Read the page cache hit counter
-		var res testProcessMetricsT
-		key := uint32(42) // Kernel TGID
-		err = obj.Processes.Lookup(key, &res)
+		// Load eBPF Specs
+		specs, err := loadTest()
 		Expect(err).NotTo(HaveOccurred())
 
-		Expect(res.Pid).To(BeNumerically("==", uint64(42)))
+		err = specs.RewriteConstants(map[string]interface{}{
+			"TEST": int32(1),
+			"HW":   int32(0),
+		})
+		Expect(err).NotTo(HaveOccurred())
 
-		err = obj.Processes.Delete(key)
+		var obj testObjects
+		// Load eBPF objects
+		err = specs.LoadAndAssign(&obj, nil)
+		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
+
+		err = obj.Processes.Put(uint32(42), testProcessMetricsT{Pid: 42})
+		Expect(err).NotTo(HaveOccurred())
+		runOnCPU0(obj.TestKeplerIoBytes)
+		runOnCPU0(obj.TestKeplerIoBytes)
+
+		var res testProcessIoT
+		err = obj.ProcessIo.Lookup(uint64(42), &res)
 		Expect(err).NotTo(HaveOccurred())
+		Expect(res.BlockIoBytes).To(Equal(uint64(2 * 4096)))
+		Expect(res.NetTxBytes).To(Equal(uint64(2 * 100)))
+		Expect(res.NetRxBytes).To(Equal(uint64(2 * 1500)))
 	})
 
-	It("should increment the page hit counter efficiently", func() {
-		experiment := gmeasure.NewExperiment("Increment the page hit counter")
-		AddReportEntry(experiment.Name, experiment)
+	It("accounts the softirq time to the interrupted process", func() {
 		// Remove resource limits for kernels <5.11.
 		err := rlimit.RemoveMemlock()
 		Expect(err).NotTo(HaveOccurred())
@@ -121,6 +1379,7 @@ var _ = Describe("BPF Exporter", func() {
 
 		err = specs.RewriteConstants(map[string]interface{}{
 			"TEST": int32(1),
+			"HW":   int32(0),
 		})
 		Expect(err).NotTo(HaveOccurred())
 
@@ -128,32 +1387,47 @@ var _ = Describe("BPF Exporter", func() {
 		// Load eBPF objects
 		err = specs.LoadAndAssign(&obj, nil)
 		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
 
-		key := uint32(0)
+		err = obj.Processes.Put(uint32(42), testProcessMetricsT{Pid: 42})
+		Expect(err).NotTo(HaveOccurred())
 
-		err = obj.Processes.Put(key, testProcessMetricsT{
-			CgroupId:       0,
-			Pid:            0,
-			ProcessRunTime: 0,
-			CpuCycles:      0,
-			CpuInstr:       0,
-			CacheMiss:      0,
-			PageCacheHit:   0,
-			VecNr:          [10]uint16{},
-			Comm:           [16]int8{},
-		})
+		// two NET_RX softirqs interrupt TGID 42
+		for i := 0; i < 2; i++ {
+			runOnCPU0(obj.TestKeplerIrqTrace)
+			runOnCPU0(obj.TestKeplerSoftirqExitTrace)
+		}
+
+		numCPU, err := ebpf.PossibleCPU()
 		Expect(err).NotTo(HaveOccurred())
+		states := make([]testSoftirqStateT, numCPU)
+		err = obj.SoftirqState.Lookup(uint32(0), &states)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(states[0].Tgid).To(Equal(uint32(42)))
+		Expect(states[0].EntryTs).To(BeZero())
+		// the NET_RX counters are the second tracked vector
+		Expect(states[0].PendingNr[1]).To(Equal(uint32(2)))
+		Expect(states[0].PendingTimeNs[1]).NotTo(BeZero())
+		pendingTime := states[0].PendingTimeNs[1]
+
+		// they are added to the process when it is switched out
+		err = obj.PidTimeMap.Put(uint32(42), getNSecs()-1000000)
+		Expect(err).NotTo(HaveOccurred())
+		runOnCPU0(obj.TestKeplerSchedSwitchTrace)
 
-		experiment.Sample(func(idx int) {
-			experiment.MeasureDuration("page hit counter increment", func() {
-				out, err := obj.TestKeplerWritePageTrace.Run(&ebpf.RunOptions{})
-				Expect(err).NotTo(HaveOccurred())
-				Expect(out).To(Equal(uint32(0)))
-			}, gmeasure.Precision(time.Nanosecond))
-		}, gmeasure.SamplingConfig{N: 1000000, Duration: 10 * time.Second})
+		var res testProcessIoT
+		err = obj.ProcessIo.Lookup(uint64(42), &res)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(res.VecNr[1]).To(Equal(uint32(2)))
+		Expect(res.SoftirqTimeNs[1]).To(Equal(pendingTime))
+
+		err = obj.SoftirqState.Lookup(uint32(0), &states)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(states[0].PendingNr[1]).To(BeZero())
+		Expect(states[0].PendingTimeNs[1]).To(BeZero())
 	})
 
-	It("collects hardware counter metrics for sched_switch events", Label("perf_event"), func() {
+	It("does not flush the softirqs without the softirq programs", func() {
 		// Remove resource limits for kernels <5.11.
 		err := rlimit.RemoveMemlock()
 		Expect(err).NotTo(HaveOccurred())
@@ -163,8 +1437,9 @@ var _ = Describe("BPF Exporter", func() {
 		Expect(err).NotTo(HaveOccurred())
 
 		err = specs.RewriteConstants(map[string]interface{}{
-			"TEST": int32(1),
-			"HW":   int32(1),
+			"TEST":            int32(1),
+			"HW":              int32(0),
+			"SOFTIRQ_METRICS": int32(0),
 		})
 		Expect(err).NotTo(HaveOccurred())
 
@@ -172,57 +1447,33 @@ var _ = Describe("BPF Exporter", func() {
 		// Load eBPF objects
 		err = specs.LoadAndAssign(&obj, nil)
 		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
 
-		perfEvents, err := createHardwarePerfEvents(
-			obj.CpuInstructionsEventReader,
-			obj.CpuCyclesEventReader,
-			obj.CacheMissEventReader,
-		)
+		err = obj.Processes.Put(uint32(42), testProcessMetricsT{Pid: 42})
 		Expect(err).NotTo(HaveOccurred())
-		defer func() {
-			for _, fd := range perfEvents {
-				unix.Close(fd)
-			}
-		}()
-
-		// Register TGID 42 - This would be done by register_new_process_if_not_exist
-		// when we get a sched_switch event for a new process
-		key := uint32(42)
-		nsecs := getNSecs()
-		err = obj.Processes.Put(key, testProcessMetricsT{
-			CgroupId:       0,
-			Pid:            42,
-			ProcessRunTime: nsecs,
-			CpuCycles:      0,
-			CpuInstr:       0,
-			CacheMiss:      0,
-			PageCacheHit:   0,
-			VecNr:          [10]uint16{},
-			Comm:           [16]int8{},
-		})
+		numCPU, err := ebpf.PossibleCPU()
 		Expect(err).NotTo(HaveOccurred())
-		err = obj.PidTimeMap.Put(key, nsecs)
+		states := make([]testSoftirqStateT, numCPU)
+		states[0].Tgid = 42
+		states[0].PendingNr[1] = 1
+		err = obj.SoftirqState.Put(uint32(0), states)
 		Expect(err).NotTo(HaveOccurred())
 
-		out, err := obj.TestKeplerSchedSwitchTrace.Run(&ebpf.RunOptions{
-			Flags: uint32(1), // BPF_F_TEST_RUN_ON_CPU
-			CPU:   uint32(0),
-		})
+		err = obj.PidTimeMap.Put(uint32(42), getNSecs()-1000000)
 		Expect(err).NotTo(HaveOccurred())
-		Expect(out).To(Equal(uint32(0)))
+		runOnCPU0(obj.TestKeplerSchedSwitchTrace)
 
+		// the process is accounted without a process_io entry
 		var res testProcessMetricsT
-		err = obj.Processes.Lookup(key, &res)
-		Expect(err).NotTo(HaveOccurred())
-		Expect(res.CpuCycles).To(BeNumerically(">", uint64(0)))
-		Expect(res.CpuInstr).To(BeNumerically(">", uint64(0)))
-		Expect(res.CacheMiss).To(BeNumerically(">", uint64(0)))
-
-		err = obj.Processes.Delete(key)
+		err = obj.Processes.Lookup(uint32(42), &res)
 		Expect(err).NotTo(HaveOccurred())
+		Expect(res.ProcessRunTime).To(BeNumerically(">=", uint64(1000)))
+		var io testProcessIoT
+		err = obj.ProcessIo.Lookup(uint64(42), &io)
+		Expect(err).To(MatchError(ebpf.ErrKeyNotExist))
 	})
 
-	It("collects metrics for sched_switch events when no hardware events are enabled", Label("perf_event"), func() {
+	It("batches the page cache hits of the current process", func() {
 		// Remove resource limits for kernels <5.11.
 		err := rlimit.RemoveMemlock()
 		Expect(err).NotTo(HaveOccurred())
@@ -232,8 +1483,9 @@ var _ = Describe("BPF Exporter", func() {
 		Expect(err).NotTo(HaveOccurred())
 
 		err = specs.RewriteConstants(map[string]interface{}{
-			"TEST": int32(1),
-			"HW":   int32(0),
+			"TEST":             int32(1),
+			"HW":               int32(0),
+			"PAGE_CACHE_BATCH": int32(1),
 		})
 		Expect(err).NotTo(HaveOccurred())
 
@@ -241,46 +1493,54 @@ var _ = Describe("BPF Exporter", func() {
 		// Load eBPF objects
 		err = specs.LoadAndAssign(&obj, nil)
 		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
 
-		// Register TGID 42 - This would be done by register_new_process_if_not_exist
-		// when we get a sched_switch event for a new process
-		key := uint32(42)
-		nsecs := getNSecs()
-		err = obj.Processes.Put(key, testProcessMetricsT{
-			CgroupId:       0,
-			Pid:            42,
-			ProcessRunTime: nsecs,
-			CpuCycles:      0,
-			CpuInstr:       0,
-			CacheMiss:      0,
-			PageCacheHit:   0,
-			VecNr:          [10]uint16{},
-			Comm:           [16]int8{},
-		})
+		err = obj.Processes.Put(uint32(0), testProcessMetricsT{})
 		Expect(err).NotTo(HaveOccurred())
-		err = obj.PidTimeMap.Put(key, nsecs)
+		err = obj.Processes.Put(uint32(42), testProcessMetricsT{Pid: 42})
 		Expect(err).NotTo(HaveOccurred())
 
-		out, err := obj.TestKeplerSchedSwitchTrace.Run(&ebpf.RunOptions{
-			Flags: uint32(1), // BPF_F_TEST_RUN_ON_CPU
-			CPU:   uint32(0),
-		})
+		numCPU, err := ebpf.PossibleCPU()
 		Expect(err).NotTo(HaveOccurred())
-		Expect(out).To(Equal(uint32(0)))
-
-		var res testProcessMetricsT
-		err = obj.Processes.Lookup(key, &res)
+		states := make([]testPageCacheStateT, numCPU)
+		getState := func() testPageCacheStateT {
+			err := obj.PageCacheState.Lookup(uint32(0), &states)
+			Expect(err).NotTo(HaveOccurred())
+			return states[0]
+		}
+		getHits := func(pid uint32) uint64 {
+			var res testProcessMetricsT
+			err := obj.Processes.Lookup(pid, &res)
+			Expect(err).NotTo(HaveOccurred())
+			return res.PageCacheHit
+		}
+
+		// the hits of TGID 0 stay on the CPU
+		runOnCPU0(obj.TestKeplerWritePageTrace)
+		runOnCPU0(obj.TestKeplerWritePageTrace)
+		Expect(getState()).To(Equal(testPageCacheStateT{Tgid: 0, Pending: 2}))
+		Expect(getHits(0)).To(BeZero())
+
+		// a hit of another process flushes the pending hits
+		states[0] = testPageCacheStateT{Tgid: 42, Pending: 5}
+		err = obj.PageCacheState.Put(uint32(0), states)
 		Expect(err).NotTo(HaveOccurred())
-		Expect(res.CpuCycles).To(BeNumerically("==", uint64(0)))
-		Expect(res.ProcessRunTime).To(BeNumerically(">", uint64(0)))
+		runOnCPU0(obj.TestKeplerWritePageTrace)
+		Expect(getHits(42)).To(Equal(uint64(5)))
+		Expect(getState()).To(Equal(testPageCacheStateT{Tgid: 0, Pending: 1}))
 
-		err = obj.Processes.Delete(key)
+		// and so does switching the process out
+		states[0] = testPageCacheStateT{Tgid: 42, Pending: 3}
+		err = obj.PageCacheState.Put(uint32(0), states)
 		Expect(err).NotTo(HaveOccurred())
+		err = obj.PidTimeMap.Put(uint32(42), getNSecs()-1000000)
+		Expect(err).NotTo(HaveOccurred())
+		runOnCPU0(obj.TestKeplerSchedSwitchTrace)
+		Expect(getHits(42)).To(Equal(uint64(8)))
+		Expect(getState().Pending).To(BeZero())
 	})
 
-	It("efficiently collects hardware counter metrics for sched_switch events", Label("perf_event"), func() {
-		experiment := gmeasure.NewExperiment("sched_switch tracepoint")
-		AddReportEntry(experiment.Name, experiment)
+	It("samples the page cache hits", func() {
 		// Remove resource limits for kernels <5.11.
 		err := rlimit.RemoveMemlock()
 		Expect(err).NotTo(HaveOccurred())
@@ -290,7 +1550,9 @@ var _ = Describe("BPF Exporter", func() {
 		Expect(err).NotTo(HaveOccurred())
 
 		err = specs.RewriteConstants(map[string]interface{}{
-			"TEST": int32(1),
+			"TEST":                   int32(1),
+			"HW":                     int32(0),
+			"PAGE_CACHE_SAMPLE_RATE": int32(3),
 		})
 		Expect(err).NotTo(HaveOccurred())
 
@@ -298,31 +1560,27 @@ var _ = Describe("BPF Exporter", func() {
 		// Load eBPF objects
 		err = specs.LoadAndAssign(&obj, nil)
 		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
 
-		perfEvents, err := createHardwarePerfEvents(
-			obj.CpuInstructionsEventReader,
-			obj.CpuCyclesEventReader,
-			obj.CacheMissEventReader,
-		)
+		err = obj.Processes.Put(uint32(0), testProcessMetricsT{})
 		Expect(err).NotTo(HaveOccurred())
-		defer func() {
-			for _, fd := range perfEvents {
-				unix.Close(fd)
-			}
-		}()
-		experiment.Sample(func(idx int) {
-			preRunSchedSwitchTracepoint(&obj)
-			experiment.MeasureDuration("sampled sched_switch tracepoint", func() {
-				runSchedSwitchTracepoint(&obj)
-			}, gmeasure.Precision(time.Nanosecond))
-			err = obj.Processes.Delete(uint32(42))
-			Expect(err).NotTo(HaveOccurred())
-		}, gmeasure.SamplingConfig{N: 1000000, Duration: 10 * time.Second})
+
+		var res testProcessMetricsT
+		// the first hit is counted for the next 3 ones
+		for i := 0; i < 4; i++ {
+			runOnCPU0(obj.TestKeplerWritePageTrace)
+		}
+		err = obj.Processes.Lookup(uint32(0), &res)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(res.PageCacheHit).To(Equal(uint64(4)))
+
+		runOnCPU0(obj.TestKeplerWritePageTrace)
+		err = obj.Processes.Lookup(uint32(0), &res)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(res.PageCacheHit).To(Equal(uint64(8)))
 	})
 
-	It("uses sample rate to reduce CPU time", Label("perf_event"), func() {
-		experiment := gmeasure.NewExperiment("sampled sched_switch tracepoint")
-		AddReportEntry(experiment.Name, experiment)
+	It("seeds the maps with the existing tasks", func() {
 		// Remove resource limits for kernels <5.11.
 		err := rlimit.RemoveMemlock()
 		Expect(err).NotTo(HaveOccurred())
@@ -332,8 +1590,8 @@ var _ = Describe("BPF Exporter", func() {
 		Expect(err).NotTo(HaveOccurred())
 
 		err = specs.RewriteConstants(map[string]interface{}{
-			"TEST":        int32(1),
-			"SAMPLE_RATE": int32(1000),
+			"TEST": int32(1),
+			"HW":   int32(0),
 		})
 		Expect(err).NotTo(HaveOccurred())
 
@@ -341,32 +1599,47 @@ var _ = Describe("BPF Exporter", func() {
 		// Load eBPF objects
 		err = specs.LoadAndAssign(&obj, nil)
 		Expect(err).NotTo(HaveOccurred())
+		defer obj.Close()
 
-		perfEvents, err := createHardwarePerfEvents(
-			obj.CpuInstructionsEventReader,
-			obj.CpuCyclesEventReader,
-			obj.CacheMissEventReader,
-		)
+		iter, err := link.AttachIter(link.IterOptions{
+			Program: obj.TestKeplerTaskIter,
+		})
 		Expect(err).NotTo(HaveOccurred())
-		defer func() {
-			for _, fd := range perfEvents {
-				unix.Close(fd)
-			}
-		}()
-		experiment.Sample(func(idx int) {
-			preRunSchedSwitchTracepoint(&obj)
-			experiment.MeasureDuration("sampled sched_switch tracepoint", func() {
-				runSchedSwitchTracepoint(&obj)
-			}, gmeasure.Precision(time.Nanosecond))
-			err = obj.Processes.Delete(uint32(42))
-			Expect(err).NotTo(HaveOccurred())
-		}, gmeasure.SamplingConfig{N: 1000000, Duration: 10 * time.Second})
+		defer iter.Close()
+
+		// the reading thread is running while the iterator visits it
+		runtime.LockOSThread()
+		defer runtime.UnlockOSThread()
+		reader, err := iter.Open()
+		Expect(err).NotTo(HaveOccurred())
+		_, err = io.Copy(io.Discard, reader)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(reader.Close()).To(Succeed())
+
+		pid := uint32(os.Getpid())
+		var process testProcessMetricsT
+		err = obj.Processes.Lookup(pid, &process)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(process.Pid).To(Equal(pid))
+
+		var info testProcessInfoT
+		err = obj.ProcessInfo.Lookup(pid, &info)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(info.CgroupId).NotTo(BeZero())
+		comm := unix.ByteSliceToString(unsafe.Slice((*byte)(unsafe.Pointer(&info.Comm[0])), len(info.Comm)))
+		Expect(comm).To(Equal("bpftest.test"))
+
+		var ts uint64
+		err = obj.PidTimeMap.Lookup(uint32(unix.Gettid()), &ts)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(ts).NotTo(BeZero())
 	})
 })
 
+// getNSecs returns the CLOCK_MONOTONIC time of bpf_ktime_get_ns
 func getNSecs() uint64 {
 	var ts syscall.Timespec
-	_, _, err := syscall.Syscall(syscall.SYS_CLOCK_GETTIME, 4, uintptr(unsafe.Pointer(&ts)), 0)
+	_, _, err := syscall.Syscall(syscall.SYS_CLOCK_GETTIME, 1, uintptr(unsafe.Pointer(&ts)), 0)
 	if err != 0 {
 		panic(err)
 	}
@@ -379,15 +1652,12 @@ func preRunSchedSwitchTracepoint(obj *testObjects) {
 	key := uint32(42)
 	nsecs := getNSecs()
 	err := obj.Processes.Put(key, testProcessMetricsT{
-		CgroupId:       0,
 		Pid:            42,
 		ProcessRunTime: nsecs,
 		CpuCycles:      0,
 		CpuInstr:       0,
 		CacheMiss:      0,
 		PageCacheHit:   0,
-		VecNr:          [10]uint16{},
-		Comm:           [16]int8{},
 	})
 	Expect(err).NotTo(HaveOccurred())
 	err = obj.PidTimeMap.Put(key, nsecs)
@@ -403,7 +1673,50 @@ func runSchedSwitchTracepoint(obj *testObjects) {
 	Expect(out).To(Equal(uint32(0)))
 }
 
-func unixOpenPerfEvent(typ, conf int) (int, error) {
+// runCurrentSchedSwitchTracepoint switches the current task out and in again. The caller locks the OS thread, so
+// that the runs see the same task.
+func runCurrentSchedSwitchTracepoint(obj *testObjects) {
+	out, err := obj.TestKeplerCurrentSchedSwitchTrace.Run(&ebpf.RunOptions{})
+	Expect(err).NotTo(HaveOccurred())
+	Expect(out).To(Equal(uint32(0)))
+}
+
+// cgroup2Mount returns the mount point of the cgroup2 hierarchy, or "" if it is not mounted writable
+func cgroup2Mount() string {
+	mounts, err := os.ReadFile("/proc/self/mounts")
+	if err != nil {
+		return ""
+	}
+	for _, line := range strings.Split(string(mounts), "\n") {
+		fields := strings.Fields(line)
+		if len(fields) >= 4 && fields[2] == "cgroup2" && strings.HasPrefix(fields[3], "rw") {
+			return fields[1]
+		}
+	}
+	return ""
+}
+
+// currentCgroup2 returns the directory of the cgroup2 cgroup of the process
+func currentCgroup2(root string) string {
+	cgroups, err := os.ReadFile("/proc/self/cgroup")
+	Expect(err).NotTo(HaveOccurred())
+	for _, line := range strings.Split(string(cgroups), "\n") {
+		if path, found := strings.CutPrefix(line, "0::"); found {
+			return root + path
+		}
+	}
+	Fail("the process is not in a cgroup2 cgroup")
+	return ""
+}
+
+// cgroupID returns the ID of the cgroup at path, as bpf_get_current_cgroup_id
+func cgroupID(path string) uint64 {
+	handle, _, err := unix.NameToHandleAt(unix.AT_FDCWD, path, 0)
+	Expect(err).NotTo(HaveOccurred())
+	return binary.NativeEndian.Uint64(handle.Bytes())
+}
+
+func unixOpenPerfEvent(typ, conf, cpu int) (int, error) {
 	sysAttr := &unix.PerfEventAttr{
 		Type:   uint32(typ),
 		Size:   uint32(unsafe.Sizeof(unix.PerfEventAttr{})),
@@ -411,9 +1724,9 @@ func unixOpenPerfEvent(typ, conf int) (int, error) {
 	}
 
 	cloexecFlags := unix.PERF_FLAG_FD_CLOEXEC
-	fd, err := unix.PerfEventOpen(sysAttr, -1, 0, -1, cloexecFlags)
+	fd, err := unix.PerfEventOpen(sysAttr, -1, cpu, -1, cloexecFlags)
 	if fd < 0 {
-		return 0, fmt.Errorf("failed to open bpf perf event on cpu 0: %w", err)
+		return 0, fmt.Errorf("failed to open bpf perf event on cpu %d: %w", cpu, err)
 	}
 
 	return fd, nil
@@ -422,7 +1735,7 @@ func unixOpenPerfEvent(typ, conf int) (int, error) {
 // This function is used to create hardware perf events for CPU cycles, instructions and cache misses.
 // Instead of using hardware perf events, we use the software perf event for testing purposes.
 func createHardwarePerfEvents(cpuCyclesMap, cpuInstructionsMap, cacheMissMap *ebpf.Map) ([]int, error) {
-	cpuCyclesFd, err := unixOpenPerfEvent(unix.PERF_TYPE_SOFTWARE, unix.PERF_COUNT_SW_CPU_CLOCK)
+	cpuCyclesFd, err := unixOpenPerfEvent(unix.PERF_TYPE_SOFTWARE, unix.PERF_COUNT_SW_CPU_CLOCK, 0)
 	if err != nil {
 		return nil, err
 	}
@@ -431,7 +1744,7 @@ func createHardwarePerfEvents(cpuCyclesMap, cpuInstructionsMap, cacheMissMap *eb
 		return nil, err
 	}
 
-	cpuInstructionsFd, err := unixOpenPerfEvent(unix.PERF_TYPE_SOFTWARE, unix.PERF_COUNT_SW_CPU_CLOCK)
+	cpuInstructionsFd, err := unixOpenPerfEvent(unix.PERF_TYPE_SOFTWARE, unix.PERF_COUNT_SW_CPU_CLOCK, 0)
 	if err != nil {
 		return nil, err
 	}
@@ -440,7 +1753,7 @@ func createHardwarePerfEvents(cpuCyclesMap, cpuInstructionsMap, cacheMissMap *eb
 		return nil, err
 	}
 
-	cacheMissFd, err := unixOpenPerfEvent(unix.PERF_TYPE_SOFTWARE, unix.PERF_COUNT_SW_CPU_CLOCK)
+	cacheMissFd, err := unixOpenPerfEvent(unix.PERF_TYPE_SOFTWARE, unix.PERF_COUNT_SW_CPU_CLOCK, 0)
 	if err != nil {
 		return nil, err
 	}
@@ -451,3 +1764,21 @@ func createHardwarePerfEvents(cpuCyclesMap, cpuInstructionsMap, cacheMissMap *eb
 
 	return []int{cpuCyclesFd, cpuInstructionsFd, cacheMissFd}, nil
 }
+
+// createPerCPUPerfEvents opens a software perf event on every CPU for each of the given perf event arrays
+func createPerCPUPerfEvents(numCPU int, eventMaps ...*ebpf.Map) ([]int, error) {
+	fds := []int{}
+	for _, m := range eventMaps {
+		for cpu := 0; cpu < numCPU; cpu++ {
+			fd, err := unixOpenPerfEvent(unix.PERF_TYPE_SOFTWARE, unix.PERF_COUNT_SW_CPU_CLOCK, cpu)
+			if err != nil {
+				return fds, err
+			}
+			fds = append(fds, fd)
+			if err := m.Update(uint32(cpu), uint32(fd), ebpf.UpdateAny); err != nil {
+				return fds, err
+			}
+		}
+	}
+	return fds, nil
+}
@@ -1,3 +1,3 @@
 package bpftest
 
-//go:generate go run github.com/cilium/ebpf/cmd/bpf2go@v0.15.0 test ../../bpf/test.bpf.c -- -I../../bpf/include
+//go:generate go run github.com/cilium/ebpf/cmd/bpf2go@v0.15.0 -type process_exit_t test ../../bpf/test.bpf.c -- -I../../bpf/include
@@ -12,15 +12,99 @@ import (
 	"github.com/cilium/ebpf"
 )
 
+type testCpuPowerStateT struct {
+	LastTs     uint64
+	FreqMhz    uint32
+	IdleState  uint32
+	BusyTimeNs uint64
+	BusyMhzUs  uint64
+	IdleTimeNs [10]uint64
+}
+
+type testHwCountersT struct {
+	CpuCycles  uint64
+	CpuInstr   uint64
+	CacheMiss  uint64
+	Generation uint64
+}
+
+type testPageCacheStateT struct {
+	Tgid    uint32
+	Pending uint32
+	Counter uint32
+}
+
+type testProcessExitT struct {
+	Metrics testProcessMetricsT
+	Io      testProcessIoT
+	Info    testProcessInfoT
+}
+
+type testProcessInfoT struct {
+	CgroupId         uint64
+	AncestorCgroupId uint64
+	Comm             [16]int8
+}
+
+type testProcessIoT struct {
+	SoftirqTimeNs [3]uint64
+	BlockIoBytes  uint64
+	NetTxBytes    uint64
+	NetRxBytes    uint64
+	VecNr         [3]uint32
+	_             [4]byte
+}
+
 type testProcessMetricsT struct {
-	CgroupId       uint64
-	Pid            uint64
 	ProcessRunTime uint64
 	CpuCycles      uint64
 	CpuInstr       uint64
 	CacheMiss      uint64
 	PageCacheHit   uint64
-	VecNr          [10]uint16
+	Pid            uint32
+	_              [4]byte
+}
+
+type testProgStatsT struct {
+	RunCount          uint64
+	RunTimeNs         uint64
+	MapUpdateFailures uint64
+	RegisterRaces     uint64
+	TimestampMisses   uint64
+}
+
+type testRuntimeConfigT struct {
+	SampleRate uint32
+	Hw         uint32
+}
+
+type testSampleStateT struct {
+	WindowStart    uint64
+	WindowSwitches uint64
+	SampleRate     uint32
+	Skipped        uint32
+}
+
+type testSliceHistogramT struct {
+	Buckets [24]uint64
+	SumUs   uint64
+}
+
+type testSoftirqStateT struct {
+	EntryTs       uint64
+	Vec           uint32
+	Tgid          uint32
+	PendingNr     [3]uint32
+	_             [4]byte
+	PendingTimeNs [3]uint64
+}
+
+type testThreadMetricsT struct {
+	ProcessRunTime uint64
+	CpuCycles      uint64
+	CpuInstr       uint64
+	CacheMiss      uint64
+	Tgid           uint32
 	Comm           [16]int8
 	_              [4]byte
 }
@@ -66,23 +150,54 @@ type testSpecs struct {
 //
 // It can be passed ebpf.CollectionSpec.Assign.
 type testProgramSpecs struct {
-	TestKeplerSchedSwitchTrace       *ebpf.ProgramSpec `ebpf:"test_kepler_sched_switch_trace"`
-	TestKeplerWritePageTrace         *ebpf.ProgramSpec `ebpf:"test_kepler_write_page_trace"`
-	TestRegisterNewProcessIfNotExist *ebpf.ProgramSpec `ebpf:"test_register_new_process_if_not_exist"`
+	TestKeplerCpuFrequencyTrace       *ebpf.ProgramSpec `ebpf:"test_kepler_cpu_frequency_trace"`
+	TestKeplerCpuIdleEnterTrace       *ebpf.ProgramSpec `ebpf:"test_kepler_cpu_idle_enter_trace"`
+	TestKeplerCpuIdleExitTrace        *ebpf.ProgramSpec `ebpf:"test_kepler_cpu_idle_exit_trace"`
+	TestKeplerCurrentProcessExitTrace *ebpf.ProgramSpec `ebpf:"test_kepler_current_process_exit_trace"`
+	TestKeplerCurrentSchedSwitchTrace *ebpf.ProgramSpec `ebpf:"test_kepler_current_sched_switch_trace"`
+	TestKeplerIoBytes                 *ebpf.ProgramSpec `ebpf:"test_kepler_io_bytes"`
+	TestKeplerIrqTrace                *ebpf.ProgramSpec `ebpf:"test_kepler_irq_trace"`
+	TestKeplerSchedProcessExecTrace   *ebpf.ProgramSpec `ebpf:"test_kepler_sched_process_exec_trace"`
+	TestKeplerSchedProcessExitTrace   *ebpf.ProgramSpec `ebpf:"test_kepler_sched_process_exit_trace"`
+	TestKeplerSchedSwitchTrace        *ebpf.ProgramSpec `ebpf:"test_kepler_sched_switch_trace"`
+	TestKeplerSoftirqExitTrace        *ebpf.ProgramSpec `ebpf:"test_kepler_softirq_exit_trace"`
+	TestKeplerTaskIter                *ebpf.ProgramSpec `ebpf:"test_kepler_task_iter"`
+	TestKeplerThreadSchedSwitchTrace  *ebpf.ProgramSpec `ebpf:"test_kepler_thread_sched_switch_trace"`
+	TestKeplerWritePageTrace          *ebpf.ProgramSpec `ebpf:"test_kepler_write_page_trace"`
+	TestNoop                          *ebpf.ProgramSpec `ebpf:"test_noop"`
+	TestRegisterNewProcessIfNotExist  *ebpf.ProgramSpec `ebpf:"test_register_new_process_if_not_exist"`
 }
 
 // testMapSpecs contains maps before they are loaded into the kernel.
 //
 // It can be passed ebpf.CollectionSpec.Assign.
 type testMapSpecs struct {
-	CacheMiss                  *ebpf.MapSpec `ebpf:"cache_miss"`
 	CacheMissEventReader       *ebpf.MapSpec `ebpf:"cache_miss_event_reader"`
-	CpuCycles                  *ebpf.MapSpec `ebpf:"cpu_cycles"`
+	CgroupSlices               *ebpf.MapSpec `ebpf:"cgroup_slices"`
+	Cgroups                    *ebpf.MapSpec `ebpf:"cgroups"`
+	CgroupsEpochs              *ebpf.MapSpec `ebpf:"cgroups_epochs"`
+	CgroupsShadow              *ebpf.MapSpec `ebpf:"cgroups_shadow"`
+	CounterSchedSwitch         *ebpf.MapSpec `ebpf:"counter_sched_switch"`
 	CpuCyclesEventReader       *ebpf.MapSpec `ebpf:"cpu_cycles_event_reader"`
-	CpuInstructions            *ebpf.MapSpec `ebpf:"cpu_instructions"`
+	CpuHwCounters              *ebpf.MapSpec `ebpf:"cpu_hw_counters"`
 	CpuInstructionsEventReader *ebpf.MapSpec `ebpf:"cpu_instructions_event_reader"`
+	CpuPowerState              *ebpf.MapSpec `ebpf:"cpu_power_state"`
+	PageCacheState             *ebpf.MapSpec `ebpf:"page_cache_state"`
 	PidTimeMap                 *ebpf.MapSpec `ebpf:"pid_time_map"`
+	ProcessExits               *ebpf.MapSpec `ebpf:"process_exits"`
+	ProcessInfo                *ebpf.MapSpec `ebpf:"process_info"`
+	ProcessIo                  *ebpf.MapSpec `ebpf:"process_io"`
+	ProcessIoEpochs            *ebpf.MapSpec `ebpf:"process_io_epochs"`
+	ProcessIoShadow            *ebpf.MapSpec `ebpf:"process_io_shadow"`
 	Processes                  *ebpf.MapSpec `ebpf:"processes"`
+	ProcessesEpochs            *ebpf.MapSpec `ebpf:"processes_epochs"`
+	ProcessesShadow            *ebpf.MapSpec `ebpf:"processes_shadow"`
+	ProgStats                  *ebpf.MapSpec `ebpf:"prog_stats"`
+	RuntimeConfig              *ebpf.MapSpec `ebpf:"runtime_config"`
+	SampleState                *ebpf.MapSpec `ebpf:"sample_state"`
+	SoftirqState               *ebpf.MapSpec `ebpf:"softirq_state"`
+	TaskTimeMap                *ebpf.MapSpec `ebpf:"task_time_map"`
+	Threads                    *ebpf.MapSpec `ebpf:"threads"`
 }
 
 // testObjects contains all objects after they have been loaded into the kernel.
@@ -104,26 +219,62 @@ func (o *testObjects) Close() error {
 //
 // It can be passed to loadTestObjects or ebpf.CollectionSpec.LoadAndAssign.
 type testMaps struct {
-	CacheMiss                  *ebpf.Map `ebpf:"cache_miss"`
 	CacheMissEventReader       *ebpf.Map `ebpf:"cache_miss_event_reader"`
-	CpuCycles                  *ebpf.Map `ebpf:"cpu_cycles"`
+	CgroupSlices               *ebpf.Map `ebpf:"cgroup_slices"`
+	Cgroups                    *ebpf.Map `ebpf:"cgroups"`
+	CgroupsEpochs              *ebpf.Map `ebpf:"cgroups_epochs"`
+	CgroupsShadow              *ebpf.Map `ebpf:"cgroups_shadow"`
+	CounterSchedSwitch         *ebpf.Map `ebpf:"counter_sched_switch"`
 	CpuCyclesEventReader       *ebpf.Map `ebpf:"cpu_cycles_event_reader"`
-	CpuInstructions            *ebpf.Map `ebpf:"cpu_instructions"`
+	CpuHwCounters              *ebpf.Map `ebpf:"cpu_hw_counters"`
 	CpuInstructionsEventReader *ebpf.Map `ebpf:"cpu_instructions_event_reader"`
+	CpuPowerState              *ebpf.Map `ebpf:"cpu_power_state"`
+	PageCacheState             *ebpf.Map `ebpf:"page_cache_state"`
 	PidTimeMap                 *ebpf.Map `ebpf:"pid_time_map"`
+	ProcessExits               *ebpf.Map `ebpf:"process_exits"`
+	ProcessInfo                *ebpf.Map `ebpf:"process_info"`
+	ProcessIo                  *ebpf.Map `ebpf:"process_io"`
+	ProcessIoEpochs            *ebpf.Map `ebpf:"process_io_epochs"`
+	ProcessIoShadow            *ebpf.Map `ebpf:"process_io_shadow"`
 	Processes                  *ebpf.Map `ebpf:"processes"`
+	ProcessesEpochs            *ebpf.Map `ebpf:"processes_epochs"`
+	ProcessesShadow            *ebpf.Map `ebpf:"processes_shadow"`
+	ProgStats                  *ebpf.Map `ebpf:"prog_stats"`
+	RuntimeConfig              *ebpf.Map `ebpf:"runtime_config"`
+	SampleState                *ebpf.Map `ebpf:"sample_state"`
+	SoftirqState               *ebpf.Map `ebpf:"softirq_state"`
+	TaskTimeMap                *ebpf.Map `ebpf:"task_time_map"`
+	Threads                    *ebpf.Map `ebpf:"threads"`
 }
 
 func (m *testMaps) Close() error {
 	return _TestClose(
-		m.CacheMiss,
 		m.CacheMissEventReader,
-		m.CpuCycles,
+		m.CgroupSlices,
+		m.Cgroups,
+		m.CgroupsEpochs,
+		m.CgroupsShadow,
+		m.CounterSchedSwitch,
 		m.CpuCyclesEventReader,
-		m.CpuInstructions,
+		m.CpuHwCounters,
 		m.CpuInstructionsEventReader,
+		m.CpuPowerState,
+		m.PageCacheState,
 		m.PidTimeMap,
+		m.ProcessExits,
+		m.ProcessInfo,
+		m.ProcessIo,
+		m.ProcessIoEpochs,
+		m.ProcessIoShadow,
 		m.Processes,
+		m.ProcessesEpochs,
+		m.ProcessesShadow,
+		m.ProgStats,
+		m.RuntimeConfig,
+		m.SampleState,
+		m.SoftirqState,
+		m.TaskTimeMap,
+		m.Threads,
 	)
 }
 
@@ -131,15 +282,41 @@ func (m *testMaps) Close() error {
 //
 // It can be passed to loadTestObjects or ebpf.CollectionSpec.LoadAndAssign.
 type testPrograms struct {
-	TestKeplerSchedSwitchTrace       *ebpf.Program `ebpf:"test_kepler_sched_switch_trace"`
-	TestKeplerWritePageTrace         *ebpf.Program `ebpf:"test_kepler_write_page_trace"`
-	TestRegisterNewProcessIfNotExist *ebpf.Program `ebpf:"test_register_new_process_if_not_exist"`
+	TestKeplerCpuFrequencyTrace       *ebpf.Program `ebpf:"test_kepler_cpu_frequency_trace"`
+	TestKeplerCpuIdleEnterTrace       *ebpf.Program `ebpf:"test_kepler_cpu_idle_enter_trace"`
+	TestKeplerCpuIdleExitTrace        *ebpf.Program `ebpf:"test_kepler_cpu_idle_exit_trace"`
+	TestKeplerCurrentProcessExitTrace *ebpf.Program `ebpf:"test_kepler_current_process_exit_trace"`
+	TestKeplerCurrentSchedSwitchTrace *ebpf.Program `ebpf:"test_kepler_current_sched_switch_trace"`
+	TestKeplerIoBytes                 *ebpf.Program `ebpf:"test_kepler_io_bytes"`
+	TestKeplerIrqTrace                *ebpf.Program `ebpf:"test_kepler_irq_trace"`
+	TestKeplerSchedProcessExecTrace   *ebpf.Program `ebpf:"test_kepler_sched_process_exec_trace"`
+	TestKeplerSchedProcessExitTrace   *ebpf.Program `ebpf:"test_kepler_sched_process_exit_trace"`
+	TestKeplerSchedSwitchTrace        *ebpf.Program `ebpf:"test_kepler_sched_switch_trace"`
+	TestKeplerSoftirqExitTrace        *ebpf.Program `ebpf:"test_kepler_softirq_exit_trace"`
+	TestKeplerTaskIter                *ebpf.Program `ebpf:"test_kepler_task_iter"`
+	TestKeplerThreadSchedSwitchTrace  *ebpf.Program `ebpf:"test_kepler_thread_sched_switch_trace"`
+	TestKeplerWritePageTrace          *ebpf.Program `ebpf:"test_kepler_write_page_trace"`
+	TestNoop                          *ebpf.Program `ebpf:"test_noop"`
+	TestRegisterNewProcessIfNotExist  *ebpf.Program `ebpf:"test_register_new_process_if_not_exist"`
 }
 
 func (p *testPrograms) Close() error {
 	return _TestClose(
+		p.TestKeplerCpuFrequencyTrace,
+		p.TestKeplerCpuIdleEnterTrace,
+		p.TestKeplerCpuIdleExitTrace,
+		p.TestKeplerCurrentProcessExitTrace,
+		p.TestKeplerCurrentSchedSwitchTrace,
+		p.TestKeplerIoBytes,
+		p.TestKeplerIrqTrace,
+		p.TestKeplerSchedProcessExecTrace,
+		p.TestKeplerSchedProcessExitTrace,
 		p.TestKeplerSchedSwitchTrace,
+		p.TestKeplerSoftirqExitTrace,
+		p.TestKeplerTaskIter,
+		p.TestKeplerThreadSchedSwitchTrace,
 		p.TestKeplerWritePageTrace,
+		p.TestNoop,
 		p.TestRegisterNewProcessIfNotExist,
 	)
 }
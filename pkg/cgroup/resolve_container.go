@@ -158,13 +158,106 @@ func (c *cache) getContainerIDFromcGroupID(cGroupID uint64) (string, error) {
 	return containerID, nil
 }
 
+// getContainerIDFromPodcGroupID is getContainerIDFromcGroupID for a cgroup under the pod cgroup podCgroupID: a cgroup
+// ID that is not cached yet is only looked up in the directory of the pod, whose path is cached by pod cgroup ID, so
+// that a new container does not walk the whole cgroupfs
+func (c *cache) getContainerIDFromPodcGroupID(cGroupID, podCgroupID uint64) (string, error) {
+	id, ok := instance.getContainerIDFromCache(cGroupID)
+	if ok {
+		return id, nil
+	}
+
+	podPath, err := instance.getPodPathFromcGroupIDUnder(cgroupPath, podCgroupID)
+	if err != nil {
+		return utils.SystemProcessName, err
+	}
+	if podPath == unknownPath {
+		return utils.SystemProcessName, fmt.Errorf("failed to find the pod cgroup %d", podCgroupID)
+	}
+	path, err := instance.getPathFromcGroupIDUnder(podPath, cGroupID)
+	if err != nil {
+		return utils.SystemProcessName, err
+	}
+
+	containerID, err := extractPodContainerIDfromPathWithCgroup(path)
+	if err != nil {
+		return utils.SystemProcessName, err
+	}
+	AddContainerIDToCache(cGroupID, containerID)
+
+	return containerID, nil
+}
+
+// getPodPathFromcGroupIDUnder is getPathFromcGroupIDUnder for a pod cgroup: the systemd units outside kubepods and the
+// containers of the pods are not walked, only the kubepods and QoS directories down to the pods
+func (c *cache) getPodPathFromcGroupIDUnder(root string, podCgroupID uint64) (string, error) {
+	p, ok := instance.cGroupIDToPath.Load(podCgroupID)
+	if ok {
+		return p.(string), nil
+	}
+
+	err := filepath.WalkDir(root, func(path string, dentry fs.DirEntry, err error) error {
+		if err != nil {
+			return err
+		}
+		if !dentry.IsDir() {
+			return nil
+		}
+
+		name := dentry.Name()
+		inKubepods := strings.Contains(strings.TrimPrefix(filepath.Dir(path), root), "/kubepods")
+		isPod := path != root && isPodCgroupName(name, inKubepods)
+		switch {
+		case path == root, isPod, strings.HasPrefix(name, "kubepods"):
+		case inKubepods && (name == "burstable" || name == "besteffort"):
+			// the QoS directories of the cgroupfs driver
+		case inKubepods, strings.HasSuffix(name, ".slice"), strings.HasSuffix(name, ".scope"), strings.HasSuffix(name, ".service"):
+			return fs.SkipDir
+		}
+
+		getCgroupID, err := utils.GetCgroupIDFromPath(instance.byteOrder, path)
+		if err != nil {
+			return fmt.Errorf("error resolving handle: %w", err)
+		}
+		instance.cGroupIDToPath.Store(getCgroupID, path)
+		if isPod {
+			// the containers of the pod are walked on their first lookup
+			return fs.SkipDir
+		}
+		return nil
+	})
+	if err != nil {
+		return unknownPath, fmt.Errorf("failed to find pod cgroup id: %v", err)
+	}
+	p, ok = instance.cGroupIDToPath.Load(podCgroupID)
+	if ok {
+		return p.(string), nil
+	}
+	return unknownPath, nil
+}
+
+// isPodCgroupName returns true for the directory of a pod: kubepods-pod<uid>.slice or kubepods-<qos>-pod<uid>.slice
+// with the systemd driver, pod<uid> under kubepods with the cgroupfs driver
+func isPodCgroupName(name string, inKubepods bool) bool {
+	if rest, found := strings.CutPrefix(name, "kubepods"); found {
+		return strings.Contains(rest, "-pod")
+	}
+	return inKubepods && strings.HasPrefix(name, "pod")
+}
+
 func (c *cache) getPathFromcGroupID(cgroupID uint64) (string, error) {
+	return c.getPathFromcGroupIDUnder(cgroupPath, cgroupID)
+}
+
+// getPathFromcGroupIDUnder returns the path of a cgroup, walking the directory root to cache the paths of the cgroups
+// under it if the cgroup is not cached yet
+func (c *cache) getPathFromcGroupIDUnder(root string, cgroupID uint64) (string, error) {
 	p, ok := instance.cGroupIDToPath.Load(cgroupID)
 	if ok {
 		return p.(string), nil
 	}
 
-	err := filepath.WalkDir(cgroupPath, func(path string, dentry fs.DirEntry, err error) error {
+	err := filepath.WalkDir(root, func(path string, dentry fs.DirEntry, err error) error {
 		if err != nil {
 			return err
 		}
@@ -261,6 +354,25 @@ func GetContainerInfo(cGroupID, pid uint64, withCGroupID bool) (ContainerInfo, e
 	}
 
 	containerID, err := getContainerIDFromPath(cGroupID, pid, withCGroupID)
+	return registerContainerInfo(info, containerID, err)
+}
+
+// GetContainerIDInPod is GetContainerID with the cgroup ID for a cgroup under the pod cgroup podCgroupID, e.g. the
+// ancestor cgroup ID recorded by the eBPF programs
+func GetContainerIDInPod(cGroupID, podCgroupID uint64) (string, error) {
+	info := ContainerInfo{
+		ContainerID:   utils.SystemProcessName,
+		ContainerName: utils.SystemProcessName,
+		PodName:       utils.SystemProcessName,
+		Namespace:     utils.SystemProcessNamespace,
+	}
+	containerID, err := instance.getContainerIDFromPodcGroupID(cGroupID, podCgroupID)
+	info, err = registerContainerInfo(info, containerID, err)
+	return info.ContainerID, err
+}
+
+// registerContainerInfo returns the info of a resolved container, registering it with the default info if it is new
+func registerContainerInfo(info ContainerInfo, containerID string, err error) (ContainerInfo, error) {
 	if err != nil {
 		return info, err
 	}
@@ -17,6 +17,8 @@ limitations under the License.
 package cgroup
 
 import (
+	"os"
+	"path/filepath"
 	"testing"
 
 	. "github.com/onsi/gomega"
@@ -236,3 +238,83 @@ func TestValidContainerID(t *testing.T) {
 	result := validContainerID("")
 	g.Expect(result).To(Equal(utils.SystemProcessName))
 }
+
+func TestContainerIDFromPodcGroupID(t *testing.T) {
+	g := NewWithT(t)
+	c := GetCache()
+	containerID := "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+	podPath := filepath.Join(t.TempDir(), "kubepods-pod1234.slice")
+	containerPath := filepath.Join(podPath, "cri-containerd-"+containerID+".scope")
+	g.Expect(os.MkdirAll(containerPath, 0o755)).To(Succeed())
+	cgroupID, err := utils.GetCgroupIDFromPath(c.byteOrder, containerPath)
+	if err != nil {
+		t.Skipf("file handles are not supported in %s: %v", podPath, err)
+	}
+
+	// the pod is known, only its directory is walked for the new container
+	c.cGroupIDToPath.Store(uint64(4242), podPath)
+	id, err := GetContainerIDInPod(cgroupID, uint64(4242))
+	g.Expect(err).NotTo(HaveOccurred())
+	g.Expect(id).To(Equal(containerID))
+	path, err := c.getPathFromcGroupID(cgroupID)
+	g.Expect(err).NotTo(HaveOccurred())
+	g.Expect(path).To(Equal(containerPath))
+
+	id, err = GetContainerIDInPod(cgroupID, uint64(4242))
+	g.Expect(err).NotTo(HaveOccurred())
+	g.Expect(id).To(Equal(containerID))
+}
+
+func TestPodPathFromcGroupIDNestedQoS(t *testing.T) {
+	g := NewWithT(t)
+	c := GetCache()
+	root := t.TempDir()
+	containerID := "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+	container := "cri-containerd-" + containerID + ".scope"
+	// the pods of each QoS class are at a different depth
+	pods := []string{
+		filepath.Join(root, "kubepods.slice", "kubepods-pod1.slice"),
+		filepath.Join(root, "kubepods.slice", "kubepods-burstable.slice", "kubepods-burstable-pod2.slice"),
+		filepath.Join(root, "kubepods.slice", "kubepods-besteffort.slice", "kubepods-besteffort-pod3.slice"),
+		filepath.Join(root, "kubepods", "burstable", "pod4"),
+		filepath.Join(root, "kubepods", "besteffort", "pod5"),
+	}
+	for _, pod := range pods {
+		g.Expect(os.MkdirAll(filepath.Join(pod, container), 0o755)).To(Succeed())
+	}
+	unit := filepath.Join(root, "system.slice", "kepler.service")
+	g.Expect(os.MkdirAll(unit, 0o755)).To(Succeed())
+	if _, err := utils.GetCgroupIDFromPath(c.byteOrder, unit); err != nil {
+		t.Skipf("file handles are not supported in %s: %v", root, err)
+	}
+
+	for _, pod := range pods {
+		podCgroupID, err := utils.GetCgroupIDFromPath(c.byteOrder, pod)
+		g.Expect(err).NotTo(HaveOccurred())
+		path, err := c.getPodPathFromcGroupIDUnder(root, podCgroupID)
+		g.Expect(err).NotTo(HaveOccurred())
+		g.Expect(path).To(Equal(pod))
+
+		// only the pod directories and their parents are walked
+		containerCgroupID, err := utils.GetCgroupIDFromPath(c.byteOrder, filepath.Join(pod, container))
+		g.Expect(err).NotTo(HaveOccurred())
+		_, found := c.cGroupIDToPath.Load(containerCgroupID)
+		g.Expect(found).To(BeFalse())
+
+		path, err = c.getPathFromcGroupIDUnder(path, containerCgroupID)
+		g.Expect(err).NotTo(HaveOccurred())
+		g.Expect(path).To(Equal(filepath.Join(pod, container)))
+		id, err := extractPodContainerIDfromPathWithCgroup(path)
+		g.Expect(err).NotTo(HaveOccurred())
+		g.Expect(id).To(Equal(containerID))
+	}
+	unitCgroupID, err := utils.GetCgroupIDFromPath(c.byteOrder, unit)
+	g.Expect(err).NotTo(HaveOccurred())
+	_, found := c.cGroupIDToPath.Load(unitCgroupID)
+	g.Expect(found).To(BeFalse())
+
+	// a pod that is not in the kubepods directories is not found
+	path, err := c.getPodPathFromcGroupIDUnder(root, unitCgroupID)
+	g.Expect(err).NotTo(HaveOccurred())
+	g.Expect(path).To(Equal(unknownPath))
+}
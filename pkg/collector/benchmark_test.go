@@ -0,0 +1,77 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package collector
+
+import (
+	"os"
+	"testing"
+
+	"github.com/sustainable-computing-io/kepler/pkg/collector/stats"
+	"github.com/sustainable-computing-io/kepler/pkg/config"
+	"github.com/sustainable-computing-io/kepler/pkg/replay"
+	"github.com/sustainable-computing-io/kepler/pkg/sensors/components"
+)
+
+// replayFileEnv is the recording replayed by the benchmarks, recorded with EXPERIMENTAL_BPF_RECORD_FILE, instead of
+// the synthetic ones
+const replayFileEnv = "KEPLER_REPLAY_FILE"
+
+// benchmarkUpdate times Collector.Update end to end, from the collection of the BPF samples to the estimation of the
+// process energy and its aggregation, replaying a recording in a loop
+func benchmarkUpdate(b *testing.B, processes, churn int) {
+	_, _ = config.Initialize(".")
+	stats.SetMockedCollectorMetrics()
+
+	var r *replay.Replayer
+	var err error
+	if path := os.Getenv(replayFileEnv); path != "" {
+		r, err = replay.NewReplayerFromFile(path)
+	} else {
+		r, err = replay.NewReplayer(replay.GenerateRecording(10, processes, churn))
+	}
+	if err != nil {
+		b.Fatal(err)
+	}
+	components.SetPowerImpl(r)
+	defer components.InitPowerImpl()
+
+	c := NewCollector(r)
+	if err := c.Initialize(); err != nil {
+		b.Fatal(err)
+	}
+	// fill the stats before timing
+	c.Update()
+
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		c.Prepare()
+		c.Update()
+	}
+}
+
+func BenchmarkUpdateWith1000Process(b *testing.B) {
+	benchmarkUpdate(b, 1000, 100)
+}
+
+func BenchmarkUpdateWith10000Process(b *testing.B) {
+	benchmarkUpdate(b, 10000, 1000)
+}
+
+func BenchmarkUpdateWith30000Process(b *testing.B) {
+	benchmarkUpdate(b, 30000, 3000)
+}
@@ -59,6 +59,12 @@ type Collector struct {
 	bpfExporter bpf.Exporter
 	// bpfSupportedMetrics holds the supported metrics by the bpf exporter
 	bpfSupportedMetrics bpf.SupportedMetrics
+	// bpfCounters are the counters of the bpf records resolved from bpfSupportedMetrics
+	bpfCounters *resourceBpf.ProcessCounters
+	// bpfRecords are the bpf records collected by Prepare for the next Update
+	bpfRecords *resourceBpf.ProcessRecords
+	// workers is the number of goroutines the process stats are sharded across
+	workers int
 }
 
 func NewCollector(bpfExporter bpf.Exporter) *Collector {
@@ -70,6 +76,8 @@ func NewCollector(bpfExporter bpf.Exporter) *Collector {
 		VMStats:             map[string]*stats.VMStats{},
 		bpfExporter:         bpfExporter,
 		bpfSupportedMetrics: bpfSupportedMetrics,
+		bpfCounters:         resourceBpf.NewProcessCounters(bpfSupportedMetrics),
+		workers:             config.GetCollectorWorkers(),
 	}
 	return c
 }
@@ -84,6 +92,17 @@ func (c *Collector) Initialize() error {
 	return nil
 }
 
+// Stop stops the background work of the collector, such as the sampling of the GPUs, before the devices are shut down
+func (c *Collector) Stop() {
+	accelerator.StopGPUSampler()
+}
+
+// Prepare collects the bpf records of the next Update and resolves the containers and VMs of their new processes.
+// It only reads the process stats, so unlike Update it can run while the stats are exported.
+func (c *Collector) Prepare() {
+	c.bpfRecords = resourceBpf.CollectProcessRecords(c.bpfExporter, c.ProcessStats, c.workers)
+}
+
 // Update updates the node and container energy and resource usage metrics
 func (c *Collector) Update() {
 	start := time.Now()
@@ -105,8 +124,17 @@ func (c *Collector) Update() {
 // resetDeltaValue resets existing podEnergy previous curr value
 func (c *Collector) resetDeltaValue() {
 	c.NodeStats.ResetDeltaValues()
-	for _, v := range c.ProcessStats {
-		v.ResetDeltaValues()
+	if c.workers > 1 {
+		_, processes := c.processList()
+		utils.ForEachShard(len(processes), c.workers, func(_, start, end int) {
+			for _, v := range processes[start:end] {
+				v.ResetDeltaValues()
+			}
+		})
+	} else {
+		for _, v := range c.ProcessStats {
+			v.ResetDeltaValues()
+		}
 	}
 	if config.IsExposeContainerStatsEnabled() {
 		for _, v := range c.ContainerStats {
@@ -150,14 +178,20 @@ func (c *Collector) updateResourceUtilizationMetrics() {
 
 // update the node metrics that are not related to aggregated resource utilization of processes
 func (c *Collector) updateNodeResourceUtilizationMetrics(wg *sync.WaitGroup) {
-	wg.Done()
+	defer wg.Done()
+	resourceBpf.UpdateNodeCPUPowerStateMetrics(c.bpfExporter, &c.NodeStats)
 }
 
 func (c *Collector) updateProcessResourceUtilizationMetrics(wg *sync.WaitGroup) {
 	defer wg.Done()
 	// update process metrics regarding the resource utilization to be used to calculate the energy consumption
 	// we first updates the bpf which is responsible to include new processes in the ProcessStats collection
-	resourceBpf.UpdateProcessBPFMetrics(c.bpfExporter, c.ProcessStats)
+	records := c.bpfRecords
+	c.bpfRecords = nil
+	if records == nil {
+		records = resourceBpf.CollectProcessRecords(c.bpfExporter, c.ProcessStats, c.workers)
+	}
+	resourceBpf.UpdateProcessBPFMetrics(records, c.bpfCounters, c.ProcessStats)
 	if config.IsGPUEnabled() {
 		if acc.GetActiveAcceleratorByType(config.GPU) != nil {
 			accelerator.UpdateProcessGPUUtilizationMetrics(c.ProcessStats)
@@ -169,37 +203,39 @@ func (c *Collector) updateProcessResourceUtilizationMetrics(wg *sync.WaitGroup)
 func (c *Collector) AggregateProcessResourceUtilizationMetrics() {
 	foundContainer := make(map[string]bool)
 	foundVM := make(map[string]bool)
-	for _, process := range c.ProcessStats {
-		if process.IdleCounter > 0 {
-			// if the process metrics were not updated for multiple iterations, very if the process still exist, otherwise delete it from the map
-			c.handleIdlingProcess(process)
-		}
-		for metricName, resource := range process.ResourceUsage {
-			for id := range resource {
-				delta := resource[id].GetDelta() // currently the process metrics are single socket
-
-				// aggregate metrics per container
-				if config.IsExposeContainerStatsEnabled() {
-					if process.ContainerID != "" {
-						c.createContainerStatsIfNotExist(process.ContainerID, process.CGroupID, process.PID, config.EnabledEBPFCgroupID())
-						c.ContainerStats[process.ContainerID].ResourceUsage[metricName].AddDeltaStat(id, delta)
-						foundContainer[process.ContainerID] = true
+	if c.workers > 1 {
+		c.aggregateShardedProcessResourceUtilizationMetrics(foundContainer, foundVM)
+	} else {
+		for key, process := range c.ProcessStats {
+			if process.IdleCounter > 0 {
+				// if the process metrics were not updated for multiple iterations, very if the process still exist, otherwise delete it from the map
+				c.handleIdlingProcess(key, process)
+			}
+			for metricName, resource := range process.ResourceUsage {
+				for id := range resource {
+					delta := resource[id].GetDelta() // currently the process metrics are single socket
+
+					// aggregate metrics per container
+					if config.IsExposeContainerStatsEnabled() {
+						if process.ContainerID != "" {
+							c.createContainerStatsIfNotExist(process.ContainerID, process.CGroupID, process.PID, config.EnabledEBPFCgroupID())
+							c.ContainerStats[process.ContainerID].ResourceUsage[metricName].AddDeltaStat(id, delta)
+							foundContainer[process.ContainerID] = true
+						}
 					}
-				}
 
-				// aggregate metrics per Virtual Machine
-				if config.IsExposeVMStatsEnabled() {
-					if process.VMID != "" {
-						if _, ok := c.VMStats[process.VMID]; !ok {
-							c.VMStats[process.VMID] = stats.NewVMStats(process.PID, process.VMID)
+					// aggregate metrics per Virtual Machine
+					if config.IsExposeVMStatsEnabled() {
+						if process.VMID != "" {
+							c.createVMStatsIfNotExist(process.VMID, process.PID)
+							c.VMStats[process.VMID].ResourceUsage[metricName].AddDeltaStat(id, delta)
+							foundVM[process.VMID] = true
 						}
-						c.VMStats[process.VMID].ResourceUsage[metricName].AddDeltaStat(id, delta)
-						foundVM[process.VMID] = true
 					}
-				}
 
-				// aggregate metrics from all process to represent the node resource utilization
-				c.NodeStats.ResourceUsage[metricName].AddDeltaStat(id, delta)
+					// aggregate metrics from all process to represent the node resource utilization
+					c.NodeStats.ResourceUsage[metricName].AddDeltaStat(id, delta)
+				}
 			}
 		}
 	}
@@ -214,14 +250,60 @@ func (c *Collector) AggregateProcessResourceUtilizationMetrics() {
 	}
 }
 
+// aggregateShardedProcessResourceUtilizationMetrics sums the processes per shard over the collector workers and merges
+// the shard sums
+func (c *Collector) aggregateShardedProcessResourceUtilizationMetrics(foundContainer, foundVM map[string]bool) {
+	keys, processes := c.processList()
+	shards := make([]*shardSums, utils.NumShards(len(processes), c.workers))
+	utils.ForEachShard(len(processes), c.workers, func(shard, start, end int) {
+		sums := newShardSums(true)
+		for i := start; i < end; i++ {
+			process := processes[i]
+			if process.IdleCounter > 0 && !processExists(process.PID) {
+				// if the process metrics were not updated for multiple iterations and the process does not exist anymore, delete it from the map
+				sums.deleted = append(sums.deleted, keys[i])
+			}
+			sums.add(process, process.ResourceUsage)
+		}
+		shards[shard] = sums
+	})
+
+	for _, sums := range shards {
+		for _, key := range sums.deleted {
+			delete(c.ProcessStats, key)
+		}
+		for containerID, container := range sums.containers {
+			c.createContainerStatsIfNotExist(containerID, container.cgroupID, container.pid, config.EnabledEBPFCgroupID())
+			container.sums.addTo(c.ContainerStats[containerID].ResourceUsage)
+			foundContainer[containerID] = true
+		}
+		for vmID, vm := range sums.vms {
+			c.createVMStatsIfNotExist(vmID, vm.pid)
+			vm.sums.addTo(c.VMStats[vmID].ResourceUsage)
+			foundVM[vmID] = true
+		}
+		// aggregate metrics from all process to represent the node resource utilization
+		sums.node.addTo(c.NodeStats.ResourceUsage)
+	}
+}
+
 // handleInactiveProcesses
-func (c *Collector) handleIdlingProcess(pStat *stats.ProcessStats) {
-	proc, _ := os.FindProcess(int(pStat.PID))
-	err := proc.Signal(syscall.Signal(0))
-	if err != nil {
+func (c *Collector) handleIdlingProcess(key uint64, pStat *stats.ProcessStats) {
+	if !processExists(pStat.PID) {
 		// delete if the process does not exist anymore
-		delete(c.ProcessStats, pStat.PID)
-		return
+		delete(c.ProcessStats, key)
+	}
+}
+
+// processExists returns false if the process does not exist anymore
+func processExists(pid uint64) bool {
+	proc, _ := os.FindProcess(int(pid))
+	return proc.Signal(syscall.Signal(0)) == nil
+}
+
+func (c *Collector) createVMStatsIfNotExist(vmID string, pid uint64) {
+	if _, ok := c.VMStats[vmID]; !ok {
+		c.VMStats[vmID] = stats.NewVMStats(pid, vmID)
 	}
 }
 
@@ -259,6 +341,10 @@ func (c *Collector) handleInactiveVM(foundVM map[string]bool) {
 
 // AggregateProcessEnergyUtilizationMetrics aggregates processes' utilization metrics to containers and virtual machines
 func (c *Collector) AggregateProcessEnergyUtilizationMetrics() {
+	if c.workers > 1 {
+		c.aggregateShardedProcessEnergyUtilizationMetrics()
+		return
+	}
 	for _, process := range c.ProcessStats {
 		for metricName, stat := range process.EnergyUsage {
 			for id := range stat {
@@ -275,9 +361,7 @@ func (c *Collector) AggregateProcessEnergyUtilizationMetrics() {
 				// aggregate metrics per Virtual Machine
 				if config.IsExposeVMStatsEnabled() {
 					if process.VMID != "" {
-						if _, ok := c.VMStats[process.VMID]; !ok {
-							c.VMStats[process.VMID] = stats.NewVMStats(process.PID, process.VMID)
-						}
+						c.createVMStatsIfNotExist(process.VMID, process.PID)
 						c.VMStats[process.VMID].EnergyUsage[metricName].AddDeltaStat(id, delta)
 					}
 				}
@@ -286,6 +370,42 @@ func (c *Collector) AggregateProcessEnergyUtilizationMetrics() {
 	}
 }
 
+// aggregateShardedProcessEnergyUtilizationMetrics sums the processes per shard over the collector workers and merges the
+// shard sums
+func (c *Collector) aggregateShardedProcessEnergyUtilizationMetrics() {
+	_, processes := c.processList()
+	shards := make([]*shardSums, utils.NumShards(len(processes), c.workers))
+	utils.ForEachShard(len(processes), c.workers, func(shard, start, end int) {
+		sums := newShardSums(false)
+		for _, process := range processes[start:end] {
+			sums.add(process, process.EnergyUsage)
+		}
+		shards[shard] = sums
+	})
+
+	for _, sums := range shards {
+		for containerID, container := range sums.containers {
+			c.createContainerStatsIfNotExist(containerID, container.cgroupID, container.pid, config.EnabledEBPFCgroupID())
+			container.sums.addTo(c.ContainerStats[containerID].EnergyUsage)
+		}
+		for vmID, vm := range sums.vms {
+			c.createVMStatsIfNotExist(vmID, vm.pid)
+			vm.sums.addTo(c.VMStats[vmID].EnergyUsage)
+		}
+	}
+}
+
+// processList returns the keys and stats of the processes, to shard them by index
+func (c *Collector) processList() ([]uint64, []*stats.ProcessStats) {
+	keys := make([]uint64, 0, len(c.ProcessStats))
+	processes := make([]*stats.ProcessStats, 0, len(c.ProcessStats))
+	for key, process := range c.ProcessStats {
+		keys = append(keys, key)
+		processes = append(processes, process)
+	}
+	return keys, processes
+}
+
 func (c *Collector) printDebugMetrics() {
 	// check the log verbosity level before iterating in all container
 	if klog.V(3).Enabled() {
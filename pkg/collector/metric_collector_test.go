@@ -1,12 +1,15 @@
 package collector
 
 import (
+	"strconv"
+
 	. "github.com/onsi/ginkgo/v2"
 	. "github.com/onsi/gomega"
 
 	"github.com/sustainable-computing-io/kepler/pkg/bpf"
 	"github.com/sustainable-computing-io/kepler/pkg/cgroup"
 	"github.com/sustainable-computing-io/kepler/pkg/collector/stats"
+	"github.com/sustainable-computing-io/kepler/pkg/collector/stats/types"
 	"github.com/sustainable-computing-io/kepler/pkg/config"
 	"github.com/sustainable-computing-io/kepler/pkg/model"
 
@@ -63,6 +66,59 @@ var _ = Describe("Test Collector Unit", func() {
 		Expect(dynEnergyInPkg).Should(Equal(uint64(17502)))
 	})
 
+	It("Aggregates the same metrics over several workers", func() {
+		bpfExporter := bpf.NewMockExporter(bpf.DefaultSupportedMetrics())
+		model.CreatePowerEstimatorModels(stats.GetProcessFeatureNames())
+		// several processes per container and per VM, so that the shard sums are merged
+		processes := map[uint64]*stats.ProcessStats{}
+		for pid := uint64(1); pid <= 13; pid++ {
+			process := stats.NewProcessStats(pid, pid, "container"+strconv.Itoa(int(pid%3)), "vm"+strconv.Itoa(int(pid%2)), "command")
+			for _, metric := range []string{config.CPUCycle, config.CPUInstruction, config.CacheMiss, config.CPUTime} {
+				process.ResourceUsage[metric].SetDeltaStat(stats.MockedSocketID, 1000*pid)
+			}
+			processes[pid] = process
+		}
+		aggregate := func(workers int) *Collector {
+			c := NewCollector(bpfExporter)
+			c.workers = workers
+			c.ProcessStats = processes
+			c.NodeStats = stats.CreateMockedNodeStats()
+			c.AggregateProcessResourceUtilizationMetrics()
+			return c
+		}
+		serial := aggregate(1)
+		// the process energy is estimated once, and both collectors aggregate it from the same ProcessStats
+		serial.UpdateProcessEnergyUtilizationMetrics()
+		serial.AggregateProcessEnergyUtilizationMetrics()
+		sharded := aggregate(4)
+		sharded.AggregateProcessEnergyUtilizationMetrics()
+
+		expectSameSums := func(got, want map[string]types.UInt64StatCollection) {
+			ExpectWithOffset(1, got).To(HaveLen(len(want)))
+			for metric, stat := range want {
+				ExpectWithOffset(1, got).To(HaveKey(metric))
+				ExpectWithOffset(1, got[metric].SumAllDeltaValues()).To(Equal(stat.SumAllDeltaValues()), metric)
+			}
+		}
+		Expect(serial.ContainerStats).To(HaveLen(3))
+		Expect(sharded.ContainerStats).To(HaveLen(len(serial.ContainerStats)))
+		for id, container := range serial.ContainerStats {
+			Expect(sharded.ContainerStats).To(HaveKey(id))
+			expectSameSums(sharded.ContainerStats[id].ResourceUsage, container.ResourceUsage)
+			expectSameSums(sharded.ContainerStats[id].EnergyUsage, container.EnergyUsage)
+		}
+		Expect(serial.VMStats).To(HaveLen(2))
+		Expect(sharded.VMStats).To(HaveLen(len(serial.VMStats)))
+		for id, vm := range serial.VMStats {
+			Expect(sharded.VMStats).To(HaveKey(id))
+			expectSameSums(sharded.VMStats[id].ResourceUsage, vm.ResourceUsage)
+			expectSameSums(sharded.VMStats[id].EnergyUsage, vm.EnergyUsage)
+		}
+		expectSameSums(sharded.NodeStats.ResourceUsage, serial.NodeStats.ResourceUsage)
+		Expect(serial.NodeStats.ResourceUsage[config.CPUInstruction].SumAllDeltaValues()).To(Equal(uint64(1000 * 13 * 14 / 2)))
+		Expect(serial.ContainerStats["container1"].EnergyUsage[config.DynEnergyInPkg].SumAllDeltaValues()).To(BeNumerically(">", 0))
+	})
+
 	It("HandleInactiveContainers without error", func() {
 		bpfExporter := bpf.NewMockExporter(bpf.DefaultSupportedMetrics())
 		metricCollector := newMockCollector(bpfExporter)
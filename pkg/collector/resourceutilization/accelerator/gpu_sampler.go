@@ -0,0 +1,215 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package accelerator
+
+import (
+	"fmt"
+	"sync"
+	"time"
+
+	"github.com/sustainable-computing-io/kepler/pkg/collector/stats"
+	dev "github.com/sustainable-computing-io/kepler/pkg/sensors/accelerator/devices"
+	"k8s.io/klog/v2"
+)
+
+// gpuSamplerRingSize is the number of batches kept by the sampler between two updates of the collector. The older
+// batches are overwritten when the collector is late.
+const gpuSamplerRingSize = 8
+
+var (
+	gpuSamplerOnce sync.Once
+	gpuSamplerInst *gpuSampler
+)
+
+// gpuUtilization is the utilization of the processes on a GPU, or on a MIG slice accounted to its parent GPU
+type gpuUtilization struct {
+	gpuID   int
+	samples map[uint32]dev.GPUProcessUtilizationSample
+}
+
+// gpuBatch is the utilization of the processes on all the GPUs in one pass of the sampler, with the commands of
+// those processes
+type gpuBatch struct {
+	devices  []gpuUtilization
+	commands map[uint32]string
+}
+
+// gpuSampler queries the per-process utilization of the GPUs from a goroutine at its own interval, so that the
+// collector only merges the batches sampled since its last update instead of waiting on the devices. A single
+// goroutine queries the devices, since their handles are not safe for concurrent use.
+type gpuSampler struct {
+	device   dev.Device
+	interval time.Duration
+	// the commands of the processes seen in the last pass, only used by the sampling goroutine
+	commands map[uint32]string
+	last     time.Time
+
+	mu   sync.Mutex
+	ring [gpuSamplerRingSize]gpuBatch
+	// the number of batches sampled and the number of batches sampled at the last take
+	sampled, taken uint64
+
+	stopOnce sync.Once
+	stop     chan struct{}
+	done     chan struct{}
+}
+
+// startGPUSampler starts the sampling of the GPU on the first call and returns the sampler. The sampling runs until
+// StopGPUSampler is called.
+func startGPUSampler(d dev.Device, interval time.Duration) *gpuSampler {
+	gpuSamplerOnce.Do(func() {
+		gpuSamplerInst = newGPUSampler(d, interval)
+		gpuSamplerInst.sample()
+		go gpuSamplerInst.run()
+		klog.V(3).Infof("Sampling the GPU process utilization every %v", interval)
+	})
+	return gpuSamplerInst
+}
+
+// StopGPUSampler stops the sampling of the GPU, which must happen before the accelerators are shut down. The sampler is
+// not started after it is stopped.
+func StopGPUSampler() {
+	gpuSamplerOnce.Do(func() {})
+	if gpuSamplerInst != nil {
+		gpuSamplerInst.stopSampling()
+	}
+}
+
+func newGPUSampler(d dev.Device, interval time.Duration) *gpuSampler {
+	return &gpuSampler{
+		device:   d,
+		interval: interval,
+		commands: map[uint32]string{},
+		last:     time.Now(),
+		stop:     make(chan struct{}),
+		done:     make(chan struct{}),
+	}
+}
+
+func (s *gpuSampler) run() {
+	defer close(s.done)
+	ticker := time.NewTicker(s.interval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-s.stop:
+			return
+		case <-ticker.C:
+			s.sample()
+		}
+	}
+}
+
+// stopSampling stops the sampling goroutine and waits for its last query of the devices. The batches that were not
+// taken yet are kept.
+func (s *gpuSampler) stopSampling() {
+	s.stopOnce.Do(func() {
+		close(s.stop)
+		<-s.done
+	})
+}
+
+// sample queries the utilization of all the GPUs and publishes it as a new batch. Only the sampling goroutine calls
+// it once started.
+func (s *gpuSampler) sample() {
+	now := time.Now()
+	since := now.Sub(s.last)
+	s.last = now
+
+	batch := gpuBatch{commands: make(map[uint32]string, len(s.commands))}
+	forEachGPUDevice(s.device, func(device dev.GPUDevice, gpuID int) {
+		processesUtilization, err := s.device.ProcessResourceUtilizationPerDevice(device, since)
+		if err != nil {
+			klog.Infoln(err)
+			return
+		}
+		samples := make(map[uint32]dev.GPUProcessUtilizationSample, len(processesUtilization))
+		for pid, processUtilization := range processesUtilization {
+			samples[pid] = processUtilization.(dev.GPUProcessUtilizationSample)
+			if _, found := batch.commands[pid]; found {
+				continue
+			}
+			command, found := s.commands[pid]
+			if !found {
+				command = getProcessCommand(uint64(pid))
+			}
+			batch.commands[pid] = command
+		}
+		batch.devices = append(batch.devices, gpuUtilization{gpuID: gpuID, samples: samples})
+	})
+	// the processes that left the GPUs are forgotten
+	s.commands = batch.commands
+	s.publish(batch)
+}
+
+func (s *gpuSampler) publish(batch gpuBatch) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	s.ring[s.sampled%gpuSamplerRingSize] = batch
+	s.sampled++
+}
+
+// take returns the batches sampled since the last take, oldest first
+func (s *gpuSampler) take() []gpuBatch {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	if s.sampled-s.taken > gpuSamplerRingSize {
+		klog.V(5).Infof("Dropped %d GPU utilization batches", s.sampled-s.taken-gpuSamplerRingSize)
+		s.taken = s.sampled - gpuSamplerRingSize
+	}
+	batches := make([]gpuBatch, 0, s.sampled-s.taken)
+	for ; s.taken < s.sampled; s.taken++ {
+		batches = append(batches, s.ring[s.taken%gpuSamplerRingSize])
+	}
+	return batches
+}
+
+// mergeGPUUtilization adds to the processes the average of their utilization on each GPU over the batches, as a single
+// query over the same period would have returned
+func mergeGPUUtilization(processStats map[uint64]*stats.ProcessStats, batches []gpuBatch) {
+	if len(batches) == 0 {
+		return
+	}
+	type processGPU struct {
+		pid   uint32
+		gpuID int
+	}
+	type utilization struct {
+		compute, mem uint64
+		command      string
+	}
+	sums := make(map[processGPU]*utilization)
+	for _, batch := range batches {
+		for _, d := range batch.devices {
+			for pid, sample := range d.samples {
+				key := processGPU{pid: pid, gpuID: d.gpuID}
+				u, found := sums[key]
+				if !found {
+					u = &utilization{command: batch.commands[pid]}
+					sums[key] = u
+				}
+				u.compute += uint64(sample.ComputeUtil)
+				u.mem += uint64(sample.MemUtil)
+			}
+		}
+	}
+	n := uint64(len(batches))
+	for key, u := range sums {
+		gpuName := fmt.Sprintf("%d", key.gpuID) // GPU ID or Parent GPU ID for MIG slices
+		addProcessGPUUtilization(processStats, uint64(key.pid), u.command, gpuName, u.compute/n, u.mem/n)
+	}
+}
@@ -0,0 +1,111 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package accelerator
+
+import (
+	"testing"
+	"time"
+
+	"github.com/sustainable-computing-io/kepler/pkg/collector/stats"
+	"github.com/sustainable-computing-io/kepler/pkg/collector/stats/types"
+	"github.com/sustainable-computing-io/kepler/pkg/config"
+	dev "github.com/sustainable-computing-io/kepler/pkg/sensors/accelerator/devices"
+)
+
+func utilizationBatch(gpuID int, pid, computeUtil, memUtil uint32) gpuBatch {
+	return gpuBatch{
+		devices: []gpuUtilization{{
+			gpuID:   gpuID,
+			samples: map[uint32]dev.GPUProcessUtilizationSample{pid: {Pid: pid, ComputeUtil: computeUtil, MemUtil: memUtil}},
+		}},
+		commands: map[uint32]string{pid: "cuda"},
+	}
+}
+
+func TestGPUSampler_TakesTheBatchesSinceTheLastTake(t *testing.T) {
+	s := newGPUSampler(nil, time.Hour)
+	if batches := s.take(); len(batches) != 0 {
+		t.Fatalf("expected no batch, got %d", len(batches))
+	}
+	s.publish(utilizationBatch(0, 1, 10, 1))
+	s.publish(utilizationBatch(0, 1, 20, 2))
+	if batches := s.take(); len(batches) != 2 || batches[1].devices[0].samples[1].ComputeUtil != 20 {
+		t.Fatalf("expected the 2 batches in order, got %v", batches)
+	}
+	if batches := s.take(); len(batches) != 0 {
+		t.Fatalf("expected no batch after a take, got %d", len(batches))
+	}
+
+	// the collector is late: only the last batches of the ring are kept
+	for i := 0; i < gpuSamplerRingSize+3; i++ {
+		s.publish(utilizationBatch(0, 1, uint32(i), 0))
+	}
+	batches := s.take()
+	if len(batches) != gpuSamplerRingSize || batches[0].devices[0].samples[1].ComputeUtil != 3 {
+		t.Fatalf("expected the last %d batches, got %v", gpuSamplerRingSize, batches)
+	}
+}
+
+func TestGPUSampler_StopsWithTheCollector(t *testing.T) {
+	s := newGPUSampler(nil, time.Hour)
+	go s.run()
+	gpuSamplerOnce.Do(func() { gpuSamplerInst = s })
+	s.publish(utilizationBatch(0, 1, 10, 1))
+
+	StopGPUSampler()
+	select {
+	case <-s.done:
+	case <-time.After(time.Second):
+		t.Fatal("expected the sampler to stop with the collector")
+	}
+	if batches := s.take(); len(batches) != 1 {
+		t.Fatalf("expected the batch sampled before the stop, got %d", len(batches))
+	}
+	// a second stop is a no-op, and the sampler is not started again
+	StopGPUSampler()
+	if started := startGPUSampler(nil, time.Hour); started != s {
+		t.Fatal("expected no new sampler after the stop")
+	}
+}
+
+func TestMergeGPUUtilization_AveragesTheBatches(t *testing.T) {
+	if _, err := config.Initialize("."); err != nil {
+		t.Fatal(err)
+	}
+	p := stats.NewProcessStats(1, 0, "", "", "bpf-comm")
+	p.ResourceUsage[config.GPUComputeUtilization] = types.NewUInt64StatCollection()
+	p.ResourceUsage[config.GPUMemUtilization] = types.NewUInt64StatCollection()
+	processStats := map[uint64]*stats.ProcessStats{1: p}
+
+	mergeGPUUtilization(processStats, []gpuBatch{
+		utilizationBatch(0, 1, 10, 4),
+		utilizationBatch(0, 1, 30, 8),
+		utilizationBatch(1, 1, 50, 0),
+	})
+	if p.Command != "bpf-comm" {
+		t.Errorf("expected the command of the bpf metrics to be kept, got %q", p.Command)
+	}
+	if u := p.ResourceUsage[config.GPUComputeUtilization]["0"].GetDelta(); u != 13 {
+		t.Errorf("expected the compute utilization of GPU 0 to be averaged to 13, got %d", u)
+	}
+	if u := p.ResourceUsage[config.GPUMemUtilization]["0"].GetDelta(); u != 4 {
+		t.Errorf("expected the memory utilization of GPU 0 to be averaged to 4, got %d", u)
+	}
+	if u := p.ResourceUsage[config.GPUComputeUtilization]["1"].GetDelta(); u != 16 {
+		t.Errorf("expected the compute utilization of GPU 1 to be averaged to 16, got %d", u)
+	}
+}
@@ -19,6 +19,7 @@ package accelerator
 import (
 	"fmt"
 	"os"
+	"strings"
 	"time"
 
 	"github.com/sustainable-computing-io/kepler/pkg/cgroup"
@@ -33,7 +34,7 @@ import (
 )
 
 const (
-	procPath string = "/proc/%d/cgroup"
+	procPath string = "/proc/%d/comm"
 )
 
 var (
@@ -41,28 +42,40 @@ var (
 	lastUtilizationTimestamp time.Time = time.Now()
 )
 
-// UpdateProcessGPUUtilizationMetrics reads the GPU metrics of each process using the GPU
+// UpdateProcessGPUUtilizationMetrics reads the GPU metrics of each process using the GPU. With a GPU sample interval,
+// it merges the utilization sampled in the background since the last update instead of querying the devices.
 func UpdateProcessGPUUtilizationMetrics(processStats map[uint64]*stats.ProcessStats) {
 	if gpu := acc.GetActiveAcceleratorByType(config.GPU); gpu != nil {
 		d := gpu.Device()
-		migDevices := d.DeviceInstances()
-		for _, _device := range d.DevicesByID() {
-			// we need to use MIG device handler if the GPU has MIG slices, otherwise, we use the GPU device handler
-			if _, hasMIG := migDevices[_device.(dev.GPUDevice).ID]; hasMIG {
-				// if the device has MIG slices, we should collect the process information directly from the MIG device handler
-				for _, migDevice := range migDevices[_device.(dev.GPUDevice).ID] {
-					// device.ID is equal to migDevice.ParentID
-					// we add the process metrics with the parent GPU ID, so that the Ratio power model will use this data to split the GPU power among the process
-					addGPUUtilizationToProcessStats(d, processStats, migDevice.(dev.GPUDevice), migDevice.(dev.GPUDevice).ParentID)
-				}
-			} else {
-				addGPUUtilizationToProcessStats(d, processStats, _device.(dev.GPUDevice), _device.(dev.GPUDevice).ID)
-			}
+		if interval := config.GetGPUSampleInterval(); interval > 0 {
+			mergeGPUUtilization(processStats, startGPUSampler(d, interval).take())
+			return
 		}
+		forEachGPUDevice(d, func(device dev.GPUDevice, gpuID int) {
+			addGPUUtilizationToProcessStats(d, processStats, device, gpuID)
+		})
 	}
 	lastUtilizationTimestamp = time.Now()
 }
 
+// forEachGPUDevice calls fn with each GPU, or with each MIG slice of the GPUs that have some
+func forEachGPUDevice(d dev.Device, fn func(device dev.GPUDevice, gpuID int)) {
+	migDevices := d.DeviceInstances()
+	for _, _device := range d.DevicesByID() {
+		// we need to use MIG device handler if the GPU has MIG slices, otherwise, we use the GPU device handler
+		if _, hasMIG := migDevices[_device.(dev.GPUDevice).ID]; hasMIG {
+			// if the device has MIG slices, we should collect the process information directly from the MIG device handler
+			for _, migDevice := range migDevices[_device.(dev.GPUDevice).ID] {
+				// device.ID is equal to migDevice.ParentID
+				// we add the process metrics with the parent GPU ID, so that the Ratio power model will use this data to split the GPU power among the process
+				fn(migDevice.(dev.GPUDevice), migDevice.(dev.GPUDevice).ParentID)
+			}
+		} else {
+			fn(_device.(dev.GPUDevice), _device.(dev.GPUDevice).ID)
+		}
+	}
+}
+
 func addGPUUtilizationToProcessStats(ai dev.Device, processStats map[uint64]*stats.ProcessStats, d dev.GPUDevice, gpuID int) {
 	var err error
 	var processesUtilization map[uint32]any
@@ -72,36 +85,42 @@ func addGPUUtilizationToProcessStats(ai dev.Device, processStats map[uint64]*sta
 		return
 	}
 
+	gpuName := fmt.Sprintf("%d", gpuID) // GPU ID or Parent GPU ID for MIG slices
 	for pid, processUtilization := range processesUtilization {
-		uintPid := uint64(pid)
-		// if the process was not identified by the bpf metrics, create a new metric object
-		if _, exist := processStats[uintPid]; !exist {
-			command := getProcessCommand(uintPid)
-			containerID := utils.SystemProcessName
-
-			// if the pid is within a container, it will have an container ID
-			if config.IsExposeContainerStatsEnabled() {
-				if containerID, err = cgroup.GetContainerIDFromPID(uintPid); err != nil {
-					klog.V(6).Infof("failed to resolve container for Pid %v (command=%s): %v, set containerID=%s", pid, command, err, containerID)
-				}
+		sample := processUtilization.(dev.GPUProcessUtilizationSample)
+		addProcessGPUUtilization(processStats, uint64(pid), "", gpuName, uint64(sample.ComputeUtil), uint64(sample.MemUtil))
+	}
+}
+
+// addProcessGPUUtilization adds the GPU utilization of a process, creating its stats if the process was not
+// identified by the bpf metrics. The command is read from /proc when not given.
+func addProcessGPUUtilization(processStats map[uint64]*stats.ProcessStats, pid uint64, command, gpuName string, computeUtil, memUtil uint64) {
+	if _, exist := processStats[pid]; !exist {
+		var err error
+		if command == "" {
+			command = getProcessCommand(pid)
+		}
+		containerID := utils.SystemProcessName
+
+		// if the pid is within a container, it will have an container ID
+		if config.IsExposeContainerStatsEnabled() {
+			if containerID, err = cgroup.GetContainerIDFromPID(pid); err != nil {
+				klog.V(6).Infof("failed to resolve container for Pid %v (command=%s): %v, set containerID=%s", pid, command, err, containerID)
 			}
+		}
 
-			// if the pid is within a VM, it will have an VM ID
-			vmID := utils.EmptyString
-			if config.IsExposeVMStatsEnabled() {
-				if config.IsExposeVMStatsEnabled() {
-					vmID, err = libvirt.GetVMID(uintPid)
-					if err != nil {
-						klog.V(6).Infof("failed to resolve VM ID for PID %v (command=%s): %v", pid, command, err)
-					}
-				}
+		// if the pid is within a VM, it will have an VM ID
+		vmID := utils.EmptyString
+		if config.IsExposeVMStatsEnabled() {
+			vmID, err = libvirt.GetVMID(pid)
+			if err != nil {
+				klog.V(6).Infof("failed to resolve VM ID for PID %v (command=%s): %v", pid, command, err)
 			}
-			processStats[uintPid] = stats.NewProcessStats(uintPid, uint64(0), containerID, vmID, command)
 		}
-		gpuName := fmt.Sprintf("%d", gpuID) // GPU ID or Parent GPU ID for MIG slices
-		processStats[uintPid].ResourceUsage[config.GPUComputeUtilization].AddDeltaStat(gpuName, uint64(processUtilization.(dev.GPUProcessUtilizationSample).ComputeUtil))
-		processStats[uintPid].ResourceUsage[config.GPUMemUtilization].AddDeltaStat(gpuName, uint64(processUtilization.(dev.GPUProcessUtilizationSample).MemUtil))
+		processStats[pid] = stats.NewProcessStats(pid, uint64(0), containerID, vmID, command)
 	}
+	processStats[pid].ResourceUsage[config.GPUComputeUtilization].AddDeltaStat(gpuName, computeUtil)
+	processStats[pid].ResourceUsage[config.GPUMemUtilization].AddDeltaStat(gpuName, memUtil)
 }
 
 func getProcessCommand(pid uint64) string {
@@ -111,5 +130,5 @@ func getProcessCommand(pid uint64) string {
 	if err != nil {
 		return ""
 	}
-	return string(comm)
+	return strings.TrimSpace(string(comm))
 }
@@ -8,6 +8,16 @@ import (
 	"github.com/sustainable-computing-io/kepler/pkg/collector/stats"
 )
 
-func UpdateProcessBPFMetrics(bpfExporter bpf.Exporter, processStats map[uint64]*stats.ProcessStats) {
+type ProcessRecords struct{}
+
+func CollectProcessRecords(bpfExporter bpf.Exporter, processStats map[uint64]*stats.ProcessStats, workers int) *ProcessRecords {
+	return &ProcessRecords{}
+}
+
+func UpdateProcessBPFMetrics(records *ProcessRecords, counters *ProcessCounters, processStats map[uint64]*stats.ProcessStats) {
+
+}
+
+func UpdateNodeCPUPowerStateMetrics(bpfExporter bpf.Exporter, nodeStats *stats.NodeStats) {
 
 }
@@ -0,0 +1,62 @@
+//go:build !darwin
+// +build !darwin
+
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package bpf
+
+import (
+	"strconv"
+
+	"github.com/sustainable-computing-io/kepler/pkg/bpf"
+	"github.com/sustainable-computing-io/kepler/pkg/collector/stats"
+	"github.com/sustainable-computing-io/kepler/pkg/config"
+
+	"k8s.io/klog/v2"
+)
+
+// UpdateNodeCPUPowerStateMetrics sets the node features of the CPU power states tracked by the eBPF programs. The
+// residencies are cumulative, so they are set as the aggregated values of each CPU and the deltas are the residencies
+// of the last interval.
+func UpdateNodeCPUPowerStateMetrics(bpfExporter bpf.Exporter, nodeStats *stats.NodeStats) {
+	if !config.IsBPFCPUPowerStateEnabled() {
+		return
+	}
+	states, err := bpfExporter.CollectCPUPowerStates()
+	if err != nil {
+		klog.V(1).Infof("failed to collect the CPU power states: %v", err)
+		return
+	}
+	// created with the node stats when the CPU power states are enabled
+	busyTime, found := nodeStats.ResourceUsage[config.CPUBusyTimeLabel]
+	if !found {
+		return
+	}
+	busyCycles := nodeStats.ResourceUsage[config.CPUBusyCyclesLabel]
+	idleTime := nodeStats.ResourceUsage[config.CPUIdleTimeLabel]
+	for i := range states {
+		s := &states[i]
+		cpu := strconv.Itoa(i)
+		var idleTimeNs uint64
+		for _, t := range s.IdleTimeNs {
+			idleTimeNs += t
+		}
+		busyTime.SetAggrStat(cpu, s.BusyTimeNs/1e6)
+		busyCycles.SetAggrStat(cpu, s.BusyCycles)
+		idleTime.SetAggrStat(cpu, idleTimeNs/1e6)
+	}
+}
@@ -0,0 +1,61 @@
+//go:build !darwin
+// +build !darwin
+
+package bpf
+
+import (
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+
+	"github.com/sustainable-computing-io/kepler/pkg/bpf"
+	"github.com/sustainable-computing-io/kepler/pkg/collector/stats"
+	"github.com/sustainable-computing-io/kepler/pkg/config"
+)
+
+// powerStatesExporter returns the given residencies from CollectCPUPowerStates
+type powerStatesExporter struct {
+	bpf.Exporter
+	states []bpf.CPUPowerState
+}
+
+func (e *powerStatesExporter) CollectCPUPowerStates() ([]bpf.CPUPowerState, error) {
+	return e.states, nil
+}
+
+var _ = Describe("Test node collector", func() {
+	BeforeEach(func() {
+		_, err := config.Initialize(".")
+		Expect(err).NotTo(HaveOccurred())
+		config.SetEnabledBPFCPUPowerState(true)
+		DeferCleanup(config.SetEnabledBPFCPUPowerState, false)
+	})
+
+	It("should set the CPU power state deltas of the node", func() {
+		exporter := &powerStatesExporter{
+			Exporter: bpf.NewMockExporter(bpf.DefaultSupportedMetrics()),
+			states:   make([]bpf.CPUPowerState, 2),
+		}
+		for i := range exporter.states {
+			exporter.states[i] = bpf.CPUPowerState{BusyTimeNs: 1e6, BusyCycles: 1000}
+			exporter.states[i].IdleTimeNs[0] = 1e6
+		}
+		nodeStats := stats.NewNodeStats()
+		// the first residencies are the baseline of the deltas
+		UpdateNodeCPUPowerStateMetrics(exporter, nodeStats)
+
+		exporter.states[0].BusyTimeNs += 3e6
+		exporter.states[0].BusyCycles += 6000
+		exporter.states[0].IdleTimeNs[1] = 2e6
+		exporter.states[1].BusyTimeNs += 1e6
+		exporter.states[1].BusyCycles += 1000
+		exporter.states[1].IdleTimeNs[2] = 4e6
+		nodeStats.ResetDeltaValues()
+		UpdateNodeCPUPowerStateMetrics(exporter, nodeStats)
+
+		usage := nodeStats.ResourceUsage
+		Expect(usage[config.CPUBusyTimeLabel].SumAllDeltaValues()).To(Equal(uint64(4)))
+		Expect(usage[config.CPUBusyCyclesLabel].SumAllDeltaValues()).To(Equal(uint64(7000)))
+		Expect(usage[config.CPUIdleTimeLabel].SumAllDeltaValues()).To(Equal(uint64(6)))
+		Expect(nodeStats.ToEstimatorValues(stats.AvailableCPUPowerStateMetrics(), false)).To(Equal([]float64{4, 7000, 6}))
+	})
+})
@@ -19,10 +19,7 @@ limitations under the License.
 
 package bpf
 
-import "C"
 import (
-	"unsafe"
-
 	"github.com/sustainable-computing-io/kepler/pkg/bpf"
 	"github.com/sustainable-computing-io/kepler/pkg/cgroup"
 	"github.com/sustainable-computing-io/kepler/pkg/collector/stats"
@@ -35,110 +32,145 @@ import (
 
 type ProcessBPFMetrics = bpf.ProcessMetrics
 
-// update software counter metrics
-func updateSWCounters(key uint64, ct *ProcessBPFMetrics, processStats map[uint64]*stats.ProcessStats, bpfSupportedMetrics bpf.SupportedMetrics) {
-	// update ebpf metrics
-	// first update CPU time and Page Cache Hit
-	for counterKey := range bpfSupportedMetrics.SoftwareCounters {
-		switch counterKey {
-		case config.CPUTime:
-			processStats[key].ResourceUsage[config.CPUTime].AddDeltaStat(utils.GenericSocketID, ct.ProcessRunTime/1000 /* convert microseconds to milliseconds */)
-		case config.PageCacheHit:
-			processStats[key].ResourceUsage[config.PageCacheHit].AddDeltaStat(utils.GenericSocketID, ct.PageCacheHit/(1000*1000))
-		case config.IRQNetTXLabel:
-			processStats[key].ResourceUsage[config.IRQNetTXLabel].AddDeltaStat(utils.GenericSocketID, uint64(ct.VecNr[bpf.IRQNetTX]))
-		case config.IRQNetRXLabel:
-			processStats[key].ResourceUsage[config.IRQNetRXLabel].AddDeltaStat(utils.GenericSocketID, uint64(ct.VecNr[bpf.IRQNetRX]))
-		case config.IRQBlockLabel:
-			processStats[key].ResourceUsage[config.IRQBlockLabel].AddDeltaStat(utils.GenericSocketID, uint64(ct.VecNr[bpf.IRQBlock]))
-		default:
-			klog.Errorf("counter %s is not supported\n", counterKey)
+// updateCounters adds the counters of a BPF record to the stats of its process
+func updateCounters(ct *ProcessBPFMetrics, pStat *stats.ProcessStats, counters *ProcessCounters) {
+	stats := pStat.Counters(counters.Names)
+	for i, value := range counters.values {
+		if err := stats[i].AddNewDelta(value(ct)); err != nil {
+			klog.V(3).Infoln(err)
 		}
 	}
 }
 
-// update hardware counter metrics
-func updateHWCounters(key uint64, ct *ProcessBPFMetrics, processStats map[uint64]*stats.ProcessStats, bpfSupportedMetrics bpf.SupportedMetrics) {
-	for counterKey := range bpfSupportedMetrics.HardwareCounters {
-		var val uint64
-		var event string
-		switch counterKey {
-		case config.CPUCycle:
-			val = ct.CpuCycles
-			event = config.CPUCycle
-		case config.CPURefCycle:
-			val = ct.CpuCycles
-			event = config.CPURefCycle
-		case config.CPUInstruction:
-			val = ct.CpuInstr
-			event = config.CPUInstruction
-		case config.CacheMiss:
-			val = ct.CacheMiss
-			event = config.CacheMiss
-		default:
-			klog.Errorf("counter %s is not supported\n", counterKey)
+// getContainerID resolves the container of a process record. When the eBPF programs record the
+// pod cgroup as the ancestor, processes without one are not in a pod and their cgroup path
+// is not looked up. The cgroups of the pods are resolved by pod cgroup ID, so that a new container
+// only walks the cgroup directory of its pod.
+func getContainerID(ct *ProcessBPFMetrics) (string, error) {
+	if config.IsBPFPodCgroupAncestorEnabled() && ct.CgroupId != 1 {
+		if ct.AncestorCgroupId == 0 {
+			return utils.SystemProcessName, nil
+		}
+		if config.EnabledEBPFCgroupID() {
+			return cgroup.GetContainerIDInPod(ct.CgroupId, ct.AncestorCgroupId)
 		}
-		processStats[key].ResourceUsage[event].AddDeltaStat(utils.GenericSocketID, val)
 	}
+	return cgroup.GetContainerID(ct.CgroupId, ct.Pid, config.EnabledEBPFCgroupID())
+}
+
+// ProcessRecords are the BPF records of an update, with the identity of their processes
+type ProcessRecords struct {
+	metrics    []ProcessBPFMetrics
+	identities []recordIdentity
 }
 
-// UpdateProcessBPFMetrics reads the BPF tables with process/pid/cgroupid metrics (CPU time, available HW counters)
-func UpdateProcessBPFMetrics(bpfExporter bpf.Exporter, processStats map[uint64]*stats.ProcessStats) {
+// recordIdentity is the process stats key of a BPF record and, for the processes that are not in the stats yet, their
+// container, VM and command
+type recordIdentity struct {
+	excluded    bool
+	resolved    bool
+	mapKey      uint64
+	pid         uint64
+	command     string
+	containerID string
+	vmID        string
+}
+
+// CollectProcessRecords reads the BPF tables with process/pid/cgroupid metrics (CPU time, available HW counters) and
+// resolves the container and VM of the new processes, sharding the records across workers goroutines.
+// It only reads processStats, so it can run concurrently with the exporters that read the stats.
+// With the per-cgroup metrics enabled each record holds the metrics of a cgroup and is keyed by its cgroup ID
+func CollectProcessRecords(bpfExporter bpf.Exporter, processStats map[uint64]*stats.ProcessStats, workers int) *ProcessRecords {
 	processesData, err := bpfExporter.CollectProcesses()
 	if err != nil {
 		klog.Errorln("could not collect ebpf metrics")
-		return
+		return &ProcessRecords{}
+	}
+	records := &ProcessRecords{
+		metrics:    processesData,
+		identities: make([]recordIdentity, len(processesData)),
 	}
-	for _, ct := range processesData {
-		comm := C.GoString((*C.char)(unsafe.Pointer(&ct.Comm)))
+	utils.ForEachShard(len(processesData), workers, func(_, start, end int) {
+		for i := start; i < end; i++ {
+			ct, id := &records.metrics[i], &records.identities[i]
+			if ct.Pid == 0 && config.ExcludeSwapperProcess() {
+				// exclude swapper process
+				id.excluded = true
+				continue
+			}
 
-		if ct.Pid == 0 && config.ExcludeSwapperProcess() {
-			// exclude swapper process
-			continue
-		}
+			if ct.Pid != 0 && klog.V(6).Enabled() {
+				klog.V(6).Infof("process %s (pid=%d, cgroup=%d) has %d process run time, %d CPU cycles, %d instructions, %d cache misses, %d page cache hits",
+					ct.Comm, ct.Pid, ct.CgroupId, ct.ProcessRunTime, ct.CpuCycles, ct.CpuInstr, ct.CacheMiss, ct.PageCacheHit)
+			}
 
-		if ct.Pid != 0 {
-			klog.V(6).Infof("process %s (pid=%d, cgroup=%d) has %d process run time, %d CPU cycles, %d instructions, %d cache misses, %d page cache hits",
-				comm, ct.Pid, ct.CgroupId, ct.ProcessRunTime, ct.CpuCycles, ct.CpuInstr, ct.CacheMiss, ct.PageCacheHit)
-		}
+			id.mapKey = ct.Pid
+			id.command = ct.Comm
+			if ct.CgroupId == 1 && config.EnabledEBPFCgroupID() {
+				// we aggregate all kernel process to minimize overhead
+				// all kernel process has cgroup id as 1 and pid 1 is also a kernel process
+				id.mapKey = 1
+				id.command = "kernel_processes"
+			}
+			id.pid = id.mapKey
+			if config.IsBPFCgroupMetricsEnabled() {
+				// the record holds the metrics of the whole cgroup of the process
+				id.mapKey = ct.CgroupId
+			}
 
-		// if the pid is within a container, it will have a container ID
-		containerID, err := cgroup.GetContainerID(ct.CgroupId, ct.Pid, config.EnabledEBPFCgroupID())
-		if err != nil {
-			klog.V(6).Infof("failed to resolve container for PID %v (command=%s): %v, set containerID=%s", ct.Pid, comm, err, utils.SystemProcessName)
+			// the container and VM of a process are only used to create its stats
+			if _, found := processStats[id.mapKey]; !found {
+				resolveIdentity(ct, id)
+			}
 		}
+	})
+	return records
+}
 
-		// if the pid is within a VM, it will have an VM ID
-		vmID := utils.EmptyString
-		if config.IsExposeVMStatsEnabled() {
-			vmID, err = libvirt.GetVMID(ct.Pid)
-			if err != nil {
-				klog.V(6).Infof("failed to resolve VM ID for PID %v (command=%s): %v", ct.Pid, comm, err)
-			}
+// resolveIdentity resolves the container and VM of the process of a record
+func resolveIdentity(ct *ProcessBPFMetrics, id *recordIdentity) {
+	var err error
+	// if the pid is within a container, it will have a container ID
+	id.containerID, err = getContainerID(ct)
+	if err != nil {
+		klog.V(6).Infof("failed to resolve container for PID %v (command=%s): %v, set containerID=%s", ct.Pid, ct.Comm, err, utils.SystemProcessName)
+	}
+
+	// if the pid is within a VM, it will have an VM ID
+	id.vmID = utils.EmptyString
+	if config.IsExposeVMStatsEnabled() {
+		id.vmID, err = libvirt.GetVMID(ct.Pid)
+		if err != nil {
+			klog.V(6).Infof("failed to resolve VM ID for PID %v (command=%s): %v", ct.Pid, ct.Comm, err)
 		}
+	}
+	id.resolved = true
+}
 
-		mapKey := ct.Pid
-		process := comm
-		if ct.CgroupId == 1 && config.EnabledEBPFCgroupID() {
-			// we aggregate all kernel process to minimize overhead
-			// all kernel process has cgroup id as 1 and pid 1 is also a kernel process
-			mapKey = 1
-			process = "kernel_processes"
+// UpdateProcessBPFMetrics adds the BPF records collected by CollectProcessRecords to the process stats, creating the
+// stats of the new processes. The counters are resolved once by the caller with NewProcessCounters
+func UpdateProcessBPFMetrics(records *ProcessRecords, counters *ProcessCounters, processStats map[uint64]*stats.ProcessStats) {
+	for i := range records.metrics {
+		ct, id := &records.metrics[i], &records.identities[i]
+		if id.excluded {
+			continue
 		}
 
-		bpfSupportedMetrics := bpfExporter.SupportedMetrics()
 		var ok bool
 		var pStat *stats.ProcessStats
-		if pStat, ok = processStats[mapKey]; !ok {
-			pStat = stats.NewProcessStats(mapKey, ct.CgroupId, containerID, vmID, process)
-			processStats[mapKey] = pStat
+		if pStat, ok = processStats[id.mapKey]; !ok {
+			if !id.resolved {
+				// the process stats were removed after the records were collected
+				resolveIdentity(ct, id)
+			}
+			pStat = stats.NewProcessStats(id.pid, ct.CgroupId, id.containerID, id.vmID, id.command)
+			processStats[id.mapKey] = pStat
 		} else if pStat.Command == "" {
-			pStat.Command = comm
+			pStat.Command = ct.Comm
 		}
 		// when the process metrics are updated, reset the idle counter
 		pStat.IdleCounter = 0
 
-		updateSWCounters(mapKey, &ct, processStats, bpfSupportedMetrics)
-		updateHWCounters(mapKey, &ct, processStats, bpfSupportedMetrics)
+		updateCounters(ct, pStat, counters)
 	}
 }
@@ -4,8 +4,107 @@
 package bpf
 
 import (
+	"testing"
+
 	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+	"k8s.io/apimachinery/pkg/util/sets"
+
+	"github.com/sustainable-computing-io/kepler/pkg/bpf"
+	"github.com/sustainable-computing-io/kepler/pkg/collector/stats"
+	"github.com/sustainable-computing-io/kepler/pkg/config"
+	"github.com/sustainable-computing-io/kepler/pkg/utils"
 )
 
+// recordsExporter returns the given records from CollectProcesses
+type recordsExporter struct {
+	bpf.Exporter
+	records []bpf.ProcessMetrics
+}
+
+func (e *recordsExporter) CollectProcesses() ([]bpf.ProcessMetrics, error) {
+	return e.records, nil
+}
+
+func newRecordsExporter(records []bpf.ProcessMetrics) *recordsExporter {
+	return &recordsExporter{
+		Exporter: bpf.NewMockExporter(bpf.DefaultSupportedMetrics()),
+		records:  records,
+	}
+}
+
 var _ = Describe("Test hc collector", func() {
+	BeforeEach(func() {
+		_, err := config.Initialize(".")
+		Expect(err).NotTo(HaveOccurred())
+	})
+
+	It("should resolve the supported counters once", func() {
+		counters := NewProcessCounters(bpf.SupportedMetrics{
+			SoftwareCounters: sets.New(config.CPUTime, "unknown"),
+			HardwareCounters: sets.New(config.CPUInstruction),
+		})
+		Expect(counters.Names).To(ConsistOf(config.CPUTime, config.CPUInstruction))
+		Expect(counters.values).To(HaveLen(2))
+	})
+
+	It("should add the counters of the records to the process stats", func() {
+		counters := NewProcessCounters(bpf.SupportedMetrics{
+			SoftwareCounters: sets.New(config.CPUTime, config.IRQNetTXLabel),
+			HardwareCounters: sets.New(config.CPUInstruction),
+		})
+		record := bpf.ProcessMetrics{Pid: 10, CgroupId: 10, ProcessRunTime: 2000, CpuInstr: 5}
+		record.VecNr[bpf.IRQNetTX] = 3
+		exporter := newRecordsExporter([]bpf.ProcessMetrics{record})
+		processStats := map[uint64]*stats.ProcessStats{}
+
+		for n := 0; n < 2; n++ {
+			records := CollectProcessRecords(exporter, processStats, 1)
+			UpdateProcessBPFMetrics(records, counters, processStats)
+		}
+
+		Expect(processStats).To(HaveKey(uint64(10)))
+		usage := processStats[10].ResourceUsage
+		Expect(usage[config.CPUTime][utils.GenericSocketID].GetDelta()).To(Equal(uint64(4)))
+		Expect(usage[config.IRQNetTXLabel][utils.GenericSocketID].GetAggr()).To(Equal(uint64(6)))
+		Expect(usage[config.CPUInstruction][utils.GenericSocketID].GetAggr()).To(Equal(uint64(10)))
+	})
+
+	It("should resolve the records across workers", func() {
+		counters := NewProcessCounters(bpf.SupportedMetrics{SoftwareCounters: sets.New(config.CPUTime)})
+		records := make([]bpf.ProcessMetrics, 100)
+		for i := range records {
+			records[i] = bpf.ProcessMetrics{Pid: uint64(i + 2), CgroupId: uint64(i + 2), ProcessRunTime: 1000, Comm: "comm"}
+		}
+		exporter := newRecordsExporter(records)
+		processStats := map[uint64]*stats.ProcessStats{}
+
+		UpdateProcessBPFMetrics(CollectProcessRecords(exporter, processStats, 8), counters, processStats)
+
+		Expect(processStats).To(HaveLen(len(records)))
+		for _, record := range records {
+			Expect(processStats).To(HaveKey(record.Pid))
+			process := processStats[record.Pid]
+			Expect(process.Command).To(Equal("comm"))
+			Expect(process.ResourceUsage[config.CPUTime].SumAllDeltaValues()).To(Equal(uint64(1)))
+		}
+	})
 })
+
+func BenchmarkUpdateProcessBPFMetrics(b *testing.B) {
+	_, _ = config.Initialize(".")
+	records := make([]bpf.ProcessMetrics, 30000)
+	for i := range records {
+		records[i] = bpf.ProcessMetrics{Pid: uint64(i + 2), CgroupId: 2, ProcessRunTime: 1000, CpuInstr: 1000}
+	}
+	exporter := newRecordsExporter(records)
+	counters := NewProcessCounters(bpf.DefaultSupportedMetrics())
+	processStats := map[uint64]*stats.ProcessStats{}
+	UpdateProcessBPFMetrics(CollectProcessRecords(exporter, processStats, 1), counters, processStats)
+
+	b.ReportAllocs()
+	b.ResetTimer()
+	for n := 0; n < b.N; n++ {
+		UpdateProcessBPFMetrics(CollectProcessRecords(exporter, processStats, 1), counters, processStats)
+	}
+}
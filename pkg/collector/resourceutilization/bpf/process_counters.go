@@ -0,0 +1,70 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package bpf
+
+import (
+	"github.com/sustainable-computing-io/kepler/pkg/bpf"
+	"github.com/sustainable-computing-io/kepler/pkg/config"
+	"k8s.io/apimachinery/pkg/util/sets"
+	"k8s.io/klog/v2"
+)
+
+// counterValues returns the value of each counter in a BPF record, converted to the unit of its metric: the on-CPU
+// time from microseconds and the softirq time from nanoseconds to milliseconds
+var counterValues = map[string]func(ct *bpf.ProcessMetrics) uint64{
+	// software counters
+	config.CPUTime:           func(ct *bpf.ProcessMetrics) uint64 { return ct.ProcessRunTime / 1000 },
+	config.PageCacheHit:      func(ct *bpf.ProcessMetrics) uint64 { return ct.PageCacheHit / (1000 * 1000) },
+	config.IRQNetTXLabel:     func(ct *bpf.ProcessMetrics) uint64 { return uint64(ct.VecNr[bpf.IRQNetTX]) },
+	config.IRQNetRXLabel:     func(ct *bpf.ProcessMetrics) uint64 { return uint64(ct.VecNr[bpf.IRQNetRX]) },
+	config.IRQBlockLabel:     func(ct *bpf.ProcessMetrics) uint64 { return uint64(ct.VecNr[bpf.IRQBlock]) },
+	config.IRQNetTXTimeLabel: func(ct *bpf.ProcessMetrics) uint64 { return ct.SoftirqTimeNs[bpf.IRQNetTX] / (1000 * 1000) },
+	config.IRQNetRXTimeLabel: func(ct *bpf.ProcessMetrics) uint64 { return ct.SoftirqTimeNs[bpf.IRQNetRX] / (1000 * 1000) },
+	config.IRQBlockTimeLabel: func(ct *bpf.ProcessMetrics) uint64 { return ct.SoftirqTimeNs[bpf.IRQBlock] / (1000 * 1000) },
+	config.BlockIOBytesLabel: func(ct *bpf.ProcessMetrics) uint64 { return ct.BlockIoBytes },
+	config.NetTXBytesLabel:   func(ct *bpf.ProcessMetrics) uint64 { return ct.NetTxBytes },
+	config.NetRXBytesLabel:   func(ct *bpf.ProcessMetrics) uint64 { return ct.NetRxBytes },
+	// hardware counters
+	config.CPUCycle:       func(ct *bpf.ProcessMetrics) uint64 { return ct.CpuCycles },
+	config.CPURefCycle:    func(ct *bpf.ProcessMetrics) uint64 { return ct.CpuCycles },
+	config.CPUInstruction: func(ct *bpf.ProcessMetrics) uint64 { return ct.CpuInstr },
+	config.CacheMiss:      func(ct *bpf.ProcessMetrics) uint64 { return ct.CacheMiss },
+}
+
+// ProcessCounters are the counters of the BPF records that a collector updates, resolved once from the metrics
+// supported by the exporter. The value of the i-th counter is added to the i-th stat of ProcessStats.Counters(Names).
+type ProcessCounters struct {
+	Names  []string
+	values []func(ct *bpf.ProcessMetrics) uint64
+}
+
+// NewProcessCounters resolves the software and hardware counters supported by the exporter
+func NewProcessCounters(bpfSupportedMetrics bpf.SupportedMetrics) *ProcessCounters {
+	c := &ProcessCounters{}
+	for _, counters := range []sets.Set[string]{bpfSupportedMetrics.SoftwareCounters, bpfSupportedMetrics.HardwareCounters} {
+		for name := range counters {
+			value, found := counterValues[name]
+			if !found {
+				klog.Errorf("counter %s is not supported\n", name)
+				continue
+			}
+			c.Names = append(c.Names, name)
+			c.values = append(c.values, value)
+		}
+	}
+	return c
+}
@@ -0,0 +1,106 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package collector
+
+import (
+	"github.com/sustainable-computing-io/kepler/pkg/collector/stats"
+	"github.com/sustainable-computing-io/kepler/pkg/collector/stats/types"
+	"github.com/sustainable-computing-io/kepler/pkg/config"
+)
+
+// deltaSums are delta values summed per metric and stat ID
+type deltaSums map[string]map[string]uint64
+
+func (s deltaSums) add(metricName, id string, delta uint64) {
+	ids, found := s[metricName]
+	if !found {
+		ids = make(map[string]uint64)
+		s[metricName] = ids
+	}
+	ids[id] += delta
+}
+
+// addTo adds the sums to the delta values of the usage stats
+func (s deltaSums) addTo(usage map[string]types.UInt64StatCollection) {
+	for metricName, ids := range s {
+		for id, delta := range ids {
+			usage[metricName].AddDeltaStat(id, delta)
+		}
+	}
+}
+
+// ownerSums are the sums of the processes of a container or VM, with the first of its processes to create its stats
+type ownerSums struct {
+	cgroupID uint64
+	pid      uint64
+	sums     deltaSums
+}
+
+// shardSums are the delta values of a shard of the processes summed per container, per VM and optionally for the node,
+// when the processes are aggregated over more than one collector worker
+type shardSums struct {
+	containers map[string]*ownerSums
+	vms        map[string]*ownerSums
+	node       deltaSums
+	// deleted are the keys of the processes to delete from the process stats
+	deleted []uint64
+}
+
+func newShardSums(withNode bool) *shardSums {
+	s := &shardSums{
+		containers: map[string]*ownerSums{},
+		vms:        map[string]*ownerSums{},
+	}
+	if withNode {
+		s.node = deltaSums{}
+	}
+	return s
+}
+
+func (s *shardSums) owner(owners map[string]*ownerSums, id string, process *stats.ProcessStats) *ownerSums {
+	o, found := owners[id]
+	if !found {
+		o = &ownerSums{cgroupID: process.CGroupID, pid: process.PID, sums: deltaSums{}}
+		owners[id] = o
+	}
+	return o
+}
+
+// add sums the delta values of the usage stats of a process with the ones of its container and VM, and of the node
+func (s *shardSums) add(process *stats.ProcessStats, usage map[string]types.UInt64StatCollection) {
+	var container, vm *ownerSums
+	if config.IsExposeContainerStatsEnabled() && process.ContainerID != "" {
+		container = s.owner(s.containers, process.ContainerID, process)
+	}
+	if config.IsExposeVMStatsEnabled() && process.VMID != "" {
+		vm = s.owner(s.vms, process.VMID, process)
+	}
+	for metricName, stat := range usage {
+		for id := range stat {
+			delta := stat[id].GetDelta() // currently the process metrics are single socket
+			if container != nil {
+				container.sums.add(metricName, id, delta)
+			}
+			if vm != nil {
+				vm.sums.add(metricName, id, delta)
+			}
+			if s.node != nil {
+				s.node.add(metricName, id, delta)
+			}
+		}
+	}
+}
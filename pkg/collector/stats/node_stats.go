@@ -19,6 +19,7 @@ package stats
 import (
 	"fmt"
 
+	"github.com/sustainable-computing-io/kepler/pkg/collector/stats/types"
 	"github.com/sustainable-computing-io/kepler/pkg/config"
 	"github.com/sustainable-computing-io/kepler/pkg/node"
 	acc "github.com/sustainable-computing-io/kepler/pkg/sensors/accelerator"
@@ -36,11 +37,16 @@ type NodeStats struct {
 }
 
 func NewNodeStats() *NodeStats {
-	return &NodeStats{
+	ne := &NodeStats{
 		Stats:              *NewStats(),
 		IdleResUtilization: map[string]uint64{},
 		nodeInfo:           node.NewNodeInfo(),
 	}
+	// the node features that are not aggregated from the processes
+	for _, metricName := range AvailableCPUPowerStateMetrics() {
+		ne.ResourceUsage[metricName] = types.NewUInt64StatCollection()
+	}
+	return ne
 }
 
 // ResetDeltaValues reset all delta values to 0
@@ -18,6 +18,9 @@ package stats
 
 import (
 	"fmt"
+
+	"github.com/sustainable-computing-io/kepler/pkg/collector/stats/types"
+	"github.com/sustainable-computing-io/kepler/pkg/utils"
 )
 
 type ProcessStats struct {
@@ -28,6 +31,8 @@ type ProcessStats struct {
 	VMID        string
 	Command     string
 	IdleCounter int
+	// counters are the stats returned by Counters, resolved once per process
+	counters []*types.UInt64Stat
 }
 
 // NewProcessStats creates a new ProcessStats instance
@@ -50,6 +55,29 @@ func (p *ProcessStats) ResetDeltaValues() {
 	p.IdleCounter += 1
 }
 
+// Counters returns the generic socket stats of the named resource usage metrics by the index of their name, creating
+// the missing ones. They are resolved on the first call, so the names must not change over the lifetime of the process.
+func (p *ProcessStats) Counters(names []string) []*types.UInt64Stat {
+	if len(p.counters) == len(names) {
+		return p.counters
+	}
+	p.counters = make([]*types.UInt64Stat, len(names))
+	for i, name := range names {
+		collection, found := p.ResourceUsage[name]
+		if !found {
+			collection = types.NewUInt64StatCollection()
+			p.ResourceUsage[name] = collection
+		}
+		stat, found := collection[utils.GenericSocketID]
+		if !found {
+			stat = types.NewUInt64Stat(0, 0)
+			collection[utils.GenericSocketID] = stat
+		}
+		p.counters[i] = stat
+	}
+	return p.counters
+}
+
 func (p *ProcessStats) String() string {
 	return fmt.Sprintf("energy from process pid: %d, containerID: %s, comm: %s\n"+
 		"%v\n", p.PID, p.ContainerID, p.Command, p.Stats.String(),
@@ -285,3 +285,12 @@ func AvailableBPFMetrics() []string {
 	metrics := append(config.BPFHwCounters(), config.BPFSwCounters()...)
 	return metrics
 }
+
+// AvailableCPUPowerStateMetrics returns the node features of the CPU power states, which are only tracked with
+// EXPERIMENTAL_BPF_CPU_POWER_STATE
+func AvailableCPUPowerStateMetrics() []string {
+	if !config.IsBPFCPUPowerStateEnabled() {
+		return nil
+	}
+	return []string{config.CPUBusyTimeLabel, config.CPUBusyCyclesLabel, config.CPUIdleTimeLabel}
+}
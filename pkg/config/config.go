@@ -25,6 +25,7 @@ import (
 	"strconv"
 	"strings"
 	"sync"
+	"time"
 
 	"golang.org/x/sys/unix"
 	"k8s.io/klog/v2"
@@ -46,13 +47,17 @@ type KeplerConfig struct {
 	KeplerNamespace              string
 	EnabledEBPFCgroupID          bool
 	EnabledGPU                   bool
+	GPUSampleIntervalMs          int
 	EnabledMSR                   bool
+	EnableRAPLPerfEvents         bool
+	RAPLSampleIntervalMs         int
 	EnableProcessStats           bool
 	ExposeContainerStats         bool
 	ExposeVMStats                bool
 	ExposeHardwareCounterMetrics bool
 	ExposeIRQCounterMetrics      bool
 	ExposeBPFMetrics             bool
+	EnableIncrementalMetrics     bool
 	ExposeComponentPower         bool
 	ExposeIdlePowerMetrics       bool
 	EnableAPIServer              bool
@@ -60,6 +65,26 @@ type KeplerConfig struct {
 	MaxLookupRetry               int
 	KubeConfig                   string
 	BPFSampleRate                int
+	BPFSampleTarget              int
+	EnableBPFTaskStorage         bool
+	EnableBPFPerCPUProcessMap    bool
+	EnableBPFCgroupMetrics       bool
+	EnableBPFPodCgroupAncestor   bool
+	EnableBPFProgStats           bool
+	EnableBPFRuntimeConfig       bool
+	EnableBPFPageCacheBatch      bool
+	BPFPageCacheSampleRate       int
+	EnableBPFBlockIOBytes        bool
+	EnableBPFNetBytes            bool
+	EnableBPFCPUPowerState       bool
+	EnableBPFThreadMetrics       bool
+	BPFThreadMapSize             int
+	EnableBPFSliceHistograms     bool
+	EnableBPFPinMaps             bool
+	EnableBPFPinLinks            bool
+	BPFPinPath                   string
+	CollectorWorkers             int
+	BPFRecordFile                string
 	EstimatorModel               string
 	EstimatorSelectFilter        string
 	CPUArchOverride              string
@@ -164,13 +189,17 @@ func getKeplerConfig() KeplerConfig {
 		KeplerNamespace:              getConfig("KEPLER_NAMESPACE", defaultNamespace),
 		EnabledEBPFCgroupID:          getBoolConfig("ENABLE_EBPF_CGROUPID", true),
 		EnabledGPU:                   getBoolConfig("ENABLE_GPU", false),
+		GPUSampleIntervalMs:          getIntConfig("EXPERIMENTAL_GPU_SAMPLE_INTERVAL_MS", 0),
 		EnabledMSR:                   getBoolConfig("ENABLE_MSR", false),
+		EnableRAPLPerfEvents:         getBoolConfig("EXPERIMENTAL_RAPL_PERF_EVENTS", false),
+		RAPLSampleIntervalMs:         getIntConfig("EXPERIMENTAL_RAPL_SAMPLE_INTERVAL_MS", 0),
 		EnableProcessStats:           getBoolConfig("ENABLE_PROCESS_METRICS", false),
 		ExposeContainerStats:         getBoolConfig("EXPOSE_CONTAINER_METRICS", true),
 		ExposeVMStats:                getBoolConfig("EXPOSE_VM_METRICS", true),
 		ExposeHardwareCounterMetrics: getBoolConfig("EXPOSE_HW_COUNTER_METRICS", true),
 		ExposeIRQCounterMetrics:      getBoolConfig("EXPOSE_IRQ_COUNTER_METRICS", true),
 		ExposeBPFMetrics:             getBoolConfig("EXPOSE_BPF_METRICS", true),
+		EnableIncrementalMetrics:     getBoolConfig("EXPERIMENTAL_INCREMENTAL_METRICS", false),
 		ExposeComponentPower:         getBoolConfig("EXPOSE_COMPONENT_POWER", true),
 		ExposeIdlePowerMetrics:       getBoolConfig("EXPOSE_ESTIMATED_IDLE_POWER_METRICS", false),
 		EnableAPIServer:              getBoolConfig("ENABLE_API_SERVER", false),
@@ -178,6 +207,26 @@ func getKeplerConfig() KeplerConfig {
 		MaxLookupRetry:               getIntConfig("MAX_LOOKUP_RETRY", defaultMaxLookupRetry),
 		KubeConfig:                   getConfig("KUBE_CONFIG", defaultKubeConfig),
 		BPFSampleRate:                getIntConfig("EXPERIMENTAL_BPF_SAMPLE_RATE", defaultBPFSampleRate),
+		BPFSampleTarget:              getIntConfig("EXPERIMENTAL_BPF_SAMPLE_TARGET", defaultBPFSampleTarget),
+		EnableBPFTaskStorage:         getBoolConfig("EXPERIMENTAL_BPF_TASK_STORAGE", false),
+		EnableBPFPerCPUProcessMap:    getBoolConfig("EXPERIMENTAL_BPF_PERCPU_PROCESS_MAP", false),
+		EnableBPFCgroupMetrics:       getBoolConfig("EXPERIMENTAL_BPF_CGROUP_METRICS", false),
+		EnableBPFPodCgroupAncestor:   getBoolConfig("EXPERIMENTAL_BPF_POD_CGROUP_ANCESTOR", false),
+		EnableBPFProgStats:           getBoolConfig("EXPERIMENTAL_BPF_PROG_STATS", false),
+		EnableBPFRuntimeConfig:       getBoolConfig("EXPERIMENTAL_BPF_RUNTIME_CONFIG", false),
+		EnableBPFPageCacheBatch:      getBoolConfig("EXPERIMENTAL_BPF_PAGE_CACHE_BATCH", false),
+		BPFPageCacheSampleRate:       getIntConfig("EXPERIMENTAL_BPF_PAGE_CACHE_SAMPLE_RATE", defaultBPFPageCacheSampleRate),
+		EnableBPFBlockIOBytes:        getBoolConfig("EXPERIMENTAL_BPF_BLOCK_IO_BYTES", false),
+		EnableBPFNetBytes:            getBoolConfig("EXPERIMENTAL_BPF_NET_BYTES", false),
+		EnableBPFCPUPowerState:       getBoolConfig("EXPERIMENTAL_BPF_CPU_POWER_STATE", false),
+		EnableBPFThreadMetrics:       getBoolConfig("EXPERIMENTAL_BPF_THREAD_METRICS", false),
+		BPFThreadMapSize:             getIntConfig("EXPERIMENTAL_BPF_THREAD_MAP_SIZE", defaultBPFThreadMapSize),
+		EnableBPFSliceHistograms:     getBoolConfig("EXPERIMENTAL_BPF_SLICE_HISTOGRAMS", false),
+		EnableBPFPinMaps:             getBoolConfig("EXPERIMENTAL_BPF_PIN_MAPS", false),
+		EnableBPFPinLinks:            getBoolConfig("EXPERIMENTAL_BPF_PIN_LINKS", false),
+		BPFPinPath:                   getConfig("EXPERIMENTAL_BPF_PIN_PATH", defaultBPFPinPath),
+		CollectorWorkers:             getIntConfig("EXPERIMENTAL_COLLECTOR_WORKERS", defaultCollectorWorkers),
+		BPFRecordFile:                getConfig("EXPERIMENTAL_BPF_RECORD_FILE", ""),
 		EstimatorModel:               getConfig("ESTIMATOR_MODEL", defaultMetricValue),
 		EstimatorSelectFilter:        getConfig("ESTIMATOR_SELECT_FILTER", defaultMetricValue), // no filter
 		CPUArchOverride:              getConfig("CPU_ARCH_OVERRIDE", defaultCPUArchOverride),
@@ -279,13 +328,37 @@ func logBoolConfigs() {
 	if klog.V(5).Enabled() {
 		klog.V(5).Infof("ENABLE_EBPF_CGROUPID: %t", instance.Kepler.EnabledEBPFCgroupID)
 		klog.V(5).Infof("ENABLE_GPU: %t", instance.Kepler.EnabledGPU)
+		klog.V(5).Infof("EXPERIMENTAL_GPU_SAMPLE_INTERVAL_MS: %d", instance.Kepler.GPUSampleIntervalMs)
+		klog.V(5).Infof("EXPERIMENTAL_RAPL_PERF_EVENTS: %t", instance.Kepler.EnableRAPLPerfEvents)
+		klog.V(5).Infof("EXPERIMENTAL_RAPL_SAMPLE_INTERVAL_MS: %d", instance.Kepler.RAPLSampleIntervalMs)
 		klog.V(5).Infof("ENABLE_PROCESS_METRICS: %t", instance.Kepler.EnableProcessStats)
 		klog.V(5).Infof("EXPOSE_HW_COUNTER_METRICS: %t", instance.Kepler.ExposeHardwareCounterMetrics)
 		klog.V(5).Infof("EXPOSE_IRQ_COUNTER_METRICS: %t", instance.Kepler.ExposeIRQCounterMetrics)
 		klog.V(5).Infof("EXPOSE_BPF_METRICS: %t", instance.Kepler.ExposeBPFMetrics)
+		klog.V(5).Infof("EXPERIMENTAL_INCREMENTAL_METRICS: %t", instance.Kepler.EnableIncrementalMetrics)
 		klog.V(5).Infof("EXPOSE_COMPONENT_POWER: %t", instance.Kepler.ExposeComponentPower)
 		klog.V(5).Infof("EXPOSE_ESTIMATED_IDLE_POWER_METRICS: %t. This only impacts when the power is estimated using pre-prained models. Estimated idle power is meaningful only when Kepler is running on bare-metal or with a single virtual machine (VM) on the node.", instance.Kepler.ExposeIdlePowerMetrics)
 		klog.V(5).Infof("EXPERIMENTAL_BPF_SAMPLE_RATE: %d", instance.Kepler.BPFSampleRate)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_SAMPLE_TARGET: %d", instance.Kepler.BPFSampleTarget)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_TASK_STORAGE: %t", instance.Kepler.EnableBPFTaskStorage)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_PERCPU_PROCESS_MAP: %t", instance.Kepler.EnableBPFPerCPUProcessMap)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_CGROUP_METRICS: %t", instance.Kepler.EnableBPFCgroupMetrics)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_POD_CGROUP_ANCESTOR: %t", instance.Kepler.EnableBPFPodCgroupAncestor)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_PROG_STATS: %t", instance.Kepler.EnableBPFProgStats)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_RUNTIME_CONFIG: %t", instance.Kepler.EnableBPFRuntimeConfig)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_PAGE_CACHE_BATCH: %t", instance.Kepler.EnableBPFPageCacheBatch)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_PAGE_CACHE_SAMPLE_RATE: %d", instance.Kepler.BPFPageCacheSampleRate)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_BLOCK_IO_BYTES: %t", instance.Kepler.EnableBPFBlockIOBytes)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_NET_BYTES: %t", instance.Kepler.EnableBPFNetBytes)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_CPU_POWER_STATE: %t", instance.Kepler.EnableBPFCPUPowerState)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_THREAD_METRICS: %t", instance.Kepler.EnableBPFThreadMetrics)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_THREAD_MAP_SIZE: %d", instance.Kepler.BPFThreadMapSize)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_SLICE_HISTOGRAMS: %t", instance.Kepler.EnableBPFSliceHistograms)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_PIN_MAPS: %t", instance.Kepler.EnableBPFPinMaps)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_PIN_LINKS: %t", instance.Kepler.EnableBPFPinLinks)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_PIN_PATH: %s", instance.Kepler.BPFPinPath)
+		klog.V(5).Infof("EXPERIMENTAL_COLLECTOR_WORKERS: %d", instance.Kepler.CollectorWorkers)
+		klog.V(5).Infof("EXPERIMENTAL_BPF_RECORD_FILE: %s", instance.Kepler.BPFRecordFile)
 		klog.V(5).Infof("EXCLUDE_SWAPPER_PROCESS: %t", instance.Kepler.ExcludeSwapperProcess)
 	}
 }
@@ -358,6 +431,11 @@ func SetEnabledMSR(enabled bool) {
 	instance.Kepler.EnabledMSR = enabled
 }
 
+// SetEnabledBPFCPUPowerState enables the tracking of the CPU power states
+func SetEnabledBPFCPUPowerState(enabled bool) {
+	instance.Kepler.EnableBPFCPUPowerState = enabled
+}
+
 // SetKubeConfig set kubeconfig file
 func SetKubeConfig(k string) {
 	instance.Kepler.KubeConfig = k
@@ -487,6 +565,12 @@ func IsExposeVMStatsEnabled() bool {
 	return instance.Kepler.ExposeVMStats
 }
 
+// IsIncrementalMetricsEnabled returns true if the scrapes should be served from a snapshot of the process, container,
+// VM and node metrics taken after each update, only rebuilding the series whose value changed.
+func IsIncrementalMetricsEnabled() bool {
+	return instance.Kepler.EnableIncrementalMetrics
+}
+
 // IsExposeBPFMetricsEnabled returns false if BPF Metrics metrics are disabled to minimize overhead.
 func IsExposeBPFMetricsEnabled() bool {
 	return instance.Kepler.ExposeBPFMetrics
@@ -501,6 +585,24 @@ func IsEnabledMSR() bool {
 	return instance.Kepler.EnabledMSR
 }
 
+// IsRAPLPerfEventsEnabled returns true if the RAPL energy should be read from the power perf PMU when it is available,
+// instead of the powercap sysfs files or the MSRs.
+func IsRAPLPerfEventsEnabled() bool {
+	return instance.Kepler.EnableRAPLPerfEvents
+}
+
+// GetRAPLSampleInterval returns the interval at which a background sampler reads the RAPL sysfs energy counters, or 0
+// if the counters are read on each collection.
+func GetRAPLSampleInterval() time.Duration {
+	return time.Duration(instance.Kepler.RAPLSampleIntervalMs) * time.Millisecond
+}
+
+// GetGPUSampleInterval returns the interval at which a background sampler queries the per-process GPU utilization, or 0
+// if the GPUs are queried on each collection.
+func GetGPUSampleInterval() time.Duration {
+	return time.Duration(instance.Kepler.GPUSampleIntervalMs) * time.Millisecond
+}
+
 func IsModelServerEnabled() bool {
 	return instance.Model.ModelServerEnable
 }
@@ -540,6 +642,131 @@ func GetBPFSampleRate() int {
 	return instance.Kepler.BPFSampleRate
 }
 
+// GetBPFSampleTarget returns the number of sched_switch events per second and CPU the eBPF programs sample, each CPU
+// adapting its sample rate to its context switch rate. 0 disables it and uses the fixed sample rate.
+func GetBPFSampleTarget() int {
+	return instance.Kepler.BPFSampleTarget
+}
+
+// IsBPFRuntimeConfigEnabled returns true if the eBPF programs should read the sample rate and hardware counter setting
+// from a map that is updated while they run, instead of constants set when they are loaded.
+func IsBPFRuntimeConfigEnabled() bool {
+	return instance.Kepler.EnableBPFRuntimeConfig
+}
+
+// GetBPFRuntimeConfig re-reads the eBPF sample rate and hardware counter setting from the environment and the config
+// files, so that updates of the config files apply while the programs run. The hardware counters can only be
+// re-enabled if they were enabled at startup.
+func GetBPFRuntimeConfig() (sampleRate int, hardwareCounters bool) {
+	sampleRate = getIntConfig("EXPERIMENTAL_BPF_SAMPLE_RATE", defaultBPFSampleRate)
+	hardwareCounters = instance.Kepler.ExposeHardwareCounterMetrics && getBoolConfig("EXPOSE_HW_COUNTER_METRICS", true)
+	return sampleRate, hardwareCounters
+}
+
+// IsBPFPerCPUProcessMapEnabled returns true if the processes map should be a per-CPU map that is reduced in userspace.
+func IsBPFPerCPUProcessMapEnabled() bool {
+	return instance.Kepler.EnableBPFPerCPUProcessMap
+}
+
+// IsBPFCgroupMetricsEnabled returns true if the eBPF programs should accumulate the metrics per cgroup instead of per process.
+func IsBPFCgroupMetricsEnabled() bool {
+	return instance.Kepler.EnableBPFCgroupMetrics
+}
+
+// IsBPFPodCgroupAncestorEnabled returns true if the eBPF programs should record the pod cgroup of each entry as its ancestor.
+func IsBPFPodCgroupAncestorEnabled() bool {
+	return instance.Kepler.EnableBPFPodCgroupAncestor
+}
+
+// IsBPFProgStatsEnabled returns true if the eBPF programs should count their own runs, run time and map errors.
+func IsBPFProgStatsEnabled() bool {
+	return instance.Kepler.EnableBPFProgStats
+}
+
+// IsBPFPageCacheBatchEnabled returns true if the page cache hits of the current process should be counted per CPU and
+// added to the process when it is switched out, instead of updating the process on every hit.
+func IsBPFPageCacheBatchEnabled() bool {
+	return instance.Kepler.EnableBPFPageCacheBatch
+}
+
+// GetBPFPageCacheSampleRate returns the number of page cache hits skipped after each counted one, 0 counts them all.
+func GetBPFPageCacheSampleRate() int {
+	return instance.Kepler.BPFPageCacheSampleRate
+}
+
+// IsBPFBlockIOBytesEnabled returns true if the eBPF programs should count the bytes of the block I/O requests issued by
+// each process, exposed as the bpf_block_io_bytes software counter.
+func IsBPFBlockIOBytesEnabled() bool {
+	return instance.Kepler.EnableBPFBlockIOBytes
+}
+
+// IsBPFNetBytesEnabled returns true if the eBPF programs should count the IPv4 and IPv6 bytes sent and received by each
+// process, exposed as the bpf_net_tx_bytes and bpf_net_rx_bytes software counters.
+func IsBPFNetBytesEnabled() bool {
+	return instance.Kepler.EnableBPFNetBytes
+}
+
+// IsBPFCPUPowerStateEnabled returns true if the eBPF programs should track the busy time, frequency-weighted busy time
+// and idle state residency of each CPU from the power tracepoints.
+func IsBPFCPUPowerStateEnabled() bool {
+	return instance.Kepler.EnableBPFCPUPowerState
+}
+
+// IsBPFThreadMetricsEnabled returns true if sched_switch should also accumulate the on-CPU metrics of each thread,
+// exposed per thread by the eBPF metrics collector.
+func IsBPFThreadMetricsEnabled() bool {
+	return instance.Kepler.EnableBPFThreadMetrics
+}
+
+// GetBPFThreadMapSize returns the number of threads tracked with the per-thread metrics, the least recently active
+// ones are evicted first.
+func GetBPFThreadMapSize() int {
+	if instance.Kepler.BPFThreadMapSize <= 0 {
+		return defaultBPFThreadMapSize
+	}
+	return instance.Kepler.BPFThreadMapSize
+}
+
+// IsBPFSliceHistogramsEnabled returns true if sched_switch should also count the on-CPU time slices of each cgroup in
+// log2 buckets, exposed as histograms by the eBPF metrics collector.
+func IsBPFSliceHistogramsEnabled() bool {
+	return instance.Kepler.EnableBPFSliceHistograms
+}
+
+// IsBPFPinMapsEnabled returns true if the eBPF maps holding the metrics and the process state should be pinned under
+// GetBPFPinPath, so that a restarted exporter reuses them when their layout did not change.
+func IsBPFPinMapsEnabled() bool {
+	return instance.Kepler.EnableBPFPinMaps
+}
+
+// IsBPFPinLinksEnabled returns true if the programs should also stay attached until the next exporter replaces them,
+// so that no event is missed while it restarts. Removing GetBPFPinPath detaches them.
+func IsBPFPinLinksEnabled() bool {
+	return instance.Kepler.EnableBPFPinMaps && instance.Kepler.EnableBPFPinLinks
+}
+
+// GetBPFPinPath returns the bpffs directory of the pinned eBPF maps and links
+func GetBPFPinPath() string {
+	return instance.Kepler.BPFPinPath
+}
+
+// GetCollectorWorkers returns the number of goroutines that the collector shards the process stats across on each
+// update. With 1 or less the update runs serially.
+func GetCollectorWorkers() int {
+	return instance.Kepler.CollectorWorkers
+}
+
+// GetBPFRecordFile returns the file that the BPF samples and the node energy readings of each collection are recorded
+// to for pkg/replay, or an empty string if they are not recorded.
+func GetBPFRecordFile() string {
+	return instance.Kepler.BPFRecordFile
+}
+
+// IsBPFTaskStorageEnabled returns true if the on-CPU timestamps should be kept in task local storage when the kernel supports it.
+func IsBPFTaskStorageEnabled() bool {
+	return instance.Kepler.EnableBPFTaskStorage
+}
+
 func GetRedfishCredFilePath() string {
 	return instance.Redfish.CredFilePath
 }
@@ -635,7 +862,14 @@ func BPFHwCounters() []string {
 }
 
 func BPFSwCounters() []string {
-	return []string{CPUTime, IRQNetTXLabel, IRQNetRXLabel, IRQBlockLabel, PageCacheHit}
+	counters := []string{CPUTime, IRQNetTXLabel, IRQNetRXLabel, IRQBlockLabel, IRQNetTXTimeLabel, IRQNetRXTimeLabel, IRQBlockTimeLabel, PageCacheHit}
+	if IsBPFBlockIOBytesEnabled() {
+		counters = append(counters, BlockIOBytesLabel)
+	}
+	if IsBPFNetBytesEnabled() {
+		counters = append(counters, NetTXBytesLabel, NetRXBytesLabel)
+	}
+	return counters
 }
 
 func DCGMHostEngineEndpoint() string {
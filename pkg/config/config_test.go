@@ -193,4 +193,34 @@ var _ = Describe("Test Configuration", func() {
 		Expect(Config.Kepler.ExposeHardwareCounterMetrics).To(BeFalse())
 		Expect(ExposeHardwareCounterMetrics()).To(BeFalse())
 	})
+	It("test re-reading the eBPF runtime config", func() {
+		_, err := Initialize(".")
+		Expect(err).NotTo(HaveOccurred())
+		SetEnabledHardwareCounterMetrics(true)
+		DeferCleanup(SetEnabledHardwareCounterMetrics, true)
+
+		GinkgoT().Setenv("EXPERIMENTAL_BPF_SAMPLE_RATE", "5")
+		GinkgoT().Setenv("EXPOSE_HW_COUNTER_METRICS", "false")
+		sampleRate, hardwareCounters := GetBPFRuntimeConfig()
+		Expect(sampleRate).To(Equal(5))
+		Expect(hardwareCounters).To(BeFalse())
+		// the startup value is kept
+		Expect(GetBPFSampleRate()).To(Equal(0))
+
+		// the hardware counters cannot be enabled if they were disabled at startup
+		SetEnabledHardwareCounterMetrics(false)
+		GinkgoT().Setenv("EXPOSE_HW_COUNTER_METRICS", "true")
+		_, hardwareCounters = GetBPFRuntimeConfig()
+		Expect(hardwareCounters).To(BeFalse())
+	})
+	It("test the optional eBPF I/O byte counters", func() {
+		_, err := Initialize(".")
+		Expect(err).NotTo(HaveOccurred())
+		Expect(BPFSwCounters()).NotTo(ContainElements(BlockIOBytesLabel, NetTXBytesLabel, NetRXBytesLabel))
+
+		instance.Kepler.EnableBPFNetBytes = true
+		DeferCleanup(func() { instance.Kepler.EnableBPFNetBytes = false })
+		Expect(BPFSwCounters()).To(ContainElements(NetTXBytesLabel, NetRXBytesLabel))
+		Expect(BPFSwCounters()).NotTo(ContainElement(BlockIOBytesLabel))
+	})
 })
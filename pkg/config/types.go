@@ -38,6 +38,18 @@ const (
 	IRQNetTXLabel = "bpf_net_tx_irq"
 	IRQNetRXLabel = "bpf_net_rx_irq"
 	IRQBlockLabel = "bpf_block_irq"
+	// time spent in the softirqs
+	IRQNetTXTimeLabel = "bpf_net_tx_irq_time_ms"
+	IRQNetRXTimeLabel = "bpf_net_rx_irq_time_ms"
+	IRQBlockTimeLabel = "bpf_block_irq_time_ms"
+	// optional I/O byte counters
+	BlockIOBytesLabel = "bpf_block_io_bytes"
+	NetTXBytesLabel   = "bpf_net_tx_bytes"
+	NetRXBytesLabel   = "bpf_net_rx_bytes"
+	// optional CPU power state residencies of the node
+	CPUBusyTimeLabel   = "bpf_cpu_busy_time_ms"
+	CPUBusyCyclesLabel = "bpf_cpu_busy_cycles"
+	CPUIdleTimeLabel   = "bpf_cpu_idle_time_ms"
 
 	// GPU
 	GPUComputeUtilization = "gpu_compute_util"
@@ -90,11 +102,16 @@ const (
 	// MaxIRQ is the maximum number of IRQs to be monitored
 	MaxIRQ = 10
 	// defaultSamplePeriodSec is the time in seconds that the reader will wait before reading the metrics again
-	defaultSamplePeriodSec       = 3
-	defaultKubeConfig            = ""
-	defaultBPFSampleRate         = 0
-	defaultCPUArchOverride       = ""
-	defaultExcludeSwapperProcess = false
+	defaultSamplePeriodSec        = 3
+	defaultKubeConfig             = ""
+	defaultBPFSampleRate          = 0
+	defaultBPFSampleTarget        = 0
+	defaultBPFPageCacheSampleRate = 0
+	defaultBPFThreadMapSize       = 4096
+	defaultBPFPinPath             = "/sys/fs/bpf/kepler"
+	defaultCollectorWorkers       = 1
+	defaultCPUArchOverride        = ""
+	defaultExcludeSwapperProcess  = false
 	// model_parameter_prefix
 	defaultNodePlatformPowerKey        = "NODE_TOTAL"
 	defaultNodeComponentsPowerKey      = "NODE_COMPONENTS"
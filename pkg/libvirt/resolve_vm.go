@@ -22,6 +22,7 @@ import (
 	"os"
 	"regexp"
 	"strings"
+	"sync"
 
 	"github.com/beevik/etree"
 	"github.com/digitalocean/go-libvirt"
@@ -37,6 +38,8 @@ const (
 )
 
 var (
+	// cacheMx guards the caches, as the collector may resolve VMs from several goroutines
+	cacheMx           sync.RWMutex
 	cacheExist        = map[uint64]string{}
 	cacheNotExist     = map[uint64]bool{}
 	regexFindVMIDPath = regexp.MustCompile(`machine-qemu.*\.scope`)
@@ -48,10 +51,14 @@ func GetVMID(pid uint64) (string, error) {
 }
 
 func getVMID(pid uint64, fileName string) (string, error) {
-	if _, exist := cacheExist[pid]; exist {
-		return cacheExist[pid], nil
+	cacheMx.RLock()
+	vmID, exist := cacheExist[pid]
+	_, notExist := cacheNotExist[pid]
+	cacheMx.RUnlock()
+	if exist {
+		return vmID, nil
 	}
-	if _, exist := cacheNotExist[pid]; exist {
+	if notExist {
 		return "", fmt.Errorf("pid %d is not in a VM", pid)
 	}
 
@@ -67,7 +74,7 @@ func getVMID(pid uint64, fileName string) (string, error) {
 		addToNotExistCache(pid)
 		return utils.EmptyString, fmt.Errorf("pid %d does not have vm ID", pid)
 	}
-	vmID := content[0]
+	vmID = content[0]
 	vmID = strings.ReplaceAll(vmID, "\\x2d", "-")
 	vmID = strings.ReplaceAll(vmID, ".scope", "")
 
@@ -83,6 +90,8 @@ func getVMID(pid uint64, fileName string) (string, error) {
 }
 
 func addVMIDToCache(pid uint64, id string) {
+	cacheMx.Lock()
+	defer cacheMx.Unlock()
 	if len(cacheExist) >= maxCacheSize {
 		counter := cacheRemoveElements
 		// Remove elements from the cache
@@ -98,6 +107,8 @@ func addVMIDToCache(pid uint64, id string) {
 }
 
 func addToNotExistCache(pid uint64) {
+	cacheMx.Lock()
+	defer cacheMx.Unlock()
 	if len(cacheNotExist) >= maxCacheSize {
 		counter := cacheRemoveElements
 		// Remove elements from the cache
@@ -49,6 +49,7 @@ func New(bpfExporter bpf.Exporter) *CollectorManager {
 	manager.PrometheusCollector.NewContainerCollector(manager.StatsCollector.ContainerStats)
 	manager.PrometheusCollector.NewVMCollector(manager.StatsCollector.VMStats)
 	manager.PrometheusCollector.NewNodeCollector(&manager.StatsCollector.NodeStats)
+	manager.PrometheusCollector.NewBPFCollector(bpfExporter)
 	// configure the watcher
 	if manager.Watcher, err = kubernetes.NewObjListWatcher(supportedMetrics); err != nil {
 		klog.Errorf("could not create the watcher, %v", err)
@@ -74,10 +75,14 @@ func (m *CollectorManager) Start() error {
 			// wait x seconds before updating the metrics
 			<-ticker.C
 
+			// read the bpf records before taking the lock, since it does not update the metrics
+			m.StatsCollector.Prepare()
 			// acquire the lock to wait prometheus finish the metric collection before updating the metrics
 			m.PrometheusCollector.Mx.Lock()
 			m.StatsCollector.Update()
 			m.PrometheusCollector.Mx.Unlock()
+			// publish the updated metrics to the scrapes with the incremental exposition
+			m.PrometheusCollector.RefreshSnapshots()
 		}
 	}()
 
@@ -86,4 +91,5 @@ func (m *CollectorManager) Start() error {
 
 func (m *CollectorManager) Stop() {
 	m.Watcher.ShutDownWithDrain()
+	m.StatsCollector.Stop()
 }
@@ -0,0 +1,233 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package bpf
+
+import (
+	"strconv"
+
+	"github.com/prometheus/client_golang/prometheus"
+	"github.com/sustainable-computing-io/kepler/pkg/bpf"
+	"github.com/sustainable-computing-io/kepler/pkg/metrics/consts"
+	"github.com/sustainable-computing-io/kepler/pkg/metrics/metricfactory"
+	"k8s.io/klog/v2"
+)
+
+const (
+	context = "bpf"
+)
+
+// collector implements prometheus.Collector. It exports the self-overhead counters and the sample rates of the eBPF
+// programs, and the CPU residencies, per-thread metrics and on-CPU slice histograms they track.
+type collector struct {
+	collectors map[string]metricfactory.PromMetric
+	// sliceHistogram is exported as a const histogram, which has no metricfactory.PromMetric
+	sliceHistogram *prometheus.Desc
+
+	bpfExporter bpf.Exporter
+}
+
+func NewBPFCollector(bpfExporter bpf.Exporter) prometheus.Collector {
+	c := &collector{
+		collectors:  make(map[string]metricfactory.PromMetric),
+		bpfExporter: bpfExporter,
+	}
+	c.initMetrics()
+	return c
+}
+
+// initMetrics creates prometheus metric description for the eBPF programs
+func (c *collector) initMetrics() {
+	for name, help := range map[string]string{
+		"prog_runs_total":               "Number of runs of the eBPF program",
+		"prog_run_seconds_total":        "Time spent running the eBPF program",
+		"map_update_failures_total":     "Number of failed map updates and ring buffer reservations of the eBPF program",
+		"process_register_races_total":  "Number of entries registered concurrently by another CPU",
+		"on_cpu_timestamp_misses_total": "Number of tasks switched out without an on-CPU start timestamp",
+	} {
+		desc := prometheus.NewDesc(
+			prometheus.BuildFQName(consts.MetricsNamespace, context, name),
+			help,
+			[]string{"program"},
+			nil,
+		)
+		c.collectors[name] = metricfactory.NewPromCounter(desc)
+	}
+
+	desc := prometheus.NewDesc(
+		prometheus.BuildFQName(consts.MetricsNamespace, context, "sched_switch_sample_rate"),
+		"Number of sched_switch events skipped per sampled one, picked by the CPU from its context switch rate",
+		[]string{"cpu"},
+		nil,
+	)
+	c.collectors["sched_switch_sample_rate"] = metricfactory.NewPromGauge(desc)
+
+	for name, help := range map[string]string{
+		"cpu_busy_seconds_total": "Time the CPU was not idle",
+		"cpu_busy_cycles_total":  "Time the CPU was not idle weighted by its frequency, in cycles",
+	} {
+		desc := prometheus.NewDesc(
+			prometheus.BuildFQName(consts.MetricsNamespace, context, name),
+			help,
+			[]string{"cpu"},
+			nil,
+		)
+		c.collectors[name] = metricfactory.NewPromCounter(desc)
+	}
+	desc = prometheus.NewDesc(
+		prometheus.BuildFQName(consts.MetricsNamespace, context, "cpu_idle_seconds_total"),
+		"Time the CPU spent in the idle state",
+		[]string{"cpu", "state"},
+		nil,
+	)
+	c.collectors["cpu_idle_seconds_total"] = metricfactory.NewPromCounter(desc)
+
+	for name, help := range map[string]string{
+		"thread_cpu_seconds_total":      "On-CPU time of the thread",
+		"thread_cpu_cycles_total":       "CPU cycles of the thread",
+		"thread_cpu_instructions_total": "CPU instructions of the thread",
+		"thread_cache_misses_total":     "Cache misses of the thread",
+	} {
+		desc := prometheus.NewDesc(
+			prometheus.BuildFQName(consts.MetricsNamespace, context, name),
+			help,
+			[]string{"pid", "tid", "command"},
+			nil,
+		)
+		c.collectors[name] = metricfactory.NewPromCounter(desc)
+	}
+
+	c.sliceHistogram = prometheus.NewDesc(
+		prometheus.BuildFQName(consts.MetricsNamespace, context, "cgroup_cpu_slice_seconds"),
+		"Duration of the on-CPU time slices of the tasks of the cgroup",
+		[]string{"cgroup_id"},
+		nil,
+	)
+}
+
+func (c *collector) Describe(ch chan<- *prometheus.Desc) {
+	for _, collector := range c.collectors {
+		ch <- collector.Desc()
+	}
+	ch <- c.sliceHistogram
+}
+
+func (c *collector) Collect(ch chan<- prometheus.Metric) {
+	c.collectProgStats(ch)
+	c.collectSampleRates(ch)
+	c.collectCPUPowerStates(ch)
+	c.collectThreads(ch)
+	c.collectSliceHistograms(ch)
+}
+
+func (c *collector) collectProgStats(ch chan<- prometheus.Metric) {
+	progStats, err := c.bpfExporter.CollectProgStats()
+	if err != nil {
+		klog.V(1).Infof("failed to collect eBPF program stats: %v", err)
+		return
+	}
+	for program, s := range progStats {
+		ch <- c.collectors["prog_runs_total"].MustMetric(float64(s.RunCount), program)
+		ch <- c.collectors["prog_run_seconds_total"].MustMetric(float64(s.RunTimeNs)/1e9, program)
+		ch <- c.collectors["map_update_failures_total"].MustMetric(float64(s.MapUpdateFailures), program)
+		ch <- c.collectors["process_register_races_total"].MustMetric(float64(s.RegisterRaces), program)
+		ch <- c.collectors["on_cpu_timestamp_misses_total"].MustMetric(float64(s.TimestampMisses), program)
+	}
+}
+
+func (c *collector) collectSampleRates(ch chan<- prometheus.Metric) {
+	rates, err := c.bpfExporter.CollectSampleRates()
+	if err != nil {
+		klog.V(1).Infof("failed to collect eBPF sample rates: %v", err)
+		return
+	}
+	for cpu, rate := range rates {
+		ch <- c.collectors["sched_switch_sample_rate"].MustMetric(float64(rate), strconv.Itoa(cpu))
+	}
+}
+
+func (c *collector) collectCPUPowerStates(ch chan<- prometheus.Metric) {
+	states, err := c.bpfExporter.CollectCPUPowerStates()
+	if err != nil {
+		klog.V(1).Infof("failed to collect the CPU power states: %v", err)
+		return
+	}
+	for i := range states {
+		s := &states[i]
+		cpu := strconv.Itoa(i)
+		ch <- c.collectors["cpu_busy_seconds_total"].MustMetric(float64(s.BusyTimeNs)/1e9, cpu)
+		ch <- c.collectors["cpu_busy_cycles_total"].MustMetric(float64(s.BusyCycles), cpu)
+		for state, idleTime := range s.IdleTimeNs {
+			// the idle states the CPU does not have
+			if idleTime == 0 {
+				continue
+			}
+			ch <- c.collectors["cpu_idle_seconds_total"].MustMetric(float64(idleTime)/1e9, cpu, strconv.Itoa(state))
+		}
+	}
+}
+
+func (c *collector) collectThreads(ch chan<- prometheus.Metric) {
+	threads, err := c.bpfExporter.CollectThreads()
+	if err != nil {
+		klog.V(1).Infof("failed to collect the eBPF thread metrics: %v", err)
+		return
+	}
+	for i := range threads {
+		t := &threads[i]
+		labels := []string{strconv.FormatUint(t.Tgid, 10), strconv.FormatUint(t.Tid, 10), t.Comm}
+		// the on-CPU time is in microseconds
+		ch <- c.collectors["thread_cpu_seconds_total"].MustMetric(float64(t.ProcessRunTime)/1e6, labels...)
+		ch <- c.collectors["thread_cpu_cycles_total"].MustMetric(float64(t.CpuCycles), labels...)
+		ch <- c.collectors["thread_cpu_instructions_total"].MustMetric(float64(t.CpuInstr), labels...)
+		ch <- c.collectors["thread_cache_misses_total"].MustMetric(float64(t.CacheMiss), labels...)
+	}
+}
+
+// sliceBucketBounds are the upper bounds in seconds of the log2 buckets of the slice histograms, the last bucket is
+// only counted in +Inf
+var sliceBucketBounds = func() []float64 {
+	bounds := make([]float64, bpf.SliceBuckets-1)
+	for i := range bounds {
+		bounds[i] = float64(uint64(2)<<i) / 1e6
+	}
+	return bounds
+}()
+
+func (c *collector) collectSliceHistograms(ch chan<- prometheus.Metric) {
+	histograms, err := c.bpfExporter.CollectSliceHistograms()
+	if err != nil {
+		klog.V(1).Infof("failed to collect the eBPF slice histograms: %v", err)
+		return
+	}
+	for cgroupID := range histograms {
+		h := histograms[cgroupID]
+		count, buckets := sliceHistogramBuckets(&h)
+		ch <- prometheus.MustNewConstHistogram(c.sliceHistogram, count, float64(h.SumUs)/1e6, buckets, strconv.FormatUint(cgroupID, 10))
+	}
+}
+
+// sliceHistogramBuckets returns the total count and the cumulative counts by upper bound of a slice histogram
+func sliceHistogramBuckets(h *bpf.SliceHistogram) (count uint64, buckets map[float64]uint64) {
+	buckets = make(map[float64]uint64, len(sliceBucketBounds))
+	for i, n := range h.Buckets {
+		count += n
+		if i < len(sliceBucketBounds) {
+			buckets[sliceBucketBounds[i]] = count
+		}
+	}
+	return count, buckets
+}
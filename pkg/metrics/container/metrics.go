@@ -65,24 +65,24 @@ func (c *collector) initMetrics() {
 	}
 	for name, desc := range metricfactory.HCMetricsPromDesc(context, c.bpfSupportedMetrics) {
 		c.descriptions[name] = desc
-		c.collectors[name] = metricfactory.NewPromCounter(desc)
+		c.collectors[name] = metricfactory.NewCachedPromCounter(desc)
 	}
 	for name, desc := range metricfactory.SCMetricsPromDesc(context, c.bpfSupportedMetrics) {
 		c.descriptions[name] = desc
-		c.collectors[name] = metricfactory.NewPromCounter(desc)
+		c.collectors[name] = metricfactory.NewCachedPromCounter(desc)
 	}
 	for name, desc := range metricfactory.EnergyMetricsPromDesc(context) {
 		c.descriptions[name] = desc
-		c.collectors[name] = metricfactory.NewPromCounter(desc)
+		c.collectors[name] = metricfactory.NewCachedPromCounter(desc)
 	}
 	for name, desc := range metricfactory.GPUUsageMetricsPromDesc(context) {
 		c.descriptions[name] = desc
-		c.collectors[name] = metricfactory.NewPromCounter(desc)
+		c.collectors[name] = metricfactory.NewCachedPromCounter(desc)
 	}
 
 	desc := metricfactory.MetricsPromDesc(context, "joules", "_total", "", consts.ContainerEnergyLabels)
 	c.descriptions["total"] = desc
-	c.collectors["total"] = metricfactory.NewPromCounter(desc)
+	c.collectors["total"] = metricfactory.NewCachedPromCounter(desc)
 }
 
 func (c *collector) Describe(ch chan<- *prometheus.Desc) {
@@ -99,5 +99,6 @@ func (c *collector) Collect(ch chan<- prometheus.Metric) {
 		// update container total joules
 		utils.CollectTotalEnergyMetrics(ch, container, c.collectors)
 	}
+	metricfactory.Sweep(c.collectors)
 	c.Mx.Unlock()
 }
@@ -0,0 +1,106 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package metricfactory
+
+import (
+	"hash/maphash"
+	"slices"
+
+	"github.com/prometheus/client_golang/prometheus"
+	"github.com/sustainable-computing-io/kepler/pkg/config"
+)
+
+// cachedSeries is the last const metric built for the label values of a series
+type cachedSeries struct {
+	labelValues []string
+	value       float64
+	metric      prometheus.Metric
+}
+
+// cachedPromCounter keeps the const metric of each series between two collections, and only builds a new one for
+// the series whose value changed or that were created. The series that are not collected again are dropped by Sweep.
+// It is not safe for concurrent collections.
+type cachedPromCounter struct {
+	desc *prometheus.Desc
+	seed maphash.Seed
+	// the series of the current and of the previous collection, by hash of their label values
+	curr, prev map[uint64]*cachedSeries
+}
+
+// NewCachedPromCounter returns a counter that caches the metrics of its series when the incremental exposition is
+// enabled, or a plain counter otherwise. Its collector must call Sweep at the end of each collection.
+func NewCachedPromCounter(desc *prometheus.Desc) PromMetric {
+	if !config.IsIncrementalMetricsEnabled() {
+		return NewPromCounter(desc)
+	}
+	return &cachedPromCounter{
+		desc: desc,
+		seed: maphash.MakeSeed(),
+		curr: make(map[uint64]*cachedSeries),
+		prev: make(map[uint64]*cachedSeries),
+	}
+}
+
+func (c *cachedPromCounter) Desc() *prometheus.Desc {
+	return c.desc
+}
+
+func (c *cachedPromCounter) MustMetric(value float64, labelValues ...string) prometheus.Metric {
+	var h maphash.Hash
+	h.SetSeed(c.seed)
+	for _, v := range labelValues {
+		h.WriteString(v)
+		h.WriteByte(0xff)
+	}
+	key := h.Sum64()
+
+	s, found := c.prev[key]
+	if !found {
+		s, found = c.curr[key]
+	}
+	if found && slices.Equal(s.labelValues, labelValues) {
+		if s.value != value {
+			s.value = value
+			s.metric = prometheus.MustNewConstMetric(c.desc, prometheus.CounterValue, value, labelValues...)
+		}
+	} else {
+		s = &cachedSeries{
+			labelValues: append([]string(nil), labelValues...),
+			value:       value,
+			metric:      prometheus.MustNewConstMetric(c.desc, prometheus.CounterValue, value, labelValues...),
+		}
+	}
+	delete(c.prev, key)
+	c.curr[key] = s
+	return s.metric
+}
+
+// sweep drops the series that were not collected since the last sweep
+func (c *cachedPromCounter) sweep() {
+	clear(c.prev)
+	c.prev, c.curr = c.curr, c.prev
+}
+
+// Sweep ends a collection of the metrics, dropping from the caches the series that were not collected again, e.g.
+// of the terminated processes
+func Sweep(collectors map[string]PromMetric) {
+	for _, collector := range collectors {
+		if c, ok := collector.(*cachedPromCounter); ok {
+			c.sweep()
+		}
+	}
+}
@@ -0,0 +1,79 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package metricfactory
+
+import (
+	"hash/maphash"
+	"testing"
+
+	"github.com/prometheus/client_golang/prometheus"
+	dto "github.com/prometheus/client_model/go"
+)
+
+func newTestCachedPromCounter() *cachedPromCounter {
+	return &cachedPromCounter{
+		desc: prometheus.NewDesc("kepler_test_joules_total", "test", []string{"pid", "mode"}, nil),
+		seed: maphash.MakeSeed(),
+		curr: make(map[uint64]*cachedSeries),
+		prev: make(map[uint64]*cachedSeries),
+	}
+}
+
+func counterValue(t *testing.T, m prometheus.Metric) float64 {
+	t.Helper()
+	var out dto.Metric
+	if err := m.Write(&out); err != nil {
+		t.Fatal(err)
+	}
+	return out.GetCounter().GetValue()
+}
+
+func TestCachedPromCounter_ReusesUnchangedSeries(t *testing.T) {
+	c := newTestCachedPromCounter()
+	first := c.MustMetric(1, "42", "dynamic")
+	other := c.MustMetric(2, "43", "dynamic")
+	Sweep(map[string]PromMetric{"total": c})
+
+	if m := c.MustMetric(1, "42", "dynamic"); m != first {
+		t.Error("expected the metric of an unchanged series to be reused")
+	}
+	changed := c.MustMetric(3, "43", "dynamic")
+	if changed == other {
+		t.Error("expected a new metric for a changed series")
+	}
+	if v := counterValue(t, changed); v != 3 {
+		t.Errorf("expected the changed series to be 3, got %v", v)
+	}
+}
+
+func TestCachedPromCounter_DropsRemovedSeries(t *testing.T) {
+	c := newTestCachedPromCounter()
+	c.MustMetric(1, "42", "dynamic")
+	c.MustMetric(2, "43", "dynamic")
+	Sweep(map[string]PromMetric{"total": c})
+
+	c.MustMetric(1, "42", "dynamic")
+	Sweep(map[string]PromMetric{"total": c})
+	if len(c.prev) != 1 {
+		t.Errorf("expected only the collected series to be cached, got %d series", len(c.prev))
+	}
+
+	// a series that comes back is created again
+	if v := counterValue(t, c.MustMetric(5, "43", "dynamic")); v != 5 {
+		t.Errorf("expected the recreated series to be 5, got %v", v)
+	}
+}
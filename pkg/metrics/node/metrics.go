@@ -59,7 +59,7 @@ func (c *collector) initMetrics() {
 	// node exports different resource utilization metrics than process, container and vm
 	for name, desc := range metricfactory.EnergyMetricsPromDesc(context) {
 		c.descriptions[name] = desc
-		c.collectors[name] = metricfactory.NewPromCounter(desc)
+		c.collectors[name] = metricfactory.NewCachedPromCounter(desc)
 	}
 
 	// TODO: prometheus metric should be "node_info"
@@ -81,6 +81,7 @@ func (c *collector) Collect(ch chan<- prometheus.Metric) {
 	utils.CollectEnergyMetrics(ch, c.NodeStats, c.collectors)
 	// we export different node resource utilization metrics than process, container and vms
 	// TODO: verify if the resource utilization metrics are needed
+	metricfactory.Sweep(c.collectors)
 	c.Mx.Unlock()
 
 	// update node info
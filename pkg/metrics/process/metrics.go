@@ -65,23 +65,23 @@ func (c *collector) initMetrics() {
 	}
 	for name, desc := range metricfactory.HCMetricsPromDesc(context, c.bpfSupportedMetrics) {
 		c.descriptions[name] = desc
-		c.collectors[name] = metricfactory.NewPromCounter(desc)
+		c.collectors[name] = metricfactory.NewCachedPromCounter(desc)
 	}
 	for name, desc := range metricfactory.SCMetricsPromDesc(context, c.bpfSupportedMetrics) {
 		c.descriptions[name] = desc
-		c.collectors[name] = metricfactory.NewPromCounter(desc)
+		c.collectors[name] = metricfactory.NewCachedPromCounter(desc)
 	}
 	for name, desc := range metricfactory.EnergyMetricsPromDesc(context) {
 		c.descriptions[name] = desc
-		c.collectors[name] = metricfactory.NewPromCounter(desc)
+		c.collectors[name] = metricfactory.NewCachedPromCounter(desc)
 	}
 	for name, desc := range metricfactory.GPUUsageMetricsPromDesc(context) {
 		c.descriptions[name] = desc
-		c.collectors[name] = metricfactory.NewPromCounter(desc)
+		c.collectors[name] = metricfactory.NewCachedPromCounter(desc)
 	}
 	desc := metricfactory.MetricsPromDesc(context, "joules", "_total", "", consts.ProcessEnergyLabels)
 	c.descriptions["total"] = desc
-	c.collectors["total"] = metricfactory.NewPromCounter(desc)
+	c.collectors["total"] = metricfactory.NewCachedPromCounter(desc)
 }
 
 func (c *collector) Describe(ch chan<- *prometheus.Desc) {
@@ -97,5 +97,6 @@ func (c *collector) Collect(ch chan<- prometheus.Metric) {
 		utils.CollectResUtilizationMetrics(ch, process, c.collectors, c.bpfSupportedMetrics)
 		utils.CollectTotalEnergyMetrics(ch, process, c.collectors)
 	}
+	metricfactory.Sweep(c.collectors)
 	c.Mx.Unlock()
 }
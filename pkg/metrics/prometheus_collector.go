@@ -17,12 +17,16 @@ limitations under the License.
 package metrics
 
 import (
+	"net/http"
 	"sync"
+	"sync/atomic"
 
 	"github.com/prometheus/client_golang/prometheus"
+	"github.com/prometheus/client_golang/prometheus/promhttp"
 	"github.com/sustainable-computing-io/kepler/pkg/bpf"
 	"github.com/sustainable-computing-io/kepler/pkg/collector/stats"
 	"github.com/sustainable-computing-io/kepler/pkg/config"
+	bpfmetrics "github.com/sustainable-computing-io/kepler/pkg/metrics/bpf"
 	"github.com/sustainable-computing-io/kepler/pkg/metrics/container"
 	"github.com/sustainable-computing-io/kepler/pkg/metrics/node"
 	"github.com/sustainable-computing-io/kepler/pkg/metrics/process"
@@ -41,11 +45,18 @@ type PrometheusExporter struct {
 	ContainerStatsCollector prometheus.Collector
 	VMStatsCollector        prometheus.Collector
 	NodeStatsCollector      prometheus.Collector
+	BPFStatsCollector       prometheus.Collector
 
 	// Lock to synchronize the collector update with prometheus exporter
 	Mx sync.Mutex
 
 	bpfSupportedMetrics bpf.SupportedMetrics
+
+	// snapshots serve the registered stats collectors with the incremental exposition
+	snapshots []*snapshotCollector
+	// snapshotRegistry holds the snapshots, whose exposition is encoded once per refresh generation
+	snapshotRegistry *prometheus.Registry
+	generation       atomic.Uint64
 }
 
 // NewPrometheusExporter creates a new prometheus exporter
@@ -75,6 +86,12 @@ func (e *PrometheusExporter) NewNodeCollector(nodeMetrics *stats.NodeStats) {
 	e.NodeStatsCollector = node.NewNodeCollector(nodeMetrics, &e.Mx)
 }
 
+// NewBPFCollector creates a new prometheus collector for the self-overhead metrics, sample rates and CPU residencies of
+// the eBPF programs
+func (e *PrometheusExporter) NewBPFCollector(bpfExporter bpf.Exporter) {
+	e.BPFStatsCollector = bpfmetrics.NewBPFCollector(bpfExporter)
+}
+
 func GetRegistry() *prometheus.Registry {
 	registryOnce.Do(func() {
 		registry = prometheus.NewRegistry()
@@ -82,32 +99,82 @@ func GetRegistry() *prometheus.Registry {
 	return registry
 }
 
+// registerStatsCollector registers the collector of the metrics of the stats. With the incremental exposition, it is
+// served from a snapshot refreshed after each update and registered in the snapshot registry.
+func (e *PrometheusExporter) registerStatsCollector(r *prometheus.Registry, collector prometheus.Collector) {
+	if !config.IsIncrementalMetricsEnabled() {
+		r.MustRegister(collector)
+		return
+	}
+	if e.snapshotRegistry == nil {
+		e.snapshotRegistry = prometheus.NewRegistry()
+	}
+	snapshot := newSnapshotCollector(collector)
+	e.snapshots = append(e.snapshots, snapshot)
+	e.snapshotRegistry.MustRegister(snapshot)
+}
+
+// RefreshSnapshots publishes the metrics of the stats for the next scrapes with the incremental exposition. It must
+// be called after the update of the stats, without holding Mx.
+func (e *PrometheusExporter) RefreshSnapshots() {
+	for _, snapshot := range e.snapshots {
+		snapshot.refresh()
+	}
+	// the next scrape encodes the refreshed snapshots
+	e.generation.Add(1)
+}
+
+// MetricsHandler returns the handler of the scrapes of the registry returned by RegisterMetrics. With the incremental
+// exposition, the scrapes also serve the snapshots of the stats encoded once per refresh.
+func (e *PrometheusExporter) MetricsHandler(reg *prometheus.Registry) http.Handler {
+	if e.snapshotRegistry == nil {
+		return promhttp.HandlerFor(reg, promhttp.HandlerOpts{
+			Registry: reg,
+		})
+	}
+	return newSnapshotHandler(e.snapshotRegistry, reg, &e.generation)
+}
+
 func (e *PrometheusExporter) RegisterMetrics() *prometheus.Registry {
 	r := GetRegistry()
 
 	if config.IsExposeProcessStatsEnabled() {
-		r.MustRegister(e.ProcessStatsCollector)
+		e.registerStatsCollector(r, e.ProcessStatsCollector)
 		klog.Infoln("Registered Process Prometheus metrics")
 	}
 
 	if config.IsExposeContainerStatsEnabled() {
-		r.MustRegister(e.ContainerStatsCollector)
+		e.registerStatsCollector(r, e.ContainerStatsCollector)
 		klog.Infoln("Registered Container Prometheus metrics")
 	}
 
 	if config.IsExposeVMStatsEnabled() {
-		r.MustRegister(e.VMStatsCollector)
+		e.registerStatsCollector(r, e.VMStatsCollector)
 		klog.Infoln("Registered VM Prometheus metrics")
 	}
 
-	r.MustRegister(e.NodeStatsCollector)
+	e.registerStatsCollector(r, e.NodeStatsCollector)
 	klog.Infoln("Registered Node Prometheus metrics")
 
+	if (config.IsBPFProgStatsEnabled() || config.GetBPFSampleTarget() > 0 || config.IsBPFCPUPowerStateEnabled() ||
+		config.IsBPFThreadMetricsEnabled() || config.IsBPFSliceHistogramsEnabled()) && e.BPFStatsCollector != nil {
+		r.MustRegister(e.BPFStatsCollector)
+		klog.Infoln("Registered BPF Prometheus metrics")
+	}
+
+	// serve the node info before the first update
+	e.RefreshSnapshots()
+
 	// log prometheus errors
 	_, err := r.Gather()
 	if err != nil {
 		klog.Errorln(err)
 	}
+	if e.snapshotRegistry != nil {
+		if _, err := e.snapshotRegistry.Gather(); err != nil {
+			klog.Errorln(err)
+		}
+	}
 
 	return r
 }
@@ -0,0 +1,65 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package metrics
+
+import (
+	"sync/atomic"
+
+	"github.com/prometheus/client_golang/prometheus"
+)
+
+// snapshotCollector serves the scrapes of a stats collector from the metrics it collected after the last update, so
+// that a scrape neither takes the lock of the stats nor blocks Collector.Update
+type snapshotCollector struct {
+	collector prometheus.Collector
+	// the metrics of the last refresh, never modified once published
+	metrics atomic.Pointer[[]prometheus.Metric]
+}
+
+func newSnapshotCollector(collector prometheus.Collector) *snapshotCollector {
+	return &snapshotCollector{collector: collector}
+}
+
+func (c *snapshotCollector) Describe(ch chan<- *prometheus.Desc) {
+	c.collector.Describe(ch)
+}
+
+func (c *snapshotCollector) Collect(ch chan<- prometheus.Metric) {
+	if metrics := c.metrics.Load(); metrics != nil {
+		for _, metric := range *metrics {
+			ch <- metric
+		}
+	}
+}
+
+// refresh collects the metrics of the stats collector and publishes them for the next scrapes
+func (c *snapshotCollector) refresh() {
+	size := 0
+	if prev := c.metrics.Load(); prev != nil {
+		size = len(*prev)
+	}
+	metrics := make([]prometheus.Metric, 0, size)
+	ch := make(chan prometheus.Metric, 1024)
+	go func() {
+		c.collector.Collect(ch)
+		close(ch)
+	}()
+	for metric := range ch {
+		metrics = append(metrics, metric)
+	}
+	c.metrics.Store(&metrics)
+}
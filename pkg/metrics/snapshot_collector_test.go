@@ -0,0 +1,143 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package metrics
+
+import (
+	"net/http"
+	"net/http/httptest"
+	"strings"
+	"sync/atomic"
+	"testing"
+
+	"github.com/prometheus/client_golang/prometheus"
+	dto "github.com/prometheus/client_model/go"
+)
+
+// constCollector collects its value as a const metric, as the stats collectors do
+type constCollector struct {
+	desc  *prometheus.Desc
+	value float64
+}
+
+func (c *constCollector) Describe(ch chan<- *prometheus.Desc) {
+	ch <- c.desc
+}
+
+func (c *constCollector) Collect(ch chan<- prometheus.Metric) {
+	ch <- prometheus.MustNewConstMetric(c.desc, prometheus.GaugeValue, c.value)
+}
+
+// collectValues returns the gauge values collected from c
+func collectValues(t *testing.T, c prometheus.Collector) []float64 {
+	t.Helper()
+	ch := make(chan prometheus.Metric, 16)
+	c.Collect(ch)
+	close(ch)
+	var values []float64
+	for m := range ch {
+		var out dto.Metric
+		if err := m.Write(&out); err != nil {
+			t.Fatal(err)
+		}
+		values = append(values, out.GetGauge().GetValue())
+	}
+	return values
+}
+
+func TestSnapshotCollector_ServesLastRefresh(t *testing.T) {
+	stats := &constCollector{desc: prometheus.NewDesc("kepler_test_value", "test", nil, nil)}
+	c := newSnapshotCollector(stats)
+
+	if values := collectValues(t, c); len(values) != 0 {
+		t.Errorf("expected no metric before the first refresh, got %v", values)
+	}
+
+	stats.value = 1
+	c.refresh()
+	stats.value = 2
+	if values := collectValues(t, c); len(values) != 1 || values[0] != 1 {
+		t.Errorf("expected the value of the last refresh, got %v", values)
+	}
+
+	c.refresh()
+	if values := collectValues(t, c); len(values) != 1 || values[0] != 2 {
+		t.Errorf("expected the refreshed value, got %v", values)
+	}
+}
+
+// countingCollector counts the collections of its collector
+type countingCollector struct {
+	prometheus.Collector
+	collects int
+}
+
+func (c *countingCollector) Collect(ch chan<- prometheus.Metric) {
+	c.collects++
+	c.Collector.Collect(ch)
+}
+
+// scrape returns the text exposition served by h
+func scrape(t *testing.T, h http.Handler) string {
+	t.Helper()
+	rec := httptest.NewRecorder()
+	h.ServeHTTP(rec, httptest.NewRequest(http.MethodGet, "/metrics", http.NoBody))
+	if rec.Code != http.StatusOK {
+		t.Fatalf("unexpected status %d: %s", rec.Code, rec.Body.String())
+	}
+	return rec.Body.String()
+}
+
+func TestSnapshotHandler_EncodesOncePerRefresh(t *testing.T) {
+	stats := &constCollector{desc: prometheus.NewDesc("kepler_test_value", "test", nil, nil), value: 1}
+	snapshot := newSnapshotCollector(stats)
+	counting := &countingCollector{Collector: snapshot}
+	snapshots := prometheus.NewRegistry()
+	snapshots.MustRegister(counting)
+	live := &constCollector{desc: prometheus.NewDesc("kepler_test_live", "test", nil, nil), value: 1}
+	reg := prometheus.NewRegistry()
+	reg.MustRegister(live)
+	var generation atomic.Uint64
+	h := newSnapshotHandler(snapshots, reg, &generation)
+
+	snapshot.refresh()
+	generation.Add(1)
+	body := scrape(t, h)
+	if !strings.Contains(body, "kepler_test_value 1") || !strings.Contains(body, "kepler_test_live 1") {
+		t.Errorf("expected the snapshot and the live metrics, got %q", body)
+	}
+
+	// the live metrics are gathered at each scrape, the snapshot is served from its encoding
+	live.value = 2
+	body = scrape(t, h)
+	if !strings.Contains(body, "kepler_test_value 1") || !strings.Contains(body, "kepler_test_live 2") {
+		t.Errorf("expected the encoded snapshot and the new live metrics, got %q", body)
+	}
+	if counting.collects != 1 {
+		t.Errorf("expected the snapshot to be gathered once, got %d", counting.collects)
+	}
+
+	stats.value = 3
+	snapshot.refresh()
+	generation.Add(1)
+	body = scrape(t, h)
+	if !strings.Contains(body, "kepler_test_value 3") {
+		t.Errorf("expected the refreshed snapshot, got %q", body)
+	}
+	if counting.collects != 2 {
+		t.Errorf("expected the snapshot to be gathered once per refresh, got %d", counting.collects)
+	}
+}
@@ -0,0 +1,125 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package metrics
+
+import (
+	"bytes"
+	"compress/gzip"
+	"io"
+	"net/http"
+	"strings"
+	"sync"
+	"sync/atomic"
+
+	"github.com/prometheus/client_golang/prometheus"
+	"github.com/prometheus/common/expfmt"
+	"k8s.io/klog/v2"
+)
+
+// snapshotHandler serves the scrapes with the exposition of the snapshots, encoded once per refresh generation and
+// format, followed by the metrics of the other collectors gathered at each scrape
+type snapshotHandler struct {
+	snapshots  prometheus.Gatherer
+	live       prometheus.Gatherer
+	generation *atomic.Uint64
+
+	mu sync.Mutex
+	// the generation of the encoded bodies, which are dropped when a refresh bumps it
+	encodedGeneration uint64
+	encoded           map[expfmt.Format][]byte
+}
+
+func newSnapshotHandler(snapshots, live prometheus.Gatherer, generation *atomic.Uint64) *snapshotHandler {
+	return &snapshotHandler{
+		snapshots:  snapshots,
+		live:       live,
+		generation: generation,
+		encoded:    map[expfmt.Format][]byte{},
+	}
+}
+
+func (h *snapshotHandler) ServeHTTP(w http.ResponseWriter, req *http.Request) {
+	format := expfmt.Negotiate(req.Header)
+	snapshot, err := h.encode(format)
+	if err != nil {
+		http.Error(w, "An error has occurred while serving metrics:\n\n"+err.Error(), http.StatusInternalServerError)
+		return
+	}
+	families, err := h.live.Gather()
+	if err != nil {
+		http.Error(w, "An error has occurred while serving metrics:\n\n"+err.Error(), http.StatusInternalServerError)
+		return
+	}
+
+	w.Header().Set("Content-Type", string(format))
+	var out io.Writer = w
+	if acceptsGzip(req.Header) {
+		w.Header().Set("Content-Encoding", "gzip")
+		gz := gzip.NewWriter(w)
+		defer gz.Close()
+		out = gz
+	}
+	if _, err := out.Write(snapshot); err != nil {
+		klog.V(3).Infof("failed to write the metrics: %v", err)
+		return
+	}
+	enc := expfmt.NewEncoder(out, format)
+	for _, family := range families {
+		if err := enc.Encode(family); err != nil {
+			klog.V(3).Infof("failed to encode the metric family %s: %v", family.GetName(), err)
+			return
+		}
+	}
+}
+
+// encode returns the exposition of the snapshots in the format, encoding it only on the first scrape of a refresh
+// generation
+func (h *snapshotHandler) encode(format expfmt.Format) ([]byte, error) {
+	generation := h.generation.Load()
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	if h.encodedGeneration != generation {
+		h.encodedGeneration = generation
+		clear(h.encoded)
+	}
+	if body, found := h.encoded[format]; found {
+		return body, nil
+	}
+	families, err := h.snapshots.Gather()
+	if err != nil {
+		return nil, err
+	}
+	var buf bytes.Buffer
+	enc := expfmt.NewEncoder(&buf, format)
+	for _, family := range families {
+		if err := enc.Encode(family); err != nil {
+			return nil, err
+		}
+	}
+	h.encoded[format] = buf.Bytes()
+	return buf.Bytes(), nil
+}
+
+// acceptsGzip returns true if the scraper accepts a gzip encoded response
+func acceptsGzip(header http.Header) bool {
+	for _, encoding := range strings.Split(header.Get("Accept-Encoding"), ",") {
+		if strings.HasPrefix(strings.TrimSpace(encoding), "gzip") {
+			return true
+		}
+	}
+	return false
+}
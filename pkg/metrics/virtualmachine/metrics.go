@@ -64,15 +64,15 @@ func (c *collector) initMetrics() {
 	}
 	for name, desc := range metricfactory.HCMetricsPromDesc(context, c.bpfSupportedMetrics) {
 		c.descriptions[name] = desc
-		c.collectors[name] = metricfactory.NewPromCounter(desc)
+		c.collectors[name] = metricfactory.NewCachedPromCounter(desc)
 	}
 	for name, desc := range metricfactory.SCMetricsPromDesc(context, c.bpfSupportedMetrics) {
 		c.descriptions[name] = desc
-		c.collectors[name] = metricfactory.NewPromCounter(desc)
+		c.collectors[name] = metricfactory.NewCachedPromCounter(desc)
 	}
 	for name, desc := range metricfactory.EnergyMetricsPromDesc(context) {
 		c.descriptions[name] = desc
-		c.collectors[name] = metricfactory.NewPromCounter(desc)
+		c.collectors[name] = metricfactory.NewCachedPromCounter(desc)
 	}
 }
 
@@ -88,5 +88,6 @@ func (c *collector) Collect(ch chan<- prometheus.Metric) {
 		utils.CollectEnergyMetrics(ch, vm, c.collectors)
 		utils.CollectResUtilizationMetrics(ch, vm, c.collectors, c.bpfSupportedMetrics)
 	}
+	metricfactory.Sweep(c.collectors)
 	c.Mx.Unlock()
 }
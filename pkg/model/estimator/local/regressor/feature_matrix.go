@@ -0,0 +1,71 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package regressor
+
+// featureMatrix stores the feature values of the samples (process/pod/node) in one row-major slice, so that the
+// predictors evaluate all samples in a single pass. The backing slice is kept across intervals and only grows.
+type featureMatrix struct {
+	values []float64
+	cols   int
+	rows   int
+}
+
+// reset empties the matrix and sets the number of features of its rows
+func (m *featureMatrix) reset(cols int) {
+	m.cols = cols
+	m.rows = 0
+}
+
+// addRow appends a sample, truncated or zero-padded to the number of features
+func (m *featureMatrix) addRow(x []float64) {
+	row := m.grow(m.rows + 1)[m.rows*m.cols:]
+	n := copy(row, x)
+	clear(row[n:])
+	m.rows++
+}
+
+// zeros sets the matrix to rows samples of cols zero features
+func (m *featureMatrix) zeros(rows, cols int) {
+	m.cols = cols
+	clear(m.grow(rows))
+	m.rows = rows
+}
+
+// row returns the features of the i-th sample
+func (m *featureMatrix) row(i int) []float64 {
+	return m.values[i*m.cols : (i+1)*m.cols]
+}
+
+// grow makes room for rows samples and returns their values
+func (m *featureMatrix) grow(rows int) []float64 {
+	size := rows * m.cols
+	if size > cap(m.values) {
+		values := make([]float64, size, 2*size)
+		copy(values, m.values)
+		m.values = values
+	}
+	m.values = m.values[:size]
+	return m.values
+}
+
+// resizePowers returns a slice of n powers, reusing the memory of powers when it is large enough
+func resizePowers(powers []float64, n int) []float64 {
+	if cap(powers) < n {
+		return make([]float64, n)
+	}
+	return powers[:n]
+}
@@ -0,0 +1,87 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package regressor
+
+import (
+	"testing"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+var _ = Describe("Test Feature Matrix", func() {
+	It("Pads and truncates the rows to the number of features", func() {
+		var m featureMatrix
+		m.reset(2)
+		m.addRow([]float64{1})
+		m.addRow([]float64{2, 3, 4})
+		Expect(m.rows).To(Equal(2))
+		Expect(m.row(0)).To(Equal([]float64{1, 0}))
+		Expect(m.row(1)).To(Equal([]float64{2, 3}))
+	})
+
+	It("Reuses its memory across intervals", func() {
+		var m featureMatrix
+		m.reset(2)
+		m.addRow([]float64{1, 2})
+		m.addRow([]float64{3, 4})
+		values := &m.values[0]
+
+		m.reset(2)
+		m.addRow([]float64{5})
+		Expect(m.rows).To(Equal(1))
+		Expect(m.row(0)).To(Equal([]float64{5, 0}))
+		Expect(&m.values[0]).To(BeIdenticalTo(values))
+	})
+
+	It("Predicts every sample of the matrix in one pass", func() {
+		p := &LinearPredictor{ModelWeights: ModelWeights{AllWeights{
+			BiasWeight: 1,
+			NumericalVariables: map[string]NormalizedNumericalFeature{
+				"a": {Scale: 2, Weight: 1},
+				"b": {Scale: 0, Weight: 5},
+			},
+		}}}
+		var m featureMatrix
+		m.reset(2)
+		m.addRow([]float64{2, 7})
+		m.addRow([]float64{4, 7})
+		powers := p.predict([]string{"a", "b"}, &m, nil, nil, nil)
+		Expect(powers).To(Equal([]float64{2, 3}))
+		Expect(&p.predict([]string{"a", "b"}, &m, nil, nil, powers)[0]).To(BeIdenticalTo(&powers[0]))
+	})
+})
+
+func BenchmarkLinearPredict(b *testing.B) {
+	names := []string{"bpf_cpu_time_ms", "cpu_cycles", "cpu_instructions", "cache_miss"}
+	weights := ModelWeights{AllWeights{BiasWeight: 1, NumericalVariables: map[string]NormalizedNumericalFeature{}}}
+	for _, name := range names {
+		weights.AllWeights.NumericalVariables[name] = NormalizedNumericalFeature{Scale: 2, Weight: 0.5}
+	}
+	p := &LinearPredictor{ModelWeights: weights}
+	var m featureMatrix
+	var powers []float64
+	row := []float64{1, 2, 3, 4}
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		m.reset(len(names))
+		for j := 0; j < 10000; j++ {
+			m.addRow(row)
+		}
+		powers = p.predict(names, &m, nil, nil, powers)
+	}
+}
@@ -43,22 +43,17 @@ func (p *LinearPredictor) name() string {
 	return "linear"
 }
 
-func (p *LinearPredictor) predict(usageMetricNames []string, usageMetricValues [][]float64, systemMetaDataFeatureNames, systemMetaDataFeatureValues []string) []float64 {
-	categoricalX, numericalX, numericalWeights := p.ModelWeights.getX(usageMetricNames, usageMetricValues, systemMetaDataFeatureNames, systemMetaDataFeatureValues)
-	basePower := p.ModelWeights.AllWeights.BiasWeight
-	for _, val := range categoricalX {
-		basePower += val
-	}
-	var powers []float64
-	for _, x := range numericalX {
+func (p *LinearPredictor) predict(usageMetricNames []string, usageMetricValues *featureMatrix, systemMetaDataFeatureNames, systemMetaDataFeatureValues []string, powers []float64) []float64 {
+	basePower := p.ModelWeights.AllWeights.BiasWeight + p.ModelWeights.getCategoricalWeight(systemMetaDataFeatureNames, systemMetaDataFeatureValues)
+	normalizedWeights := p.ModelWeights.getNormalizedWeights(usageMetricNames)
+	powers = resizePowers(powers, usageMetricValues.rows)
+	for i := range powers {
+		x := usageMetricValues.row(i)[:len(normalizedWeights)]
 		power := basePower
-		for i, coeff := range numericalWeights {
-			if coeff.Weight == 0 {
-				continue
-			}
-			power += coeff.Weight * x[i]
+		for j, weight := range normalizedWeights {
+			power += weight * x[j]
 		}
-		powers = append(powers, power)
+		powers[i] = power
 	}
 	return powers
 }
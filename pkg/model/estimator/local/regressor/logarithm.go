@@ -37,21 +37,18 @@ func (LogarithmicPredictor) name() string {
 	return "logarithmic"
 }
 
-func (p *LogarithmicPredictor) predict(usageMetricNames []string, usageMetricValues [][]float64, systemMetaDataFeatureNames, systemMetaDataFeatureValues []string) []float64 {
-	categoricalX, numericalX, _ := p.ModelWeights.getX(usageMetricNames, usageMetricValues, systemMetaDataFeatureNames, systemMetaDataFeatureValues)
-	var basePower float64
+func (p *LogarithmicPredictor) predict(usageMetricNames []string, usageMetricValues *featureMatrix, systemMetaDataFeatureNames, systemMetaDataFeatureValues []string, powers []float64) []float64 {
 	// TODO: update categoricalX transform (current no categorical value trained)
-	for _, val := range categoricalX {
-		basePower += val
-	}
-	var powers []float64
+	basePower := p.ModelWeights.getCategoricalWeight(systemMetaDataFeatureNames, systemMetaDataFeatureValues)
+	scale := p.ModelWeights.getCurveFitScale(usageMetricNames)
 	a := p.ModelWeights.CurveFitWeights[0]
 	b := p.ModelWeights.CurveFitWeights[1]
 	c := p.ModelWeights.CurveFitWeights[2]
-	for _, x := range numericalX {
+	powers = resizePowers(powers, usageMetricValues.rows)
+	for i := range powers {
 		// note: curvefit use only index 0 feature
-		power := basePower + a*math.Log(b*x[0]+1) + c
-		powers = append(powers, power)
+		x := curveFitX(usageMetricValues.row(i), scale)
+		powers[i] = basePower + a*math.Log(b*x+1) + c
 	}
 	return powers
 }
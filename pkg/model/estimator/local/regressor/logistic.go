@@ -37,22 +37,19 @@ func (LogisticPredictor) name() string {
 	return "logistic"
 }
 
-func (p *LogisticPredictor) predict(usageMetricNames []string, usageMetricValues [][]float64, systemMetaDataFeatureNames, systemMetaDataFeatureValues []string) []float64 {
-	categoricalX, numericalX, _ := p.ModelWeights.getX(usageMetricNames, usageMetricValues, systemMetaDataFeatureNames, systemMetaDataFeatureValues)
-	var basePower float64
+func (p *LogisticPredictor) predict(usageMetricNames []string, usageMetricValues *featureMatrix, systemMetaDataFeatureNames, systemMetaDataFeatureValues []string, powers []float64) []float64 {
 	// TODO: update categoricalX transform (current no categorical value trained)
-	for _, val := range categoricalX {
-		basePower += val
-	}
-	var powers []float64
+	basePower := p.ModelWeights.getCategoricalWeight(systemMetaDataFeatureNames, systemMetaDataFeatureValues)
+	scale := p.ModelWeights.getCurveFitScale(usageMetricNames)
 	A := p.ModelWeights.CurveFitWeights[0]
 	x0 := p.ModelWeights.CurveFitWeights[1]
 	k := p.ModelWeights.CurveFitWeights[2]
 	off := p.ModelWeights.CurveFitWeights[3]
-	for _, x := range numericalX {
+	powers = resizePowers(powers, usageMetricValues.rows)
+	for i := range powers {
 		// note: curvefit use only index 0 feature
-		power := basePower + A/(1+math.Exp(-k*(x[0]-x0))) + off
-		powers = append(powers, power)
+		x := curveFitX(usageMetricValues.row(i), scale)
+		powers[i] = basePower + A/(1+math.Exp(-k*(x-x0))) + off
 	}
 	return powers
 }
@@ -54,35 +54,43 @@ type ModelWeights struct {
 	AllWeights `json:"All_Weights"`
 }
 
-// getIndexedWeights maps weight index with usageMetrics
-func (weights ModelWeights) getIndexedWeights(usageMetrics, systemFeatures []string) (categoricalWeights []map[string]CategoricalFeature, numericalWeights []NormalizedNumericalFeature) {
-	w := weights.AllWeights
-	for _, m := range systemFeatures {
-		categoricalWeights = append(categoricalWeights, w.CategoricalVariables[m])
+// getCategoricalWeight returns the sum of the weights of the system metadata feature values
+func (weights ModelWeights) getCategoricalWeight(systemMetaDataFeatureNames, systemMetaDataFeatureValues []string) float64 {
+	var weight float64
+	for i, m := range systemMetaDataFeatureNames {
+		weight += weights.AllWeights.CategoricalVariables[m][systemMetaDataFeatureValues[i]].Weight
 	}
-	for _, m := range usageMetrics {
-		numericalWeights = append(numericalWeights, w.NumericalVariables[m])
+	return weight
+}
+
+// getNormalizedWeights returns the weight of each usage metric divided by its scale, so that the linear term of a
+// sample is the dot product with its raw values. Metrics without scale or weight are ignored and get 0.
+func (weights ModelWeights) getNormalizedWeights(usageMetricNames []string) []float64 {
+	normalizedWeights := make([]float64, len(usageMetricNames))
+	for i, m := range usageMetricNames {
+		coeff := weights.AllWeights.NumericalVariables[m]
+		if coeff.Scale == 0 {
+			continue
+		}
+		normalizedWeights[i] = coeff.Weight / coeff.Scale
 	}
-	return
+	return normalizedWeights
 }
 
-func (weights ModelWeights) getX(usageMetricNames []string, usageMetricValues [][]float64, systemMetaDataFeatureNames, systemMetaDataFeatureValues []string) (categoricalX []float64, numericalX [][]float64, numericalWeights []NormalizedNumericalFeature) {
-	categoricalWeights, numericalWeights := weights.getIndexedWeights(usageMetricNames, systemMetaDataFeatureNames)
-	categoricalX = make([]float64, len(categoricalWeights))
-	numericalX = make([][]float64, len(usageMetricValues))
-	for i, coeffMap := range categoricalWeights {
-		categoricalX[i] = coeffMap[systemMetaDataFeatureValues[i]].Weight
+// getCurveFitScale returns the scale of the first usage metric, the only one used by curvefit
+func (weights ModelWeights) getCurveFitScale(usageMetricNames []string) float64 {
+	if len(usageMetricNames) == 0 {
+		return 0
 	}
-	for i, vals := range usageMetricValues {
-		numericalX[i] = make([]float64, len(numericalWeights))
-		for j, coeff := range numericalWeights {
-			if coeff.Scale == 0 {
-				continue
-			}
-			numericalX[i][j] = vals[j] / coeff.Scale
-		}
+	return weights.AllWeights.NumericalVariables[usageMetricNames[0]].Scale
+}
+
+// curveFitX returns the normalized value of the first usage metric of a sample, or 0 when the metric has no scale
+func curveFitX(row []float64, scale float64) float64 {
+	if scale == 0 {
+		return 0
 	}
-	return categoricalX, numericalX, numericalWeights
+	return row[0] / scale
 }
 
 type AllWeights struct {
@@ -110,6 +118,19 @@ type ComponentModelWeights struct {
 	DRAM             *ModelWeights       `json:"dram,omitempty"`
 }
 
+// declares returns true if the numerical variables of any component weights include the metric
+func (w ComponentModelWeights) declares(metric string) bool {
+	for _, weights := range []*ModelWeights{w.Platform, w.Core, w.Uncore, w.Package, w.DRAM} {
+		if weights == nil {
+			continue
+		}
+		if _, found := weights.AllWeights.NumericalVariables[metric]; found {
+			return true
+		}
+	}
+	return false
+}
+
 func (w ComponentModelWeights) String() string {
 	if w.Platform != nil {
 		return fmt.Sprintf("%s (platform: %v)", w.ModelName, w.Platform)
@@ -47,7 +47,8 @@ type ModelRequest struct {
 // Predictor defines required implementation for power prediction
 type Predictor interface {
 	name() string
-	predict(usageMetricNames []string, usageMetricValues [][]float64, systemMetaDataFeatureNames, systemMetaDataFeatureValues []string) []float64
+	// predict returns the power of each sample of usageMetricValues, reusing the memory of powers when it is large enough
+	predict(usageMetricNames []string, usageMetricValues *featureMatrix, systemMetaDataFeatureNames, systemMetaDataFeatureValues []string, powers []float64) []float64
 }
 
 // Regressor defines power estimator with regression approach
@@ -61,15 +62,16 @@ type Regressor struct {
 	ModelWeightsFilepath string
 
 	FloatFeatureNames           []string
+	OptionalFeatureNames        []string // appended to FloatFeatureNames only if the loaded model weights declare them
 	SystemMetaDataFeatureNames  []string
 	SystemMetaDataFeatureValues []string
 
-	floatFeatureValues [][]float64 // metrics per process/process/pod/node
+	floatFeatureValues featureMatrix // metrics per process/process/pod/node
 	// idle power is calculated with the minimal resource utilization, which means that the system is at rest
-	// due to performance reasons, we keep a shadow copy of the floatFeatureValues with 1 values
-	floatFeatureValuesForIdlePower [][]float64 // metrics per process/process/pod/node
-	// xidx represents the instance slide window position, where an instance can be process/process/pod/node
-	xidx int
+	// due to performance reasons, we keep a zero matrix of the shape of floatFeatureValues
+	floatFeatureValuesForIdlePower featureMatrix
+	// compPowers holds the predicted powers of each component, reused across predictions
+	compPowers map[string][]float64
 
 	enabled               bool
 	modelWeight           *ComponentModelWeights
@@ -99,6 +101,7 @@ func (r *Regressor) Start() error {
 	if weight != nil {
 		r.enabled = true
 		r.modelWeight = weight
+		r.addDeclaredFeatureNames(weight)
 		r.modelPredictors = map[string]Predictor{}
 		if weight.Platform != nil {
 			if predictor, err := r.createPredictor(*weight.Platform); err != nil {
@@ -146,6 +149,19 @@ func (r *Regressor) Start() error {
 	return err
 }
 
+// addDeclaredFeatureNames appends the optional features that the model weights declare to the float features
+func (r *Regressor) addDeclaredFeatureNames(weight *ComponentModelWeights) {
+	featureNames := append([]string{}, r.FloatFeatureNames...)
+	for _, name := range r.OptionalFeatureNames {
+		if weight.declares(name) {
+			featureNames = append(featureNames, name)
+		} else {
+			klog.V(3).Infof("Regression Model (%s): skipping the feature %s, the model does not declare it", r.OutputType.String(), name)
+		}
+	}
+	r.FloatFeatureNames = featureNames
+}
+
 // getWeightFromServer tries getting weights for Kepler Model Server
 func (r *Regressor) getWeightFromServer() (*ComponentModelWeights, error) {
 	modelRequest := ModelRequest{
@@ -283,15 +299,9 @@ func (r *Regressor) GetPlatformPower(isIdlePower bool) ([]uint64, error) {
 		return []uint64{}, fmt.Errorf("disabled power model call: %s", r.OutputType.String())
 	}
 	if r.modelPredictors != nil {
-		floatFeatureValues := r.floatFeatureValues[0:r.xidx]
-		if isIdlePower {
-			floatFeatureValues = r.floatFeatureValuesForIdlePower[0:r.xidx]
-		}
 		if predictor, found := (r.modelPredictors)[config.PLATFORM]; found {
 			coreRatio := utils.GetCoreRatio(isIdlePower, r.coreRatio)
-			powers := predictor.predict(
-				r.FloatFeatureNames, floatFeatureValues,
-				r.SystemMetaDataFeatureNames, r.SystemMetaDataFeatureValues)
+			powers := r.predict(config.PLATFORM, predictor, isIdlePower)
 			return utils.GetPlatformPower(powers, coreRatio), nil
 		}
 		return []uint64{}, fmt.Errorf("model Weight for model type %s is not valid: %v", r.OutputType.String(), r.modelWeight)
@@ -308,30 +318,40 @@ func (r *Regressor) GetComponentsPower(isIdlePower bool) ([]source.NodeComponent
 		r.enabled = false
 		return []source.NodeComponentsEnergy{}, fmt.Errorf("model weight is not set")
 	}
-	compPowers := make(map[string][]float64)
 	for comp, predictor := range r.modelPredictors {
-		floatFeatureValues := r.floatFeatureValues[0:r.xidx]
-		if isIdlePower {
-			floatFeatureValues = r.floatFeatureValuesForIdlePower[0:r.xidx]
-		}
-		compPowers[comp] = predictor.predict(
-			r.FloatFeatureNames, floatFeatureValues,
-			r.SystemMetaDataFeatureNames, r.SystemMetaDataFeatureValues)
+		r.predict(comp, predictor, isIdlePower)
 	}
 	coreRatio := utils.GetCoreRatio(isIdlePower, r.coreRatio)
-	nodeComponentsPower := []source.NodeComponentsEnergy{}
-	num := r.xidx // number of processes
+	num := r.floatFeatureValues.rows // number of processes
+	nodeComponentsPower := make([]source.NodeComponentsEnergy, 0, num)
 	for index := 0; index < num; index++ {
-		pkgPower := utils.GetComponentPower(compPowers, config.PKG, index, coreRatio)
-		corePower := utils.GetComponentPower(compPowers, config.CORE, index, coreRatio)
-		uncorePower := utils.GetComponentPower(compPowers, config.UNCORE, index, coreRatio)
-		dramPower := utils.GetComponentPower(compPowers, config.DRAM, index, coreRatio)
+		pkgPower := utils.GetComponentPower(r.compPowers, config.PKG, index, coreRatio)
+		corePower := utils.GetComponentPower(r.compPowers, config.CORE, index, coreRatio)
+		uncorePower := utils.GetComponentPower(r.compPowers, config.UNCORE, index, coreRatio)
+		dramPower := utils.GetComponentPower(r.compPowers, config.DRAM, index, coreRatio)
 		nodeComponentsPower = append(nodeComponentsPower, utils.FillNodeComponentsPower(pkgPower, corePower, uncorePower, dramPower))
 	}
 
 	return nodeComponentsPower, nil
 }
 
+// predict evaluates the predictor of a component over all the samples added since the last ResetSampleIdx
+func (r *Regressor) predict(comp string, predictor Predictor, isIdlePower bool) []float64 {
+	featureValues := &r.floatFeatureValues
+	if isIdlePower {
+		r.floatFeatureValuesForIdlePower.zeros(featureValues.rows, featureValues.cols)
+		featureValues = &r.floatFeatureValuesForIdlePower
+	}
+	if r.compPowers == nil {
+		r.compPowers = make(map[string][]float64)
+	}
+	powers := predictor.predict(
+		r.FloatFeatureNames, featureValues,
+		r.SystemMetaDataFeatureNames, r.SystemMetaDataFeatureValues, r.compPowers[comp])
+	r.compPowers[comp] = powers
+	return powers
+}
+
 // updateCoreRatio sets coreRatio attribute as a ratio of the discovered number of cores over the cores of machine used for training a model
 func (r *Regressor) updateCoreRatio(mSpec *config.MachineSpec) {
 	if mSpec == nil || r.DiscoveredMachineSpec == nil {
@@ -349,26 +369,10 @@ func (r *Regressor) GetGPUPower(isIdlePower bool) ([]uint64, error) {
 }
 
 func (r *Regressor) addFloatFeatureValues(x []float64) {
-	for i, feature := range x {
-		// floatFeatureValues is a cyclic list, where we only append a new value if it is necessary.
-		if r.xidx < len(r.floatFeatureValues) {
-			if i < len(r.floatFeatureValues[r.xidx]) {
-				r.floatFeatureValues[r.xidx][i] = feature
-				// we don't need to add idle power since it is already set as 0
-			} else {
-				r.floatFeatureValues[r.xidx] = append(r.floatFeatureValues[r.xidx], feature)
-				r.floatFeatureValuesForIdlePower[r.xidx] = append(r.floatFeatureValuesForIdlePower[r.xidx], 0)
-			}
-		} else {
-			// add new process
-			r.floatFeatureValues = append(r.floatFeatureValues, []float64{})
-			r.floatFeatureValuesForIdlePower = append(r.floatFeatureValuesForIdlePower, []float64{})
-			// add feature of new process
-			r.floatFeatureValues[r.xidx] = append(r.floatFeatureValues[r.xidx], feature)
-			r.floatFeatureValuesForIdlePower[r.xidx] = append(r.floatFeatureValuesForIdlePower[r.xidx], 0)
-		}
+	if r.floatFeatureValues.rows == 0 {
+		r.floatFeatureValues.reset(len(r.FloatFeatureNames))
 	}
-	r.xidx += 1 // mode pointer to next process
+	r.floatFeatureValues.addRow(x)
 }
 
 // AddProcessFeatureValues adds the the x for prediction, which are the explanatory variables (or the independent variable) of regression.
@@ -392,7 +396,7 @@ func (r *Regressor) AddDesiredOutValue(y float64) {
 
 // ResetSampleIdx set the sample vector index to 0 to overwrite the old samples with new ones for training or prediction.
 func (r *Regressor) ResetSampleIdx() {
-	r.xidx = 0
+	r.floatFeatureValues.reset(len(r.FloatFeatureNames))
 }
 
 // Train triggers the regressiong fit after adding data points to create a new power model.
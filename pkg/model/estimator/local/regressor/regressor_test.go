@@ -289,6 +289,45 @@ var _ = Describe("Test Regressor Weight Unit (default trainer)", func() {
 		})
 	})
 
+	Context("with optional features", func() {
+		startWithOptionalFeatures := func(coreNumericalVars map[string]NormalizedNumericalFeature) Regressor {
+			testServer := httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+				weights := GenComponentModelWeights([]float64{})
+				weights.Core = genWeights(coreNumericalVars, []float64{})
+				err := json.NewEncoder(w).Encode(weights)
+				Expect(err).NotTo(HaveOccurred())
+			}))
+			DeferCleanup(testServer.Close)
+			modelWeightFilepath := config.GetDefaultPowerModelURL(types.AbsPower.String(), types.ComponentEnergySource)
+			r := genRegressor(types.AbsPower, types.ComponentEnergySource, testServer.URL, "", modelWeightFilepath, "")
+			r.OptionalFeatureNames = []string{config.CPUBusyTimeLabel, config.CPUIdleTimeLabel}
+			err := r.Start()
+			Expect(err).NotTo(HaveOccurred())
+			return r
+		}
+
+		It("Adds the optional features that the model declares", func() {
+			r := startWithOptionalFeatures(map[string]NormalizedNumericalFeature{
+				config.CPUCycle:         {Weight: 1.0, Scale: 2},
+				config.CPUBusyTimeLabel: {Weight: 1.0, Scale: 2},
+			})
+			Expect(r.GetNodeFeatureNamesList()).To(Equal(append(append([]string{}, processFeatureNames...), config.CPUBusyTimeLabel)))
+			Expect(processFeatureNames).To(HaveLen(3))
+
+			// the busy time is weighted after the process features: bias, cpu architecture, cycles and busy time add 1W each
+			r.ResetSampleIdx()
+			r.AddNodeFeatureValues([]float64{2, 0, 0, 2})
+			compPowers, err := r.GetComponentsPower(false)
+			Expect(err).NotTo(HaveOccurred())
+			Expect(compPowers[0].Core).Should(BeEquivalentTo(4000))
+		})
+
+		It("Skips the optional features that the model does not declare", func() {
+			r := startWithOptionalFeatures(SampleCoreNumericalVars)
+			Expect(r.GetNodeFeatureNamesList()).To(Equal(processFeatureNames))
+		})
+	})
+
 	Context("with core ratio", Ordered, func() {
 		DescribeTable("Test core ratio computation", func(discoveredCore, modelCores int, expectedCoreRatio float64) {
 			ModelCores = modelCores
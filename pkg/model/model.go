@@ -92,9 +92,10 @@ func createPowerModelEstimator(modelConfig *types.ModelConfig) (PowerModelInterf
 		return model, nil
 
 	case types.Regressor:
-		var featuresNames []string
+		var featuresNames, optionalFeatureNames []string
 		if modelConfig.IsNodePowerModel {
 			featuresNames = modelConfig.NodeFeatureNames
+			optionalFeatureNames = modelConfig.OptionalNodeFeatureNames
 		} else {
 			featuresNames = modelConfig.ProcessFeatureNames
 		}
@@ -111,6 +112,7 @@ func createPowerModelEstimator(modelConfig *types.ModelConfig) (PowerModelInterf
 			ModelWeightsURL:             modelConfig.InitModelURL,
 			ModelWeightsFilepath:        modelConfig.InitModelFilepath,
 			FloatFeatureNames:           featuresNames,
+			OptionalFeatureNames:        optionalFeatureNames,
 			SystemMetaDataFeatureNames:  modelConfig.SystemMetaDataFeatureNames,
 			SystemMetaDataFeatureValues: modelConfig.SystemMetaDataFeatureValues,
 			RequestMachineSpec:          config.GetMachineSpec(),
@@ -51,6 +51,9 @@ func CreateNodeComponentPowerEstimatorModel(nodeFeatureNames []string) {
 	var err error
 	if !components.IsSystemCollectionSupported() {
 		modelConfig := createNodeComponentPowerModelConfig(nodeFeatureNames)
+		// the CPU power states only describe the node, they are not process features, and only the models trained
+		// with them can weight them
+		modelConfig.OptionalNodeFeatureNames = stats.AvailableCPUPowerStateMetrics()
 		// init func for NodeComponentPower
 		nodeComponentPowerModel, err = createPowerModelEstimator(modelConfig)
 		if err == nil {
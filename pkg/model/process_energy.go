@@ -152,24 +152,37 @@ func UpdateProcessEnergy(processesMetrics map[uint64]*stats.ProcessStats, nodeMe
 }
 
 // addSamplesToPowerModels converts process's metrics to array to add the samples to the power model
+// The feature values are read over the collector workers and added to the models in the order of the returned IDs
 func addSamplesToPowerModels(processesMetrics map[uint64]*stats.ProcessStats, nodeMetrics *stats.NodeStats) []uint64 {
-	processIDList := []uint64{}
-	// Add process metrics
+	processIDList := make([]uint64, 0, len(processesMetrics))
+	processes := make([]*stats.ProcessStats, 0, len(processesMetrics))
 	for processID, c := range processesMetrics {
-		// add samples to estimate the platform power
+		processIDList = append(processIDList, processID)
+		processes = append(processes, c)
+	}
+
+	platformFeatureValues := make([][]float64, len(processes))
+	componentFeatureValues := make([][]float64, len(processes))
+	utils.ForEachShard(len(processes), config.GetCollectorWorkers(), func(_, start, end int) {
+		for i := start; i < end; i++ {
+			// add samples to estimate the platform power
+			if processPlatformPowerModel.IsEnabled() {
+				platformFeatureValues[i] = processes[i].ToEstimatorValues(processPlatformPowerModel.GetProcessFeatureNamesList(), true) // add process features with normalized values
+			}
+			// add samples to estimate the components (CPU and DRAM) power
+			if processComponentPowerModel.IsEnabled() {
+				componentFeatureValues[i] = processes[i].ToEstimatorValues(processComponentPowerModel.GetProcessFeatureNamesList(), true) // add node features with normalized values
+			}
+		}
+	})
+	// Add process metrics
+	for i := range processes {
 		if processPlatformPowerModel.IsEnabled() {
-			featureValues := c.ToEstimatorValues(processPlatformPowerModel.GetProcessFeatureNamesList(), true) // add process features with normalized values
-			processPlatformPowerModel.AddProcessFeatureValues(featureValues)
+			processPlatformPowerModel.AddProcessFeatureValues(platformFeatureValues[i])
 		}
-
-		// add samples to estimate the components (CPU and DRAM) power
 		if processComponentPowerModel.IsEnabled() {
-			// Add process metrics
-			featureValues := c.ToEstimatorValues(processComponentPowerModel.GetProcessFeatureNamesList(), true) // add node features with normalized values
-			processComponentPowerModel.AddProcessFeatureValues(featureValues)
+			processComponentPowerModel.AddProcessFeatureValues(componentFeatureValues[i])
 		}
-
-		processIDList = append(processIDList, processID)
 	}
 	// Add node metrics.
 	if processPlatformPowerModel.IsEnabled() {
@@ -217,77 +230,81 @@ func addEstimatedEnergy(processIDList []uint64, processesMetrics map[uint64]*sta
 		}
 	}
 
-	var energy uint64
-	for i, processID := range processIDList {
-		if errComp == nil {
-			// add PKG power consumption
-			// since Kepler collects metrics at intervals of SamplePeriodSec, which is greater than 1 second, it is necessary to calculate the energy consumption for the entire waiting period
-			energy = processComponentsPower[i].Pkg * config.SamplePeriodSec()
-			if isIdlePower {
-				processesMetrics[processID].EnergyUsage[config.IdleEnergyInPkg].SetDeltaStat(utils.GenericSocketID, energy)
-			} else {
-				processesMetrics[processID].EnergyUsage[config.DynEnergyInPkg].SetDeltaStat(utils.GenericSocketID, energy)
-			}
-
-			// add CORE power consumption
-			energy = processComponentsPower[i].Core * config.SamplePeriodSec()
-			if isIdlePower {
-				processesMetrics[processID].EnergyUsage[config.IdleEnergyInCore].SetDeltaStat(utils.GenericSocketID, energy)
-			} else {
-				processesMetrics[processID].EnergyUsage[config.DynEnergyInCore].SetDeltaStat(utils.GenericSocketID, energy)
-			}
+	// the processes are independent, so their energy is set over the collector workers
+	utils.ForEachShard(len(processIDList), config.GetCollectorWorkers(), func(_, start, end int) {
+		for i := start; i < end; i++ {
+			processID := processIDList[i]
+			var energy uint64
+			if errComp == nil {
+				// add PKG power consumption
+				// since Kepler collects metrics at intervals of SamplePeriodSec, which is greater than 1 second, it is necessary to calculate the energy consumption for the entire waiting period
+				energy = processComponentsPower[i].Pkg * config.SamplePeriodSec()
+				if isIdlePower {
+					processesMetrics[processID].EnergyUsage[config.IdleEnergyInPkg].SetDeltaStat(utils.GenericSocketID, energy)
+				} else {
+					processesMetrics[processID].EnergyUsage[config.DynEnergyInPkg].SetDeltaStat(utils.GenericSocketID, energy)
+				}
 
-			// add DRAM power consumption
-			energy = processComponentsPower[i].DRAM * config.SamplePeriodSec()
-			if isIdlePower {
-				processesMetrics[processID].EnergyUsage[config.IdleEnergyInDRAM].SetDeltaStat(utils.GenericSocketID, energy)
-			} else {
-				processesMetrics[processID].EnergyUsage[config.DynEnergyInDRAM].SetDeltaStat(utils.GenericSocketID, energy)
-			}
+				// add CORE power consumption
+				energy = processComponentsPower[i].Core * config.SamplePeriodSec()
+				if isIdlePower {
+					processesMetrics[processID].EnergyUsage[config.IdleEnergyInCore].SetDeltaStat(utils.GenericSocketID, energy)
+				} else {
+					processesMetrics[processID].EnergyUsage[config.DynEnergyInCore].SetDeltaStat(utils.GenericSocketID, energy)
+				}
 
-			// add Uncore power consumption
-			energy = processComponentsPower[i].Uncore * config.SamplePeriodSec()
-			if isIdlePower {
-				processesMetrics[processID].EnergyUsage[config.IdleEnergyInUnCore].SetDeltaStat(utils.GenericSocketID, energy)
-			} else {
-				processesMetrics[processID].EnergyUsage[config.DynEnergyInUnCore].SetDeltaStat(utils.GenericSocketID, energy)
-			}
+				// add DRAM power consumption
+				energy = processComponentsPower[i].DRAM * config.SamplePeriodSec()
+				if isIdlePower {
+					processesMetrics[processID].EnergyUsage[config.IdleEnergyInDRAM].SetDeltaStat(utils.GenericSocketID, energy)
+				} else {
+					processesMetrics[processID].EnergyUsage[config.DynEnergyInDRAM].SetDeltaStat(utils.GenericSocketID, energy)
+				}
 
-			// add GPU power consumption
-			if errGPU == nil {
-				energy = processGPUPower[i] * (config.SamplePeriodSec())
+				// add Uncore power consumption
+				energy = processComponentsPower[i].Uncore * config.SamplePeriodSec()
 				if isIdlePower {
-					processesMetrics[processID].EnergyUsage[config.IdleEnergyInGPU].SetDeltaStat(utils.GenericSocketID, energy)
+					processesMetrics[processID].EnergyUsage[config.IdleEnergyInUnCore].SetDeltaStat(utils.GenericSocketID, energy)
 				} else {
-					processesMetrics[processID].EnergyUsage[config.DynEnergyInGPU].SetDeltaStat(utils.GenericSocketID, energy)
+					processesMetrics[processID].EnergyUsage[config.DynEnergyInUnCore].SetDeltaStat(utils.GenericSocketID, energy)
 				}
-			}
-		}
 
-		if errPlat == nil {
-			energy = processPlatformPower[i] * config.SamplePeriodSec()
-			if isIdlePower {
-				processesMetrics[processID].EnergyUsage[config.IdleEnergyInPlatform].SetDeltaStat(utils.GenericSocketID, energy)
-			} else {
-				processesMetrics[processID].EnergyUsage[config.DynEnergyInPlatform].SetDeltaStat(utils.GenericSocketID, energy)
+				// add GPU power consumption
+				if errGPU == nil {
+					energy = processGPUPower[i] * (config.SamplePeriodSec())
+					if isIdlePower {
+						processesMetrics[processID].EnergyUsage[config.IdleEnergyInGPU].SetDeltaStat(utils.GenericSocketID, energy)
+					} else {
+						processesMetrics[processID].EnergyUsage[config.DynEnergyInGPU].SetDeltaStat(utils.GenericSocketID, energy)
+					}
+				}
 			}
-		}
 
-		// estimate other components power if both platform and components power are available
-		if errComp == nil && errPlat == nil {
-			// TODO: verify if Platform power also includes the GPU into consideration
-			var otherPower uint64
-			if processPlatformPower[i] <= (processComponentsPower[i].Pkg + processComponentsPower[i].DRAM) {
-				otherPower = 0
-			} else {
-				otherPower = processPlatformPower[i] - processComponentsPower[i].Pkg - processComponentsPower[i].DRAM
+			if errPlat == nil {
+				energy = processPlatformPower[i] * config.SamplePeriodSec()
+				if isIdlePower {
+					processesMetrics[processID].EnergyUsage[config.IdleEnergyInPlatform].SetDeltaStat(utils.GenericSocketID, energy)
+				} else {
+					processesMetrics[processID].EnergyUsage[config.DynEnergyInPlatform].SetDeltaStat(utils.GenericSocketID, energy)
+				}
 			}
-			energy = otherPower * config.SamplePeriodSec()
-			if isIdlePower {
-				processesMetrics[processID].EnergyUsage[config.IdleEnergyInOther].SetDeltaStat(utils.GenericSocketID, energy)
-			} else {
-				processesMetrics[processID].EnergyUsage[config.DynEnergyInOther].SetDeltaStat(utils.GenericSocketID, energy)
+
+			// estimate other components power if both platform and components power are available
+			if errComp == nil && errPlat == nil {
+				// TODO: verify if Platform power also includes the GPU into consideration
+				var otherPower uint64
+				if processPlatformPower[i] <= (processComponentsPower[i].Pkg + processComponentsPower[i].DRAM) {
+					otherPower = 0
+				} else {
+					otherPower = processPlatformPower[i] - processComponentsPower[i].Pkg - processComponentsPower[i].DRAM
+				}
+				energy = otherPower * config.SamplePeriodSec()
+				if isIdlePower {
+					processesMetrics[processID].EnergyUsage[config.IdleEnergyInOther].SetDeltaStat(utils.GenericSocketID, energy)
+				} else {
+					processesMetrics[processID].EnergyUsage[config.DynEnergyInOther].SetDeltaStat(utils.GenericSocketID, energy)
+				}
 			}
 		}
-	}
+	})
 }
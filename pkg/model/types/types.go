@@ -98,6 +98,7 @@ type ModelConfig struct {
 	// initial samples to start the model
 	ProcessFeatureNames         []string
 	NodeFeatureNames            []string
+	OptionalNodeFeatureNames    []string // only used by the models that declare them
 	SystemMetaDataFeatureNames  []string
 	SystemMetaDataFeatureValues []string
 }
@@ -0,0 +1,258 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+Package replay records the BPF process samples and the node energy readings of each collection interval to a file,
+and feeds them back to the collector at full speed, so that the userspace pipeline can be benchmarked at production
+scale without root or real hardware.
+
+A recording starts with a header holding the magic string and the software and hardware counters supported by the
+exporter. It is followed by one frame per interval:
+
+	uvarint number of packages, then per package: id, Pkg, Core, Uncore, DRAM energy in mJ
+	uvarint number of processes, then per process: each numeric field of bpf.ProcessMetrics, then the command
+
+All the numbers are uvarints, as most of the counters of a short interval are small or zero, and the strings are
+prefixed by their uvarint length.
+*/
+package replay
+
+import (
+	"bufio"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"sort"
+
+	"github.com/sustainable-computing-io/kepler/pkg/bpf"
+	"github.com/sustainable-computing-io/kepler/pkg/sensors/components/source"
+	"k8s.io/apimachinery/pkg/util/sets"
+)
+
+const magic = "KEPLER-REPLAY-1\n"
+
+// maxStringLen bounds the length of the strings read from a recording, the commands being at most 16 bytes
+const maxStringLen = 4096
+
+// Interval holds the samples collected on one collection interval
+type Interval struct {
+	// NodeEnergy is the absolute energy of each package, nil if the system collection was not supported
+	NodeEnergy map[int]source.NodeComponentsEnergy
+	Processes  []bpf.ProcessMetrics
+}
+
+// Recording is the content of a recording file
+type Recording struct {
+	SupportedMetrics bpf.SupportedMetrics
+	Intervals        []Interval
+}
+
+// Writer appends the intervals to a recording
+type Writer struct {
+	w   *bufio.Writer
+	buf []byte
+}
+
+// NewWriter writes the header of a recording of an exporter supporting the given metrics
+func NewWriter(w io.Writer, supportedMetrics bpf.SupportedMetrics) (*Writer, error) {
+	rw := &Writer{w: bufio.NewWriter(w)}
+	rw.buf = append(rw.buf, magic...)
+	for _, counters := range []sets.Set[string]{supportedMetrics.SoftwareCounters, supportedMetrics.HardwareCounters} {
+		names := sets.List(counters)
+		rw.buf = binary.AppendUvarint(rw.buf, uint64(len(names)))
+		for _, name := range names {
+			rw.appendString(name)
+		}
+	}
+	return rw, rw.flushBuf()
+}
+
+// WriteInterval appends the samples of an interval
+func (rw *Writer) WriteInterval(interval *Interval) error {
+	pkgIDs := make([]int, 0, len(interval.NodeEnergy))
+	for pkgID := range interval.NodeEnergy {
+		pkgIDs = append(pkgIDs, pkgID)
+	}
+	sort.Ints(pkgIDs)
+	rw.buf = binary.AppendUvarint(rw.buf, uint64(len(pkgIDs)))
+	for _, pkgID := range pkgIDs {
+		e := interval.NodeEnergy[pkgID]
+		for _, v := range []uint64{uint64(pkgID), e.Pkg, e.Core, e.Uncore, e.DRAM} {
+			rw.buf = binary.AppendUvarint(rw.buf, v)
+		}
+	}
+	if err := rw.flushBuf(); err != nil {
+		return err
+	}
+
+	rw.buf = binary.AppendUvarint(rw.buf, uint64(len(interval.Processes)))
+	for i := range interval.Processes {
+		p := &interval.Processes[i]
+		for _, v := range []uint64{p.CgroupId, p.AncestorCgroupId, p.Pid, p.ProcessRunTime, p.CpuCycles, p.CpuInstr, p.CacheMiss, p.PageCacheHit} {
+			rw.buf = binary.AppendUvarint(rw.buf, v)
+		}
+		for _, v := range p.VecNr {
+			rw.buf = binary.AppendUvarint(rw.buf, uint64(v))
+		}
+		for _, v := range p.SoftirqTimeNs {
+			rw.buf = binary.AppendUvarint(rw.buf, v)
+		}
+		for _, v := range []uint64{p.BlockIoBytes, p.NetTxBytes, p.NetRxBytes} {
+			rw.buf = binary.AppendUvarint(rw.buf, v)
+		}
+		rw.appendString(p.Comm)
+		if err := rw.flushBuf(); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// Flush writes the buffered intervals to the underlying writer
+func (rw *Writer) Flush() error {
+	return rw.w.Flush()
+}
+
+func (rw *Writer) appendString(s string) {
+	rw.buf = binary.AppendUvarint(rw.buf, uint64(len(s)))
+	rw.buf = append(rw.buf, s...)
+}
+
+func (rw *Writer) flushBuf() error {
+	_, err := rw.w.Write(rw.buf)
+	rw.buf = rw.buf[:0]
+	return err
+}
+
+// Read reads a whole recording
+func Read(r io.Reader) (*Recording, error) {
+	br := bufio.NewReader(r)
+	header := make([]byte, len(magic))
+	if _, err := io.ReadFull(br, header); err != nil || string(header) != magic {
+		return nil, fmt.Errorf("not a replay recording")
+	}
+	rr := &reader{r: br}
+	rec := &Recording{}
+	counters := make([]sets.Set[string], 2)
+	for i := range counters {
+		counters[i] = sets.New[string]()
+		for n := rr.uvarint(); n > 0 && rr.err == nil; n-- {
+			counters[i].Insert(rr.string())
+		}
+	}
+	rec.SupportedMetrics = bpf.SupportedMetrics{SoftwareCounters: counters[0], HardwareCounters: counters[1]}
+
+	for rr.err == nil {
+		if _, err := br.Peek(1); errors.Is(err, io.EOF) {
+			break
+		}
+		rec.Intervals = append(rec.Intervals, rr.interval())
+	}
+	if rr.err != nil {
+		return nil, fmt.Errorf("failed to read interval %d of the recording: %w", len(rec.Intervals), rr.err)
+	}
+	return rec, nil
+}
+
+// ReadFile reads a whole recording file
+func ReadFile(path string) (*Recording, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+	return Read(f)
+}
+
+// reader decodes the values of a recording, keeping the first error
+type reader struct {
+	r   *bufio.Reader
+	err error
+}
+
+func (rr *reader) uvarint() uint64 {
+	if rr.err != nil {
+		return 0
+	}
+	v, err := binary.ReadUvarint(rr.r)
+	if err != nil {
+		if errors.Is(err, io.EOF) {
+			err = io.ErrUnexpectedEOF
+		}
+		rr.err = err
+	}
+	return v
+}
+
+func (rr *reader) string() string {
+	n := rr.uvarint()
+	if rr.err != nil {
+		return ""
+	}
+	if n > maxStringLen {
+		rr.err = fmt.Errorf("string of %d bytes is too long", n)
+		return ""
+	}
+	b := make([]byte, n)
+	if _, err := io.ReadFull(rr.r, b); err != nil {
+		rr.err = io.ErrUnexpectedEOF
+		return ""
+	}
+	return string(b)
+}
+
+func (rr *reader) interval() Interval {
+	var interval Interval
+	if n := rr.uvarint(); n > 0 {
+		interval.NodeEnergy = make(map[int]source.NodeComponentsEnergy, n)
+		for ; n > 0 && rr.err == nil; n-- {
+			pkgID := int(rr.uvarint())
+			interval.NodeEnergy[pkgID] = source.NodeComponentsEnergy{
+				Pkg:    rr.uvarint(),
+				Core:   rr.uvarint(),
+				Uncore: rr.uvarint(),
+				DRAM:   rr.uvarint(),
+			}
+		}
+	}
+
+	n := rr.uvarint()
+	if rr.err != nil {
+		return interval
+	}
+	// do not trust the count for the allocation, a truncated file fails on the first missing value
+	interval.Processes = make([]bpf.ProcessMetrics, 0, min(n, 1<<16))
+	for ; n > 0 && rr.err == nil; n-- {
+		var p bpf.ProcessMetrics
+		for _, v := range []*uint64{&p.CgroupId, &p.AncestorCgroupId, &p.Pid, &p.ProcessRunTime, &p.CpuCycles, &p.CpuInstr, &p.CacheMiss, &p.PageCacheHit} {
+			*v = rr.uvarint()
+		}
+		for i := range p.VecNr {
+			p.VecNr[i] = uint32(rr.uvarint())
+		}
+		for i := range p.SoftirqTimeNs {
+			p.SoftirqTimeNs[i] = rr.uvarint()
+		}
+		for _, v := range []*uint64{&p.BlockIoBytes, &p.NetTxBytes, &p.NetRxBytes} {
+			*v = rr.uvarint()
+		}
+		p.Comm = rr.string()
+		interval.Processes = append(interval.Processes, p)
+	}
+	return interval
+}
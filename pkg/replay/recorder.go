@@ -0,0 +1,90 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package replay
+
+import (
+	"fmt"
+	"os"
+	"sync"
+
+	"github.com/sustainable-computing-io/kepler/pkg/bpf"
+	"github.com/sustainable-computing-io/kepler/pkg/sensors/components"
+	"k8s.io/klog/v2"
+)
+
+// recordingExporter records the processes collected by an exporter, with the node energy read at the same time
+type recordingExporter struct {
+	bpf.Exporter
+
+	mu sync.Mutex
+	f  *os.File
+	w  *Writer
+}
+
+// NewRecordingExporter returns an exporter that records each collection of exporter to the file at path
+func NewRecordingExporter(exporter bpf.Exporter, path string) (bpf.Exporter, error) {
+	f, err := os.Create(path)
+	if err != nil {
+		return nil, fmt.Errorf("failed to create the recording: %w", err)
+	}
+	w, err := NewWriter(f, exporter.SupportedMetrics())
+	if err != nil {
+		f.Close()
+		return nil, fmt.Errorf("failed to write the recording header: %w", err)
+	}
+	klog.Infof("recording the BPF samples to %s", path)
+	return &recordingExporter{Exporter: exporter, f: f, w: w}, nil
+}
+
+func (e *recordingExporter) CollectProcesses() ([]bpf.ProcessMetrics, error) {
+	processes, err := e.Exporter.CollectProcesses()
+	if err != nil {
+		return processes, err
+	}
+	interval := &Interval{Processes: processes}
+	if components.IsSystemCollectionSupported() {
+		interval.NodeEnergy = components.GetAbsEnergyFromNodeComponents()
+	}
+
+	e.mu.Lock()
+	defer e.mu.Unlock()
+	if e.w != nil {
+		if err := e.w.WriteInterval(interval); err != nil {
+			klog.Errorf("failed to record the BPF samples, stopping the recording: %v", err)
+			e.close()
+		}
+	}
+	return processes, nil
+}
+
+func (e *recordingExporter) Detach() {
+	e.mu.Lock()
+	e.close()
+	e.mu.Unlock()
+	e.Exporter.Detach()
+}
+
+func (e *recordingExporter) close() {
+	if e.w == nil {
+		return
+	}
+	if err := e.w.Flush(); err != nil {
+		klog.Errorf("failed to flush the recording: %v", err)
+	}
+	e.f.Close()
+	e.w = nil
+}
@@ -0,0 +1,110 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package replay
+
+import (
+	"bytes"
+	"path/filepath"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+
+	"github.com/sustainable-computing-io/kepler/pkg/bpf"
+	"github.com/sustainable-computing-io/kepler/pkg/config"
+	"github.com/sustainable-computing-io/kepler/pkg/sensors/components/source"
+)
+
+var _ = Describe("Replay", func() {
+	BeforeEach(func() {
+		_, err := config.Initialize(".")
+		Expect(err).NotTo(HaveOccurred())
+	})
+
+	It("reads back the intervals it writes", func() {
+		rec := GenerateRecording(3, 10, 2)
+		rec.Intervals[1].Processes[0].VecNr[bpf.IRQNetRX] = 7
+		rec.Intervals[1].Processes[0].SoftirqTimeNs[bpf.IRQBlock] = 1 << 40
+		rec.Intervals[2].NodeEnergy = nil
+
+		var buf bytes.Buffer
+		w, err := NewWriter(&buf, rec.SupportedMetrics)
+		Expect(err).NotTo(HaveOccurred())
+		for i := range rec.Intervals {
+			Expect(w.WriteInterval(&rec.Intervals[i])).To(Succeed())
+		}
+		Expect(w.Flush()).To(Succeed())
+
+		read, err := Read(&buf)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(read).To(Equal(rec))
+	})
+
+	It("rejects truncated recordings", func() {
+		rec := GenerateRecording(1, 10, 0)
+		var buf bytes.Buffer
+		w, err := NewWriter(&buf, rec.SupportedMetrics)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(w.WriteInterval(&rec.Intervals[0])).To(Succeed())
+		Expect(w.Flush()).To(Succeed())
+
+		_, err = Read(bytes.NewReader(buf.Bytes()[:buf.Len()-3]))
+		Expect(err).To(HaveOccurred())
+		_, err = Read(bytes.NewReader([]byte("not a recording")))
+		Expect(err).To(HaveOccurred())
+	})
+
+	It("records the collections of an exporter", func() {
+		path := filepath.Join(GinkgoT().TempDir(), "kepler.rec")
+		exporter, err := NewRecordingExporter(bpf.NewMockExporter(bpf.DefaultSupportedMetrics()), path)
+		Expect(err).NotTo(HaveOccurred())
+		for i := 0; i < 2; i++ {
+			_, err = exporter.CollectProcesses()
+			Expect(err).NotTo(HaveOccurred())
+		}
+		exporter.Detach()
+
+		rec, err := ReadFile(path)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(rec.Intervals).To(HaveLen(2))
+		Expect(rec.Intervals[0].Processes).To(HaveLen(1))
+		Expect(rec.SupportedMetrics).To(Equal(bpf.DefaultSupportedMetrics()))
+	})
+
+	It("replays the intervals in a loop with increasing node energy", func() {
+		rec := GenerateRecording(2, 5, 1)
+		r, err := NewReplayer(rec)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(r.IsSystemCollectionSupported()).To(BeTrue())
+
+		expected := []source.NodeComponentsEnergy{
+			{},
+			{Pkg: 90000, Core: 60000, Uncore: 5000, DRAM: 15000},
+			// the first interval has no delta
+			{Pkg: 90000, Core: 60000, Uncore: 5000, DRAM: 15000},
+			{Pkg: 180000, Core: 120000, Uncore: 10000, DRAM: 30000},
+		}
+		for i, energy := range expected {
+			processes, err := r.CollectProcesses()
+			Expect(err).NotTo(HaveOccurred())
+			Expect(processes).To(Equal(rec.Intervals[i%2].Processes))
+			Expect(r.GetAbsEnergyFromNodeComponents()).To(Equal(map[int]source.NodeComponentsEnergy{0: energy, 1: energy}))
+			pkg, err := r.GetAbsEnergyFromPackage()
+			Expect(err).NotTo(HaveOccurred())
+			Expect(pkg).To(Equal(2 * energy.Pkg))
+		}
+	})
+})
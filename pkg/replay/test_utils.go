@@ -0,0 +1,73 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package replay
+
+import (
+	"fmt"
+
+	"github.com/sustainable-computing-io/kepler/pkg/bpf"
+	"github.com/sustainable-computing-io/kepler/pkg/sensors/components/source"
+)
+
+// GenerateRecording creates a synthetic recording of intervals with the given number of processes on two packages.
+// On each interval churn processes exit and are replaced by new ones, so that the stats of the collector keep growing
+// and being garbage collected as on a busy node.
+func GenerateRecording(intervals, processes, churn int) *Recording {
+	rec := &Recording{SupportedMetrics: bpf.DefaultSupportedMetrics()}
+	nextPid := uint64(1000)
+	pids := make([]uint64, processes)
+	for i := range pids {
+		pids[i] = nextPid
+		nextPid++
+	}
+	energy := map[int]source.NodeComponentsEnergy{}
+	for i := 0; i < intervals; i++ {
+		if i > 0 {
+			for j := 0; j < churn && processes > 0; j++ {
+				pids[(i*churn+j)%processes] = nextPid
+				nextPid++
+			}
+		}
+		interval := Interval{
+			NodeEnergy: make(map[int]source.NodeComponentsEnergy, 2),
+			Processes:  make([]bpf.ProcessMetrics, processes),
+		}
+		for pkgID := 0; pkgID < 2; pkgID++ {
+			e := energy[pkgID]
+			e.Pkg += 90000
+			e.Core += 60000
+			e.Uncore += 5000
+			e.DRAM += 15000
+			energy[pkgID] = e
+			interval.NodeEnergy[pkgID] = e
+		}
+		for j, pid := range pids {
+			interval.Processes[j] = bpf.ProcessMetrics{
+				CgroupId:       pid%100 + 2,
+				Pid:            pid,
+				ProcessRunTime: 1000 * (pid%50 + 1),
+				CpuCycles:      100000 * (pid%50 + 1),
+				CpuInstr:       200000 * (pid%50 + 1),
+				CacheMiss:      1000 * (pid%50 + 1),
+				PageCacheHit:   pid % 10,
+				Comm:           fmt.Sprintf("proc-%d", pid%1000),
+			}
+		}
+		rec.Intervals = append(rec.Intervals, interval)
+	}
+	return rec
+}
@@ -54,6 +54,22 @@ func InitPowerImpl() {
 		return
 	}
 
+	perfImpl := &source.PowerPerf{}
+	if config.IsRAPLPerfEventsEnabled() && perfImpl.IsSystemCollectionSupported() {
+		klog.V(1).Infoln("use RAPL perf events to obtain power")
+		powerImpl = perfImpl
+		return
+	}
+
+	if interval := config.GetRAPLSampleInterval(); interval > 0 {
+		samplerImpl := source.NewPowerSysfsSampler(interval)
+		if samplerImpl.IsSystemCollectionSupported() {
+			klog.V(1).Infof("use sysfs sampled every %v to obtain power", interval)
+			powerImpl = samplerImpl
+			return
+		}
+	}
+
 	sysfsImpl := &source.PowerSysfs{}
 	if sysfsImpl.IsSystemCollectionSupported() /*&& false*/ {
 		klog.V(1).Infoln("use sysfs to obtain power")
@@ -121,6 +137,12 @@ func SetIsSystemCollectionSupported(enable bool) {
 	enabled = enable
 }
 
+// SetPowerImpl replaces the source of the node components energy, e.g. with a recording replayed by a benchmark.
+func SetPowerImpl(impl powerInterface) {
+	powerImpl = impl
+	enabled = true
+}
+
 func StopPower() {
 	powerImpl.StopPower()
 }
@@ -0,0 +1,278 @@
+//go:build !darwin
+// +build !darwin
+
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package source
+
+import (
+	"fmt"
+	"os"
+	"strconv"
+	"strings"
+	"sync"
+	"unsafe"
+
+	"golang.org/x/sys/unix"
+	"k8s.io/klog/v2"
+)
+
+const (
+	// the RAPL perf PMU, per arch/x86/events/rapl.c
+	powerPMUPath             = "/sys/bus/event_source/devices/power/"
+	cpuPackageIDPathTemplate = "/sys/devices/system/cpu/cpu%d/topology/physical_package_id"
+)
+
+// perfEnergyEvents maps the RAPL events to the names of the power PMU events
+var perfEnergyEvents = map[string]string{
+	packageEvent: "energy-pkg",
+	coreEvent:    "energy-cores",
+	uncoreEvent:  "energy-gpu",
+	dramEvent:    "energy-ram",
+}
+
+// perfEnergyEvent is a power PMU event opened on one CPU of each package, or
+// of each die on multi-die packages
+type perfEnergyEvent struct {
+	fds    []int
+	pkgIDs []int
+	// mJ per count
+	scale float64
+}
+
+// read returns the energy in mJ of each package since the event was opened
+func (e *perfEnergyEvent) read() map[int]uint64 {
+	energy := make(map[int]uint64, len(e.fds))
+	buf := make([]byte, 8)
+	for i, fd := range e.fds {
+		if n, err := unix.Read(fd, buf); err != nil || n != len(buf) {
+			klog.V(3).Infof("failed to read the RAPL perf event of package %d: %v", e.pkgIDs[i], err)
+			continue
+		}
+		energy[e.pkgIDs[i]] += uint64(float64(byteOrder.Uint64(buf)) * e.scale)
+	}
+	return energy
+}
+
+func (e *perfEnergyEvent) close() {
+	for _, fd := range e.fds {
+		unix.Close(fd)
+	}
+}
+
+// PowerPerf reads the RAPL energy counters through the power perf PMU. The
+// kernel keeps the counters 64 bits wide, so they do not wrap like the
+// powercap ones, and a read is one syscall per package instead of an MSR or
+// sysfs file read.
+type PowerPerf struct {
+	once      sync.Once
+	supported bool
+	mu        sync.Mutex
+	events    map[string]*perfEnergyEvent
+}
+
+func (r *PowerPerf) GetName() string {
+	return "rapl-perf"
+}
+
+func (r *PowerPerf) IsSystemCollectionSupported() bool {
+	r.once.Do(func() {
+		events, err := openPerfEnergyEvents()
+		if err != nil {
+			klog.V(3).Infof("RAPL perf events are not available: %v", err)
+			return
+		}
+		r.events = events
+		r.supported = true
+	})
+	return r.supported
+}
+
+func (r *PowerPerf) getEnergy(event string) (uint64, error) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	e, ok := r.events[event]
+	if !ok {
+		return 0, fmt.Errorf("could not read RAPL perf energy for %s", event)
+	}
+	energy := uint64(0)
+	for _, v := range e.read() {
+		energy += v
+	}
+	return energy, nil
+}
+
+func (r *PowerPerf) GetAbsEnergyFromDram() (uint64, error) {
+	return r.getEnergy(dramEvent)
+}
+
+func (r *PowerPerf) GetAbsEnergyFromCore() (uint64, error) {
+	return r.getEnergy(coreEvent)
+}
+
+func (r *PowerPerf) GetAbsEnergyFromUncore() (uint64, error) {
+	return r.getEnergy(uncoreEvent)
+}
+
+func (r *PowerPerf) GetAbsEnergyFromPackage() (uint64, error) {
+	return r.getEnergy(packageEvent)
+}
+
+func (r *PowerPerf) GetAbsEnergyFromNodeComponents() map[int]NodeComponentsEnergy {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	read := func(event string) map[int]uint64 {
+		if e, ok := r.events[event]; ok {
+			return e.read()
+		}
+		return nil
+	}
+
+	coreEnergies := read(coreEvent)
+	dramEnergies := read(dramEvent)
+	uncoreEnergies := read(uncoreEvent)
+	packageEnergies := make(map[int]NodeComponentsEnergy)
+	for pkgID, pkgEnergy := range read(packageEvent) {
+		packageEnergies[pkgID] = NodeComponentsEnergy{
+			Core:   coreEnergies[pkgID],
+			DRAM:   dramEnergies[pkgID],
+			Uncore: uncoreEnergies[pkgID],
+			Pkg:    pkgEnergy,
+		}
+	}
+	return packageEnergies
+}
+
+func (r *PowerPerf) StopPower() {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	for _, e := range r.events {
+		e.close()
+	}
+	r.events = nil
+}
+
+// openPerfEnergyEvents opens the energy events of the power PMU on the CPUs
+// of its cpumask, which has one CPU per package. The package event is required.
+func openPerfEnergyEvents() (map[string]*perfEnergyEvent, error) {
+	pmuType, err := readSysfsUint(powerPMUPath + "type")
+	if err != nil {
+		return nil, err
+	}
+	data, err := os.ReadFile(powerPMUPath + "cpumask")
+	if err != nil {
+		return nil, err
+	}
+	cpus, err := parseCPUList(strings.TrimSpace(string(data)))
+	if err != nil {
+		return nil, err
+	}
+
+	events := map[string]*perfEnergyEvent{}
+	for event, name := range perfEnergyEvents {
+		e, err := openPerfEnergyEvent(uint32(pmuType), name, cpus)
+		if err != nil {
+			if event == packageEvent {
+				for _, opened := range events {
+					opened.close()
+				}
+				return nil, err
+			}
+			klog.V(3).Infof("RAPL perf event %s is not available: %v", name, err)
+			continue
+		}
+		events[event] = e
+	}
+	return events, nil
+}
+
+func openPerfEnergyEvent(pmuType uint32, name string, cpus []int) (*perfEnergyEvent, error) {
+	// e.g. "event=0x02"
+	data, err := os.ReadFile(powerPMUPath + "events/" + name)
+	if err != nil {
+		return nil, err
+	}
+	value, found := strings.CutPrefix(strings.TrimSpace(string(data)), "event=")
+	if !found {
+		return nil, fmt.Errorf("unexpected format of event %s: %q", name, data)
+	}
+	eventConfig, err := strconv.ParseUint(value, 0, 64)
+	if err != nil {
+		return nil, err
+	}
+	// Joules per count, e.g. "2.3283064365386962890625e-10"
+	data, err = os.ReadFile(powerPMUPath + "events/" + name + ".scale")
+	if err != nil {
+		return nil, err
+	}
+	scale, err := strconv.ParseFloat(strings.TrimSpace(string(data)), 64)
+	if err != nil {
+		return nil, err
+	}
+
+	e := &perfEnergyEvent{scale: scale * 1000 /*mJ*/}
+	attr := &unix.PerfEventAttr{
+		Type:   pmuType,
+		Config: eventConfig,
+		Size:   uint32(unsafe.Sizeof(unix.PerfEventAttr{})),
+	}
+	for _, cpu := range cpus {
+		pkgID, err := readSysfsUint(fmt.Sprintf(cpuPackageIDPathTemplate, cpu))
+		if err != nil {
+			e.close()
+			return nil, err
+		}
+		fd, err := unix.PerfEventOpen(attr, -1, cpu, -1, unix.PERF_FLAG_FD_CLOEXEC)
+		if err != nil {
+			e.close()
+			return nil, fmt.Errorf("failed to open perf event %s on cpu %d: %w", name, cpu, err)
+		}
+		e.fds = append(e.fds, fd)
+		e.pkgIDs = append(e.pkgIDs, int(pkgID))
+	}
+	return e, nil
+}
+
+func readSysfsUint(path string) (uint64, error) {
+	data, err := os.ReadFile(path)
+	if err != nil {
+		return 0, err
+	}
+	return strconv.ParseUint(strings.TrimSpace(string(data)), 10, 64)
+}
+
+// parseCPUList parses a list of CPUs such as "0,28" or "0-3"
+func parseCPUList(list string) ([]int, error) {
+	var cpus []int
+	for _, r := range strings.Split(list, ",") {
+		first, last, isRange := strings.Cut(r, "-")
+		start, err := strconv.Atoi(first)
+		if err != nil {
+			return nil, fmt.Errorf("invalid CPU list %q: %w", list, err)
+		}
+		end := start
+		if isRange {
+			if end, err = strconv.Atoi(last); err != nil {
+				return nil, fmt.Errorf("invalid CPU list %q: %w", list, err)
+			}
+		}
+		for cpu := start; cpu <= end; cpu++ {
+			cpus = append(cpus, cpu)
+		}
+	}
+	return cpus, nil
+}
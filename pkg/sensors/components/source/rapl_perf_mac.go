@@ -0,0 +1,56 @@
+//go:build darwin
+// +build darwin
+
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package source
+
+import "fmt"
+
+// PowerPerf is not supported without perf events
+type PowerPerf struct{}
+
+func (r *PowerPerf) GetName() string {
+	return "rapl-perf"
+}
+
+func (r *PowerPerf) IsSystemCollectionSupported() bool {
+	return false
+}
+
+func (r *PowerPerf) GetAbsEnergyFromDram() (uint64, error) {
+	return 0, fmt.Errorf("RAPL perf events are not supported")
+}
+
+func (r *PowerPerf) GetAbsEnergyFromCore() (uint64, error) {
+	return 0, fmt.Errorf("RAPL perf events are not supported")
+}
+
+func (r *PowerPerf) GetAbsEnergyFromUncore() (uint64, error) {
+	return 0, fmt.Errorf("RAPL perf events are not supported")
+}
+
+func (r *PowerPerf) GetAbsEnergyFromPackage() (uint64, error) {
+	return 0, fmt.Errorf("RAPL perf events are not supported")
+}
+
+func (r *PowerPerf) GetAbsEnergyFromNodeComponents() map[int]NodeComponentsEnergy {
+	return nil
+}
+
+func (r *PowerPerf) StopPower() {
+}
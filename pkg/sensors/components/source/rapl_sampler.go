@@ -0,0 +1,284 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package source
+
+import (
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"k8s.io/klog/v2"
+)
+
+// raplDomain is the energy counter of a RAPL powercap zone, kept open by the sampler
+type raplDomain struct {
+	file  *os.File
+	pkgID int
+	// packageEvent, coreEvent, uncoreEvent or dramEvent
+	event string
+	// the value in uJ at which energy_uj wraps to 0, or 0 if unknown
+	maxRange uint64
+	// the last read of energy_uj and the energy since it was opened, in uJ
+	last   uint64
+	energy uint64
+}
+
+// sample reads the counter and accumulates the energy since the last read, across a wrap of the counter
+func (d *raplDomain) sample(buf []byte) error {
+	n, err := d.file.ReadAt(buf, 0)
+	if err != nil && !errors.Is(err, io.EOF) {
+		return err
+	}
+	e, err := parseEnergy(buf[:n])
+	if err != nil {
+		return fmt.Errorf("failed to parse %s: %w", d.file.Name(), err)
+	}
+	switch {
+	case e >= d.last:
+		d.energy += e - d.last
+	case d.maxRange > d.last:
+		d.energy += d.maxRange - d.last + e
+	default:
+		d.energy += e
+	}
+	d.last = e
+	return nil
+}
+
+// PowerSysfsSampler reads the RAPL powercap counters from a goroutine at a
+// fixed interval, so that a collection only loads the last snapshot instead of
+// opening and reading each energy_uj file. The files are opened once, and the
+// wrap of energy_uj at max_energy_range_uj is handled between two samples, so
+// it does not depend on the collection period either.
+type PowerSysfsSampler struct {
+	interval time.Duration
+	// the zone paths of each package, as detected by detectEventPaths
+	paths map[string]map[string]string
+
+	once      sync.Once
+	supported bool
+	domains   []*raplDomain
+	events    map[string]bool
+	// the read buffer of the counters, only used by the sampling goroutine once started
+	buf []byte
+	// the energy in mJ of each package of the last sample, never modified once published
+	snapshot atomic.Pointer[map[int]NodeComponentsEnergy]
+
+	stopOnce sync.Once
+	stop     chan struct{}
+	done     chan struct{}
+}
+
+// NewPowerSysfsSampler returns a sampler of the detected RAPL zones
+func NewPowerSysfsSampler(interval time.Duration) *PowerSysfsSampler {
+	return newPowerSysfsSampler(eventPaths, interval)
+}
+
+func newPowerSysfsSampler(paths map[string]map[string]string, interval time.Duration) *PowerSysfsSampler {
+	return &PowerSysfsSampler{
+		interval: interval,
+		paths:    paths,
+		events:   map[string]bool{},
+		buf:      make([]byte, 32),
+		stop:     make(chan struct{}),
+		done:     make(chan struct{}),
+	}
+}
+
+func (r *PowerSysfsSampler) GetName() string {
+	return "rapl-sysfs"
+}
+
+// IsSystemCollectionSupported opens the counters and starts the sampling on the first call
+func (r *PowerSysfsSampler) IsSystemCollectionSupported() bool {
+	r.once.Do(func() {
+		if err := r.openDomains(); err != nil {
+			klog.V(3).Infof("RAPL sysfs sampler is not available: %v", err)
+			r.closeDomains()
+			return
+		}
+		r.supported = true
+		r.sample()
+		go r.run()
+	})
+	return r.supported
+}
+
+func (r *PowerSysfsSampler) openDomains() error {
+	for packageName, subTree := range r.paths {
+		splits := strings.Split(packageName, "-")
+		pkgID, err := strconv.Atoi(splits[len(splits)-1])
+		if err != nil {
+			return fmt.Errorf("unexpected RAPL package name %q", packageName)
+		}
+		for eventName, path := range subTree {
+			event := raplEventOf(eventName)
+			if event == "" {
+				continue
+			}
+			file, err := os.Open(path + energyFile)
+			if err != nil {
+				return err
+			}
+			d := &raplDomain{file: file, pkgID: pkgID, event: event}
+			if data, err := os.ReadFile(path + energyMaxRangeFile); err == nil {
+				d.maxRange, _ = parseEnergy(data)
+			}
+			r.domains = append(r.domains, d)
+			r.events[event] = true
+		}
+	}
+	if !r.events[packageEvent] {
+		return fmt.Errorf("no RAPL package zone")
+	}
+	// the first read sets the energy to the counter, as it is without the sampler
+	for _, d := range r.domains {
+		if err := d.sample(r.buf); err != nil {
+			return err
+		}
+		d.energy = d.last
+	}
+	return nil
+}
+
+func (r *PowerSysfsSampler) closeDomains() {
+	for _, d := range r.domains {
+		d.file.Close()
+	}
+	r.domains = nil
+}
+
+func (r *PowerSysfsSampler) run() {
+	defer close(r.done)
+	ticker := time.NewTicker(r.interval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-r.stop:
+			return
+		case <-ticker.C:
+			r.sample()
+		}
+	}
+}
+
+// sample reads all the counters and publishes a new snapshot. Only the sampling goroutine calls it once started.
+func (r *PowerSysfsSampler) sample() {
+	energies := make(map[int]NodeComponentsEnergy)
+	for _, d := range r.domains {
+		if err := d.sample(r.buf); err != nil {
+			klog.V(3).Infoln(err)
+		}
+		e := energies[d.pkgID]
+		switch d.event {
+		case packageEvent:
+			e.Pkg = d.energy / 1000 /*mJ*/
+		case coreEvent:
+			e.Core = d.energy / 1000 /*mJ*/
+		case uncoreEvent:
+			e.Uncore = d.energy / 1000 /*mJ*/
+		case dramEvent:
+			e.DRAM = d.energy / 1000 /*mJ*/
+		}
+		energies[d.pkgID] = e
+	}
+	r.snapshot.Store(&energies)
+}
+
+func (r *PowerSysfsSampler) getEnergy(event string, value func(e *NodeComponentsEnergy) uint64) (uint64, error) {
+	if !r.events[event] {
+		return 0, fmt.Errorf("could not read RAPL energy for %s", event)
+	}
+	energy := uint64(0)
+	for _, e := range r.GetAbsEnergyFromNodeComponents() {
+		energy += value(&e)
+	}
+	return energy, nil
+}
+
+func (r *PowerSysfsSampler) GetAbsEnergyFromDram() (uint64, error) {
+	return r.getEnergy(dramEvent, func(e *NodeComponentsEnergy) uint64 { return e.DRAM })
+}
+
+func (r *PowerSysfsSampler) GetAbsEnergyFromCore() (uint64, error) {
+	return r.getEnergy(coreEvent, func(e *NodeComponentsEnergy) uint64 { return e.Core })
+}
+
+func (r *PowerSysfsSampler) GetAbsEnergyFromUncore() (uint64, error) {
+	return r.getEnergy(uncoreEvent, func(e *NodeComponentsEnergy) uint64 { return e.Uncore })
+}
+
+func (r *PowerSysfsSampler) GetAbsEnergyFromPackage() (uint64, error) {
+	return r.getEnergy(packageEvent, func(e *NodeComponentsEnergy) uint64 { return e.Pkg })
+}
+
+// GetAbsEnergyFromNodeComponents returns the last snapshot, which must not be modified
+func (r *PowerSysfsSampler) GetAbsEnergyFromNodeComponents() map[int]NodeComponentsEnergy {
+	if energies := r.snapshot.Load(); energies != nil {
+		return *energies
+	}
+	return map[int]NodeComponentsEnergy{}
+}
+
+func (r *PowerSysfsSampler) StopPower() {
+	r.stopOnce.Do(func() {
+		if !r.supported {
+			return
+		}
+		close(r.stop)
+		<-r.done
+		r.closeDomains()
+	})
+}
+
+// raplEventOf returns the RAPL event of a powercap zone name, e.g. packageEvent for "package-0"
+func raplEventOf(eventName string) string {
+	for _, event := range []string{packageEvent, coreEvent, uncoreEvent, dramEvent} {
+		if strings.HasPrefix(eventName, event) {
+			return event
+		}
+	}
+	return ""
+}
+
+// parseEnergy parses an energy_uj or max_energy_range_uj file without allocating
+func parseEnergy(data []byte) (uint64, error) {
+	value, digits := uint64(0), 0
+	for _, c := range data {
+		if c == '\n' || c == ' ' {
+			if digits > 0 {
+				break
+			}
+			continue
+		}
+		if c < '0' || c > '9' {
+			return 0, fmt.Errorf("invalid energy %q", data)
+		}
+		value = value*10 + uint64(c-'0')
+		digits++
+	}
+	if digits == 0 {
+		return 0, fmt.Errorf("invalid energy %q", data)
+	}
+	return value, nil
+}
@@ -0,0 +1,111 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package source
+
+import (
+	"os"
+	"path/filepath"
+	"strconv"
+	"testing"
+	"time"
+)
+
+func writeZone(t *testing.T, dir string, energyUJ, maxRangeUJ uint64) string {
+	t.Helper()
+	if err := os.MkdirAll(dir, 0o755); err != nil {
+		t.Fatal(err)
+	}
+	setZoneEnergy(t, dir, energyUJ)
+	if err := os.WriteFile(filepath.Join(dir, energyMaxRangeFile), []byte(strconv.FormatUint(maxRangeUJ, 10)+"\n"), 0o644); err != nil {
+		t.Fatal(err)
+	}
+	return dir + "/"
+}
+
+func setZoneEnergy(t *testing.T, dir string, energyUJ uint64) {
+	t.Helper()
+	if err := os.WriteFile(filepath.Join(dir, energyFile), []byte(strconv.FormatUint(energyUJ, 10)+"\n"), 0o644); err != nil {
+		t.Fatal(err)
+	}
+}
+
+func TestPowerSysfsSampler_HandlesWrap(t *testing.T) {
+	root := t.TempDir()
+	pkgDir := filepath.Join(root, "intel-rapl:0")
+	dramDir := filepath.Join(pkgDir, "intel-rapl:0:0")
+	paths := map[string]map[string]string{
+		"package-0": {
+			"package-0": writeZone(t, pkgDir, 1000000, 2000000),
+			"dram":      writeZone(t, dramDir, 5000, 2000000),
+		},
+	}
+
+	// the interval is long enough for the test to drive the sampling
+	r := newPowerSysfsSampler(paths, time.Hour)
+	if !r.IsSystemCollectionSupported() {
+		t.Fatal("expected the sampler to be supported")
+	}
+	defer r.StopPower()
+
+	expectPkg := func(expected uint64) {
+		t.Helper()
+		if e := r.GetAbsEnergyFromNodeComponents()[0].Pkg; e != expected {
+			t.Fatalf("expected %d mJ in the package, got %d", expected, e)
+		}
+	}
+	expectPkg(1000)
+	if e, err := r.GetAbsEnergyFromDram(); err != nil || e != 5 {
+		t.Fatalf("expected 5 mJ in the DRAM, got %d (%v)", e, err)
+	}
+	if _, err := r.GetAbsEnergyFromCore(); err == nil {
+		t.Fatal("expected an error without a core zone")
+	}
+
+	setZoneEnergy(t, pkgDir, 1500000)
+	r.sample()
+	expectPkg(1500)
+
+	// 500000 uJ to the wrap at 2000000 and 500000 uJ after it
+	setZoneEnergy(t, pkgDir, 500000)
+	r.sample()
+	expectPkg(2500)
+}
+
+func TestPowerSysfsSampler_RequiresPackageZone(t *testing.T) {
+	root := t.TempDir()
+	paths := map[string]map[string]string{
+		"package-0": {"dram": writeZone(t, filepath.Join(root, "intel-rapl:0:0"), 5000, 2000000)},
+	}
+	r := newPowerSysfsSampler(paths, time.Hour)
+	if r.IsSystemCollectionSupported() {
+		t.Fatal("expected the sampler not to be supported without a package zone")
+	}
+	r.StopPower()
+}
+
+func TestParseEnergy(t *testing.T) {
+	for input, expected := range map[string]uint64{"0\n": 0, "262143328850\n": 262143328850, "42": 42} {
+		if e, err := parseEnergy([]byte(input)); err != nil || e != expected {
+			t.Errorf("parseEnergy(%q) = %d, %v; expected %d", input, e, err, expected)
+		}
+	}
+	for _, input := range []string{"", "\n", "-1\n", "12a\n"} {
+		if _, err := parseEnergy([]byte(input)); err == nil {
+			t.Errorf("expected parseEnergy(%q) to fail", input)
+		}
+	}
+}
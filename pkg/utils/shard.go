@@ -0,0 +1,50 @@
+/*
+Copyright 2024.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+package utils
+
+import "sync"
+
+// NumShards returns the number of shards ForEachShard splits n items into
+func NumShards(n, workers int) int {
+	if workers > n {
+		workers = n
+	}
+	if workers < 1 {
+		return 1
+	}
+	return workers
+}
+
+// ForEachShard splits [0, n) into NumShards(n, workers) contiguous ranges and calls fn with the index and the bounds
+// of each of them on its own goroutine, returning once all calls have returned. With a single shard fn runs on the
+// calling goroutine.
+func ForEachShard(n, workers int, fn func(shard, start, end int)) {
+	shards := NumShards(n, workers)
+	if shards == 1 {
+		fn(0, 0, n)
+		return
+	}
+	var wg sync.WaitGroup
+	wg.Add(shards)
+	for shard := 0; shard < shards; shard++ {
+		start, end := shard*n/shards, (shard+1)*n/shards
+		go func(shard int) {
+			defer wg.Done()
+			fn(shard, start, end)
+		}(shard)
+	}
+	wg.Wait()
+}
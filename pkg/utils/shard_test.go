@@ -0,0 +1,40 @@
+package utils
+
+import (
+	"sync/atomic"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+var _ = Describe("ForEachShard", func() {
+	It("should cover every item once", func() {
+		for _, workers := range []int{0, 1, 3, 8, 20} {
+			var visits [10]atomic.Int32
+			var maxShard atomic.Int32
+			ForEachShard(len(visits), workers, func(shard, start, end int) {
+				for i := start; i < end; i++ {
+					visits[i].Add(1)
+				}
+				for {
+					if m := maxShard.Load(); int32(shard) <= m || maxShard.CompareAndSwap(m, int32(shard)) {
+						break
+					}
+				}
+			})
+			Expect(int(maxShard.Load())).To(BeNumerically("<", NumShards(len(visits), workers)))
+			for i := range visits {
+				Expect(visits[i].Load()).To(Equal(int32(1)), "item %d with %d workers", i, workers)
+			}
+		}
+	})
+
+	It("should call fn once for no items", func() {
+		calls := 0
+		ForEachShard(0, 4, func(shard, start, end int) {
+			calls++
+			Expect(end).To(Equal(start))
+		})
+		Expect(calls).To(Equal(1))
+	})
+})